@@ -0,0 +1,65 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "auth_pool.h"
+#include "bench.h"
+#include "password_hash.h"
+
+// Authentication benchmarks: what checking one password costs, the time the
+// event loop would lose per login if it hashed inline, and logins checked by
+// the worker pool.
+//
+// Names are "auth/scrypt/<logN>" for one hash at that cost (r = 8, p = 1), and
+// "auth/pool/<threads>" for one login of a batch of 64 through a pool of that
+// many workers, at logN 10, from Submit() to the verdict.
+
+namespace {
+constexpr uint32 kPOOL_LOGINS = 64;
+constexpr uint32 kPOOL_LOG_N = 10;
+
+void BenchScrypt(uint32 logN) {
+    ScryptParams params;
+    params.logN = logN;
+    const uint8 salt[CredentialStore::kSALT_SIZE] = {};
+    std::vector<uint32> scratch;
+    uint8 hash[CredentialStore::kHASH_SIZE];
+    Bench("auth/scrypt/" + std::to_string(logN), 0, [&]() {
+        Scrypt("correct horse battery staple", salt, sizeof(salt), params, hash, sizeof(hash), scratch);
+        g_Sink = g_Sink + hash[0];
+    });
+}
+
+void BenchPool(uint32 threads) {
+    CredentialConfig config;
+    config.path.clear();
+    config.params.logN = kPOOL_LOG_N;
+    std::atomic<uint32> verdicts{0};
+    AuthPool pool{config, threads, kPOOL_LOGINS,
+                  [&verdicts](const AuthRequest&, AuthVerdict) { verdicts.fetch_add(1, std::memory_order_release); }};
+
+    // every name is registered by the first batch, later ones are checked against it
+    BenchBatch("auth/pool/" + std::to_string(threads), 0, kPOOL_LOGINS, [&]() {
+        verdicts.store(0, std::memory_order_relaxed);
+        for (uint32 i = 0; i < kPOOL_LOGINS; i++) {
+            AuthRequest request;
+            request.userName = "user" + std::to_string(i);
+            request.password = "password";
+            pool.Submit(std::move(request));
+        }
+        while (verdicts.load(std::memory_order_acquire) < kPOOL_LOGINS) {
+            std::this_thread::yield();
+        }
+    });
+}
+}  // namespace
+
+void RunAuthBenchmarks() {
+    for (uint32 logN : {10u, 12u, 14u}) {
+        BenchScrypt(logN);
+    }
+    for (uint32 threads : {1u, 2u, 4u}) {
+        BenchPool(threads);
+    }
+}
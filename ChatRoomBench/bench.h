@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "alloc_counter.h"
+#include "common.h"
+
+// Shared helpers of the benchmarks
+//
+// Every benchmark is a named op run through Bench(), which times it, counts
+// the heap allocations it makes, and reports one result line.
+
+// keeps the optimizer from dropping the work being measured
+extern volatile size_t g_Sink;
+
+struct Measurement {
+    uint64 iterations = 0;
+    double nanoseconds = 0;
+    uint64 allocations = 0;
+};
+
+// runs op until at least kMIN_DURATION has passed
+// the clock is read once per batch, batches double in size so that short ops are not dominated by it
+template <typename Op>
+Measurement Measure(Op op) {
+    constexpr std::chrono::milliseconds kMIN_DURATION{200};
+    Measurement m;
+    uint64 batch = 1;
+    uint64 allocationsBefore = AllocationCount();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration elapsed{};
+    do {
+        for (uint64 i = 0; i < batch; i++) {
+            op();
+        }
+        m.iterations += batch;
+        batch *= 2;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < kMIN_DURATION);
+    m.nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    m.allocations = AllocationCount() - allocationsBefore;
+    return m;
+}
+
+// false if name is filtered out on the command line
+bool Selected(const std::string& name);
+
+// print one result, opsPerCall is how many of the named op one call of the measured lambda does
+void Report(const std::string& name, const Measurement& m, double bytesPerOp, uint32 opsPerCall = 1);
+
+// print a result that is not a timing, e.g. a compression ratio
+void ReportValue(const std::string& name, const char* unit, double value);
+
+// measure op under name and report it, unless it is filtered out
+template <typename Op>
+void Bench(const std::string& name, double bytesPerOp, Op op) {
+    if (!Selected(name)) return;
+    Report(name, Measure(op), bytesPerOp);
+}
+
+template <typename Op>
+void BenchBatch(const std::string& name, double bytesPerOp, uint32 opsPerCall, Op op) {
+    if (!Selected(name)) return;
+    Report(name, Measure(op), bytesPerOp, opsPerCall);
+}
+
+// network::Buffer field reads and writes
+void RunBufferBenchmarks();
+
+// message encode/decode for every MessageType, large rosters and broadcast encoding,
+// and the schema generated code against the virtual Serialize it replaced
+void RunMessageBenchmarks();
+
+// room index: join, leave and broadcast fan-out at room sizes from 10 to 100k
+void RunRoomBenchmarks();
+
+// packet compression: ratio and cost on login acks, rosters and chats, with and without the dictionary
+void RunCompressionBenchmarks();
+
+// chat log: append throughput under each sync policy, and the backfill of a joining member
+void RunChatLogBenchmarks();
+
+// chat history: the in-memory ring of each room's chats, and history acks built from it
+void RunHistoryBenchmarks();
+
+// metrics: the cost of recording a packet, and of rendering a scrape
+void RunMetricsBenchmarks();
+
+// logging: a log line on the logging thread and through the writer, against a synchronous fprintf
+void RunLogBenchmarks();
+
+// timers: the heartbeat timing wheel at 1k and 100k connections, against scanning every deadline
+void RunTimerBenchmarks();
+
+// connection table: lookup, churn and iteration of the slot table, against a vector of flagged clients
+void RunSlotBenchmarks();
+
+// authentication: a scrypt hash at several costs, and logins checked by the worker pool
+void RunAuthBenchmarks();
+
+// rate limiting: a connection's limiter, a room's limiter under contention, and finding a room's limiter
+void RunRateBenchmarks();
+
+// pollers: a broadcast to a room's sockets by readiness and sendmsg, against io_uring with the sends batched
+void RunPollerBenchmarks();
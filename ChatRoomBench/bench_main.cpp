@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+#ifdef _WIN32
+// Need to link Ws2_32.lib, for the outbound queues in the broadcast benchmarks
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+
+volatile size_t g_Sink = 0;
+
+namespace {
+enum OutputFormat {
+    kFORMAT_JSON,   // one JSON object per line, for scripts comparing runs
+    kFORMAT_TABLE,  // aligned columns, for reading
+};
+
+OutputFormat g_Format = OutputFormat::kFORMAT_JSON;
+std::vector<std::string> g_Filters;  // run only the benchmarks whose name contains one of these
+}  // namespace
+
+bool Selected(const std::string& name) {
+    if (g_Filters.empty()) return true;
+    for (const std::string& filter : g_Filters) {
+        if (name.find(filter) != std::string::npos) return true;
+    }
+    return false;
+}
+
+void Report(const std::string& name, const Measurement& m, double bytesPerOp, uint32 opsPerCall) {
+    double ops = static_cast<double>(m.iterations) * opsPerCall;
+    double nsPerOp = m.nanoseconds / ops;
+    double bytesPerSecond = bytesPerOp * ops / (m.nanoseconds / 1e9);
+    double allocsPerOp = m.allocations / ops;
+
+    if (g_Format == OutputFormat::kFORMAT_JSON) {
+        printf("{\"name\":\"%s\",\"iterations\":%.0f,\"ns_per_op\":%.3f,\"bytes_per_op\":%.0f,"
+               "\"bytes_per_sec\":%.0f,\"allocs_per_op\":%.3f}\n",
+               name.c_str(), ops, nsPerOp, bytesPerOp, bytesPerSecond, allocsPerOp);
+    } else {
+        printf("%-52s %12.1f ns/op %10.1f MB/s %9.2f allocs/op\n", name.c_str(), nsPerOp,
+               bytesPerSecond / (1024 * 1024), allocsPerOp);
+    }
+}
+
+void ReportValue(const std::string& name, const char* unit, double value) {
+    if (!Selected(name)) return;
+
+    if (g_Format == OutputFormat::kFORMAT_JSON) {
+        printf("{\"name\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}\n", name.c_str(), value, unit);
+    } else {
+        printf("%-52s %12.3f %s\n", name.c_str(), value, unit);
+    }
+}
+
+// usage: ChatRoomBench [--format json|table] [filter...]
+// a filter is a substring of the names to run, e.g. "buffer/" or "S2C_JoinRoomAck"
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IONBF, 0);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* format = argv[++i];
+            if (strcmp(format, "json") == 0) {
+                g_Format = OutputFormat::kFORMAT_JSON;
+            } else if (strcmp(format, "table") == 0) {
+                g_Format = OutputFormat::kFORMAT_TABLE;
+            } else {
+                printf("unknown format '%s', expected json or table\n", format);
+                return 1;
+            }
+        } else {
+            g_Filters.push_back(argv[i]);
+        }
+    }
+
+    RunBufferBenchmarks();
+    RunMessageBenchmarks();
+    RunRoomBenchmarks();
+    RunCompressionBenchmarks();
+    RunChatLogBenchmarks();
+    RunHistoryBenchmarks();
+    RunMetricsBenchmarks();
+    RunLogBenchmarks();
+    RunTimerBenchmarks();
+    RunSlotBenchmarks();
+    RunAuthBenchmarks();
+    RunRateBenchmarks();
+    RunPollerBenchmarks();
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <string>
+
+#include "bench.h"
+#include "buffer.h"
+
+// Buffer benchmarks: one field read or write at a time.
+// A single field takes a few ns, so each measured call does kBATCH of them
+// and the Reset()/Set() that rewinds the buffer is amortized over the batch.
+
+using namespace network;
+
+namespace {
+
+constexpr uint32 kBATCH = 128;
+
+template <typename Write>
+void BenchWrite(const std::string& name, uint32 fieldSize, Write write) {
+    Buffer buf{kBATCH * fieldSize};
+    BenchBatch(name, fieldSize, kBATCH, [&]() {
+        buf.Reset();
+        for (uint32 i = 0; i < kBATCH; i++) {
+            write(buf);
+        }
+        g_Sink = g_Sink + buf.Size();
+    });
+}
+
+// fill a buffer once with kBATCH fields, then read them back on every call
+template <typename Write, typename Read>
+void BenchRead(const std::string& name, uint32 fieldSize, Write write, Read read) {
+    Buffer source{kBATCH * fieldSize};
+    for (uint32 i = 0; i < kBATCH; i++) {
+        write(source);
+    }
+    std::vector<char> bytes(source.ConstData(), source.ConstData() + source.Size());
+
+    Buffer buf{kBATCH * fieldSize};
+    BenchBatch(name, fieldSize, kBATCH, [&]() {
+        buf.Set(bytes.data(), static_cast<uint32>(bytes.size()));
+        for (uint32 i = 0; i < kBATCH; i++) {
+            read(buf);
+        }
+    });
+}
+
+void BenchString(uint32 length) {
+    const std::string str(length, 'x');
+    const std::string suffix = "/" + std::to_string(length);
+    BenchWrite("buffer/WriteString" + suffix, length, [&](Buffer& buf) { buf.WriteString(str, length); });
+    BenchRead(
+        "buffer/ReadString" + suffix, length, [&](Buffer& buf) { buf.WriteString(str, length); },
+        [&](Buffer& buf) { g_Sink = g_Sink + buf.ReadString(length).size(); });
+}
+
+}  // namespace
+
+void RunBufferBenchmarks() {
+    BenchWrite("buffer/WriteUInt32LE", sizeof(uint32), [](Buffer& buf) { buf.WriteUInt32LE(0x01020304); });
+    BenchWrite("buffer/WriteUInt16LE", sizeof(uint16), [](Buffer& buf) { buf.WriteUInt16LE(0x0102); });
+    BenchRead(
+        "buffer/ReadUInt32LE", sizeof(uint32), [](Buffer& buf) { buf.WriteUInt32LE(0x01020304); },
+        [](Buffer& buf) { g_Sink = g_Sink + buf.ReadUInt32LE(); });
+    BenchRead(
+        "buffer/ReadUInt16LE", sizeof(uint16), [](Buffer& buf) { buf.WriteUInt16LE(0x0102); },
+        [](Buffer& buf) { g_Sink = g_Sink + buf.ReadUInt16LE(); });
+    BenchString(16);
+    BenchString(256);
+}
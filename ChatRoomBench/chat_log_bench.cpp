@@ -0,0 +1,108 @@
+#include <stdio.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "chat_log.h"
+#include "frame.h"
+#include "message.h"
+
+// Chat log benchmarks: append throughput of S2C_ChatInRoomNtf records under
+// each sync policy, and the backfill a joining member is sent.
+//
+// Names are "log/append/<chat size>/<none|group|always>", the bytes of an op
+// are the packet's. Group commit syncs on another thread, what is timed is
+// what the appending reactor pays. "log/syncs/..." is the number of syncs per
+// 1000 appends. The logs are written under the system's temp directory.
+
+using namespace network;
+
+namespace {
+
+const std::vector<std::string> kROOM_NAMES = {"graphics", "network", "media", "configuration"};
+
+const char* PolicyName(LogSyncPolicy policy) {
+    switch (policy) {
+        case LogSyncPolicy::kLOG_SYNC_NONE:
+            return "none";
+        case LogSyncPolicy::kLOG_SYNC_GROUP:
+            return "group";
+        case LogSyncPolicy::kLOG_SYNC_ALWAYS:
+            return "always";
+    }
+    return "?";
+}
+
+// small segments, so that rotation is part of what is measured and the disk use stays bounded
+ChatLogConfig MakeConfig(const std::filesystem::path& directory, LogSyncPolicy policy) {
+    ChatLogConfig config;
+    config.directory = directory.string();
+    config.segmentSize = 4 * 1024 * 1024;
+    config.maxSegments = 4;
+    config.syncPolicy = policy;
+    return config;
+}
+
+void BenchAppend(const std::filesystem::path& directory, size_t chatSize, LogSyncPolicy policy) {
+    std::string name = "log/append/" + std::to_string(chatSize) + "/" + PolicyName(policy);
+    if (!Selected(name)) return;
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    FramePtr frame = Frame::Encode(S2C_ChatInRoomNtfMsg{"network", "alice", std::string(chatSize, 'x'), 1});
+    ChatLog log{kROOM_NAMES, MakeConfig(directory, policy)};
+    if (!log.IsOpen()) {
+        printf("%s cannot open the log in %s\n", name.c_str(), directory.string().c_str());
+        return;
+    }
+
+    Measurement m = Measure([&]() { g_Sink = g_Sink + log.Append("network", frame->Data(), frame->Size()); });
+    Report(name, m, frame->Size());
+    ChatLogStats stats = log.TakeStats();
+    if (stats.appends > 0) {
+        ReportValue("log/syncs/" + std::to_string(chatSize) + "/" + PolicyName(policy), "per 1k appends",
+                    stats.syncs * 1000.0 / stats.appends);
+    }
+}
+
+void BenchRecent(const std::filesystem::path& directory, uint32 count) {
+    std::string name = "log/recent/" + std::to_string(count);
+    if (!Selected(name)) return;
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    ChatLogConfig config = MakeConfig(directory, LogSyncPolicy::kLOG_SYNC_NONE);
+    config.recentRecords = count;
+    ChatLog log{kROOM_NAMES, config};
+    FramePtr frame = Frame::Encode(S2C_ChatInRoomNtfMsg{"network", "alice", std::string(64, 'x'), 1});
+    for (uint32 i = 0; i < count; i++) {
+        log.Append("network", frame->Data(), frame->Size());
+    }
+
+    std::vector<FramePtr> frames;
+    Bench(name, static_cast<double>(frame->Size()) * count, [&]() {
+        log.Recent("network", count, frames);
+        g_Sink = g_Sink + frames.size();
+    });
+}
+
+}  // namespace
+
+void RunChatLogBenchmarks() {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "ChatRoomBench_chatlog";
+
+    const size_t chatSizes[] = {64, 512, 4096};
+    const LogSyncPolicy policies[] = {LogSyncPolicy::kLOG_SYNC_NONE, LogSyncPolicy::kLOG_SYNC_GROUP,
+                                      LogSyncPolicy::kLOG_SYNC_ALWAYS};
+    for (size_t chatSize : chatSizes) {
+        for (LogSyncPolicy policy : policies) {
+            BenchAppend(directory, chatSize, policy);
+        }
+    }
+    BenchRecent(directory, 20);
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+}
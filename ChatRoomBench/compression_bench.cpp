@@ -0,0 +1,105 @@
+#include <stdio.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "compression.h"
+#include "frame.h"
+#include "message.h"
+
+// Compression benchmarks: the packets compression is for (login acks, rosters,
+// long chats) through the server's PacketCompressor and the client's
+// DecompressPacket, with and without the room name dictionary.
+//
+// Names are "<compress|decompress>/<message>/<size>/<lz4|lz4_dict>", the bytes
+// of an op are the uncompressed packet's. "ratio/..." is the packet's size
+// over its compressed size.
+
+using namespace network;
+
+namespace {
+
+// the server's rooms, what the dictionary is built from
+const std::vector<std::string> kROOM_NAMES = {"graphics", "network", "media", "configuration"};
+
+std::vector<std::string> MakeNames(const std::string& prefix, size_t count) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; i++) {
+        names.push_back(prefix + std::to_string(i));
+    }
+    return names;
+}
+
+// words drawn from a small vocabulary, closer to a real chat than random bytes or one repeated letter
+std::string MakeChat(size_t size) {
+    static const char* kWORDS[] = {"the",    "server", "room",  "packet", "is",    "we",      "latency", "and",
+                                   "client", "to",     "a",     "join",   "build", "network", "it",      "fast",
+                                   "send",   "of",     "queue", "today",  "test",  "works",   "slow",    "why"};
+    std::mt19937 random{42};
+    std::uniform_int_distribution<size_t> pick(0, sizeof(kWORDS) / sizeof(kWORDS[0]) - 1);
+    std::string chat;
+    while (chat.size() < size) {
+        chat += kWORDS[pick(random)];
+        chat += ' ';
+    }
+    chat.resize(size);
+    return chat;
+}
+
+void BenchCodec(const std::string& name, const FramePtr& frame, bool useDictionary) {
+    std::string dictionary = BuildDictionary(kROOM_NAMES);
+    PacketCompressor compressor{dictionary, 0};
+    std::string suffix = useDictionary ? "/lz4_dict" : "/lz4";
+    double packetSize = frame->Size();
+
+    FramePtr compressed = compressor.Compress(*frame, useDictionary);
+    if (!compressed) {
+        ReportValue("ratio/" + name + suffix, "x", 1.0);
+        return;
+    }
+    ReportValue("ratio/" + name + suffix, "x", packetSize / compressed->Size());
+
+    Bench("compress/" + name + suffix, packetSize,
+          [&]() { g_Sink = g_Sink + compressor.Compress(*frame, useDictionary)->Size(); });
+
+    S2C_CompressedView msg;
+    if (!Decode(compressed->Data() + sizeof(PacketHeader), compressed->Size() - sizeof(PacketHeader), msg)) {
+        printf("%s does not decode\n", name.c_str());
+        return;
+    }
+    std::vector<char> packet;
+    if (!DecompressPacket(msg, dictionary, packet) || packet.size() != frame->Size()) {
+        printf("%s does not decompress\n", name.c_str());
+        return;
+    }
+    Bench("decompress/" + name + suffix, packetSize, [&]() {
+        g_Sink = g_Sink + DecompressPacket(msg, dictionary, packet);
+    });
+}
+
+void BenchBoth(const std::string& name, const FramePtr& frame) {
+    BenchCodec(name, frame, false);
+    BenchCodec(name, frame, true);
+}
+
+}  // namespace
+
+void RunCompressionBenchmarks() {
+    BenchBoth("S2C_LoginAck/4", Frame::Encode(S2C_LoginAckMsg{kSUCCESS, kROOM_NAMES, kFEATURE_LZ4, std::string{}}));
+    BenchBoth("S2C_LoginAck/100",
+              Frame::Encode(S2C_LoginAckMsg{kSUCCESS, MakeNames("room", 100), kFEATURE_LZ4, std::string{}}));
+
+    const size_t rosterSizes[] = {10, 100, 1000, 10000};
+    for (size_t userCount : rosterSizes) {
+        S2C_JoinRoomAckMsg msg{kSUCCESS, "network", MakeNames("user", userCount), {}, 1, kROSTER_PAGE, 0};
+        BenchBoth("S2C_JoinRoomAck/" + std::to_string(userCount), Frame::Encode(msg));
+    }
+
+    const size_t chatSizes[] = {64, 256, 1024, 4096};
+    for (size_t chatSize : chatSizes) {
+        S2C_ChatInRoomNtfMsg msg{"network", "alice", MakeChat(chatSize), 1};
+        BenchBoth("S2C_ChatInRoomNtf/" + std::to_string(chatSize), Frame::Encode(msg));
+    }
+}
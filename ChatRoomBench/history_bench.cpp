@@ -0,0 +1,82 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "chat_history.h"
+#include "frame.h"
+#include "message.h"
+
+// History benchmarks: numbering and keeping a chat in the room's ring, and
+// building the S2C_HistoryAck for a fetch from the kept frames against
+// encoding every chat again.
+//
+// Names are "history/append" and "history/fetch/<chats>/<ring|reencode>", the
+// bytes of an op are the packet's.
+
+using namespace network;
+
+namespace {
+
+const std::vector<std::string> kROOM_NAMES = {"graphics", "network", "media", "configuration"};
+const std::string kCHAT = "hello everyone, this is a chat message of a typical length.";
+constexpr uint32 kCAPACITY = 256;
+
+void BenchAppend() {
+    ChatHistory history{kROOM_NAMES, kCAPACITY};
+    FramePtr frame = history.Append("network", "alice", kCHAT);
+    Bench("history/append", frame->Size(),
+          [&]() { g_Sink = g_Sink + history.Append("network", "alice", kCHAT)->Size(); });
+}
+
+void BenchFetch(uint32 count) {
+    ChatHistory history{kROOM_NAMES, kCAPACITY};
+    std::vector<std::string> chats;
+    for (uint32 i = 0; i < kCAPACITY; i++) {
+        chats.push_back(kCHAT + " " + std::to_string(i));
+        history.Append("network", "alice", chats.back());
+    }
+
+    std::vector<FramePtr> frames;
+    std::vector<std::string_view> packets;
+    uint32 oldestSeq, newestSeq;
+    history.Fetch("network", 0, count, frames, oldestSeq, newestSeq);
+    for (const FramePtr& frame : frames) {
+        packets.emplace_back(frame->Data(), frame->Size());
+    }
+    uint32 packetSize = PacketSize(S2C_HistoryAckGather{kSUCCESS, "network", oldestSeq, newestSeq, packets});
+    std::string prefix = "history/fetch/" + std::to_string(count);
+
+    // what the server does: the frames of the chats, copied into the ack as they are
+    Bench(prefix + "/ring", packetSize, [&]() {
+        history.Fetch("network", 0, count, frames, oldestSeq, newestSeq);
+        S2C_HistoryAckGather msg{kSUCCESS, "network", oldestSeq, newestSeq, {}};
+        msg.packets.swap(packets);
+        msg.packets.clear();
+        for (const FramePtr& frame : frames) {
+            msg.packets.emplace_back(frame->Data(), frame->Size());
+        }
+        g_Sink = g_Sink + Frame::Encode(msg)->Size();
+        msg.packets.swap(packets);
+    });
+
+    // keeping the chats as text, every chat encoded again for every fetch
+    Bench(prefix + "/reencode", packetSize, [&]() {
+        S2C_HistoryAckMsg msg{kSUCCESS, "network", oldestSeq, newestSeq, {}};
+        for (uint32 i = kCAPACITY - count; i < kCAPACITY; i++) {
+            std::vector<uint8> ntf = Encode(S2C_ChatInRoomNtfView{"network", "alice", chats[i], i + 1});
+            msg.packets.emplace_back(ntf.begin(), ntf.end());
+        }
+        g_Sink = g_Sink + Frame::Encode(msg)->Size();
+    });
+}
+
+}  // namespace
+
+void RunHistoryBenchmarks() {
+    BenchAppend();
+
+    const uint32 fetchCounts[] = {20, 100, 256};
+    for (uint32 count : fetchCounts) {
+        BenchFetch(count);
+    }
+}
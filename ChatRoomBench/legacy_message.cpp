@@ -0,0 +1,105 @@
+#include "legacy_message.h"
+
+namespace legacy {
+
+void Message::Serialize(network::Buffer& buf) {
+    buf.Reset();
+    buf.WriteUInt32LE(header.packetSize);
+    buf.WriteUInt32LE(header.messageType);
+}
+
+// JoinRoom ack message
+S2C_JoinRoomAckMsg::S2C_JoinRoomAckMsg(uint16 iStatus, const std::string& strRoomName,
+                                       const std::vector<std::string>& vecUserNames)
+    : joinStatus(iStatus), roomName(strRoomName) {
+    roomNameLength = strRoomName.size();
+    userListLength = vecUserNames.size();
+    for (const std::string& userName : vecUserNames) {
+        userNameLengths.push_back(userName.size());
+        userNames.push_back(userName);
+    }
+
+    header.messageType = 1004;
+    header.packetSize = sizeof(PacketHeader);
+    header.packetSize += sizeof(joinStatus);
+    header.packetSize += sizeof(roomNameLength) + roomNameLength;
+    header.packetSize += sizeof(userListLength);
+    header.packetSize += sizeof(uint32_t) * userNameLengths.size();
+    for (uint32_t len : userNameLengths) {
+        header.packetSize += len;
+    }
+}
+
+void S2C_JoinRoomAckMsg::Serialize(network::Buffer& buf) {
+    Message::Serialize(buf);
+
+    buf.WriteUInt16LE(joinStatus);
+    buf.WriteUInt32LE(roomNameLength);
+    buf.WriteString(roomName, roomNameLength);
+    buf.WriteUInt32LE(userListLength);
+    for (size_t i = 0; i < userListLength; i++) {
+        buf.WriteUInt32LE(userNameLengths[i]);
+    }
+    for (size_t i = 0; i < userListLength; i++) {
+        buf.WriteString(userNames[i], userNameLengths[i]);
+    }
+}
+
+// C2S_ChatInRoomReqMsg
+C2S_ChatInRoomReqMsg::C2S_ChatInRoomReqMsg(const std::string& strRoomName, const std::string& strUserName,
+                                           const std::string& strChat)
+    : roomName(strRoomName), userName(strUserName), chat(strChat) {
+    roomNameLength = strRoomName.size();
+    userNameLength = strUserName.size();
+    chatLength = strChat.size();
+
+    header.messageType = 1009;
+    header.packetSize = sizeof(PacketHeader);
+    header.packetSize += sizeof(roomNameLength) + roomNameLength;
+    header.packetSize += sizeof(userNameLength) + userNameLength;
+    header.packetSize += sizeof(chatLength) + chatLength;
+}
+
+void C2S_ChatInRoomReqMsg::Serialize(network::Buffer& buf) {
+    Message::Serialize(buf);
+
+    buf.WriteUInt32LE(roomNameLength);
+    buf.WriteString(roomName, roomNameLength);
+    buf.WriteUInt32LE(userNameLength);
+    buf.WriteString(userName, userNameLength);
+    buf.WriteUInt32LE(chatLength);
+    buf.WriteString(chat, chatLength);
+}
+
+// S2C_ChatInRoomNtfMsg
+S2C_ChatInRoomNtfMsg::S2C_ChatInRoomNtfMsg(const std::string& strRoomName, const std::string& strUserName,
+                                           const std::string& strChat)
+    : roomName(strRoomName), userName(strUserName), chat(strChat) {
+    roomNameLength = strRoomName.size();
+    userNameLength = strUserName.size();
+    chatLength = strChat.size();
+
+    header.messageType = 1011;
+    header.packetSize = sizeof(PacketHeader);
+    header.packetSize += sizeof(roomNameLength) + roomNameLength;
+    header.packetSize += sizeof(userNameLength) + userNameLength;
+    header.packetSize += sizeof(chatLength) + chatLength;
+}
+
+void S2C_ChatInRoomNtfMsg::Serialize(network::Buffer& buf) {
+    Message::Serialize(buf);
+
+    buf.WriteUInt32LE(roomNameLength);
+    buf.WriteString(roomName, roomNameLength);
+    buf.WriteUInt32LE(userNameLength);
+    buf.WriteString(userName, userNameLength);
+    buf.WriteUInt32LE(chatLength);
+    buf.WriteString(chat, chatLength);
+}
+
+std::vector<uint8> Encode(Message& msg) {
+    network::Buffer buf{msg.header.packetSize};
+    msg.Serialize(buf);
+    return buf.Detach();
+}
+}  // namespace legacy
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "common.h"
+
+// The hand written messages the schema in message.h replaced, a few of them
+// kept to benchmark against: each has its packetSize arithmetic in the
+// constructor and serializes through a virtual call into a network::Buffer.
+namespace legacy {
+struct PacketHeader {
+    uint32 packetSize;
+    uint32 messageType;
+};
+
+// the Message (aka. protocol) base class
+struct Message {
+    PacketHeader header;
+    virtual void Serialize(network::Buffer& buf);
+};
+
+// JoinRoom ack message
+struct S2C_JoinRoomAckMsg : public Message {
+    uint16 joinStatus;
+    uint32 roomNameLength;
+    std::string roomName;
+    uint32 userListLength;
+    std::vector<uint32> userNameLengths;
+    std::vector<std::string> userNames;
+
+    S2C_JoinRoomAckMsg(uint16 iStatus, const std::string& strRoomName, const std::vector<std::string>& vecUserNames);
+    void Serialize(network::Buffer& buf) override;
+};
+
+// ChatInRoom req message
+struct C2S_ChatInRoomReqMsg : public Message {
+    uint32 roomNameLength;
+    std::string roomName;
+    uint32 userNameLength;
+    std::string userName;
+    uint32 chatLength;
+    std::string chat;
+
+    C2S_ChatInRoomReqMsg(const std::string& strRoomName, const std::string& strUserName, const std::string& strChat);
+    void Serialize(network::Buffer& buf) override;
+};
+
+// ChatInRoom ntf message
+struct S2C_ChatInRoomNtfMsg : public Message {
+    uint32 roomNameLength;
+    std::string roomName;
+    uint32 userNameLength;
+    std::string userName;
+    uint32 chatLength;
+    std::string chat;
+
+    S2C_ChatInRoomNtfMsg(const std::string& strRoomName, const std::string& strUserName, const std::string& strChat);
+    void Serialize(network::Buffer& buf) override;
+};
+
+// what the old Frame::Encode() did: serialize into a Buffer sized from the header, then take its bytes
+std::vector<uint8> Encode(Message& msg);
+}  // namespace legacy
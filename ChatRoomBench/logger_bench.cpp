@@ -0,0 +1,100 @@
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+
+#include "bench.h"
+#include "logger.h"
+
+// Logging benchmarks: what a log line costs the thread that logs it, against
+// the synchronous fprintf the server used to do, and what it costs when its
+// level is off.
+//
+// Names are "logger/<disabled|caller|end_to_end|fprintf|fprintf_flush>", the
+// bytes are a formatted line's.
+//
+// "logger/caller" times only the logging calls, the writer thread is flushed
+// between batches so no record is dropped. "logger/end_to_end" includes that
+// flush, so it is the rate the writer keeps up with.
+
+namespace {
+constexpr uint32 kBATCH = 1024;  // below Logger::kQUEUE_RECORDS
+
+const std::string kUSER = "some_user_name";
+const std::string kROOM = "general";
+const std::string kCHAT = "a chat line of a typical length, not long and not short";
+
+void LogChat(uint64 i) { LOG_INFO("'%s' - #%s: %s. (%llu)", kUSER, kROOM, kCHAT, i); }
+
+void BenchDisabled() {
+    Logger::Instance().SetLevel(kLOG_INFO);
+    uint64 i = 0;
+    Bench("logger/disabled", 0, [&]() { LOG_DEBUG("'%s' - #%s: %s. (%llu)", kUSER, kROOM, kCHAT, i++); });
+}
+
+void BenchCaller(double lineBytes) {
+    if (!Selected("logger/caller")) return;
+
+    Logger& logger = Logger::Instance();
+    Measurement m;
+    uint64 allocationsBefore = AllocationCount();
+    uint64 i = 0;
+    while (m.nanoseconds < 200e6) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint32 j = 0; j < kBATCH; j++) {
+            LogChat(i++);
+        }
+        m.nanoseconds +=
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        m.iterations += kBATCH;
+        logger.Flush();
+    }
+    m.allocations = AllocationCount() - allocationsBefore;
+    Report("logger/caller", m, lineBytes);
+}
+
+void BenchEndToEnd(double lineBytes) {
+    uint64 i = 0;
+    BenchBatch("logger/end_to_end", lineBytes, kBATCH, [&]() {
+        for (uint32 j = 0; j < kBATCH; j++) {
+            LogChat(i++);
+        }
+        Logger::Instance().Flush();
+    });
+}
+
+// what the server did before, fully buffered, and flushed per line as a terminal is
+void BenchFprintf(FILE* file, double lineBytes) {
+    uint64 i = 0;
+    Bench("logger/fprintf", lineBytes, [&]() {
+        fprintf(file, "'%s' - #%s: %s. (%llu)\n", kUSER.c_str(), kROOM.c_str(), kCHAT.c_str(),
+                static_cast<unsigned long long>(i++));
+    });
+    Bench("logger/fprintf_flush", lineBytes, [&]() {
+        fprintf(file, "'%s' - #%s: %s. (%llu)\n", kUSER.c_str(), kROOM.c_str(), kCHAT.c_str(),
+                static_cast<unsigned long long>(i++));
+        fflush(file);
+    });
+}
+}  // namespace
+
+void RunLogBenchmarks() {
+    FILE* file = tmpfile();
+    if (file == nullptr) return;
+
+    Logger& logger = Logger::Instance();
+    logger.SetOutput(file);
+    uint64 droppedBefore = logger.Dropped();
+
+    double lineBytes =
+        snprintf(nullptr, 0, "'%s' - #%s: %s. (%llu)\n", kUSER.c_str(), kROOM.c_str(), kCHAT.c_str(), 0ull);
+
+    BenchDisabled();
+    BenchCaller(lineBytes);
+    BenchEndToEnd(lineBytes);
+    BenchFprintf(file, lineBytes);
+    ReportValue("logger/dropped", "records", static_cast<double>(logger.Dropped() - droppedBefore));
+
+    logger.SetOutput(stdout);
+    fclose(file);
+}
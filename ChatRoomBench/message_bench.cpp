@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "buffer.h"
+#include "frame.h"
+#include "legacy_message.h"
+#include "message.h"
+#include "outbound_queue.h"
+
+// Message benchmarks: encode and decode of every MessageType through the
+// schema in message.h, large rosters, broadcast encoding, and the virtual
+// Serialize / Buffer::ReadString code the schema replaced.
+//
+// Names are "<encode|decode|broadcast|frame>/<message>[/<size>]/<path>", the
+// bytes of an op are the packet's.
+
+using namespace network;
+
+namespace {
+
+const std::string kROOM = "network";
+const std::string kUSER = "alice";
+const std::string kPASSWORD = "correct horse battery staple";
+const std::string kCHAT = "hello everyone, this is a chat message of a typical length.";
+
+std::vector<std::string> MakeNames(size_t count) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; i++) {
+        names.push_back("user" + std::to_string(i));
+    }
+    return names;
+}
+
+// the schema must produce the same bytes as the code it replaced, up to where the legacy message ends
+// (the messages have grown fields since), the packet size aside
+bool SameLeadingFields(const std::vector<uint8>& legacy, const std::vector<uint8>& schema) {
+    return legacy.size() <= schema.size() &&
+           memcmp(legacy.data() + sizeof(uint32), schema.data() + sizeof(uint32), legacy.size() - sizeof(uint32)) == 0;
+}
+
+// encode and decode one message as a Msg and as a View
+// the View is decoded from the Msg's packet, so both encode the same bytes
+template <template <typename> class Message>
+void BenchMessage(const std::string& name, const Message<OwnedFields>& msg) {
+    std::vector<uint8> packet = Encode(msg);
+    const char* body = reinterpret_cast<const char*>(packet.data()) + sizeof(PacketHeader);
+    uint32 bodySize = static_cast<uint32>(packet.size() - sizeof(PacketHeader));
+    uint32 packetSize = static_cast<uint32>(packet.size());
+
+    Message<ViewFields> view;
+    if (!Decode(body, bodySize, view)) {
+        printf("%s does not decode\n", name.c_str());
+        return;
+    }
+
+    Bench("encode/" + name + "/msg", packetSize, [&]() { g_Sink = g_Sink + Encode(msg).size(); });
+    Bench("encode/" + name + "/view", packetSize, [&]() { g_Sink = g_Sink + Encode(view).size(); });
+    // into a reused buffer, what's left once allocation is out of the picture
+    std::vector<uint8> out(packetSize);
+    Bench("encode/" + name + "/in_place", packetSize, [&]() {
+        EncodeInto(view, PacketSize(view), out.data());
+        g_Sink = g_Sink + out[packetSize - 1];
+    });
+
+    Bench("decode/" + name + "/msg", packetSize, [&]() {
+        Message<OwnedFields> decoded;
+        g_Sink = g_Sink + Decode(body, bodySize, decoded);
+    });
+    Bench("decode/" + name + "/view", packetSize, [&]() {
+        Message<ViewFields> decoded;
+        g_Sink = g_Sink + Decode(body, bodySize, decoded);
+    });
+}
+
+void BenchEveryMessage() {
+    std::vector<std::string> roomNames = {"graphics", "network", "physics", "sound"};
+    std::vector<std::string> userNames = MakeNames(10);
+
+    BenchMessage<LoginReq>("C2S_LoginReq", C2S_LoginReqMsg{kUSER, kPASSWORD, kFEATURE_LZ4});
+    BenchMessage<LoginAck>("S2C_LoginAck", S2C_LoginAckMsg{kSUCCESS, roomNames, kFEATURE_LZ4, std::string{}});
+    BenchMessage<JoinRoomReq>("C2S_JoinRoomReq", C2S_JoinRoomReqMsg{kUSER, kROOM, 42});
+    BenchMessage<JoinRoomAck>("S2C_JoinRoomAck",
+                              S2C_JoinRoomAckMsg{kSUCCESS, kROOM, userNames, {}, 42, kROSTER_PAGE, 0});
+    BenchMessage<JoinRoomNtf>("S2C_JoinRoomNtf", S2C_JoinRoomNtfMsg{kROOM, kUSER, 42});
+    BenchMessage<LeaveRoomReq>("C2S_LeaveRoomReq", C2S_LeaveRoomReqMsg{kROOM, kUSER});
+    BenchMessage<LeaveRoomAck>("S2C_LeaveRoomAck", S2C_LeaveRoomAckMsg{kSUCCESS, kROOM, kUSER});
+    BenchMessage<LeaveRoomNtf>("S2C_LeaveRoomNtf", S2C_LeaveRoomNtfMsg{kROOM, kUSER, 43});
+    BenchMessage<ChatInRoomReq>("C2S_ChatInRoomReq", C2S_ChatInRoomReqMsg{kROOM, kUSER, kCHAT});
+    BenchMessage<ChatInRoomAck>("S2C_ChatInRoomAck", S2C_ChatInRoomAckMsg{kSUCCESS, kROOM, kUSER});
+    BenchMessage<ChatInRoomNtf>("S2C_ChatInRoomNtf", S2C_ChatInRoomNtfMsg{kROOM, kUSER, kCHAT, 42});
+    BenchMessage<RosterReq>("C2S_RosterReq", C2S_RosterReqMsg{kROOM, 42, 0});
+    BenchMessage<RosterAck>("S2C_RosterAck",
+                            S2C_RosterAckMsg{kSUCCESS, kROOM, {"user10"}, {"user3"}, 44, kROSTER_DELTA, 0});
+    BenchMessage<HistoryReq>("C2S_HistoryReq", C2S_HistoryReqMsg{kROOM, 0, 20});
+
+    std::vector<std::string> chats;
+    for (int i = 0; i < 8; i++) {
+        std::vector<uint8> chat = Encode(C2S_ChatInRoomReqMsg{kROOM, kUSER, kCHAT});
+        chats.emplace_back(chat.begin(), chat.end());
+    }
+    BenchMessage<BatchReq>("C2S_BatchReq/8", C2S_BatchReqMsg{chats});
+
+    std::vector<std::string> ntfs;
+    for (uint32 seq = 1; seq <= 8; seq++) {
+        std::vector<uint8> ntf = Encode(S2C_ChatInRoomNtfMsg{kROOM, kUSER, kCHAT, seq});
+        ntfs.emplace_back(ntf.begin(), ntf.end());
+    }
+    BenchMessage<HistoryAck>("S2C_HistoryAck/8", S2C_HistoryAckMsg{kSUCCESS, kROOM, 1, 8, ntfs});
+}
+
+// the roster sent to whoever joins a room grows with the room
+void BenchLargeRoster(size_t userCount) {
+    std::vector<std::string> userNames = MakeNames(userCount);
+    S2C_JoinRoomAckMsg msg{kSUCCESS, kROOM, userNames, {}, 1, kROSTER_PAGE, 0};
+    std::string name = "S2C_JoinRoomAck/" + std::to_string(userCount);
+    BenchMessage<JoinRoomAck>(name, msg);
+
+    legacy::S2C_JoinRoomAckMsg legacyMsg{kSUCCESS, kROOM, userNames};
+    if (!SameLeadingFields(legacy::Encode(legacyMsg), Encode(msg))) {
+        printf("%s encodings differ\n", name.c_str());
+    }
+    uint32 packetSize = PacketSize(msg);
+    // both build the message from names the server already has, the legacy constructor copies them
+    Bench("encode/" + name + "/virtual", packetSize, [&]() {
+        legacy::S2C_JoinRoomAckMsg copy{kSUCCESS, kROOM, userNames};
+        g_Sink = g_Sink + legacy::Encode(copy).size();
+    });
+    Bench("encode/" + name + "/msg_copy", packetSize, [&]() {
+        S2C_JoinRoomAckMsg copy{kSUCCESS, kROOM, userNames, {}, 1, kROSTER_PAGE, 0};
+        g_Sink = g_Sink + Encode(copy).size();
+    });
+}
+
+// the paths the schema replaced, on the hottest messages
+void BenchLegacy() {
+    legacy::S2C_ChatInRoomNtfMsg legacyNtf{kROOM, kUSER, kCHAT};
+    S2C_ChatInRoomNtfView ntf{kROOM, kUSER, kCHAT, 1};
+    if (!SameLeadingFields(legacy::Encode(legacyNtf), Encode(ntf))) {
+        printf("S2C_ChatInRoomNtf encodings differ\n");
+    }
+    Bench("encode/S2C_ChatInRoomNtf/virtual", PacketSize(ntf), [&]() {
+        legacy::S2C_ChatInRoomNtfMsg msg{kROOM, kUSER, kCHAT};
+        g_Sink = g_Sink + legacy::Encode(msg).size();
+    });
+
+    // what the server did before the views: copy into its Buffer, read a std::string per field
+    std::vector<uint8> packet = Encode(C2S_ChatInRoomReqMsg{kROOM, kUSER, kCHAT});
+    const char* data = reinterpret_cast<const char*>(packet.data());
+    uint32 size = static_cast<uint32>(packet.size());
+    Buffer buf{512};
+    Bench("decode/C2S_ChatInRoomReq/buffer", size, [&]() {
+        buf.Set(data, size);
+        buf.ReadUInt32LE();
+        buf.ReadUInt32LE();
+        uint32 roomNameLength = buf.ReadUInt32LE();
+        std::string roomName = buf.ReadString(roomNameLength);
+        uint32 userNameLength = buf.ReadUInt32LE();
+        std::string userName = buf.ReadString(userNameLength);
+        uint32 chatLength = buf.ReadUInt32LE();
+        std::string chat = buf.ReadString(chatLength);
+        g_Sink = g_Sink + roomName.size() + userName.size() + chat.size();
+    });
+}
+
+// one chat to a room of `recipients`, up to the point it sits in every recipient's outbound queue
+// the bytes of an op are all the bytes queued, the queues are cleared after each op
+void BenchBroadcast(size_t recipients) {
+    std::vector<OutboundQueue> queues(recipients);
+    S2C_ChatInRoomNtfView msg{kROOM, kUSER, kCHAT, 1};
+    double bytes = static_cast<double>(PacketSize(msg)) * recipients;
+    std::string name = "broadcast/S2C_ChatInRoomNtf/" + std::to_string(recipients);
+
+    // what the server does: encode once, queue the frame by reference
+    Bench(name + "/shared_frame", bytes, [&]() {
+        FramePtr frame = Frame::Encode(msg);
+        for (OutboundQueue& queue : queues) {
+            queue.Push(frame);
+        }
+        for (OutboundQueue& queue : queues) {
+            g_Sink = g_Sink + queue.QueuedBytes();
+            queue.Clear();
+        }
+    });
+    // encoding for each recipient, as before frames were shared
+    Bench(name + "/per_recipient", bytes, [&]() {
+        for (OutboundQueue& queue : queues) {
+            queue.Push(Frame::Encode(msg));
+        }
+        for (OutboundQueue& queue : queues) {
+            g_Sink = g_Sink + queue.QueuedBytes();
+            queue.Clear();
+        }
+    });
+}
+
+// a chat of chatSize bytes encoded into a frame and released, the frame and its bytes from the BlockPool
+// against the heap; past BlockPool::kMAX_BLOCK both go to the heap
+void BenchFrame(size_t chatSize) {
+    std::string chat(chatSize, 'x');
+    S2C_ChatInRoomNtfView msg{kROOM, kUSER, chat, 1};
+    std::string name = "frame/S2C_ChatInRoomNtf/" + std::to_string(chatSize);
+
+    Bench(name + "/pool", PacketSize(msg), [&]() { g_Sink = g_Sink + Frame::Encode(msg)->Size(); });
+    // what Frame::Encode() did before the pool
+    Bench(name + "/heap", PacketSize(msg),
+          [&]() { g_Sink = g_Sink + std::make_shared<const Frame>(Encode(msg))->Size(); });
+}
+
+}  // namespace
+
+void RunMessageBenchmarks() {
+    BenchEveryMessage();
+    BenchLegacy();
+
+    const size_t rosterSizes[] = {100, 1000, 10000, 100000};
+    for (size_t userCount : rosterSizes) {
+        BenchLargeRoster(userCount);
+    }
+
+    const size_t recipientCounts[] = {10, 100, 1000, 10000};
+    for (size_t recipients : recipientCounts) {
+        BenchBroadcast(recipients);
+    }
+
+    const size_t chatSizes[] = {64, 1024, 16384, 100000};
+    for (size_t chatSize : chatSizes) {
+        BenchFrame(chatSize);
+    }
+}
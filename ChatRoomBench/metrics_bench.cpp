@@ -0,0 +1,65 @@
+#include <chrono>
+#include <string>
+
+#include "bench.h"
+#include "metrics.h"
+#include "room_directory.h"
+
+// Metrics benchmarks: what recording costs the reactor on every packet, and
+// what a scrape costs the thread serving it.
+//
+// Names are "metrics/<counter|histogram|packet>" and "metrics/render/<reactors>",
+// the bytes of a render are the text's.
+
+namespace {
+
+void BenchRecord() {
+    ReactorMetrics metrics;
+    Bench("metrics/counter", 0, [&]() { metrics.loopIterations.Add(); });
+
+    uint64 value = 1;
+    Bench("metrics/histogram", 0, [&]() {
+        metrics.fanout.Record(value);
+        value = value * 3 + 1;
+    });
+
+    // what HandleMessage adds to a packet: two counters, the clock read twice and a histogram
+    Bench("metrics/packet", 0, [&]() {
+        ReactorMetrics::TypeMetrics& type = metrics.types[ReactorMetrics::TypeSlot(1009)];
+        type.packetsIn.Add();
+        type.bytesIn.Add(96);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        type.handlerNanoseconds.Record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    });
+    g_Sink = g_Sink + metrics.loopIterations.Value();
+}
+
+void BenchRender(uint32 reactors) {
+    RoomDirectory rooms;
+    MetricsRegistry registry{rooms};
+    for (uint32 i = 0; i < reactors; i++) {
+        ReactorMetrics& metrics = registry.AddReactor();
+        for (uint32 type = ReactorMetrics::kFIRST_TYPE; type <= ReactorMetrics::kLAST_TYPE; type++) {
+            ReactorMetrics::TypeMetrics& slot = metrics.types[ReactorMetrics::TypeSlot(type)];
+            slot.packetsIn.Add();
+            slot.handlerNanoseconds.Record(20000);
+        }
+        metrics.fanout.Record(100);
+    }
+
+    std::string text;
+    registry.Render(text);
+    Bench("metrics/render/" + std::to_string(reactors), text.size(), [&]() {
+        text.clear();
+        registry.Render(text);
+        g_Sink = g_Sink + text.size();
+    });
+}
+}  // namespace
+
+void RunMetricsBenchmarks() {
+    BenchRecord();
+    BenchRender(1);
+    BenchRender(8);
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "epoll_poller.h"
+#include "io_uring_poller.h"
+#include "socket.h"
+
+// Poller benchmarks: a broadcast of one chat to every member of a room, by
+// readiness with a sendmsg per member, against io_uring with the sends queued
+// and submitted in the wait that collects their completions.
+//
+// Names are "poller/broadcast/<backend>/<members>" for one 128 byte frame sent
+// to that many sockets, local socket pairs whose other ends are drained every
+// kDRAIN_EVERY broadcasts, and "poller/syscalls/<backend>/<members>" for the
+// system calls a broadcast made, the wait of the event loop iteration included.
+
+namespace {
+constexpr uint32 kFRAME_SIZE = 128;
+constexpr uint32 kDRAIN_EVERY = 64;
+
+struct Room {
+    std::vector<SOCKET> members;  // the server's ends
+    std::vector<SOCKET> clients;  // the other ends
+
+    explicit Room(uint32 size) {
+        for (uint32 i = 0; i < size; i++) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) break;
+            members.push_back(pair[0]);
+            clients.push_back(pair[1]);
+        }
+    }
+
+    ~Room() {
+        for (SOCKET socket : members) close(socket);
+        for (SOCKET socket : clients) close(socket);
+    }
+
+    Room(const Room&) = delete;
+    Room& operator=(const Room&) = delete;
+
+    void Drain() {
+        char buffer[64 * 1024];
+        for (SOCKET socket : clients) {
+            while (recv(socket, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+            }
+        }
+    }
+};
+
+void BenchEpoll(uint32 size) {
+    std::string name = "poller/broadcast/epoll/" + std::to_string(size);
+    if (!Selected(name)) return;
+
+    Room room{size};
+    EpollPoller poller;
+    if (!poller.IsValid() || room.members.size() != size) {
+        printf("%s cannot set up %u sockets\n", name.c_str(), size);
+        return;
+    }
+    for (uint32 i = 0; i < size; i++) {
+        poller.Add(room.members[i], kPOLL_READ, i);
+    }
+
+    const char frame[kFRAME_SIZE] = {};
+    const network::IoSlice slice{frame, kFRAME_SIZE};
+    std::vector<PollEvent> ready;
+    uint64 broadcasts = 0;
+    uint64 syscalls = 0;
+    Measurement m = Measure([&]() {
+        for (SOCKET socket : room.members) {
+            g_Sink = g_Sink + network::SendVectored(socket, &slice, 1);
+        }
+        poller.Wait(ready, 0);
+        syscalls += size + 1;
+        if (++broadcasts % kDRAIN_EVERY == 0) room.Drain();
+    });
+    Report(name, m, static_cast<double>(kFRAME_SIZE) * size);
+    ReportValue("poller/syscalls/epoll/" + std::to_string(size), "per broadcast",
+                static_cast<double>(syscalls) / broadcasts);
+}
+
+void BenchIoUring(uint32 size) {
+    std::string name = "poller/broadcast/io_uring/" + std::to_string(size);
+    if (!Selected(name)) return;
+
+    Room room{size};
+    IoUringPoller poller;
+    if (!poller.IsValid() || room.members.size() != size) {
+        printf("%s cannot set up %u sockets, or io_uring is not available\n", name.c_str(), size);
+        return;
+    }
+    for (uint32 i = 0; i < size; i++) {
+        poller.Add(room.members[i], 0, i);
+    }
+
+    const char frame[kFRAME_SIZE] = {};
+    const network::IoSlice slice{frame, kFRAME_SIZE};
+    std::vector<PollEvent> ready;
+    uint64 broadcasts = 0;
+    uint64 enterCallsBefore = poller.EnterCalls();
+    Measurement m = Measure([&]() {
+        for (SOCKET socket : room.members) {
+            poller.Send(socket, &slice, 1, 0);
+        }
+        // a member's next send waits for its last one to complete, as on the server
+        uint32 sent = 0;
+        while (sent < size) {
+            poller.Wait(ready, 1000);
+            for (const PollEvent& event : ready) {
+                if (event.flags & kPOLL_SENT) sent++;
+            }
+        }
+        g_Sink = g_Sink + sent;
+        if (++broadcasts % kDRAIN_EVERY == 0) room.Drain();
+    });
+    Report(name, m, static_cast<double>(kFRAME_SIZE) * size);
+    ReportValue("poller/syscalls/io_uring/" + std::to_string(size), "per broadcast",
+                static_cast<double>(poller.EnterCalls() - enterCallsBefore) / broadcasts);
+}
+}  // namespace
+
+void RunPollerBenchmarks() {
+    for (uint32 size : {100u, 1000u}) {
+        BenchEpoll(size);
+        BenchIoUring(size);
+    }
+}
+
+#else
+
+// the backends compared are Linux only
+void RunPollerBenchmarks() {}
+
+#endif  // __linux__
@@ -0,0 +1,74 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "rate_limiter.h"
+
+// Rate limiter benchmarks: what admitting one chat costs a reactor.
+//
+// Names are "rate/local" for a connection's limiter, "rate/shared/<threads>"
+// for a room's limiter taken from that many threads at once, each taking
+// kTAKES tokens a call, and "rate/lookup" for finding a room's limiter by name.
+// The limit is high enough that every take succeeds, a refused take costs the same.
+
+namespace {
+constexpr uint32 kTAKES = 1024;
+const RateLimit kLIMIT{1000000000, 1000000};
+
+void BenchLocal() {
+    RateLimiter limiter{kLIMIT};
+    BenchBatch("rate/local", 0, kTAKES, [&]() {
+        RateLimiter::Clock::time_point now = RateLimiter::Clock::now();
+        for (uint32 i = 0; i < kTAKES; i++) {
+            g_Sink = g_Sink + limiter.TryTake(now);
+        }
+    });
+}
+
+void BenchShared(uint32 threads) {
+    SharedRateLimiter limiter{kLIMIT};
+    // the other threads take from the same limiter for as long as the measuring one runs
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> others;
+    for (uint32 i = 1; i < threads; i++) {
+        others.emplace_back([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                limiter.TryTake(SharedRateLimiter::Clock::now());
+            }
+        });
+    }
+    BenchBatch("rate/shared/" + std::to_string(threads), 0, kTAKES, [&]() {
+        SharedRateLimiter::Clock::time_point now = SharedRateLimiter::Clock::now();
+        for (uint32 i = 0; i < kTAKES; i++) {
+            g_Sink = g_Sink + limiter.TryTake(now);
+        }
+    });
+    stop.store(true, std::memory_order_relaxed);
+    for (std::thread& other : others) {
+        other.join();
+    }
+}
+
+void BenchLookup() {
+    std::vector<std::string> roomNames;
+    for (uint32 i = 0; i < 64; i++) {
+        roomNames.push_back("room" + std::to_string(i));
+    }
+    RoomRateLimits limits{roomNames, kLIMIT};
+    uint32 next = 0;
+    Bench("rate/lookup", 0, [&]() {
+        g_Sink = g_Sink + (limits.Find(roomNames[next++ % roomNames.size()]) != nullptr);
+    });
+}
+}  // namespace
+
+void RunRateBenchmarks() {
+    BenchLocal();
+    for (uint32 threads : {1u, 2u, 4u}) {
+        BenchShared(threads);
+    }
+    BenchLookup();
+}
@@ -0,0 +1,249 @@
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "room_directory.h"
+
+// Room index benchmarks: join, leave, roster and broadcast fan-out at room sizes from 10 to 100k,
+// RoomDirectory against the string keyed maps it replaced, and what a member of every room costs
+// the directory when its connection drops and comes back.
+
+namespace {
+
+// The server cache before RoomDirectory interned names, kept for comparison
+// it has no roster versions, every roster is the whole room in one page
+class StringRoomIndex {
+public:
+    StringRoomIndex() { m_RoomMap.insert(std::make_pair("network", std::set<std::string>{})); }
+
+    void Login(const std::string& userName, const ClientLocation& location) {
+        m_ClientMap.insert(std::make_pair(userName, location));
+    }
+
+    bool Join(const std::string& roomName, const std::string& userName, std::vector<ClientLocation>& notify,
+              uint32& version, bool& added) {
+        std::map<std::string, std::set<std::string>>::iterator it = m_RoomMap.find(roomName);
+        if (it == m_RoomMap.end()) {
+            return false;
+        }
+        added = it->second.insert(userName).second;
+        version = 0;
+        notify.clear();
+        if (added) {
+            Locate(it->second, &userName, notify);
+        }
+        return true;
+    }
+
+    bool Join(const std::string& roomName, const std::string& userName) {
+        std::map<std::string, std::set<std::string>>::iterator it = m_RoomMap.find(roomName);
+        if (it == m_RoomMap.end()) {
+            return false;
+        }
+        it->second.insert(userName);
+        return true;
+    }
+
+    bool Leave(const std::string& roomName, const std::string& userName, std::vector<ClientLocation>& notify,
+               uint32& version) {
+        std::map<std::string, std::set<std::string>>::iterator it = m_RoomMap.find(roomName);
+        if (it == m_RoomMap.end()) {
+            return false;
+        }
+        it->second.erase(userName);
+        version = 0;
+        Locate(it->second, nullptr, notify);
+        return true;
+    }
+
+    bool Roster(const std::string& roomName, uint32 /*sinceVersion*/, uint32 /*cursor*/, RosterPage& page,
+                Arena& arena) const {
+        std::map<std::string, std::set<std::string>>::const_iterator it = m_RoomMap.find(roomName);
+        if (it == m_RoomMap.end()) {
+            return false;
+        }
+        page.Clear();
+        for (const std::string& name : it->second) {
+            page.present.push_back(arena.Copy(name));
+        }
+        return true;
+    }
+
+    bool Members(const std::string& roomName, std::vector<ClientLocation>& members) const {
+        std::map<std::string, std::set<std::string>>::const_iterator it = m_RoomMap.find(roomName);
+        if (it == m_RoomMap.end()) {
+            return false;
+        }
+        Locate(it->second, nullptr, members);
+        return true;
+    }
+
+private:
+    void Locate(const std::set<std::string>& usersInRoom, const std::string* excludedUser,
+                std::vector<ClientLocation>& locations) const {
+        locations.clear();
+        for (const std::string& name : usersInRoom) {
+            if (excludedUser != nullptr && name == *excludedUser) continue;
+            std::map<std::string, ClientLocation>::const_iterator it = m_ClientMap.find(name);
+            if (it != m_ClientMap.end()) {
+                locations.push_back(it->second);
+            }
+        }
+    }
+
+    std::map<std::string, ClientLocation> m_ClientMap;
+    std::map<std::string, std::set<std::string>> m_RoomMap;
+};
+
+std::string UserName(size_t i) {
+    return "user" + std::to_string(i);
+}
+
+// the work the server does per broadcast: find the members, then walk them to send
+size_t FanOut(const std::vector<ClientLocation>& targets) {
+    size_t sum = 0;
+    for (const ClientLocation& target : targets) {
+        sum += target.handle;
+    }
+    return sum;
+}
+
+// names are "rooms/<index>/<members>/<op>", no bytes are moved so only ns/op and allocs/op mean anything
+template <typename Index>
+void Run(const std::string& indexName, size_t roomSize) {
+    std::string prefix = "rooms/" + indexName + "/" + std::to_string(roomSize) + "/";
+    // building a 100k room takes a while, skip it when none of its ops runs
+    if (!Selected(prefix + "join_leave") && !Selected(prefix + "leave_join") && !Selected(prefix + "roster_full") &&
+        !Selected(prefix + "broadcast")) {
+        return;
+    }
+
+    Index index;
+    RosterPage roster;
+    Arena arena;  // reset after each op, like the server does after each packet
+    std::vector<ClientLocation> targets;
+    uint32 version = 0;
+    bool added = false;
+    for (size_t i = 0; i < roomSize; i++) {
+        std::string userName = UserName(i);
+        index.Login(userName, ClientLocation{0, i});
+        index.Join("network", userName);
+    }
+
+    const std::string room = "network";
+    const std::string joiner = UserName(roomSize);
+    index.Login(joiner, ClientLocation{0, roomSize});
+
+    // join and leave of one more user, the room is back to roomSize after each call
+    // the joiner keeps the roster it had before leaving, so a versioned index only sends what changed since
+    uint32 joinerVersion = 0;
+    Bench(prefix + "join_leave", 0, [&]() {
+        index.Join(room, joiner, targets, version, added);
+        index.Roster(room, joinerVersion, 0, roster, arena);
+        joinerVersion = roster.version;
+        g_Sink = g_Sink + targets.size() + roster.present.size();
+        index.Leave(room, joiner, targets, version);
+        g_Sink = g_Sink + targets.size();
+        arena.Reset();
+    });
+
+    // a member in the middle of the room leaving and coming back
+    const std::string member = UserName(roomSize / 2);
+    uint32 memberVersion = 0;
+    Bench(prefix + "leave_join", 0, [&]() {
+        index.Leave(room, member, targets, version);
+        g_Sink = g_Sink + targets.size();
+        index.Join(room, member, targets, version, added);
+        index.Roster(room, memberVersion, 0, roster, arena);
+        memberVersion = roster.version;
+        g_Sink = g_Sink + targets.size() + roster.present.size();
+        arena.Reset();
+    });
+
+    // the whole roster for a client that has none, page by page
+    Bench(prefix + "roster_full", 0, [&]() {
+        uint32 cursor = 0;
+        do {
+            index.Roster(room, 0, cursor, roster, arena);
+            g_Sink = g_Sink + roster.present.size();
+            cursor = roster.nextCursor;
+            arena.Reset();
+        } while (cursor != 0);
+    });
+
+    Bench(prefix + "broadcast", 0, [&]() {
+        index.Members(room, targets);
+        g_Sink = g_Sink + FanOut(targets);
+    });
+}
+
+// names are "rooms/reconnect/<members>/<op>", every room has that many members, one of which reconnects:
+// relogin is the disconnect leaving each room and the login and joins after it, resume is the suspend and
+// the resume that replace them. g_Sink gets the notifications either would broadcast.
+void RunReconnect(size_t roomSize) {
+    std::string prefix = "rooms/reconnect/" + std::to_string(roomSize) + "/";
+    if (!Selected(prefix + "relogin") && !Selected(prefix + "resume")) {
+        return;
+    }
+
+    RoomDirectory directory;
+    const std::vector<std::string>& rooms = directory.RoomNames();
+    const std::string token = "0123456789abcdef";
+    for (size_t i = 0; i < roomSize; i++) {
+        std::string userName = UserName(i);
+        directory.Login(userName, ClientLocation{0, i + 1}, token);
+        for (const std::string& room : rooms) {
+            directory.Join(room, userName);
+        }
+    }
+
+    const std::string member = UserName(roomSize / 2);
+    RosterPage roster;
+    Arena arena;
+    std::vector<ClientLocation> targets;
+    std::vector<uint32> versions(rooms.size(), 0);
+    uint32 version = 0;
+    bool added = false;
+    uint64 connection = roomSize + 1;
+
+    Bench(prefix + "relogin", 0, [&]() {
+        ClientLocation location{0, connection};
+        std::string_view roomName;
+        while (directory.LeaveNextRoom(member, location, roomName, targets, version)) {
+            g_Sink = g_Sink + targets.size();
+        }
+        directory.Logout(member, location);
+
+        location.handle = ++connection;
+        directory.Login(member, location, token);
+        for (size_t i = 0; i < rooms.size(); i++) {
+            directory.Join(rooms[i], member, targets, version, added);
+            directory.Roster(rooms[i], versions[i], 0, roster, arena);
+            versions[i] = roster.version;
+            g_Sink = g_Sink + targets.size() + roster.present.size();
+            arena.Reset();
+        }
+    });
+
+    std::vector<std::string_view> roomNames;
+    Bench(prefix + "resume", 0, [&]() {
+        ClientLocation suspended, previous;
+        directory.Suspend(member, ClientLocation{0, connection}, suspended);
+        // given the same token again, so that every round resumes by it
+        directory.Resume(member, token, token, ClientLocation{0, ++connection}, previous, roomNames);
+        g_Sink = g_Sink + roomNames.size();
+    });
+}
+
+}  // namespace
+
+void RunRoomBenchmarks() {
+    const size_t roomSizes[] = {10, 100, 1000, 10000, 100000};
+    for (size_t roomSize : roomSizes) {
+        Run<StringRoomIndex>("string", roomSize);
+        Run<RoomDirectory>("interned", roomSize);
+        RunReconnect(roomSize);
+    }
+}
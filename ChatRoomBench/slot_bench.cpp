@@ -0,0 +1,75 @@
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "slot_table.h"
+
+// Connection table benchmarks: the generation-tagged slot table the server keeps
+// its clients in, against the vector it used to only ever grow, its
+// disconnected clients flagged and left in place.
+//
+// Names are "slots/<table|flagged>/<live>of<connected>/<op>": <connected> is
+// how many connections the server has seen, <live> how many are still up.
+
+namespace {
+struct Client {
+    uint64 queued = 0;
+    bool connected = false;
+};
+
+void Run(uint32 connected, uint32 live) {
+    std::string suffix = "/" + std::to_string(live) + "of" + std::to_string(connected) + "/";
+
+    // every connection comes and most go, the table ends up as large as the most ever live
+    SlotTable<Client> table;
+    std::vector<uint64> handles;
+    std::vector<Client> flagged(connected);
+    for (uint32 i = 0; i < connected; i++) {
+        uint64 handle = table.Acquire();
+        table.Find(handle)->connected = true;
+        handles.push_back(handle);
+        flagged[i].connected = i % (connected / live) == 0;
+    }
+    for (uint32 i = 0; i < connected; i++) {
+        if (!flagged[i].connected) table.Release(handles[i]);
+    }
+
+    // a poll event's token back to its client
+    uint32 i = 0;
+    Bench("slots/table" + suffix + "find", 0, [&]() {
+        Client* client = table.Find(handles[i]);
+        g_Sink = g_Sink + (client != nullptr ? client->queued + 1 : 0);
+        i = (i + 7919) % connected;
+    });
+
+    // a disconnect and the next accept, the slot goes round the free list
+    Bench("slots/table" + suffix + "churn", 0, [&]() {
+        uint32 slot = table.LiveSlots()[i % table.Size()];
+        table.Release(table.Handle(slot));
+        g_Sink = g_Sink + table.Acquire();
+        i = (i + 7919) % connected;
+    });
+
+    // sampling the queues of every client, as the metrics do
+    Bench("slots/table" + suffix + "iterate", 0, [&]() {
+        uint64 queued = 0;
+        for (uint32 slot : table.LiveSlots()) {
+            queued += table.At(slot).queued + 1;
+        }
+        g_Sink = g_Sink + queued;
+    });
+    Bench("slots/flagged" + suffix + "iterate", 0, [&]() {
+        uint64 queued = 0;
+        for (const Client& client : flagged) {
+            if (!client.connected) continue;
+            queued += client.queued + 1;
+        }
+        g_Sink = g_Sink + queued;
+    });
+}
+}  // namespace
+
+void RunSlotBenchmarks() {
+    Run(100000, 100000);
+    Run(100000, 1000);
+}
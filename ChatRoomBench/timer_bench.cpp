@@ -0,0 +1,92 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "timing_wheel.h"
+
+// Timer benchmarks: the heartbeat timers of many connections on the timing
+// wheel, against scanning every connection's deadline on each tick.
+//
+// Names are "timer/<schedule|cancel>/<timers>" for one operation with that
+// many timers pending, and "timer/<tick|scan>/<timers>" for one 100 ms tick
+// with the timers' deadlines spread over 30 s, each expired timer re-armed.
+
+namespace {
+typedef TimingWheel::Clock Clock;
+
+constexpr std::chrono::milliseconds kTICK{100};
+constexpr std::chrono::seconds kSPREAD{30};
+
+// every id armed at a random point of the next kSPREAD
+void ArmAll(TimingWheel& wheel, std::vector<Clock::time_point>& deadlines, Clock::time_point now, uint32 timers) {
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int64> offset{0, std::chrono::duration_cast<Clock::duration>(kSPREAD).count()};
+    deadlines.resize(timers);
+    for (uint32 id = 0; id < timers; id++) {
+        deadlines[id] = now + Clock::duration{offset(random)};
+        wheel.Schedule(id, deadlines[id]);
+    }
+}
+
+void BenchOperations(uint32 timers) {
+    Clock::time_point start = Clock::now();
+    TimingWheel wheel{kTICK, start};
+    std::vector<Clock::time_point> deadlines;
+    ArmAll(wheel, deadlines, start, timers);
+
+    // moving an armed timer, as a client's deadline is pushed back
+    uint32 id = 0;
+    Bench("timer/schedule/" + std::to_string(timers), 0, [&]() {
+        wheel.Schedule(id, deadlines[id] + std::chrono::seconds{1});
+        id = (id + 7919) % timers;
+    });
+
+    // as on a disconnect, the timer is armed again right after so that the count stays the same
+    Bench("timer/cancel/" + std::to_string(timers), 0, [&]() {
+        wheel.Cancel(id);
+        wheel.Schedule(id, deadlines[id]);
+        id = (id + 7919) % timers;
+    });
+    g_Sink = g_Sink + wheel.Size();
+}
+
+void BenchTick(uint32 timers) {
+    Clock::time_point start = Clock::now();
+    TimingWheel wheel{kTICK, start};
+    std::vector<Clock::time_point> deadlines;
+    ArmAll(wheel, deadlines, start, timers);
+
+    std::vector<uint32> expired;
+    Clock::time_point now = start;
+    Bench("timer/tick/" + std::to_string(timers), 0, [&]() {
+        now += kTICK;
+        wheel.Advance(now, expired);
+        for (uint32 id : expired) {
+            wheel.Schedule(id, now + kSPREAD);
+        }
+        g_Sink = g_Sink + expired.size();
+        expired.clear();
+    });
+
+    // what the wheel saves: a look at every connection on every tick
+    now = start;
+    Bench("timer/scan/" + std::to_string(timers), 0, [&]() {
+        now += kTICK;
+        for (Clock::time_point& deadline : deadlines) {
+            if (deadline <= now) {
+                deadline = now + kSPREAD;
+                g_Sink = g_Sink + 1;
+            }
+        }
+    });
+}
+}  // namespace
+
+void RunTimerBenchmarks() {
+    for (uint32 timers : {1000u, 100000u}) {
+        BenchOperations(timers);
+        BenchTick(timers);
+    }
+}
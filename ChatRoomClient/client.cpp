@@ -1,12 +1,16 @@
 #include "client.h"
 
-#include <WS2tcpip.h>
+#include <string.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
+#include "compression.h"
+
 using namespace network;
 
-ChatRoomClient::ChatRoomClient(const std::string& host, uint16 port) {
+ChatRoomClient::ChatRoomClient(const std::string& host, uint16 port) : m_Host(host), m_Port(port) {
     // init chatroom logic stuff
     m_JoinedRoomMap.clear();
     m_JoinedRoomNames.clear();
@@ -26,16 +30,16 @@ ChatRoomClient::~ChatRoomClient() { Shutdown(); }
 // 3. create socket
 // 4. connect
 // 5. set non-blocking socket
+// 6. watch the socket (and the waker) with a poller, start the network thread
 int ChatRoomClient::Initialize(const std::string& host, uint16 port) {
     // Decalre adn initialize variables
     int result;
-    WSADATA wsaData;
     m_ConnectSocket = INVALID_SOCKET;
     m_ClientState = ClientState::kOFFLINE;
 
     // 1. WSAStartup
-    result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != NO_ERROR) {
+    result = StartupSockets();
+    if (result != 0) {
         printf("WSAStartup failed with error %d\n", result);
         return result;
     } else {
@@ -46,7 +50,7 @@ int ChatRoomClient::Initialize(const std::string& host, uint16 port) {
     // specifies the address family,
     // IP address, and port of the server to be connected to.
     struct addrinfo hints;
-    ZeroMemory(&hints, sizeof(hints));
+    memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_INET;  // IPv4 #.#.#.#, AF_INET6 is IPv6
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
@@ -54,7 +58,7 @@ int ChatRoomClient::Initialize(const std::string& host, uint16 port) {
     result = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &m_AddrInfo);
     if (result != 0) {
         printf("getaddrinfo failed with error: %d\n", result);
-        WSACleanup();
+        CleanupSockets();
         return result;
     } else {
         printf("getaddrinfo OK!\n");
@@ -63,9 +67,10 @@ int ChatRoomClient::Initialize(const std::string& host, uint16 port) {
     // 3. Create a SOCKET for connecting to server [Socket]
     m_ConnectSocket = socket(m_AddrInfo->ai_family, m_AddrInfo->ai_socktype, m_AddrInfo->ai_protocol);
     if (m_ConnectSocket == INVALID_SOCKET) {
-        printf("socket failed with error: %d\n", WSAGetLastError());
+        printf("socket failed with error: %d\n", LastSocketError());
         freeaddrinfo(m_AddrInfo);
-        WSACleanup();
+        m_AddrInfo = nullptr;
+        CleanupSockets();
         return -1;
     } else {
         printf("socket OK!\n");
@@ -74,140 +79,359 @@ int ChatRoomClient::Initialize(const std::string& host, uint16 port) {
     // 4. [Connect] to the server
     result = connect(m_ConnectSocket, m_AddrInfo->ai_addr, (int)m_AddrInfo->ai_addrlen);
     if (result == SOCKET_ERROR) {
-        printf("connect failed with error: %d\n", WSAGetLastError());
-        closesocket(m_ConnectSocket);
+        printf("connect failed with error: %d\n", LastSocketError());
+        CloseSocket(m_ConnectSocket);
+        m_ConnectSocket = INVALID_SOCKET;
         freeaddrinfo(m_AddrInfo);
-        WSACleanup();
+        m_AddrInfo = nullptr;
+        CleanupSockets();
         return result;
     } else {
         printf("connect OK!\n");
         m_ClientState = ClientState::kONLINE;
     }
 
-    // 5. [ioctlsocket] input output control socket, makes it Non-blocking
-    DWORD NonBlock = 1;
-    result = ioctlsocket(m_ConnectSocket, FIONBIO, &NonBlock);
+    // 5. Non-blocking, so that the network thread can drain the socket and go back to waiting
+    result = SetNonBlocking(m_ConnectSocket);
     if (result == SOCKET_ERROR) {
-        printf("ioctlsocket to failed with error: %d\n", WSAGetLastError());
-        closesocket(m_ConnectSocket);
-        freeaddrinfo(m_AddrInfo);
-        WSACleanup();
+        printf("set non-blocking failed with error: %d\n", LastSocketError());
+        Shutdown();
         return result;
     }
 
+    // 6. the network thread sleeps in the poller until there is something to read
+    m_Poller = CreatePoller(DefaultPollerType());
+    m_Waker = std::make_unique<Waker>();
+    if (!m_Poller || !m_Waker->IsValid() || m_Poller->Add(m_ConnectSocket, kPOLL_READ, kSOCKET_TOKEN) == SOCKET_ERROR ||
+        m_Poller->Add(m_Waker->Handle(), kPOLL_READ, kWAKE_TOKEN) == SOCKET_ERROR) {
+        printf("poller setup failed with error: %d\n", LastSocketError());
+        Shutdown();
+        return SOCKET_ERROR;
+    }
+    m_Running = true;
+    m_NetworkThread = std::thread{&ChatRoomClient::NetworkLoop, this};
+
     return result;
 }
 
-// Send request to server
-int ChatRoomClient::SendRequest(network::Message* msg) {
-    int result = send(m_ConnectSocket, m_SendBuf.ConstData(), msg->header.packetSize, 0);
-    if (result == SOCKET_ERROR) {
-        printf("send failed with error: %d\n", WSAGetLastError());
-        closesocket(m_ConnectSocket);
-        WSACleanup();
-        return result;
-    } else {
-        printf("\tsent msg %d (%d bytes) to the server!\n", msg->header.messageType, result);
+// Connect to the server again after losing the connection, the session is taken back with ReqResume()
+int ChatRoomClient::Reconnect() {
+    Shutdown();
+    // a packet cut off by the lost connection is never completed
+    m_RecvBuf.Consume(m_RecvBuf.ReadableSize());
+    m_SendBacklog.clear();
+    return Initialize(m_Host, m_Port);
+}
+
+// Send an encoded request to server
+int ChatRoomClient::SendRequest(network::MessageType msgType, const std::vector<uint8>& packet) {
+    if (m_ConnectSocket == INVALID_SOCKET) {
+        return SOCKET_ERROR;
     }
 
-    return result;
+    std::lock_guard<std::mutex> lock{m_SendMutex};
+    // the rest of a pong the network thread could not finish goes first, the server is in the middle of it
+    if (!m_SendBacklog.empty()) {
+        if (SendAll(m_SendBacklog.data(), static_cast<int>(m_SendBacklog.size())) == SOCKET_ERROR) {
+            return SOCKET_ERROR;
+        }
+        m_SendBacklog.clear();
+    }
+    if (SendAll(reinterpret_cast<const char*>(packet.data()), static_cast<int>(packet.size())) == SOCKET_ERROR) {
+        return SOCKET_ERROR;
+    }
+    printf("\tsent msg %d (%d bytes) to the server!\n", msgType, static_cast<int>(packet.size()));
+
+    return static_cast<int>(packet.size());
 }
 
-// Receive response from server
-int ChatRoomClient::RecvResponse() {
-    int result = 0;
-    // the non-blocking version
-    // remember to use ioctlsocket() to set the socket i/o mode first
-    bool tryAgain = true;
-    while (tryAgain) {
-        ZeroMemory(m_RawRecvBuf, kRECV_BUF_SIZE);
-        result = recv(m_ConnectSocket, m_RawRecvBuf, kRECV_BUF_SIZE, 0);
-        // Expected result values:
-        // 0 = closed connection, disconnection
-        // >0 = number of bytes received
-        // -1 = SOCKET_ERROR
-        //
-        // NonBlocking recv, it will immediately return
-        // result will be -1
+// Send all of data, m_SendMutex held
+// the socket is non-blocking for the network thread's sake, a request is
+// small enough that waiting for buffer space is all but unheard of
+int ChatRoomClient::SendAll(const char* data, int size) {
+    int remaining = size;
+    while (remaining > 0) {
+        int result = send(m_ConnectSocket, data, remaining, 0);
         if (result == SOCKET_ERROR) {
-            if (WSAGetLastError() == WSAEWOULDBLOCK) {
-                // printf("WouldBlock!\n");
-                tryAgain = true;
-            } else {
-                printf("recv failed with error: %d\n", WSAGetLastError());
-                closesocket(m_ConnectSocket);
-                WSACleanup();
-                return result;
+            int error = LastSocketError();
+            if (IsWouldBlock(error)) {
+                std::this_thread::yield();
+                continue;
             }
-        } else {
-            m_RecvBuf.Set(m_RawRecvBuf, kRECV_BUF_SIZE);
-            uint32_t packetSize = m_RecvBuf.ReadUInt32LE();
-            MessageType messageType = static_cast<MessageType>(m_RecvBuf.ReadUInt32LE());
+            printf("send failed with error: %d\n", error);
+            return result;
+        }
+        data += result;
+        remaining -= result;
+    }
+    return size;
+}
 
-            printf("\trecv msg %d (%d bytes) from the server!\n", messageType, result);
+// [send] C2S_PongMsg, from the network thread
+// It never waits for buffer space: a network thread stuck on a full socket stops
+// reading, and the server, with its queue for this client growing, would stop
+// reading it in turn. A pong that cannot go out now is skipped, the next ping
+// gets one, and only the rest of one sent in part is kept for later.
+void ChatRoomClient::SendPong(uint32 sequence) {
+    std::unique_lock<std::mutex> lock{m_SendMutex, std::try_to_lock};
+    // the application thread is sending, and may be waiting on the socket itself
+    if (!lock.owns_lock()) return;
+
+    bool partial = !m_SendBacklog.empty();
+    if (!partial) {
+        C2S_PongMsg pong{sequence};
+        std::vector<uint8> packet = Encode(pong);
+        m_SendBacklog.assign(packet.begin(), packet.end());
+    }
+    int result = send(m_ConnectSocket, m_SendBacklog.data(), static_cast<int>(m_SendBacklog.size()), 0);
+    if (result == SOCKET_ERROR) {
+        int error = LastSocketError();
+        if (!IsWouldBlock(error)) {
+            printf("send failed with error: %d\n", error);
+        }
+        // nothing of this pong went out, so there is nothing to finish
+        if (!partial) m_SendBacklog.clear();
+        return;
+    }
+    m_SendBacklog.erase(m_SendBacklog.begin(), m_SendBacklog.begin() + result);
+}
+
+// The network thread: wait for the socket, decode what arrives, queue it for the application thread
+void ChatRoomClient::NetworkLoop() {
+    while (m_Running) {
+        if (m_Poller->Wait(m_ReadyEvents, -1) == SOCKET_ERROR) {
+            printf("%s wait failed with error: %d\n", m_Poller->Name(), LastSocketError());
+            Deliver(ConnectionLost{});
+            return;
+        }
+
+        for (const PollEvent& event : m_ReadyEvents) {
+            if (event.token == kWAKE_TOKEN) {
+                // woken to shut down, m_Running says so
+                m_Waker->Drain();
+            } else if (!ReadFromServer()) {
+                Deliver(ConnectionLost{});
+                return;
+            }
+        }
+    }
+}
 
-            if (m_RecvBuf.Size() >= packetSize) {
-                HandleMessage(messageType);
+// Receive until the socket would block
+// returns false if the connection is gone
+bool ChatRoomClient::ReadFromServer() {
+    while (true) {
+        // result
+        //		-1 : SOCKET_ERROR (More info received from LastSocketError() after)
+        //		0 : server disconnected
+        //		>0: The number of bytes received.
+        int result = recv(m_ConnectSocket, m_RecvBuf.WritePtr(), (int)m_RecvBuf.WritableSize(), 0);
+        if (result == SOCKET_ERROR) {
+            int error = LastSocketError();
+            if (IsWouldBlock(error)) {
+                return true;
             }
+            printf("recv failed with error: %d\n", error);
+            return false;
+        }
+        if (result == 0) {
+            printf("Connection closed\n");
+            return false;
+        }
 
-            tryAgain = false;
+        m_RecvBuf.Commit(result);
+        if (!HandlePackets()) {
+            return false;
         }
     }
-    // the blocking version
-    // Receive until the peer closes the connection
-    // do {
-    //    result = recv(m_ConnectSocket, m_RawRecvBuf, kRECV_BUF_SIZE, 0);
-    //    if (result > 0) {
-    //        printf("received: %d bytes\n", result);
-    //        Buffer m_RecvBuf{m_RawRecvBuf, kRECV_BUF_SIZE};
-    //        uint32_t packetSize = m_RecvBuf.ReadUInt32LE();
-    //        MessageType messageType = static_cast<MessageType>(m_RecvBuf.ReadUInt32LE());
-
-    //        if (m_RecvBuf.Size() >= packetSize) {
-    //            HandleMessage(messageType);
-    //        }
-    //    } else if (result == 0) {
-    //        printf("Connection closed\n");
-    //    } else {
-    //        printf("recv failed with error: %d\n", WSAGetLastError());
-    //    }
-
-    //} while (result > 0);
-    return result;
+}
+
+// Decode and queue every complete packet in m_RecvBuf, a partial one waits for the rest
+// returns false if the stream is corrupt
+bool ChatRoomClient::HandlePackets() {
+    uint32 packetSize = 0;
+    while (m_RecvBuf.PeekUInt32LE(0, packetSize)) {
+        if (packetSize < sizeof(PacketHeader) || packetSize > kMAX_PACKET_SIZE) {
+            printf("invalid packet size %u from the server\n", packetSize);
+            return false;
+        }
+        if (m_RecvBuf.ReadableSize() < packetSize) {
+            m_RecvBuf.Reserve(packetSize);
+            break;
+        }
+
+        const char* packet = m_RecvBuf.Contiguous(packetSize);
+        MessageType messageType = static_cast<MessageType>(LoadUInt32LE(packet + sizeof(uint32)));
+        printf("\trecv msg %d (%u bytes) from the server!\n", messageType, packetSize);
+
+        std::optional<ServerEvent> event;
+        if (!DecodeEvent(messageType, packet + sizeof(PacketHeader), packetSize - sizeof(PacketHeader), event)) {
+            printf("malformed message %d from the server\n", messageType);
+            return false;
+        }
+        m_RecvBuf.Consume(packetSize);
+
+        if (event && !Deliver(std::move(*event))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+template <typename Msg>
+bool DecodeAs(const char* body, uint32 bodySize, std::optional<ServerEvent>& event) {
+    Msg msg;
+    if (!Decode(body, bodySize, msg)) return false;
+    event = std::move(msg);
+    return true;
+}
+}  // namespace
+
+// Decode a message body into the matching event, event is left empty for an unknown message
+// returns false if the message does not decode
+bool ChatRoomClient::DecodeEvent(MessageType msgType, const char* body, uint32 bodySize,
+                                 std::optional<ServerEvent>& event) {
+    switch (msgType) {
+        case MessageType::kLOGIN_ACK: {
+            if (!DecodeAs<S2C_LoginAckMsg>(body, bodySize, event)) return false;
+            const S2C_LoginAckMsg& ack = std::get<S2C_LoginAckMsg>(*event);
+            if (ack.features & Feature::kFEATURE_LZ4) {
+                m_Dictionary = BuildDictionary(ack.roomNames);
+            }
+            return true;
+        }
+        case MessageType::kJOIN_ROOM_ACK:
+            return DecodeAs<S2C_JoinRoomAckMsg>(body, bodySize, event);
+        case MessageType::kJOIN_ROOM_NTF:
+            return DecodeAs<S2C_JoinRoomNtfMsg>(body, bodySize, event);
+        case MessageType::kLEAVE_ROOM_ACK:
+            return DecodeAs<S2C_LeaveRoomAckMsg>(body, bodySize, event);
+        case MessageType::kLEAVE_ROOM_NTF:
+            return DecodeAs<S2C_LeaveRoomNtfMsg>(body, bodySize, event);
+        case MessageType::kCHAT_IN_ROOM_ACK:
+            return DecodeAs<S2C_ChatInRoomAckMsg>(body, bodySize, event);
+        case MessageType::kCHAT_IN_ROOM_NTF:
+            return DecodeAs<S2C_ChatInRoomNtfMsg>(body, bodySize, event);
+        case MessageType::kROSTER_ACK:
+            return DecodeAs<S2C_RosterAckMsg>(body, bodySize, event);
+        case MessageType::kHISTORY_ACK:
+            return DecodeAs<S2C_HistoryAckMsg>(body, bodySize, event);
+        case MessageType::kRESUME_ACK:
+            return DecodeAs<S2C_ResumeAckMsg>(body, bodySize, event);
+        case MessageType::kCOMPRESSED:
+            return DecodeCompressed(body, bodySize, event);
+        case MessageType::kPING: {
+            // a heartbeat, answered from here so that an application busy elsewhere is not taken for a dead one
+            S2C_PingMsg ping;
+            if (!Decode(body, bodySize, ping)) return false;
+            SendPong(ping.sequence);
+            return true;
+        }
+        default:
+            printf("unknown message.\n");
+            return true;
+    }
+}
+
+// Decompress a S2C_Compressed and decode the packet inside it
+bool ChatRoomClient::DecodeCompressed(const char* body, uint32 bodySize, std::optional<ServerEvent>& event) {
+    S2C_CompressedView msg;
+    if (!Decode(body, bodySize, msg) || !DecompressPacket(msg, m_Dictionary, m_Inflated)) return false;
+
+    MessageType messageType = static_cast<MessageType>(LoadUInt32LE(m_Inflated.data() + sizeof(uint32)));
+    if (messageType == MessageType::kCOMPRESSED) return false;
+    return DecodeEvent(messageType, m_Inflated.data() + sizeof(PacketHeader), msg.originalSize - sizeof(PacketHeader),
+                       event);
+}
+
+// Queue an event for the application thread, and wake it if it is waiting.
+// A full inbox means the application has fallen behind: stop reading until it
+// catches up, TCP pushes back on the server meanwhile.
+// returns false if the client is shutting down
+bool ChatRoomClient::Deliver(ServerEvent&& event) {
+    while (!m_Inbox.TryPush(std::move(event))) {
+        if (!m_Running) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    // pairs with the fence in DispatchEvents: either the application thread
+    // sees the event before it sleeps, or we see it waiting and wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_InboxWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock{m_InboxMutex};
+        m_InboxReady.notify_one();
+    }
+    return true;
+}
+
+int ChatRoomClient::DispatchEvents(int timeoutMs) {
+    if (m_Inbox.Empty() && timeoutMs > 0) {
+        std::unique_lock<std::mutex> lock{m_InboxMutex};
+        m_InboxWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_InboxReady.wait_for(lock, std::chrono::milliseconds{timeoutMs}, [this]() { return !m_Inbox.Empty(); });
+        m_InboxWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    int handled = 0;
+    ServerEvent event;
+    while (m_Inbox.TryPop(event)) {
+        std::visit([this](const auto& e) { HandleEvent(e); }, event);
+        handled++;
+    }
+    return handled;
 }
 
 // [send] C2S_LoginReqMsg
 int ChatRoomClient::ReqLogin(const std::string& userName, const std::string& password) {
     m_MyUserName = userName;
 
-    C2S_LoginReqMsg msg{userName, password};
-    msg.Serialize(m_SendBuf);
-
-    return SendRequest(&msg);
+    C2S_LoginReqMsg msg{userName, password, Feature::kFEATURE_LZ4};
+    return SendRequest(msg.kTYPE, Encode(msg));
 }
 
 // [send] C2S_JoinRoomReqMsg
+// a roster kept from an earlier join only needs the changes since
 int ChatRoomClient::ReqJoinRoom(const std::string& roomName) {
-    C2S_JoinRoomReqMsg msg{m_MyUserName, roomName};
-    msg.Serialize(m_SendBuf);
+    uint32 rosterVersion = 0;
+    std::map<std::string, RosterSync>::const_iterator it = m_RosterSync.find(roomName);
+    if (it != m_RosterSync.end() && it->second.pagesVersion == 0 && !it->second.resyncing) {
+        rosterVersion = it->second.version;
+    }
 
-    return SendRequest(&msg);
+    C2S_JoinRoomReqMsg msg{m_MyUserName, roomName, rosterVersion};
+    return SendRequest(msg.kTYPE, Encode(msg));
 }
 
 // [send] C2S_LeaveRoomReqMsg
 int ChatRoomClient::ReqLeaveRoom(const std::string& roomName) {
     C2S_LeaveRoomReqMsg msg{roomName, m_MyUserName};
-    msg.Serialize(m_SendBuf);
-
-    return SendRequest(&msg);
+    return SendRequest(msg.kTYPE, Encode(msg));
 }
 
 // [send] C2S_ChatInRoomReqMsg
 int ChatRoomClient::ReqChatInRoom(const std::string& roomName, const std::string chat) {
     C2S_ChatInRoomReqMsg msg{roomName, m_MyUserName, chat};
-    msg.Serialize(m_SendBuf);
+    return SendRequest(msg.kTYPE, Encode(msg));
+}
+
+// [send] C2S_HistoryReqMsg
+int ChatRoomClient::ReqHistory(const std::string& roomName, uint32 afterSeq, uint32 count) {
+    C2S_HistoryReqMsg msg{roomName, afterSeq, count};
+    return SendRequest(msg.kTYPE, Encode(msg));
+}
+
+// [send] C2S_ResumeReqMsg
+int ChatRoomClient::ReqResume() {
+    C2S_ResumeReqMsg msg{m_MyUserName, m_ResumeToken, Feature::kFEATURE_LZ4};
+    return SendRequest(msg.kTYPE, Encode(msg));
+}
 
-    return SendRequest(&msg);
+// [send] C2S_RosterReqMsg
+int ChatRoomClient::ReqRoster(const std::string& roomName, uint32 sinceVersion, uint32 cursor) {
+    C2S_RosterReqMsg msg{roomName, sinceVersion, cursor};
+    return SendRequest(msg.kTYPE, Encode(msg));
 }
 
 // print the rooms
@@ -234,185 +458,282 @@ void ChatRoomClient::PrintUsersInRoom(const std::string& roomName) const {
     std::cout << "---------------------\n";
 }
 
-// Handle received messages
-void ChatRoomClient::HandleMessage(network::MessageType msgType) {
-    switch (msgType) {
-        // login ACK
-        case MessageType::kLOGIN_ACK: {
-            uint16 status = m_RecvBuf.ReadUInt16LE();
-            if (status == MessageStatus::kSUCCESS) {
-                uint32 roomListLength = m_RecvBuf.ReadUInt32LE();
-                std::vector<uint32> roomNameLengths;
-                for (size_t i = 0; i < roomListLength; i++) {
-                    roomNameLengths.push_back(m_RecvBuf.ReadUInt32LE());
-                }
-
-                std::vector<std::string> roomNames;
-                for (size_t i = 0; i < roomListLength; i++) {
-                    std::string roomName = m_RecvBuf.ReadString(roomNameLengths[i]);
-                    roomNames.push_back(roomName);
-                }
-
-                PrintRooms(roomNames);
-            } else {
-                m_ClientState = ClientState::kOFFLINE;
-                printf("loign failed, status: %d\n", status);
-            }
-        } break;
-
-        // join room ACK
-        case MessageType::kJOIN_ROOM_ACK: {
-            uint16 status = m_RecvBuf.ReadUInt16LE();
-            if (status == MessageStatus::kSUCCESS) {
-                uint32 roomNameLength = m_RecvBuf.ReadUInt32LE();
-                std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-
-                uint32 userListLength = m_RecvBuf.ReadUInt32LE();
-                std::vector<uint32> userNameLengths;
-                for (size_t i = 0; i < userListLength; i++) {
-                    userNameLengths.push_back(m_RecvBuf.ReadUInt32LE());
-                }
-
-                std::set<std::string> userNames;
-                for (size_t i = 0; i < userListLength; i++) {
-                    std::string userName = m_RecvBuf.ReadString(userNameLengths[i]);
-                    userNames.insert(userName);
-                }
-                // update JoinedRoomNames & JoinedRoomMap
-                m_JoinedRoomNames.insert(roomName);
-                std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(roomName);
-                if (it != m_JoinedRoomMap.end()) {
-                    (it->second).merge(userNames);
-                } else {
-                    m_JoinedRoomMap.insert(std::make_pair(roomName, userNames));
-                }
-
-                printf("join room #%s OK\n", roomName.c_str());
-                printf("joined rooms: ");
-                for (const std::string& room : m_JoinedRoomNames) {
-                    std::cout << room << " ";
-                }
-                printf("\n");
-
-                PrintUsersInRoom(roomName);
-            } else {
-                m_ClientState = ClientState::kOFFLINE;
-                printf("join room failed, status: %d\n", status);
-            }
-        } break;
-
-        // join room NTF
-        case MessageType::kJOIN_ROOM_NTF: {
-            uint32 roomNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-            uint32 userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-
-            printf("'%s' has joined room #%s\n", userName.c_str(), roomName.c_str());
-            // update JoinedRoomMap
-            std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(roomName);
-            if (it != m_JoinedRoomMap.end()) {
-                (it->second).insert(userName);
-            }
-            PrintUsersInRoom(roomName);
-        } break;
-
-        // leave room ACK
-        case MessageType::kLEAVE_ROOM_ACK: {
-            uint16 status = m_RecvBuf.ReadUInt16LE();
-            if (status == MessageStatus::kSUCCESS) {
-                uint32 roomNameLength = m_RecvBuf.ReadUInt32LE();
-                std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-                uint32 userNameLength = m_RecvBuf.ReadUInt32LE();
-                std::string userName = m_RecvBuf.ReadString(userNameLength);
-
-                // update JoinedRoomNames & JoinedRoomMap
-                m_JoinedRoomNames.erase(roomName);
-                std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(roomName);
-                if (it != m_JoinedRoomMap.end()) {
-                    (it->second).erase(userName);
-                }
-
-                printf("leaved room #%s OK\n", roomName.c_str());
-                printf("joined rooms: ");
-                for (const std::string& room : m_JoinedRoomNames) {
-                    std::cout << room << " ";
-                }
-                printf("\n");
-            } else {
-                m_ClientState = ClientState::kOFFLINE;
-                printf("leave room failed, status: %d\n", status);
-            }
-        } break;
-
-        // leave room NTF
-        case MessageType::kLEAVE_ROOM_NTF: {
-            uint32 roomNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-            uint32 userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-
-            printf("'%s' has left room #%s\n", userName.c_str(), roomName.c_str());
-            // update JoinedRoomMap
-            std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(roomName);
-            if (it != m_JoinedRoomMap.end()) {
-                (it->second).erase(userName);
-            }
-            PrintUsersInRoom(roomName);
-        } break;
-
-        // chat in room ACK
-        case MessageType::kCHAT_IN_ROOM_ACK: {
-            uint16 status = m_RecvBuf.ReadUInt16LE();
-            if (status == MessageStatus::kSUCCESS) {
-                uint32 roomNameLength = m_RecvBuf.ReadUInt32LE();
-                std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-                uint32 userNameLength = m_RecvBuf.ReadUInt32LE();
-                std::string userName = m_RecvBuf.ReadString(userNameLength);
-
-                printf("chat OK.\n");
-            } else {
-                m_ClientState = ClientState::kOFFLINE;
-                printf("chat failed, status: %d\n", status);
-            }
-        } break;
+// login ACK
+void ChatRoomClient::HandleEvent(const S2C_LoginAckMsg& ack) {
+    if (ack.loginStatus == MessageStatus::kSUCCESS) {
+        m_ResumeToken = ack.resumeToken;
+        PrintRooms(ack.roomNames);
+    } else {
+        m_ClientState = ClientState::kOFFLINE;
+        printf("loign failed, status: %d\n", ack.loginStatus);
+    }
+}
 
-        // chat in room NTF
-        case MessageType::kCHAT_IN_ROOM_NTF: {
-            uint32 roomNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-            uint32 userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-            uint32 chatLength = m_RecvBuf.ReadUInt32LE();
-            std::string chat = m_RecvBuf.ReadString(chatLength);
+// join room ACK
+void ChatRoomClient::HandleEvent(const S2C_JoinRoomAckMsg& ack) {
+    if (ack.joinStatus == MessageStatus::kSUCCESS) {
+        // update JoinedRoomNames
+        m_JoinedRoomNames.insert(ack.roomName);
 
-            printf("'%s' - #%s: %s\n", userName.c_str(), roomName.c_str(), chat.c_str());
-        } break;
+        printf("join room #%s OK\n", ack.roomName.c_str());
+        printf("joined rooms: ");
+        for (const std::string& room : m_JoinedRoomNames) {
+            std::cout << room << " ";
+        }
+        printf("\n");
 
-        default:
-            printf("unknown message.\n");
-            break;
+        // update JoinedRoomMap
+        ApplyRoster(ack.roomName, ack.userNames, ack.leftUserNames, ack.rosterVersion, ack.rosterKind,
+                    ack.nextCursor);
+    } else {
+        m_ClientState = ClientState::kOFFLINE;
+        printf("join room failed, status: %d\n", ack.joinStatus);
+    }
+}
+
+// join room NTF
+void ChatRoomClient::HandleEvent(const S2C_JoinRoomNtfMsg& ntf) {
+    printf("'%s' has joined room #%s\n", ntf.userName.c_str(), ntf.roomName.c_str());
+    // update JoinedRoomMap
+    std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(ntf.roomName);
+    if (it != m_JoinedRoomMap.end() && CheckRosterVersion(ntf.roomName, ntf.rosterVersion)) {
+        (it->second).insert(ntf.userName);
+    }
+    PrintUsersInRoom(ntf.roomName);
+}
+
+// leave room ACK
+void ChatRoomClient::HandleEvent(const S2C_LeaveRoomAckMsg& ack) {
+    if (ack.leaveStatus == MessageStatus::kSUCCESS) {
+        // update JoinedRoomNames & JoinedRoomMap
+        m_JoinedRoomNames.erase(ack.roomName);
+        std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(ack.roomName);
+        if (it != m_JoinedRoomMap.end()) {
+            (it->second).erase(ack.userName);
+        }
+
+        printf("leaved room #%s OK\n", ack.roomName.c_str());
+        printf("joined rooms: ");
+        for (const std::string& room : m_JoinedRoomNames) {
+            std::cout << room << " ";
+        }
+        printf("\n");
+    } else {
+        m_ClientState = ClientState::kOFFLINE;
+        printf("leave room failed, status: %d\n", ack.leaveStatus);
+    }
+}
+
+// leave room NTF
+void ChatRoomClient::HandleEvent(const S2C_LeaveRoomNtfMsg& ntf) {
+    printf("'%s' has left room #%s\n", ntf.userName.c_str(), ntf.roomName.c_str());
+    // update JoinedRoomMap
+    std::map<std::string, std::set<std::string>>::iterator it = m_JoinedRoomMap.find(ntf.roomName);
+    if (it != m_JoinedRoomMap.end() && CheckRosterVersion(ntf.roomName, ntf.rosterVersion)) {
+        (it->second).erase(ntf.userName);
+    }
+    PrintUsersInRoom(ntf.roomName);
+}
+
+// chat in room ACK
+void ChatRoomClient::HandleEvent(const S2C_ChatInRoomAckMsg& ack) {
+    if (ack.chatStatus == MessageStatus::kSUCCESS) {
+        printf("chat OK.\n");
+    } else {
+        m_ClientState = ClientState::kOFFLINE;
+        printf("chat failed, status: %d\n", ack.chatStatus);
+    }
+}
+
+// chat in room NTF
+void ChatRoomClient::HandleEvent(const S2C_ChatInRoomNtfMsg& ntf) {
+    uint32& lastSeq = m_ChatSeq[ntf.roomName];
+    if (ntf.seq <= lastSeq) return;
+
+    if (lastSeq != 0 && ntf.seq > lastSeq + 1) {
+        // e.g. broadcasts dropped while this client was slow, or said while it was out of the room
+        printf("missed %u chats in #%s, fetching them\n", ntf.seq - lastSeq - 1, ntf.roomName.c_str());
+        uint32& until = m_HistoryUntil[ntf.roomName];
+        until = std::max(until, ntf.seq - 1);
+        ReqHistory(ntf.roomName, lastSeq, ntf.seq - lastSeq - 1);
+    }
+    lastSeq = ntf.seq;
+    printf("'%s' - #%s: %s\n", ntf.userName.c_str(), ntf.roomName.c_str(), ntf.chat.c_str());
+}
+
+// history ACK, every packet in it is a S2C_ChatInRoomNtf
+void ChatRoomClient::HandleEvent(const S2C_HistoryAckMsg& ack) {
+    if (ack.historyStatus != MessageStatus::kSUCCESS) {
+        printf("history of #%s failed, status: %d\n", ack.roomName.c_str(), ack.historyStatus);
+        m_HistoryUntil.erase(ack.roomName);
+        return;
+    }
+
+    for (const std::string& packet : ack.packets) {
+        S2C_ChatInRoomNtfView ntf;
+        if (packet.size() < sizeof(PacketHeader) ||
+            LoadUInt32LE(packet.data() + sizeof(uint32)) != MessageType::kCHAT_IN_ROOM_NTF ||
+            !Decode(packet.data() + sizeof(PacketHeader), static_cast<uint32>(packet.size() - sizeof(PacketHeader)),
+                    ntf)) {
+            continue;
+        }
+        printf("(earlier) '%.*s' - #%.*s: %.*s\n", static_cast<int>(ntf.userName.size()), ntf.userName.data(),
+               static_cast<int>(ntf.roomName.size()), ntf.roomName.data(), static_cast<int>(ntf.chat.size()),
+               ntf.chat.data());
+    }
+
+    // an ack stops short of the chats asked for when they do not fit in one packet, the rest come after newestSeq
+    auto until = m_HistoryUntil.find(ack.roomName);
+    if (until == m_HistoryUntil.end()) return;
+    if (!ack.packets.empty() && ack.newestSeq < until->second) {
+        ReqHistory(ack.roomName, ack.newestSeq, until->second - ack.newestSeq);
+    } else {
+        m_HistoryUntil.erase(until);
+    }
+}
+
+// roster ACK, a page or the changes asked for by ReqRoster
+void ChatRoomClient::HandleEvent(const S2C_RosterAckMsg& ack) {
+    if (ack.rosterStatus == MessageStatus::kSUCCESS) {
+        ApplyRoster(ack.roomName, ack.userNames, ack.leftUserNames, ack.rosterVersion, ack.rosterKind,
+                    ack.nextCursor);
+    } else {
+        m_RosterSync.erase(ack.roomName);
+        printf("roster of #%s failed, status: %d\n", ack.roomName.c_str(), ack.rosterStatus);
+    }
+}
+
+// Apply a roster page or delta to JoinedRoomMap, then ask for whatever is still missing:
+// the next page, or after the last one the changes made while paging
+void ChatRoomClient::ApplyRoster(const std::string& roomName, const std::vector<std::string>& userNames,
+                                 const std::vector<std::string>& leftUserNames, uint32 version, uint16 kind,
+                                 uint32 nextCursor) {
+    std::set<std::string>& users = m_JoinedRoomMap[roomName];
+    RosterSync& sync = m_RosterSync[roomName];
+
+    if (kind == RosterKind::kROSTER_DELTA) {
+        users.insert(userNames.begin(), userNames.end());
+        for (const std::string& name : leftUserNames) {
+            users.erase(name);
+        }
+        sync.version = version;
+        sync.resyncing = false;
+        PrintUsersInRoom(roomName);
+        return;
+    }
+
+    // the first page replaces whatever was there
+    if (sync.pagesVersion == 0) {
+        users.clear();
+        sync.pagesVersion = version;
+    }
+    users.insert(userNames.begin(), userNames.end());
+    if (nextCursor != 0) {
+        ReqRoster(roomName, sync.pagesVersion, nextCursor);
+        return;
+    }
+
+    // the pages hold the members as of the first one at least
+    sync.version = sync.pagesVersion;
+    sync.pagesVersion = 0;
+    sync.resyncing = version != sync.version;
+    if (sync.resyncing) {
+        ReqRoster(roomName, sync.version, 0);
+        return;
+    }
+    PrintUsersInRoom(roomName);
+}
+
+// Check a NTF's roster version against the room's
+// returns false if the roster already has the change (the NTF is stale)
+bool ChatRoomClient::CheckRosterVersion(const std::string& roomName, uint32 version) {
+    std::map<std::string, RosterSync>::iterator it = m_RosterSync.find(roomName);
+    if (it == m_RosterSync.end()) return true;
+
+    RosterSync& sync = it->second;
+    if (version <= std::max(sync.version, sync.pagesVersion)) return false;
+    // a page or delta on the way settles the version
+    if (sync.pagesVersion != 0 || sync.resyncing) return true;
+
+    if (version != sync.version + 1) {
+        // changes were missed, e.g. broadcasts dropped while this client was slow
+        sync.resyncing = true;
+        ReqRoster(roomName, sync.version, 0);
+        return true;
+    }
+    sync.version = version;
+    return true;
+}
+
+// resume ACK
+// the rosters and chats missed while away are caught up with like those of a slow client
+void ChatRoomClient::HandleEvent(const S2C_ResumeAckMsg& ack) {
+    if (ack.resumeStatus != MessageStatus::kSUCCESS) {
+        // the session is gone, the rooms have to be joined again after a login
+        m_ResumeToken.clear();
+        m_JoinedRoomNames.clear();
+        m_ClientState = ClientState::kOFFLINE;
+        printf("the session has expired, log in again\n");
+        return;
+    }
+
+    // a token is good for one resume, the next one takes the token that came with this ack
+    m_ResumeToken = ack.resumeToken;
+    m_JoinedRoomNames = std::set<std::string>(ack.roomNames.begin(), ack.roomNames.end());
+    printf("back in %d rooms\n", static_cast<int>(m_JoinedRoomNames.size()));
+    for (const std::string& room : m_JoinedRoomNames) {
+        std::map<std::string, RosterSync>::iterator it = m_RosterSync.find(room);
+        if (it == m_RosterSync.end() || it->second.pagesVersion != 0 || it->second.resyncing) continue;
+        it->second.resyncing = true;
+        ReqRoster(room, it->second.version, 0);
+    }
+}
+
+// the network thread has stopped
+// with a session to go back to, connect once more and resume it
+void ChatRoomClient::HandleEvent(const ConnectionLost&) {
+    m_ClientState = ClientState::kOFFLINE;
+    printf("lost the connection to the server\n");
+
+    if (m_ResumeToken.empty()) return;
+    if (Reconnect() == 0) {
+        ReqResume();
     }
 }
 
 // Shutdown and cleanup include:
-// 1. shutdown socket
-// 2. close socket
-// 3. freeaddrinfo
-// 4. WSACleanup
+// 1. stop the network thread
+// 2. shutdown socket
+// 3. close socket
+// 4. freeaddrinfo
+// 5. WSACleanup
 int ChatRoomClient::Shutdown() {
+    if (m_NetworkThread.joinable()) {
+        m_Running = false;
+        m_Waker->Wake();
+        m_NetworkThread.join();
+    }
+    m_Poller.reset();
+    m_Waker.reset();
+    m_ClientState = ClientState::kOFFLINE;
+
+    if (m_ConnectSocket == INVALID_SOCKET) {
+        return 0;
+    }
+
     int result = shutdown(m_ConnectSocket, SD_SEND);
     if (result == SOCKET_ERROR) {
-        printf("shutdown failed with error: %d\n", WSAGetLastError());
-        return 1;
+        printf("shutdown failed with error: %d\n", LastSocketError());
     } else {
         printf("shutdown OK!\n");
     }
 
     printf("closing socket ... \n");
-    closesocket(m_ConnectSocket);
+    CloseSocket(m_ConnectSocket);
+    m_ConnectSocket = INVALID_SOCKET;
     freeaddrinfo(m_AddrInfo);
-    WSACleanup();
+    m_AddrInfo = nullptr;
+    CleanupSockets();
 
     return result;
 }
@@ -1,15 +1,23 @@
 #pragma once
 
-#define WIN32_LEAN_AND_MEAN
-#include <WinSock2.h>
-
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <string>
+#include <thread>
+#include <variant>
 #include <vector>
 
-#include "buffer.h"
 #include "message.h"
+#include "poller.h"
+#include "ring_buffer.h"
+#include "socket.h"
+#include "spsc_queue.h"
+#include "waker.h"
 
 // the client state
 enum ClientState {
@@ -17,19 +25,50 @@ enum ClientState {
     kONLINE,   // online (loged in server)
 };
 
+// The connection is gone: closed, failed, or the server sent something that does not decode
+struct ConnectionLost {};
+
+// A message from the server, decoded by the network thread into owned fields
+typedef std::variant<network::S2C_LoginAckMsg, network::S2C_JoinRoomAckMsg, network::S2C_JoinRoomNtfMsg,
+                     network::S2C_LeaveRoomAckMsg, network::S2C_LeaveRoomNtfMsg, network::S2C_ChatInRoomAckMsg,
+                     network::S2C_ChatInRoomNtfMsg, network::S2C_RosterAckMsg, network::S2C_HistoryAckMsg,
+                     network::S2C_ResumeAckMsg, ConnectionLost>
+    ServerEvent;
+
+// How far a room's roster in m_JoinedRoomMap is in sync with the server
+// NTFs carry the room's roster version: the next one in line is applied, older ones are stale,
+// and a gap (broadcasts dropped while the client was slow) is filled by asking for the changes since
+struct RosterSync {
+    uint32 version = 0;       // the roster version the users reflect, 0 for none
+    uint32 pagesVersion = 0;  // while paging through the members, the version of the first page
+    bool resyncing = false;   // a delta request is out
+};
+
 // the ChatRoom client
+//
+// A network thread blocks in a poller until the socket has data, decodes
+// whole messages and hands them to the application thread through a
+// lock-free queue. The chat room state below is only ever touched by the
+// application thread, in DispatchEvents(), and requests are sent from there.
 class ChatRoomClient {
 public:
     ChatRoomClient(const std::string& host, uint16 port);
     ~ChatRoomClient();
 
-    int RecvResponse();
+    // application thread: handle every event queued by the network thread,
+    // waiting up to timeoutMs for one if there is none yet
+    // returns the number of events handled
+    int DispatchEvents(int timeoutMs);
 
     // Requests
     int ReqLogin(const std::string& userName, const std::string& password);
     int ReqJoinRoom(const std::string& roomName);
     int ReqLeaveRoom(const std::string& roomName);
     int ReqChatInRoom(const std::string& roomName, const std::string chat);
+    // a room's chats after afterSeq, or with afterSeq 0 its last count chats
+    int ReqHistory(const std::string& roomName, uint32 afterSeq, uint32 count);
+    // take the session of the last login back after a reconnect, with the token its ack gave
+    int ReqResume();
 
     // Print
     void PrintRooms(const std::vector<std::string>& roomNames) const;
@@ -37,29 +76,82 @@ public:
 
 private:
     int Initialize(const std::string& host, uint16 port);
-    int SendRequest(network::Message* msg);
+    int Reconnect();
+    int SendRequest(network::MessageType msgType, const std::vector<uint8>& packet);
+    int SendAll(const char* data, int size);
+    void SendPong(uint32 sequence);
+    int ReqRoster(const std::string& roomName, uint32 sinceVersion, uint32 cursor);
+
+    // network thread
+    void NetworkLoop();
+    bool ReadFromServer();
+    bool HandlePackets();
+    bool DecodeEvent(network::MessageType msgType, const char* body, uint32 bodySize,
+                     std::optional<ServerEvent>& event);
+    bool DecodeCompressed(const char* body, uint32 bodySize, std::optional<ServerEvent>& event);
+    bool Deliver(ServerEvent&& event);
 
-    void HandleMessage(network::MessageType msgType);
+    // application thread, one per event
+    void HandleEvent(const network::S2C_LoginAckMsg& ack);
+    void HandleEvent(const network::S2C_JoinRoomAckMsg& ack);
+    void HandleEvent(const network::S2C_JoinRoomNtfMsg& ntf);
+    void HandleEvent(const network::S2C_LeaveRoomAckMsg& ack);
+    void HandleEvent(const network::S2C_LeaveRoomNtfMsg& ntf);
+    void HandleEvent(const network::S2C_ChatInRoomAckMsg& ack);
+    void HandleEvent(const network::S2C_ChatInRoomNtfMsg& ntf);
+    void HandleEvent(const network::S2C_RosterAckMsg& ack);
+    void HandleEvent(const network::S2C_HistoryAckMsg& ack);
+    void HandleEvent(const network::S2C_ResumeAckMsg& ack);
+    void HandleEvent(const ConnectionLost& lost);
+    void ApplyRoster(const std::string& roomName, const std::vector<std::string>& userNames,
+                     const std::vector<std::string>& leftUserNames, uint32 version, uint16 kind, uint32 nextCursor);
+    bool CheckRosterVersion(const std::string& roomName, uint32 version);
 
     int Shutdown();
 
 private:
     // low-level network stuff
+    std::string m_Host;  // kept to reconnect
+    uint16 m_Port = 0;
     SOCKET m_ConnectSocket = INVALID_SOCKET;
     struct addrinfo* m_AddrInfo = nullptr;
+    std::mutex m_SendMutex;  // requests go out from the application thread, pongs from the network thread
+    std::vector<char> m_SendBacklog;  // the unsent rest of a pong, sent before anything else, under m_SendMutex
 
-    // send/recv buffer
-    static constexpr int kRECV_BUF_SIZE = 512;
-    char m_RawRecvBuf[kRECV_BUF_SIZE];
-    network::Buffer m_RecvBuf{kSEND_BUF_SIZE};
+    // network thread, blocked in m_Poller until the socket is readable or m_Waker is woken for shutdown
+    std::thread m_NetworkThread;
+    std::atomic<bool> m_Running{false};
+    std::unique_ptr<Poller> m_Poller;
+    std::vector<PollEvent> m_ReadyEvents;
+    std::unique_ptr<Waker> m_Waker;  // created after the socket layer is started, it may be a socket
+    network::RingBuffer m_RecvBuf;  // bytes received but not yet decoded
+    std::string m_Dictionary;       // compression dictionary, built from the login ack's room names
+    std::vector<char> m_Inflated;   // the packet inside the last S2C_Compressed
 
-    static constexpr int kSEND_BUF_SIZE = 512;
-    network::Buffer m_SendBuf{kSEND_BUF_SIZE};
+    // network thread -> application thread
+    // m_InboxWaiting is set while the application thread sleeps on m_InboxReady,
+    // so the network thread only takes the mutex when there is someone to wake
+    static constexpr uint32 kINBOX_CAPACITY = 1024;
+    SpscQueue<ServerEvent> m_Inbox{kINBOX_CAPACITY};
+    std::atomic<bool> m_InboxWaiting{false};
+    std::mutex m_InboxMutex;
+    std::condition_variable m_InboxReady;
 
-    // logic variables
+    // logic variables, application thread only
     ClientState m_ClientState = ClientState::kOFFLINE;
     std::string m_MyUserName;
+    std::string m_ResumeToken;  // from the last login or resume ack, empty if the server keeps no session to resume
     std::set<std::string> m_JoinedRoomNames;  // rooms already joined
     std::map<std::string, std::set<std::string>>
-        m_JoinedRoomMap;  // roomName (string) -> userNames (set of string), only joined rooms
-};
\ No newline at end of file
+        m_JoinedRoomMap;  // roomName (string) -> userNames (set of string), kept after leaving
+    std::map<std::string, RosterSync> m_RosterSync;  // roomName -> version of its m_JoinedRoomMap entry
+    // roomName -> seq of the last chat seen, a chat at or below it was already shown (e.g. backfilled on a rejoin)
+    // and a jump past it means chats were missed, they are fetched with ReqHistory
+    std::map<std::string, uint32> m_ChatSeq;
+    // roomName -> seq of the last missed chat, while the history acks come back short of it they are followed up
+    std::map<std::string, uint32> m_HistoryUntil;
+
+    // poller tokens
+    static constexpr uint64 kSOCKET_TOKEN = 0;
+    static constexpr uint64 kWAKE_TOKEN = 1;
+};
@@ -2,7 +2,6 @@
 
 #include <iostream>
 #include <random>
-#include <thread>
 
 #include "client.h"
 
@@ -11,6 +10,8 @@
 
 #define DEFAULT_PORT 5555
 
+constexpr int kKEYBOARD_POLL_MS = 50;
+
 // this snippet is generated by Codeium
 std::string MumboJumbo() {
     // Define the subjects and adjectives
@@ -32,12 +33,6 @@ std::string MumboJumbo() {
     return sentence;
 }
 
-void RecvLoop(ChatRoomClient* client) {
-    while (true) {
-        client->RecvResponse();
-    }
-}
-
 int main(int argc, char** argv) {
     std::string userName{"Fan"};
     std::string password{"Fanshawe"};
@@ -49,14 +44,15 @@ int main(int argc, char** argv) {
 
     ChatRoomClient client{"127.0.0.1", DEFAULT_PORT};
 
-    std::thread t{RecvLoop, &client};
-
     std::cout << "Pressed Enter key to execute each step" << std::endl;
 
     // Send messages to the server when a key is pressed
     int step = 0;
     int bQuit = false;
     while (!bQuit) {
+        // handle what the server sent, sleeping while there is nothing, the keyboard is checked at least this often
+        client.DispatchEvents(kKEYBOARD_POLL_MS);
+
         if (_kbhit()) {
             char key = _getch();
             if (key == '\r') {
@@ -91,7 +87,5 @@ int main(int argc, char** argv) {
         }
     }
 
-    t.join();
-
     return 0;
 }
@@ -0,0 +1,472 @@
+#include "bot_swarm.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "compression.h"
+
+using namespace network;
+
+namespace {
+// a chat starts with the time it was scheduled for, as 16 hex digits of steady_clock nanoseconds
+constexpr uint32 kTIMESTAMP_SIZE = 16;
+
+void WriteTimestamp(TimePoint when, char* out) {
+    static const char kHEX[] = "0123456789abcdef";
+    uint64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+    for (int i = kTIMESTAMP_SIZE - 1; i >= 0; i--) {
+        out[i] = kHEX[ns & 0xf];
+        ns >>= 4;
+    }
+}
+
+// false for a chat that does not come from a bot
+bool ReadTimestamp(std::string_view chat, TimePoint& when) {
+    if (chat.size() < kTIMESTAMP_SIZE) return false;
+    uint64 ns = 0;
+    for (uint32 i = 0; i < kTIMESTAMP_SIZE; i++) {
+        char c = chat[i];
+        uint64 digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else {
+            return false;
+        }
+        ns = (ns << 4) | digit;
+    }
+    when = TimePoint{std::chrono::duration_cast<TimePoint::duration>(std::chrono::nanoseconds{ns})};
+    return true;
+}
+
+uint64 NanosecondsBetween(TimePoint from, TimePoint to) {
+    if (to < from) return 0;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+}  // namespace
+
+void SwarmStats::Merge(const SwarmStats& other) {
+    sessionsReady += other.sessionsReady;
+    chatsSent += other.chatsSent;
+    chatAcks += other.chatAcks;
+    ntfsReceived += other.ntfsReceived;
+    bytesSent += other.bytesSent;
+    bytesReceived += other.bytesReceived;
+    sendCalls += other.sendCalls;
+    recvCalls += other.recvCalls;
+    connectErrors += other.connectErrors;
+    loginErrors += other.loginErrors;
+    joinErrors += other.joinErrors;
+    chatErrors += other.chatErrors;
+    disconnects += other.disconnects;
+    malformed += other.malformed;
+    compressedPackets += other.compressedPackets;
+    compressedBytes += other.compressedBytes;
+    inflatedBytes += other.inflatedBytes;
+    ackLatency.Merge(other.ackLatency);
+    echoLatency.Merge(other.echoLatency);
+    fanoutLatency.Merge(other.fanoutLatency);
+}
+
+BotSwarm::BotSwarm(const SwarmConfig& config, uint32 firstSession, uint32 sessionCount, TimePoint start)
+    : m_Config(config),
+      m_FirstSession(firstSession),
+      m_Sessions(sessionCount),
+      m_Random(firstSession),
+      m_MeasureStart(start + config.warmup),
+      m_End(start + config.warmup + config.duration) {
+    m_Config.minChatSize = std::max(m_Config.minChatSize, kTIMESTAMP_SIZE);
+    m_Config.maxChatSize = std::max(m_Config.maxChatSize, m_Config.minChatSize);
+}
+
+BotSwarm::~BotSwarm() {
+    for (Session& session : m_Sessions) {
+        Disconnect(session);
+    }
+    if (m_AddrInfo != nullptr) {
+        freeaddrinfo(m_AddrInfo);
+    }
+}
+
+// Connect every session, then run the event loop until the end of the run
+void BotSwarm::Run() {
+    m_Poller = CreatePoller(m_Config.pollerType);
+    if (!m_Poller) {
+        printf("poller not available\n");
+        return;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    int result = getaddrinfo(m_Config.host.c_str(), std::to_string(m_Config.port).c_str(), &hints, &m_AddrInfo);
+    if (result != 0) {
+        printf("getaddrinfo failed with error: %d\n", result);
+        m_Stats.connectErrors += m_Sessions.size();
+        return;
+    }
+
+    // the server accepts into its backlog, so blocking connects are quick and ramp the sessions up in order
+    for (uint32 i = 0; i < m_Sessions.size(); i++) {
+        Session& session = m_Sessions[i];
+        session.userName = "bot" + std::to_string(m_FirstSession + i);
+        if (!Connect(session)) {
+            m_Stats.connectErrors++;
+            continue;
+        }
+        if (m_Poller->Add(session.socket, kPOLL_READ, i) == SOCKET_ERROR) {
+            printf("%s add failed with error: %d\n", m_Poller->Name(), LastSocketError());
+            Disconnect(session);
+            m_Stats.connectErrors++;
+            continue;
+        }
+        session.pollFlags = kPOLL_READ;
+
+        uint32 features = m_Config.compression ? static_cast<uint32>(Feature::kFEATURE_LZ4) : 0u;
+        C2S_LoginReqView msg{session.userName, "loadgen", features};
+        Send(session, Frame::Encode(msg));
+        UpdateInterest(i);
+    }
+
+    while (true) {
+        TimePoint now = std::chrono::steady_clock::now();
+        if (now >= m_End) break;
+
+        // sleep until the next chat is due, but not past the end of the run
+        TimePoint wakeUp = m_Schedule.empty() ? m_End : std::min(m_Schedule.top().when, m_End);
+        int timeoutMs = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(wakeUp - now).count());
+        int count = m_Poller->Wait(m_ReadyEvents, std::max(timeoutMs, 0));
+        if (count == SOCKET_ERROR) {
+            printf("%s wait failed with error: %d\n", m_Poller->Name(), LastSocketError());
+            break;
+        }
+
+        for (const PollEvent& event : m_ReadyEvents) {
+            uint32 index = static_cast<uint32>(event.token);
+            if (event.flags & (kPOLL_READ | kPOLL_ERROR)) {
+                ReadFromSession(index);
+            }
+            if (event.flags & kPOLL_WRITE) {
+                Flush(m_Sessions[index]);
+                UpdateInterest(index);
+            }
+        }
+
+        // every chat that is due, late ones included, keeps its scheduled time
+        now = std::chrono::steady_clock::now();
+        while (!m_Schedule.empty() && m_Schedule.top().when <= now) {
+            ScheduledChat chat = m_Schedule.top();
+            m_Schedule.pop();
+            SendChat(chat.session, chat.when);
+        }
+    }
+}
+
+bool BotSwarm::Connect(Session& session) {
+    session.socket = socket(m_AddrInfo->ai_family, m_AddrInfo->ai_socktype, m_AddrInfo->ai_protocol);
+    if (session.socket == INVALID_SOCKET) {
+        printf("socket failed with error: %d\n", LastSocketError());
+        return false;
+    }
+
+    if (connect(session.socket, m_AddrInfo->ai_addr, (int)m_AddrInfo->ai_addrlen) == SOCKET_ERROR) {
+        printf("connect failed with error: %d\n", LastSocketError());
+        CloseSocket(session.socket);
+        session.socket = INVALID_SOCKET;
+        return false;
+    }
+
+    // requests are small and latency is what is measured, do not let Nagle hold them back
+    int noDelay = 1;
+    setsockopt(session.socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+    if (SetNonBlocking(session.socket) == SOCKET_ERROR) {
+        printf("set non-blocking failed with error: %d\n", LastSocketError());
+        CloseSocket(session.socket);
+        session.socket = INVALID_SOCKET;
+        return false;
+    }
+
+    session.connected = true;
+    return true;
+}
+
+void BotSwarm::Disconnect(Session& session) {
+    if (!session.connected) return;
+
+    m_Poller->Remove(session.socket);
+    CloseSocket(session.socket);
+    session.socket = INVALID_SOCKET;
+    session.connected = false;
+    session.sendQueue.Clear();
+    session.pendingAcks.clear();
+}
+
+// recv until the socket would block, handling every complete packet
+void BotSwarm::ReadFromSession(uint32 index) {
+    Session& session = m_Sessions[index];
+    while (session.connected) {
+        RingBuffer& ring = session.recvBuf;
+        int recvResult = recv(session.socket, ring.WritePtr(), (int)ring.WritableSize(), 0);
+        if (recvResult < 0) {
+            int error = LastSocketError();
+            if (IsWouldBlock(error)) {
+                break;
+            }
+            printf("%s: recv failed with error: %d\n", session.userName.c_str(), error);
+            m_Stats.disconnects++;
+            Disconnect(session);
+            break;
+        }
+        if (recvResult == 0) {
+            printf("%s: disconnected by the server\n", session.userName.c_str());
+            m_Stats.disconnects++;
+            Disconnect(session);
+            break;
+        }
+
+        ring.Commit(recvResult);
+        if (Measuring(std::chrono::steady_clock::now())) {
+            m_Stats.bytesReceived += recvResult;
+            m_Stats.recvCalls++;
+        }
+        if (!HandlePackets(index)) {
+            m_Stats.disconnects++;
+            Disconnect(session);
+            break;
+        }
+    }
+    // the replies to what was received may not all have been written
+    UpdateInterest(index);
+}
+
+// returns false if the stream is corrupt
+bool BotSwarm::HandlePackets(uint32 index) {
+    RingBuffer& ring = m_Sessions[index].recvBuf;
+
+    uint32 packetSize = 0;
+    while (ring.PeekUInt32LE(0, packetSize)) {
+        if (packetSize < sizeof(PacketHeader) || packetSize > kMAX_PACKET_SIZE) {
+            printf("invalid packet size %u from the server\n", packetSize);
+            m_Stats.malformed++;
+            return false;
+        }
+        if (ring.ReadableSize() < packetSize) {
+            ring.Reserve(packetSize);
+            break;
+        }
+
+        const char* packet = ring.Contiguous(packetSize);
+        MessageType messageType = static_cast<MessageType>(LoadUInt32LE(packet + sizeof(uint32)));
+        if (!HandleMessage(messageType, packet + sizeof(PacketHeader), packetSize - sizeof(PacketHeader), index)) {
+            printf("malformed message %u from the server\n", messageType);
+            m_Stats.malformed++;
+            return false;
+        }
+        ring.Consume(packetSize);
+    }
+    return true;
+}
+
+// returns false if the message does not decode
+bool BotSwarm::HandleMessage(MessageType msgType, const char* body, uint32 bodySize, uint32 index) {
+    Session& session = m_Sessions[index];
+    TimePoint now = std::chrono::steady_clock::now();
+
+    switch (msgType) {
+        case MessageType::kLOGIN_ACK: {
+            S2C_LoginAckView ack;
+            if (!Decode(body, bodySize, ack)) return false;
+
+            if (ack.loginStatus != MessageStatus::kSUCCESS || ack.roomNames.Count() == 0) {
+                m_Stats.loginErrors++;
+                break;
+            }
+            if (ack.features & Feature::kFEATURE_LZ4) {
+                session.dictionary = BuildDictionary(ack.roomNames);
+            }
+
+            // spread the sessions over the rooms: session i joins rooms i, i + 1, ...
+            std::vector<std::string_view> roomNames{ack.roomNames.begin(), ack.roomNames.end()};
+            uint32 roomCount = std::min<uint32>(m_Config.roomsPerSession, ack.roomNames.Count());
+            for (uint32 k = 0; k < roomCount; k++) {
+                std::string_view roomName = roomNames[(m_FirstSession + index + k) % roomNames.size()];
+                session.rooms.emplace_back(roomName);
+                C2S_JoinRoomReqView msg{session.userName, roomName, 0};
+                Send(session, Frame::Encode(msg));
+            }
+            session.state = SessionState::kJOINING;
+        } break;
+
+        case MessageType::kJOIN_ROOM_ACK: {
+            S2C_JoinRoomAckView ack;
+            if (!Decode(body, bodySize, ack)) return false;
+
+            if (ack.joinStatus != MessageStatus::kSUCCESS) {
+                m_Stats.joinErrors++;
+                break;
+            }
+            session.joinAcks++;
+            if (session.state == SessionState::kJOINING && session.joinAcks == session.rooms.size()) {
+                session.state = SessionState::kCHATTING;
+                m_Stats.sessionsReady++;
+                ScheduleChat(index, now);
+            }
+        } break;
+
+        case MessageType::kCHAT_IN_ROOM_ACK: {
+            S2C_ChatInRoomAckView ack;
+            if (!Decode(body, bodySize, ack)) return false;
+            if (session.pendingAcks.empty()) break;
+
+            TimePoint scheduled = session.pendingAcks.front();
+            session.pendingAcks.pop_front();
+            if (ack.chatStatus != MessageStatus::kSUCCESS) {
+                m_Stats.chatErrors++;
+                break;
+            }
+            if (!Measuring(scheduled)) break;
+
+            m_Stats.chatAcks++;
+            m_Stats.ackLatency.Record(NanosecondsBetween(scheduled, now));
+        } break;
+
+        case MessageType::kCHAT_IN_ROOM_NTF: {
+            S2C_ChatInRoomNtfView ntf;
+            if (!Decode(body, bodySize, ntf)) return false;
+
+            TimePoint scheduled;
+            if (!ReadTimestamp(ntf.chat, scheduled) || !Measuring(scheduled)) break;
+
+            m_Stats.ntfsReceived++;
+            if (ntf.userName == session.userName) {
+                m_Stats.echoLatency.Record(NanosecondsBetween(scheduled, now));
+            } else {
+                m_Stats.fanoutLatency.Record(NanosecondsBetween(scheduled, now));
+            }
+        } break;
+
+        case MessageType::kJOIN_ROOM_NTF:
+        case MessageType::kLEAVE_ROOM_ACK:
+        case MessageType::kLEAVE_ROOM_NTF:
+            // the bots never leave, and do not track the rosters
+            break;
+
+        case MessageType::kPING: {
+            // a heartbeat, a bot that only listens would be taken for a dead one otherwise
+            S2C_PingMsg ping;
+            if (!Decode(body, bodySize, ping)) return false;
+            Send(session, Frame::Encode(C2S_PongMsg{ping.sequence}));
+        } break;
+
+        case MessageType::kCOMPRESSED: {
+            S2C_CompressedView msg;
+            if (!Decode(body, bodySize, msg) || !DecompressPacket(msg, session.dictionary, m_Inflated)) return false;
+
+            MessageType innerType = static_cast<MessageType>(LoadUInt32LE(m_Inflated.data() + sizeof(uint32)));
+            if (innerType == MessageType::kCOMPRESSED) return false;
+            m_Stats.compressedPackets++;
+            m_Stats.compressedBytes += sizeof(PacketHeader) + bodySize;
+            m_Stats.inflatedBytes += msg.originalSize;
+            return HandleMessage(innerType, m_Inflated.data() + sizeof(PacketHeader),
+                                 msg.originalSize - sizeof(PacketHeader), index);
+        }
+
+        default:
+            printf("unknown message %u from the server\n", msgType);
+            break;
+    }
+    return true;
+}
+
+// Send one chat scheduled for `scheduled`, then schedule the next one
+void BotSwarm::SendChat(uint32 index, TimePoint scheduled) {
+    Session& session = m_Sessions[index];
+    if (!session.connected || session.rooms.empty()) return;
+
+    std::uniform_int_distribution<uint32> sizeDist(m_Config.minChatSize, m_Config.maxChatSize);
+    m_Chat.assign(sizeDist(m_Random), 'x');
+    WriteTimestamp(scheduled, &m_Chat[0]);
+
+    const std::string& roomName = session.rooms[session.nextRoom];
+    session.nextRoom = (session.nextRoom + 1) % session.rooms.size();
+
+    C2S_ChatInRoomReqView msg{roomName, session.userName, m_Chat};
+    if (Measuring(scheduled)) {
+        m_Stats.chatsSent++;
+    }
+    session.pendingAcks.push_back(scheduled);
+    ScheduleChat(index, scheduled);
+
+    FramePtr frame;
+    if (m_Config.batchSize <= 1) {
+        frame = Frame::Encode(msg);
+    } else {
+        std::vector<uint8> packet = Encode(msg);
+        session.batch.emplace_back(packet.begin(), packet.end());
+        if (session.batch.size() < m_Config.batchSize) return;
+
+        C2S_BatchReqMsg batch;
+        batch.packets.swap(session.batch);
+        frame = Frame::Encode(batch);
+    }
+
+    if (Measuring(scheduled)) {
+        m_Stats.bytesSent += frame->Size();
+    }
+    Send(session, frame);
+    UpdateInterest(index);
+}
+
+void BotSwarm::ScheduleChat(uint32 index, TimePoint after) {
+    if (m_Config.chatsPerSecond <= 0) return;
+
+    std::exponential_distribution<double> gapDist(m_Config.chatsPerSecond);
+    std::chrono::duration<double> gap{gapDist(m_Random)};
+    m_Schedule.push(ScheduledChat{after + std::chrono::duration_cast<TimePoint::duration>(gap), index});
+}
+
+// queue a frame and write as much as the socket takes
+void BotSwarm::Send(Session& session, const FramePtr& frame) {
+    if (!session.connected) return;
+    session.sendQueue.Push(frame);
+    Flush(session);
+}
+
+void BotSwarm::Flush(Session& session) {
+    if (!session.connected || session.sendQueue.Empty()) return;
+
+    uint64 sendCalls = 0;
+    int sent = session.sendQueue.Flush(session.socket, sendCalls);
+    if (Measuring(std::chrono::steady_clock::now())) {
+        m_Stats.sendCalls += sendCalls;
+    }
+    if (sent == SOCKET_ERROR) {
+        printf("%s: send failed with error: %d\n", session.userName.c_str(), LastSocketError());
+        m_Stats.disconnects++;
+        Disconnect(session);
+    }
+}
+
+// watch for writes only while frames are queued
+void BotSwarm::UpdateInterest(uint32 index) {
+    Session& session = m_Sessions[index];
+    if (!session.connected) return;
+
+    uint32 flags = kPOLL_READ;
+    if (!session.sendQueue.Empty()) flags |= kPOLL_WRITE;
+    if (flags == session.pollFlags) return;
+
+    if (m_Poller->Modify(session.socket, flags, index) == SOCKET_ERROR) {
+        printf("%s modify failed with error: %d\n", m_Poller->Name(), LastSocketError());
+        m_Stats.disconnects++;
+        Disconnect(session);
+        return;
+    }
+    session.pollFlags = flags;
+}
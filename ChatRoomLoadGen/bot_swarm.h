@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "message.h"
+#include "outbound_queue.h"
+#include "poller.h"
+#include "ring_buffer.h"
+#include "socket.h"
+
+typedef std::chrono::steady_clock::time_point TimePoint;
+
+// Load generator tunables
+struct SwarmConfig {
+    std::string host = "127.0.0.1";
+    uint16 port = 5555;
+    PollerType pollerType = DefaultPollerType();
+
+    uint32 sessions = 100;  // over all threads
+    uint32 threads = 1;     // each thread runs its share of the sessions
+    uint32 roomsPerSession = 1;
+
+    // per session, the gaps between chats are exponentially distributed (a Poisson process),
+    // so the sessions do not fire in lockstep
+    double chatsPerSecond = 1;
+    // chat length in bytes, uniformly distributed, at least the timestamp the chat carries
+    uint32 minChatSize = 64;
+    uint32 maxChatSize = 64;
+    // chats per C2S_BatchReq, 1 sends each chat in its own packet
+    // a batch goes out when its last chat is due, the earlier ones' latency includes the wait
+    uint32 batchSize = 1;
+    // ask the server for compression at login
+    bool compression = false;
+
+    // latencies and counts are recorded from the end of the warmup to the end of the run
+    std::chrono::seconds warmup{2};
+    std::chrono::seconds duration{10};
+};
+
+// What a swarm saw during the measured part of the run
+struct SwarmStats {
+    uint64 sessionsReady = 0;  // logged in and joined all their rooms, over the whole run
+    uint64 chatsSent = 0;
+    uint64 chatAcks = 0;
+    uint64 ntfsReceived = 0;
+    uint64 bytesSent = 0;
+    uint64 bytesReceived = 0;
+    uint64 sendCalls = 0;
+    uint64 recvCalls = 0;
+
+    // errors, over the whole run
+    uint64 connectErrors = 0;
+    uint64 loginErrors = 0;
+    uint64 joinErrors = 0;
+    uint64 chatErrors = 0;   // chat acks with a failure status
+    uint64 disconnects = 0;  // connections lost, by either side or a socket error
+    uint64 malformed = 0;    // packets that do not decode
+
+    // S2C_Compressed received over the whole run, and the size of what they held
+    uint64 compressedPackets = 0;
+    uint64 compressedBytes = 0;
+    uint64 inflatedBytes = 0;
+
+    LatencyHistogram ackLatency;     // chat sent -> its ack
+    LatencyHistogram echoLatency;    // chat sent -> its NTF back to the sender
+    LatencyHistogram fanoutLatency;  // chat sent -> its NTF at another member of the room
+
+    void Merge(const SwarmStats& other);
+};
+
+// Simulated chat sessions driven by one event loop.
+//
+// Every session logs in, joins its rooms, then chats at the configured rate.
+// A chat carries the time it was scheduled for, and every member receiving its
+// NTF records the latency from there. Measuring from the schedule rather than
+// from when the send actually happened keeps a stalled server (or generator)
+// from hiding its own delay.
+class BotSwarm {
+public:
+    // sessions [firstSession, firstSession + sessionCount) of the run, the run ends at start + warmup + duration
+    BotSwarm(const SwarmConfig& config, uint32 firstSession, uint32 sessionCount, TimePoint start);
+    ~BotSwarm();
+
+    void Run();
+
+    const SwarmStats& Stats() const { return m_Stats; }
+
+private:
+    enum SessionState {
+        kLOGGING_IN,  // login sent, waiting for the ack
+        kJOINING,     // join requests sent, waiting for their acks
+        kCHATTING,
+    };
+
+    struct Session {
+        SOCKET socket = INVALID_SOCKET;
+        bool connected = false;
+        SessionState state = SessionState::kLOGGING_IN;
+        std::string userName;
+        std::vector<std::string> rooms;  // joined, or being joined
+        uint32 joinAcks = 0;
+        uint32 nextRoom = 0;             // chats go to the rooms in turn
+        network::RingBuffer recvBuf;
+        OutboundQueue sendQueue;
+        uint32 pollFlags = 0;
+        std::deque<TimePoint> pendingAcks;  // scheduled times of the chats not acked yet, acks come in order
+        std::vector<std::string> batch;     // encoded chats waiting for the rest of their batch
+        std::string dictionary;             // compression dictionary, from the login ack's room names
+    };
+
+    // a session's next chat, the earliest on top
+    struct ScheduledChat {
+        TimePoint when;
+        uint32 session;
+        bool operator>(const ScheduledChat& other) const { return when > other.when; }
+    };
+
+    bool Connect(Session& session);
+    void Disconnect(Session& session);
+    void ReadFromSession(uint32 index);
+    bool HandlePackets(uint32 index);
+    bool HandleMessage(network::MessageType msgType, const char* body, uint32 bodySize, uint32 index);
+    void SendChat(uint32 index, TimePoint scheduled);
+    void ScheduleChat(uint32 index, TimePoint after);
+    void Send(Session& session, const network::FramePtr& frame);
+    void Flush(Session& session);
+    void UpdateInterest(uint32 index);
+    bool Measuring(TimePoint when) const { return when >= m_MeasureStart; }
+
+private:
+    SwarmConfig m_Config;
+    uint32 m_FirstSession;
+    std::vector<Session> m_Sessions;
+
+    std::unique_ptr<Poller> m_Poller;
+    std::vector<PollEvent> m_ReadyEvents;
+    struct addrinfo* m_AddrInfo = nullptr;
+
+    std::priority_queue<ScheduledChat, std::vector<ScheduledChat>, std::greater<ScheduledChat>> m_Schedule;
+    std::mt19937_64 m_Random;
+    std::string m_Chat;            // SendChat() scratch
+    std::vector<char> m_Inflated;  // the packet inside the last S2C_Compressed
+
+    TimePoint m_MeasureStart;
+    TimePoint m_End;
+    SwarmStats m_Stats;
+};
@@ -0,0 +1,73 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// index of the highest set bit, value must not be 0
+uint32 HighestBit(uint64 value) {
+    uint32 bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+}  // namespace
+
+LatencyHistogram::LatencyHistogram() : m_Buckets(kBUCKET_COUNT, 0) {}
+
+// values below kSUB_BUCKETS map to themselves, above that a value is
+// (top << shift) with top in [kSUB_BUCKETS / 2, kSUB_BUCKETS), and each
+// shift adds kSUB_BUCKETS / 2 buckets
+uint32 LatencyHistogram::BucketOf(uint64 value) {
+    if (value < kSUB_BUCKETS) {
+        return static_cast<uint32>(value);
+    }
+    uint32 shift = HighestBit(value) - (kSUB_BUCKET_BITS - 1);
+    uint32 top = static_cast<uint32>(value >> shift);
+    return kSUB_BUCKETS + (shift - 1) * (kSUB_BUCKETS / 2) + (top - kSUB_BUCKETS / 2);
+}
+
+uint64 LatencyHistogram::UpperBoundOf(uint32 bucket) {
+    if (bucket < kSUB_BUCKETS) {
+        return bucket;
+    }
+    uint32 shift = (bucket - kSUB_BUCKETS) / (kSUB_BUCKETS / 2) + 1;
+    uint64 top = (bucket - kSUB_BUCKETS) % (kSUB_BUCKETS / 2) + kSUB_BUCKETS / 2;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64 nanoseconds) {
+    m_Buckets[BucketOf(nanoseconds)]++;
+    m_Count++;
+    m_Sum += nanoseconds;
+    m_Min = std::min(m_Min, nanoseconds);
+    m_Max = std::max(m_Max, nanoseconds);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (uint32 i = 0; i < kBUCKET_COUNT; i++) {
+        m_Buckets[i] += other.m_Buckets[i];
+    }
+    m_Count += other.m_Count;
+    m_Sum += other.m_Sum;
+    m_Min = std::min(m_Min, other.m_Min);
+    m_Max = std::max(m_Max, other.m_Max);
+}
+
+uint64 LatencyHistogram::Percentile(double percentile) const {
+    if (m_Count == 0) return 0;
+
+    // the rank of the value, 1-based
+    uint64 rank = static_cast<uint64>(std::ceil(percentile / 100.0 * m_Count));
+    rank = std::max<uint64>(rank, 1);
+
+    uint64 seen = 0;
+    for (uint32 i = 0; i < kBUCKET_COUNT; i++) {
+        seen += m_Buckets[i];
+        if (seen >= rank) {
+            return std::min(UpperBoundOf(i), m_Max);
+        }
+    }
+    return m_Max;
+}
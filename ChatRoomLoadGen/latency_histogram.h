@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "common.h"
+
+// A log-linear histogram of latencies in nanoseconds.
+//
+// Values below kSUB_BUCKETS get a bucket each, above that every power of two
+// is split into kSUB_BUCKETS / 2 buckets, so a recorded value is off by less
+// than 2 / kSUB_BUCKETS (about 3%) whatever its magnitude. Recording is an
+// increment, and histograms of different threads merge by adding counts.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void Record(uint64 nanoseconds);
+    void Merge(const LatencyHistogram& other);
+
+    uint64 Count() const { return m_Count; }
+    uint64 Min() const { return m_Count == 0 ? 0 : m_Min; }
+    uint64 Max() const { return m_Max; }
+    double Mean() const { return m_Count == 0 ? 0 : static_cast<double>(m_Sum) / m_Count; }
+
+    // the value at or below which `percentile` percent of the recorded values fall, e.g. 99.9
+    // reported as the upper bound of its bucket, so it never understates
+    uint64 Percentile(double percentile) const;
+
+private:
+    static uint32 BucketOf(uint64 value);
+    static uint64 UpperBoundOf(uint32 bucket);
+
+    static constexpr uint32 kSUB_BUCKET_BITS = 6;
+    static constexpr uint32 kSUB_BUCKETS = 1 << kSUB_BUCKET_BITS;
+    // up to 2^63 ns, far more than a run lasts
+    static constexpr uint32 kBUCKET_COUNT = kSUB_BUCKETS + (64 - kSUB_BUCKET_BITS) * (kSUB_BUCKETS / 2);
+
+private:
+    std::vector<uint64> m_Buckets;
+    uint64 m_Count = 0;
+    uint64 m_Sum = 0;
+    uint64 m_Min = ~0ull;
+    uint64 m_Max = 0;
+};
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bot_swarm.h"
+
+#ifdef _WIN32
+// Need to link Ws2_32.lib
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+
+namespace {
+// "n" or "min-max"
+bool ParseSizeRange(const char* value, uint32& minSize, uint32& maxSize) {
+    char* end = nullptr;
+    minSize = static_cast<uint32>(strtoul(value, &end, 10));
+    if (end == value) return false;
+    maxSize = minSize;
+    if (*end == '-') {
+        const char* max = end + 1;
+        maxSize = static_cast<uint32>(strtoul(max, &end, 10));
+        if (end == max) return false;
+    }
+    return *end == '\0' && minSize <= maxSize;
+}
+
+void PrintLatency(const char* name, const LatencyHistogram& histogram) {
+    printf("%-8s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, histogram.Count(), histogram.Min() / 1e3,
+           histogram.Percentile(50) / 1e3, histogram.Percentile(99) / 1e3, histogram.Percentile(99.9) / 1e3,
+           histogram.Max() / 1e3, histogram.Mean() / 1e3);
+}
+
+void PrintReport(const SwarmConfig& config, const SwarmStats& stats) {
+    double seconds = std::chrono::duration<double>(config.duration).count();
+
+    printf("\n%u sessions (%llu ready) on %u threads, %.2f chats/s each, %u-%u byte chats in batches of %u, "
+           "%.0f s measured\n",
+           config.sessions, stats.sessionsReady, config.threads, config.chatsPerSecond, config.minChatSize,
+           config.maxChatSize, config.batchSize, seconds);
+    printf("throughput: %.0f chats/s sent, %.0f acks/s, %.0f ntfs/s received, %.2f MB/s out, %.2f MB/s in\n",
+           stats.chatsSent / seconds, stats.chatAcks / seconds, stats.ntfsReceived / seconds,
+           stats.bytesSent / seconds / (1024 * 1024), stats.bytesReceived / seconds / (1024 * 1024));
+    printf("syscalls: %.0f send/s, %.0f recv/s, %.1f ntfs per recv\n", stats.sendCalls / seconds,
+           stats.recvCalls / seconds,
+           stats.recvCalls > 0 ? static_cast<double>(stats.ntfsReceived) / stats.recvCalls : 0.0);
+    printf("errors: %llu connect, %llu login, %llu join, %llu chat, %llu disconnects, %llu malformed\n",
+           stats.connectErrors, stats.loginErrors, stats.joinErrors, stats.chatErrors, stats.disconnects,
+           stats.malformed);
+    if (config.compression) {
+        printf("compression: %llu packets, %llu -> %llu bytes (%.2fx), over the whole run\n", stats.compressedPackets,
+               stats.inflatedBytes, stats.compressedBytes,
+               stats.compressedBytes > 0 ? static_cast<double>(stats.inflatedBytes) / stats.compressedBytes : 0.0);
+    }
+
+    printf("\n%-8s %10s %10s %10s %10s %10s %10s %10s\n", "us", "count", "min", "p50", "p99", "p999", "max",
+           "mean");
+    PrintLatency("ack", stats.ackLatency);
+    PrintLatency("echo", stats.echoLatency);
+    PrintLatency("fanout", stats.fanoutLatency);
+}
+}  // namespace
+
+// usage: ChatRoomLoadGen [--host address] [--port n] [--poller select|epoll|io_uring] [--sessions n] [--threads n]
+//                        [--rooms n] [--rate chats/s] [--size bytes|min-max] [--batch chats] [--warmup s]
+//                        [--duration s] [--compression on|off]
+int main(int argc, char** argv) {
+    SwarmConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            printf("missing value for '%s'\n", arg);
+            return 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--host") == 0) {
+            config.host = value;
+        } else if (strcmp(arg, "--port") == 0) {
+            config.port = static_cast<uint16>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--poller") == 0) {
+            if (!ParsePollerType(value, config.pollerType)) {
+                printf("unsupported poller '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--sessions") == 0) {
+            config.sessions = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--threads") == 0) {
+            config.threads = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--rooms") == 0) {
+            config.roomsPerSession = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--rate") == 0) {
+            config.chatsPerSecond = strtod(value, nullptr);
+        } else if (strcmp(arg, "--size") == 0) {
+            if (!ParseSizeRange(value, config.minChatSize, config.maxChatSize)) {
+                printf("invalid chat size '%s', expected bytes or min-max\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--batch") == 0) {
+            config.batchSize = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--compression") == 0) {
+            if (strcmp(value, "on") == 0) {
+                config.compression = true;
+            } else if (strcmp(value, "off") == 0) {
+                config.compression = false;
+            } else {
+                printf("--compression is on or off, not '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--warmup") == 0) {
+            config.warmup = std::chrono::seconds{strtoul(value, nullptr, 10)};
+        } else if (strcmp(arg, "--duration") == 0) {
+            config.duration = std::chrono::seconds{strtoul(value, nullptr, 10)};
+        } else {
+            printf("unknown option '%s'\n", arg);
+            return 1;
+        }
+    }
+
+    if (config.threads == 0 || config.sessions < config.threads || config.duration.count() == 0) {
+        printf("need at least one thread, one session per thread and a non-zero duration\n");
+        return 1;
+    }
+
+    if (network::StartupSockets() != 0) {
+        printf("socket startup failed\n");
+        return 1;
+    }
+
+    // the sessions are dealt out evenly, the first threads take the remainder
+    TimePoint start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<BotSwarm>> swarms;
+    uint32 firstSession = 0;
+    for (uint32 i = 0; i < config.threads; i++) {
+        uint32 count = config.sessions / config.threads + (i < config.sessions % config.threads ? 1 : 0);
+        swarms.push_back(std::make_unique<BotSwarm>(config, firstSession, count, start));
+        firstSession += count;
+    }
+
+    printf("running %u sessions for %lld s after a %lld s warmup\n", config.sessions,
+           static_cast<long long>(config.duration.count()), static_cast<long long>(config.warmup.count()));
+    std::vector<std::thread> threads;
+    for (std::unique_ptr<BotSwarm>& swarm : swarms) {
+        threads.emplace_back(&BotSwarm::Run, swarm.get());
+    }
+
+    SwarmStats total;
+    for (uint32 i = 0; i < config.threads; i++) {
+        threads[i].join();
+        total.Merge(swarms[i]->Stats());
+    }
+    PrintReport(config, total);
+
+    swarms.clear();
+    network::CleanupSockets();
+    return 0;
+}
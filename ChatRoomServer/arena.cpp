@@ -0,0 +1,45 @@
+#include "arena.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    for (; m_Current < m_Chunks.size(); m_Current++, m_Offset = 0) {
+        Chunk& chunk = m_Chunks[m_Current];
+        size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+        if (offset + size <= chunk.size) {
+            m_Offset = offset + size;
+            return chunk.data.get() + offset;
+        }
+    }
+
+    // out of chunks, a larger request than usual gets one of its own size
+    // new[] of char is aligned for any type, offset 0 fits every alignment
+    Chunk chunk{std::make_unique<char[]>(std::max(size, kCHUNK_SIZE)), std::max(size, kCHUNK_SIZE)};
+    m_Chunks.push_back(std::move(chunk));
+    m_Current = m_Chunks.size() - 1;
+    m_Offset = size;
+    return m_Chunks.back().data.get();
+}
+
+std::string_view Arena::Copy(std::string_view str) {
+    if (str.empty()) return std::string_view{};
+
+    char* copy = static_cast<char*>(Allocate(str.size(), 1));
+    memcpy(copy, str.data(), str.size());
+    return std::string_view{copy, str.size()};
+}
+
+void Arena::Reset() {
+    m_Current = 0;
+    m_Offset = 0;
+}
+
+size_t Arena::Capacity() const {
+    size_t capacity = 0;
+    for (const Chunk& chunk : m_Chunks) {
+        capacity += chunk.size;
+    }
+    return capacity;
+}
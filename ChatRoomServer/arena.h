@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+
+// A bump allocator for the temporaries of handling one request, freed all at once by Reset().
+//
+// Memory comes in chunks that are kept across resets, so once the arena has
+// grown to what a request takes, handling one does not allocate. Nothing in
+// it is destroyed: what goes in must be trivially destructible, or a
+// container whose memory all comes from the same arena (see ArenaAllocator).
+class Arena {
+public:
+    static constexpr size_t kCHUNK_SIZE = 64 * 1024;
+
+    Arena() = default;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // alignment is a power of two, at most alignof(std::max_align_t)
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // a copy of str that lives until the next Reset()
+    std::string_view Copy(std::string_view str);
+
+    // free everything at once, the chunks are kept for reuse
+    void Reset();
+
+    // bytes in chunks, used or not
+    size_t Capacity() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Chunk> m_Chunks;
+    size_t m_Current = 0;  // the chunk being bumped
+    size_t m_Offset = 0;   // the next free byte in it
+};
+
+// std allocator over an Arena, deallocating is a no-op
+template <typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->Allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    Arena* arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena != b.arena;
+}
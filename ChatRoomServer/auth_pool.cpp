@@ -0,0 +1,58 @@
+#include "auth_pool.h"
+
+#include <algorithm>
+
+AuthPool::AuthPool(const CredentialConfig& config, uint32 threads, uint32 queueLimit, Completion complete)
+    : m_Store(config), m_QueueLimit(std::max(queueLimit, 1u)), m_Complete(std::move(complete)) {
+    uint32 count = std::max(threads, 1u);
+    for (uint32 i = 0; i < count; i++) {
+        m_Workers.emplace_back(&AuthPool::WorkerLoop, this);
+    }
+}
+
+AuthPool::~AuthPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Wake.notify_all();
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+bool AuthPool::Submit(AuthRequest&& request) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Queue.size() >= m_QueueLimit) return false;
+        m_Queue.push_back(std::move(request));
+    }
+    m_Wake.notify_one();
+    return true;
+}
+
+uint32 AuthPool::Waiting() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return static_cast<uint32>(m_Queue.size());
+}
+
+void AuthPool::WorkerLoop() {
+    // the hash's working memory, allocated by the first check and kept
+    std::vector<uint32> scratch;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;) {
+        m_Wake.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+        if (m_Stopping) return;
+
+        AuthRequest request = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        lock.unlock();
+
+        AuthVerdict verdict = m_Store.Check(request.userName, request.password, scratch);
+        std::fill(request.password.begin(), request.password.end(), '\0');
+        m_Complete(request, verdict);
+
+        lock.lock();
+    }
+}
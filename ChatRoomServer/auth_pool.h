@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "credential_store.h"
+
+// A login waiting for its password to be checked
+struct AuthRequest {
+    uint32 reactor = 0;  // the reactor the login came in on, the verdict goes back to it
+    uint64 client = 0;   // the client's handle there
+    std::string userName;
+    std::string password;
+};
+
+// Checks login passwords against the CredentialStore on worker threads of its own.
+//
+// A check costs a memory-hard hash, milliseconds of CPU and megabytes of
+// memory, which an event loop cannot spend without stalling every room it
+// serves. The event loops submit logins instead and carry on, and a worker
+// hands each verdict to the completion, which posts it back to the login's
+// reactor. At most queueLimit logins wait, a storm of them past that is turned
+// away at once rather than queued for longer than any client would wait.
+class AuthPool {
+public:
+    // called on a worker thread
+    typedef std::function<void(const AuthRequest& request, AuthVerdict verdict)> Completion;
+
+    AuthPool(const CredentialConfig& config, uint32 threads, uint32 queueLimit, Completion complete);
+    // the logins still waiting get no verdict
+    ~AuthPool();
+
+    AuthPool(const AuthPool&) = delete;
+    AuthPool& operator=(const AuthPool&) = delete;
+
+    // any thread, returns false if queueLimit logins are waiting already
+    bool Submit(AuthRequest&& request);
+
+    // logins waiting for a worker
+    uint32 Waiting() const;
+
+private:
+    void WorkerLoop();
+
+private:
+    CredentialStore m_Store;
+    uint32 m_QueueLimit;
+    Completion m_Complete;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::deque<AuthRequest> m_Queue;
+    bool m_Stopping = false;
+    std::vector<std::thread> m_Workers;
+};
@@ -0,0 +1,130 @@
+#include "chat_history.h"
+
+#include <algorithm>
+
+#include "message.h"
+
+using namespace network;
+
+ChatHistory::ChatHistory(const std::vector<std::string>& roomNames, uint32 capacity, const ChatLog* log)
+    : m_Capacity(capacity) {
+    for (const std::string& roomName : roomNames) {
+        m_RoomIds.Intern(roomName);
+        std::unique_ptr<RoomHistory> room = std::make_unique<RoomHistory>();
+        room->ring.resize(m_Capacity);
+        m_Rooms.push_back(std::move(room));
+    }
+
+    if (log != nullptr) {
+        std::vector<FramePtr> frames;
+        for (const std::string& roomName : roomNames) {
+            log->Recent(roomName, m_Capacity, frames);
+            Seed(roomName, frames);
+        }
+    }
+}
+
+// the reactors log chats in the order they broadcast them, which across reactors may not be seq order
+void ChatHistory::Seed(std::string_view roomName, const std::vector<FramePtr>& frames) {
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return;
+    }
+
+    std::vector<std::pair<uint32, FramePtr>> numbered;
+    for (const FramePtr& frame : frames) {
+        S2C_ChatInRoomNtfView ntf;
+        if (frame->Size() < sizeof(PacketHeader) ||
+            LoadUInt32LE(frame->Data() + sizeof(uint32)) != MessageType::kCHAT_IN_ROOM_NTF ||
+            !Decode(frame->Data() + sizeof(PacketHeader), frame->Size() - sizeof(PacketHeader), ntf) ||
+            ntf.seq == 0) {
+            continue;
+        }
+        numbered.emplace_back(ntf.seq, frame);
+    }
+    std::sort(numbered.begin(), numbered.end(),
+              [](const std::pair<uint32, FramePtr>& a, const std::pair<uint32, FramePtr>& b) {
+                  return a.first < b.first;
+              });
+
+    RoomHistory& room = *m_Rooms[roomId];
+    std::lock_guard<std::mutex> lock(room.mutex);
+    if (!numbered.empty() && numbered.front().first >= room.nextSeq) {
+        room.firstSeq = numbered.front().first;
+    }
+    for (const std::pair<uint32, FramePtr>& chat : numbered) {
+        if (chat.first < room.nextSeq) continue;
+        // a gap in what was logged is left empty
+        for (uint32 seq = room.nextSeq; seq < chat.first && m_Capacity > 0; seq++) {
+            room.ring[seq % m_Capacity] = nullptr;
+        }
+        if (m_Capacity > 0) {
+            room.ring[chat.first % m_Capacity] = chat.second;
+        }
+        room.nextSeq = chat.first + 1;
+    }
+}
+
+FramePtr ChatHistory::Append(std::string_view roomName, std::string_view userName, std::string_view chat) {
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return nullptr;
+    }
+
+    // encoded under the lock, so that the ring is in seq order
+    RoomHistory& room = *m_Rooms[roomId];
+    std::lock_guard<std::mutex> lock(room.mutex);
+    uint32 seq = room.nextSeq++;
+    FramePtr frame = Frame::Encode(S2C_ChatInRoomNtfView{roomName, userName, chat, seq});
+    if (m_Capacity > 0) {
+        room.ring[seq % m_Capacity] = frame;
+    }
+    return frame;
+}
+
+bool ChatHistory::Fetch(std::string_view roomName, uint32 afterSeq, uint32 count, std::vector<FramePtr>& frames,
+                        uint32& oldestSeq, uint32& newestSeq) const {
+    frames.clear();
+    oldestSeq = 0;
+    newestSeq = 0;
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    const RoomHistory& room = *m_Rooms[roomId];
+    std::lock_guard<std::mutex> lock(room.mutex);
+    uint32 oldest = OldestSeq(room);
+    if (oldest == room.nextSeq) {
+        return true;
+    }
+    oldestSeq = oldest;
+    newestSeq = room.nextSeq - 1;
+
+    uint32 first;
+    if (afterSeq == 0) {
+        first = newestSeq - std::min(count, newestSeq - oldest + 1) + 1;
+    } else {
+        first = std::max(afterSeq + 1, oldest);
+    }
+    uint32 end = first + std::min<uint64>(count, room.nextSeq - std::min(first, room.nextSeq));
+    frames.reserve(end - first);
+    // sized as the ack will be encoded, each frame is one more string in its list
+    uint64 ackSize = PacketSize(S2C_HistoryAckGather{0, roomName, 0, 0, {}});
+    for (uint32 seq = first; seq < end; seq++) {
+        const FramePtr& frame = room.ring[seq % m_Capacity];
+        if (!frame) continue;
+        ackSize += sizeof(uint32) + frame->Size();
+        if (ackSize > kMAX_PACKET_SIZE) {
+            newestSeq = seq - 1;
+            break;
+        }
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+uint32 ChatHistory::OldestSeq(const RoomHistory& room) const {
+    uint32 kept = std::min(m_Capacity, room.nextSeq - 1);
+    return std::max(room.nextSeq - kept, std::min(room.firstSeq, room.nextSeq));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chat_log.h"
+#include "frame.h"
+#include "intern_table.h"
+
+// Each room's recent chats, kept in memory as the S2C_ChatInRoomNtf frames that were broadcast.
+//
+// A chat gets the room's next sequence number as it is encoded, and its frame
+// goes into a fixed-capacity ring that overwrites the oldest. Fetching
+// history copies frame pointers out under the room's lock, nothing is
+// encoded again and nothing is read from disk. Shared by the reactors of a
+// group like the RoomDirectory, each room has its own lock.
+class ChatHistory {
+public:
+    // with a log, each room is seeded with the chats read back from it, so the numbering carries on after a restart
+    ChatHistory(const std::vector<std::string>& roomNames, uint32 capacity, const ChatLog* log = nullptr);
+
+    ChatHistory(const ChatHistory&) = delete;
+    ChatHistory& operator=(const ChatHistory&) = delete;
+
+    // carry the room's numbering on from frames
+    // frames that are not numbered S2C_ChatInRoomNtf packets are skipped
+    void Seed(std::string_view roomName, const std::vector<network::FramePtr>& frames);
+
+    // number and encode a chat, and keep its frame
+    // returns nullptr if there is no such room
+    network::FramePtr Append(std::string_view roomName, std::string_view userName, std::string_view chat);
+
+    // fills frames with the room's chats after afterSeq, or with afterSeq 0 its last ones, count at most,
+    // oldest first, and no more than fit in one S2C_HistoryAck; oldestSeq is the oldest the ring holds and
+    // newestSeq the last chat the frames cover, the ring's newest unless the rest did not fit, both 0 if it is empty
+    // returns false if there is no such room
+    bool Fetch(std::string_view roomName, uint32 afterSeq, uint32 count, std::vector<network::FramePtr>& frames,
+               uint32& oldestSeq, uint32& newestSeq) const;
+
+private:
+    struct RoomHistory {
+        mutable std::mutex mutex;
+        std::vector<network::FramePtr> ring;  // seq s is at s % capacity
+        uint32 nextSeq = 1;
+        uint32 firstSeq = 1;  // the oldest seq ever kept, after a restart the oldest one read back
+    };
+
+    // the oldest seq the ring holds, nextSeq if none
+    uint32 OldestSeq(const RoomHistory& room) const;
+
+private:
+    uint32 m_Capacity;
+    InternTable m_RoomIds;
+    std::vector<std::unique_ptr<RoomHistory>> m_Rooms;  // by room id
+};
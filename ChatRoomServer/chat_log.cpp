@@ -0,0 +1,303 @@
+#include "chat_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "logger.h"
+#include "message.h"
+
+using namespace network;
+
+ChatLog::ChatLog(const std::vector<std::string>& roomNames, const ChatLogConfig& config) : m_Config(config) {
+    for (const std::string& roomName : roomNames) {
+        m_RoomIds.Intern(roomName);
+        std::unique_ptr<RoomLog> room = std::make_unique<RoomLog>();
+        room->directory = (std::filesystem::path(m_Config.directory) / roomName).string();
+        if (!OpenRoom(*room)) {
+            LOG_ERROR("cannot open the chat log in %s", room->directory.c_str());
+            m_Open = false;
+        }
+        m_Rooms.push_back(std::move(room));
+    }
+
+    if (m_Open && m_Config.syncPolicy == LogSyncPolicy::kLOG_SYNC_GROUP) {
+        m_SyncThread = std::thread(&ChatLog::SyncLoop, this);
+    }
+}
+
+ChatLog::~ChatLog() {
+    if (m_SyncThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_SyncMutex);
+            m_Stopping = true;
+        }
+        m_SyncWake.notify_one();
+        m_SyncThread.join();
+    }
+    if (m_Open && m_Config.syncPolicy != LogSyncPolicy::kLOG_SYNC_NONE) {
+        Sync();
+    }
+}
+
+bool ChatLog::Append(std::string_view roomName, const char* packet, uint32 size) {
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID || !m_Open) {
+        return false;
+    }
+
+    uint32 recordSize = kRECORD_HEADER_SIZE + size;
+    if (recordSize > m_Config.segmentSize) {
+        m_Rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    RoomLog& room = *m_Rooms[roomId];
+    std::unique_lock<std::mutex> lock(room.mutex);
+    if (room.writeOffset + recordSize > room.segment->file.Size() && !Rotate(room)) {
+        m_Rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // the checksum makes a record torn by a crash look like the end of the log
+    char* record = room.segment->file.Data() + room.writeOffset;
+    memcpy(record + kRECORD_HEADER_SIZE, packet, size);
+    uint32 checksum = Checksum(packet, size);
+    memcpy(record, &checksum, sizeof(checksum));
+
+    if (m_Config.recentRecords > 0) {
+        if (room.recent.size() == m_Config.recentRecords) {
+            room.recent.pop_front();
+        }
+        room.recent.push_back(RecordRef{room.segment, room.writeOffset + kRECORD_HEADER_SIZE, size});
+    }
+    room.writeOffset += recordSize;
+
+    m_Appends.fetch_add(1, std::memory_order_relaxed);
+    m_Bytes.fetch_add(recordSize, std::memory_order_relaxed);
+
+    if (m_Config.syncPolicy == LogSyncPolicy::kLOG_SYNC_ALWAYS) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        room.segment->file.Sync(room.syncedOffset, room.writeOffset - room.syncedOffset);
+        room.syncedOffset = room.writeOffset;
+        m_Syncs.fetch_add(1, std::memory_order_relaxed);
+        m_SyncNanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+            std::memory_order_relaxed);
+    } else if (m_Config.syncPolicy == LogSyncPolicy::kLOG_SYNC_GROUP &&
+               room.writeOffset - room.syncedOffset >= m_Config.syncBytes) {
+        // only the first append over the limit takes the mutex to wake the syncing thread
+        lock.unlock();
+        if (!m_SyncRequested.exchange(true, std::memory_order_acq_rel)) {
+            std::lock_guard<std::mutex> syncLock(m_SyncMutex);
+            m_SyncWake.notify_one();
+        }
+    }
+    return true;
+}
+
+bool ChatLog::Recent(std::string_view roomName, uint32 count, std::vector<FramePtr>& frames) const {
+    frames.clear();
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    const RoomLog& room = *m_Rooms[roomId];
+    std::lock_guard<std::mutex> lock(room.mutex);
+    size_t first = room.recent.size() > count ? room.recent.size() - count : 0;
+    frames.reserve(room.recent.size() - first);
+    for (size_t i = first; i < room.recent.size(); i++) {
+        // the frame keeps the segment mapped until it is sent
+        const RecordRef& ref = room.recent[i];
+        frames.push_back(std::allocate_shared<const Frame>(PoolAllocator<Frame>{}, ref.segment->file.Data() + ref.offset,
+                                                          ref.size, ref.segment));
+    }
+    return true;
+}
+
+// appends go on while the rooms are synced, only the ranges are taken under the room's lock
+void ChatLog::Sync() {
+    std::vector<PendingSync> pending;
+    for (std::unique_ptr<RoomLog>& roomPtr : m_Rooms) {
+        RoomLog& room = *roomPtr;
+        std::shared_ptr<Segment> segment;
+        uint32 begin, end;
+        {
+            std::lock_guard<std::mutex> lock(room.mutex);
+            pending.swap(room.pending);
+            segment = room.segment;
+            begin = room.syncedOffset;
+            end = room.writeOffset;
+        }
+        if (pending.empty() && begin == end) continue;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (const PendingSync& rotated : pending) {
+            rotated.segment->file.Sync(rotated.begin, rotated.end - rotated.begin);
+        }
+        pending.clear();
+        segment->file.Sync(begin, end - begin);
+        m_Syncs.fetch_add(1, std::memory_order_relaxed);
+        m_SyncNanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+            std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(room.mutex);
+        if (room.segment == segment) {
+            room.syncedOffset = std::max(room.syncedOffset, end);
+        }
+    }
+}
+
+ChatLogStats ChatLog::TakeStats() {
+    ChatLogStats stats;
+    stats.appends = m_Appends.exchange(0, std::memory_order_relaxed);
+    stats.bytes = m_Bytes.exchange(0, std::memory_order_relaxed);
+    stats.rejected = m_Rejected.exchange(0, std::memory_order_relaxed);
+    stats.syncs = m_Syncs.exchange(0, std::memory_order_relaxed);
+    stats.syncNanoseconds = m_SyncNanoseconds.exchange(0, std::memory_order_relaxed);
+    stats.rotations = m_Rotations.exchange(0, std::memory_order_relaxed);
+    return stats;
+}
+
+// Open the room's last segment and find where its records end.
+// The segment before it is scanned first, the recent records may start there.
+bool ChatLog::OpenRoom(RoomLog& room) {
+    std::error_code error;
+    std::filesystem::create_directories(room.directory, error);
+    if (error) {
+        return false;
+    }
+
+    // segment files are named after their index
+    std::vector<uint32> indices;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(room.directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (entry.path().extension() != ".log" || name.find_first_not_of("0123456789") != name.size() - 4) continue;
+        indices.push_back(static_cast<uint32>(strtoul(name.c_str(), nullptr, 10)));
+    }
+    if (error) {
+        return false;
+    }
+    std::sort(indices.begin(), indices.end());
+
+    uint32 last = indices.empty() ? 0 : indices.back();
+    if (indices.size() >= 2 && m_Config.recentRecords > 0) {
+        std::shared_ptr<Segment> previous = OpenSegment(room, indices[indices.size() - 2]);
+        if (previous) {
+            Scan(room, previous);
+        }
+    }
+
+    room.segment = OpenSegment(room, last);
+    if (!room.segment) {
+        return false;
+    }
+    room.writeOffset = Scan(room, room.segment);
+    room.syncedOffset = room.writeOffset;
+    return true;
+}
+
+// Walk a segment's records, keeping the last ones in room.recent.
+// A damaged record ends the log: the rest of the segment is zeroed so that appends cannot run into it.
+// returns the offset where the records end
+uint32 ChatLog::Scan(RoomLog& room, const std::shared_ptr<Segment>& segment) {
+    const char* data = segment->file.Data();
+    uint64 capacity = segment->file.Size();
+    uint64 offset = 0;
+    while (offset + kRECORD_HEADER_SIZE + sizeof(PacketHeader) <= capacity) {
+        uint32 checksum, packetSize;
+        memcpy(&checksum, data + offset, sizeof(checksum));
+        memcpy(&packetSize, data + offset + kRECORD_HEADER_SIZE, sizeof(packetSize));
+        if (packetSize < sizeof(PacketHeader) || offset + kRECORD_HEADER_SIZE + packetSize > capacity ||
+            Checksum(data + offset + kRECORD_HEADER_SIZE, packetSize) != checksum) {
+            break;
+        }
+
+        if (m_Config.recentRecords > 0) {
+            if (room.recent.size() == m_Config.recentRecords) {
+                room.recent.pop_front();
+            }
+            room.recent.push_back(RecordRef{segment, static_cast<uint32>(offset + kRECORD_HEADER_SIZE), packetSize});
+        }
+        offset += kRECORD_HEADER_SIZE + packetSize;
+    }
+
+    const char* tail = data + offset;
+    if (std::find_if(tail, data + capacity, [](char c) { return c != 0; }) != data + capacity) {
+        memset(segment->file.Data() + offset, 0, static_cast<size_t>(capacity - offset));
+    }
+    return static_cast<uint32>(offset);
+}
+
+// caller holds the room's lock
+// the full segment stays mapped while records in room.recent or frames in flight point into it
+bool ChatLog::Rotate(RoomLog& room) {
+    std::shared_ptr<Segment> next = OpenSegment(room, room.segment->index + 1);
+    if (!next) {
+        return false;
+    }
+
+    if (m_Config.syncPolicy == LogSyncPolicy::kLOG_SYNC_GROUP && room.syncedOffset < room.writeOffset) {
+        room.pending.push_back(PendingSync{room.segment, room.syncedOffset, room.writeOffset});
+    }
+    room.segment = std::move(next);
+    room.writeOffset = 0;
+    room.syncedOffset = 0;
+    m_Rotations.fetch_add(1, std::memory_order_relaxed);
+
+    if (room.segment->index >= m_Config.maxSegments) {
+        // a file still mapped cannot be deleted on Windows, it is left behind
+        std::error_code error;
+        std::filesystem::remove(SegmentPath(room, room.segment->index - m_Config.maxSegments), error);
+    }
+    return true;
+}
+
+std::shared_ptr<ChatLog::Segment> ChatLog::OpenSegment(const RoomLog& room, uint32 index) {
+    std::shared_ptr<Segment> segment = std::make_shared<Segment>();
+    segment->index = index;
+    if (!segment->file.Open(SegmentPath(room, index), m_Config.segmentSize)) {
+        return nullptr;
+    }
+    return segment;
+}
+
+std::string ChatLog::SegmentPath(const RoomLog& room, uint32 index) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%010u.log", index);
+    return (std::filesystem::path(room.directory) / name).string();
+}
+
+// group commit, every room's appends since the last pass go to disk with one sync each
+void ChatLog::SyncLoop() {
+    std::unique_lock<std::mutex> lock(m_SyncMutex);
+    while (!m_Stopping) {
+        m_SyncWake.wait_for(lock, m_Config.syncInterval,
+                            [this]() { return m_Stopping || m_SyncRequested.load(std::memory_order_acquire); });
+        m_SyncRequested.store(false, std::memory_order_release);
+        lock.unlock();
+        Sync();
+        lock.lock();
+    }
+}
+
+// FNV-1a style, but over 8 bytes at a time: it only has to catch torn and stale records, at memcpy speed
+uint32 ChatLog::Checksum(const char* data, uint32 size) {
+    uint64 hash = 14695981039346656037ull ^ size;
+    uint32 i = 0;
+    for (; i + sizeof(uint64) <= size; i += sizeof(uint64)) {
+        uint64 word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ static_cast<uint8>(data[i])) * 1099511628211ull;
+    }
+    return static_cast<uint32>(hash ^ (hash >> 32));
+}
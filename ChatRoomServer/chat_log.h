@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "block_pool.h"
+#include "frame.h"
+#include "intern_table.h"
+#include "mapped_file.h"
+
+// When the chat log's appends are forced to disk
+enum LogSyncPolicy {
+    kLOG_SYNC_NONE,    // never, the OS writes the pages back when it sees fit
+    kLOG_SYNC_GROUP,   // a background thread syncs everything appended since its last pass, one sync per room
+    kLOG_SYNC_ALWAYS,  // every append, before Append() returns
+};
+
+// Chat log tunables
+struct ChatLogConfig {
+    std::string directory = "chatlog";  // one subdirectory per room
+    uint32 segmentSize = 8 * 1024 * 1024;
+    uint32 maxSegments = 16;  // per room, the oldest segment file is deleted past it
+    LogSyncPolicy syncPolicy = LogSyncPolicy::kLOG_SYNC_GROUP;
+    // group commit: a pass every syncInterval, or sooner once a room has syncBytes not on disk
+    std::chrono::milliseconds syncInterval{50};
+    uint32 syncBytes = 1024 * 1024;
+    uint32 recentRecords = 20;  // records of each room kept at hand for Recent()
+};
+
+// Chat log activity, reported periodically by the server
+struct ChatLogStats {
+    uint64 appends = 0;
+    uint64 bytes = 0;
+    uint64 rejected = 0;  // records too large for a segment, or a segment that could not be created
+    uint64 syncs = 0;
+    uint64 syncNanoseconds = 0;
+    uint64 rotations = 0;
+};
+
+// An append-only log of every room's chats, shared by the reactors like the RoomDirectory.
+//
+// A room's log is a directory of fixed-size segment files, mapped into memory
+// and written with plain stores. A record is a checksum followed by the
+// encoded S2C_ChatInRoomNtf packet, so the last records of a room are sent to
+// a joining member as they are, by frames that view the mapped segment. A
+// segment that is full is unmapped once the last such frame is gone, and the
+// oldest files are deleted, so memory and disk stay bounded.
+class ChatLog {
+public:
+    ChatLog(const std::vector<std::string>& roomNames, const ChatLogConfig& config);
+    ~ChatLog();
+
+    ChatLog(const ChatLog&) = delete;
+    ChatLog& operator=(const ChatLog&) = delete;
+
+    // false if a room's log could not be opened
+    bool IsOpen() const { return m_Open; }
+
+    // append one encoded packet to the room's log, any thread
+    // returns false if there is no such room or the record cannot be written
+    bool Append(std::string_view roomName, const char* packet, uint32 size);
+
+    // fills the room's last count packets at most, oldest first
+    // returns false if there is no such room
+    bool Recent(std::string_view roomName, uint32 count, std::vector<network::FramePtr>& frames) const;
+
+    // force everything appended so far to disk
+    void Sync();
+
+    // the counters since the last call
+    ChatLogStats TakeStats();
+
+private:
+    struct Segment {
+        MappedFile file;
+        uint32 index;  // position in the room's sequence of segments, also the file name
+    };
+
+    // where one record's packet is
+    struct RecordRef {
+        std::shared_ptr<Segment> segment;
+        uint32 offset;
+        uint32 size;
+    };
+
+    // bytes of a rotated segment not synced yet
+    struct PendingSync {
+        std::shared_ptr<Segment> segment;
+        uint32 begin;
+        uint32 end;
+    };
+
+    struct RoomLog {
+        std::string directory;
+        mutable std::mutex mutex;
+        std::shared_ptr<Segment> segment;  // the one appended to
+        uint32 writeOffset = 0;
+        uint32 syncedOffset = 0;
+        std::vector<PendingSync> pending;
+        std::deque<RecordRef, network::PoolAllocator<RecordRef>> recent;  // oldest first, at most recentRecords
+    };
+
+    static constexpr uint32 kRECORD_HEADER_SIZE = sizeof(uint32);  // the checksum
+
+    bool OpenRoom(RoomLog& room);
+    uint32 Scan(RoomLog& room, const std::shared_ptr<Segment>& segment);
+    bool Rotate(RoomLog& room);
+    std::shared_ptr<Segment> OpenSegment(const RoomLog& room, uint32 index);
+    std::string SegmentPath(const RoomLog& room, uint32 index) const;
+    void SyncLoop();
+
+    static uint32 Checksum(const char* data, uint32 size);
+
+private:
+    ChatLogConfig m_Config;
+    bool m_Open = true;
+    InternTable m_RoomIds;
+    std::vector<std::unique_ptr<RoomLog>> m_Rooms;  // by room id
+
+    // group commit
+    std::thread m_SyncThread;
+    std::mutex m_SyncMutex;
+    std::condition_variable m_SyncWake;
+    bool m_Stopping = false;
+    std::atomic<bool> m_SyncRequested{false};
+
+    // stats, any thread
+    std::atomic<uint64> m_Appends{0};
+    std::atomic<uint64> m_Bytes{0};
+    std::atomic<uint64> m_Rejected{0};
+    std::atomic<uint64> m_Syncs{0};
+    std::atomic<uint64> m_SyncNanoseconds{0};
+    std::atomic<uint64> m_Rotations{0};
+};
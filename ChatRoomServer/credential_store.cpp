@@ -0,0 +1,148 @@
+#include "credential_store.h"
+
+#include <string.h>
+
+#include <sstream>
+
+#include "logger.h"
+
+namespace {
+void AppendHex(std::string& out, const uint8* data, size_t size) {
+    static const char kDIGITS[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; i++) {
+        out += kDIGITS[data[i] >> 4];
+        out += kDIGITS[data[i] & 0xf];
+    }
+}
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// false unless hex is exactly size bytes of lowercase hex
+bool ParseHex(const std::string& hex, uint8* out, size_t size) {
+    if (hex.size() != size * 2) return false;
+    for (size_t i = 0; i < size; i++) {
+        int high = HexDigit(hex[i * 2]);
+        int low = HexDigit(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) return false;
+        out[i] = static_cast<uint8>(high << 4 | low);
+    }
+    return true;
+}
+
+// a name may hold any byte, it is written in hex too, the empty name as "-"
+bool ParseName(const std::string& hex, std::string& name) {
+    if (hex == "-") {
+        name.clear();
+        return true;
+    }
+    if (hex.size() % 2 != 0) return false;
+    name.resize(hex.size() / 2);
+    return ParseHex(hex, reinterpret_cast<uint8*>(&name[0]), name.size());
+}
+}  // namespace
+
+CredentialStore::CredentialStore(const CredentialConfig& config) : m_Config(config) {
+    if (m_Config.path.empty()) return;
+
+    Load();
+    m_File.open(m_Config.path, std::ios::out | std::ios::app | std::ios::binary);
+    if (!m_File.is_open()) {
+        LOG_ERROR("cannot open %s, new passwords are kept in memory only", m_Config.path);
+    }
+}
+
+// one line per name: the name, logN, r, p, the salt and the hash, the name, salt and hash in hex
+void CredentialStore::Load() {
+    std::ifstream file(m_Config.path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) return;
+
+    std::string line;
+    uint32 lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string nameHex, saltHex, hashHex;
+        Credential credential;
+        std::string userName;
+        if (!(fields >> nameHex >> credential.params.logN >> credential.params.r >> credential.params.p >> saltHex >>
+              hashHex) ||
+            !ParseName(nameHex, userName) || !ParseHex(saltHex, credential.salt, kSALT_SIZE) ||
+            !ParseHex(hashHex, credential.hash, kHASH_SIZE) || credential.params.logN == 0 ||
+            credential.params.logN > 24 || credential.params.r == 0 || credential.params.p == 0) {
+            // a line torn by a crash, the name registers again
+            LOG_WARN("%s:%u is not a credential, skipped", m_Config.path, lineNumber);
+            continue;
+        }
+        // a name registered twice keeps its first password, as it did when it was registered
+        m_Credentials.emplace(std::move(userName), credential);
+    }
+    LOG_INFO("%u credentials read from %s", static_cast<uint32>(m_Credentials.size()), m_Config.path);
+}
+
+// under m_Mutex
+void CredentialStore::Append(const std::string& userName, const Credential& credential) {
+    if (!m_File.is_open()) return;
+
+    std::string line = userName.empty() ? "-" : "";
+    AppendHex(line, reinterpret_cast<const uint8*>(userName.data()), userName.size());
+    line += ' ' + std::to_string(credential.params.logN) + ' ' + std::to_string(credential.params.r) + ' ' +
+            std::to_string(credential.params.p) + ' ';
+    AppendHex(line, credential.salt, kSALT_SIZE);
+    line += ' ';
+    AppendHex(line, credential.hash, kHASH_SIZE);
+    line += '\n';
+    m_File << line;
+    m_File.flush();
+}
+
+AuthVerdict CredentialStore::Check(std::string_view userName, std::string_view password,
+                                   std::vector<uint32>& scratch) {
+    std::string name{userName};
+    Credential credential;
+    bool registered;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Credentials.find(name);
+        registered = it != m_Credentials.end();
+        if (registered) {
+            credential = it->second;
+        } else {
+            credential.params = m_Config.params;
+            for (uint32 i = 0; i < kSALT_SIZE; i += sizeof(uint32)) {
+                uint32 random = m_Random();
+                memcpy(credential.salt + i, &random, sizeof(random));
+            }
+        }
+    }
+
+    uint8 hash[kHASH_SIZE];
+    Scrypt(password, credential.salt, kSALT_SIZE, credential.params, hash, kHASH_SIZE, scratch);
+    if (registered) {
+        return ConstantTimeEqual(hash, credential.hash, kHASH_SIZE) ? AuthVerdict::kAUTH_ACCEPTED
+                                                                    : AuthVerdict::kAUTH_REJECTED;
+    }
+
+    memcpy(credential.hash, hash, kHASH_SIZE);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto inserted = m_Credentials.emplace(name, credential);
+        if (inserted.second) {
+            Append(name, credential);
+            return AuthVerdict::kAUTH_REGISTERED;
+        }
+        // another login of the name registered it while this one was hashing
+        credential = inserted.first->second;
+    }
+    Scrypt(password, credential.salt, kSALT_SIZE, credential.params, hash, kHASH_SIZE, scratch);
+    return ConstantTimeEqual(hash, credential.hash, kHASH_SIZE) ? AuthVerdict::kAUTH_ACCEPTED
+                                                                : AuthVerdict::kAUTH_REJECTED;
+}
+
+size_t CredentialStore::Size() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Credentials.size();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "password_hash.h"
+
+// Credential store tunables
+struct CredentialConfig {
+    std::string path = "credentials.txt";  // empty to keep the credentials in memory only
+    ScryptParams params;                   // for the passwords registered from now on
+};
+
+// What a login's password came to
+enum AuthVerdict {
+    kAUTH_ACCEPTED,    // it matches the name's
+    kAUTH_REGISTERED,  // the name had none, it is the name's from now on
+    kAUTH_REJECTED,    // it does not match the name's
+};
+
+// Every user name's password, as a salted scrypt hash.
+//
+// There is no sign up: the first login of a name registers the password it
+// was given, and every later login of the name has to give the same one. The
+// hashes are appended to a file as they are registered, one line each, and
+// read back at startup. Check() hashes with the whole cost of the name's
+// parameters, which is the point, so it belongs on a worker thread and never
+// on an event loop; any number of threads may check at once.
+class CredentialStore {
+public:
+    static constexpr uint32 kSALT_SIZE = 16;
+    static constexpr uint32 kHASH_SIZE = 32;
+
+    explicit CredentialStore(const CredentialConfig& config);
+
+    CredentialStore(const CredentialStore&) = delete;
+    CredentialStore& operator=(const CredentialStore&) = delete;
+
+    // any thread, scratch is the hash's working memory, kept by the thread
+    AuthVerdict Check(std::string_view userName, std::string_view password, std::vector<uint32>& scratch);
+
+    // registered names
+    size_t Size() const;
+
+private:
+    struct Credential {
+        ScryptParams params;
+        uint8 salt[kSALT_SIZE];
+        uint8 hash[kHASH_SIZE];
+    };
+
+    void Load();
+    void Append(const std::string& userName, const Credential& credential);
+
+private:
+    CredentialConfig m_Config;
+    mutable std::mutex m_Mutex;  // the map, the file and the random source, never held while hashing
+    std::unordered_map<std::string, Credential> m_Credentials;
+    std::ofstream m_File;  // appended to, not open if in memory only
+    std::random_device m_Random;
+};
@@ -0,0 +1,61 @@
+#include "epoll_poller.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <unistd.h>
+
+EpollPoller::EpollPoller() : m_Events(kINITIAL_EVENTS) { m_EpollFd = epoll_create1(EPOLL_CLOEXEC); }
+
+EpollPoller::~EpollPoller() {
+    if (m_EpollFd != -1) {
+        close(m_EpollFd);
+    }
+}
+
+int EpollPoller::Control(int op, SOCKET socket, uint32 flags, uint64 token) {
+    struct epoll_event ev;
+    ev.events = EPOLLET | EPOLLRDHUP;
+    if (flags & kPOLL_READ) ev.events |= EPOLLIN;
+    if (flags & kPOLL_WRITE) ev.events |= EPOLLOUT;
+    ev.data.u64 = token;
+    return epoll_ctl(m_EpollFd, op, socket, &ev);
+}
+
+int EpollPoller::Add(SOCKET socket, uint32 flags, uint64 token) {
+    return Control(EPOLL_CTL_ADD, socket, flags, token);
+}
+
+int EpollPoller::Modify(SOCKET socket, uint32 flags, uint64 token) {
+    return Control(EPOLL_CTL_MOD, socket, flags, token);
+}
+
+int EpollPoller::Remove(SOCKET socket) { return epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, socket, nullptr); }
+
+int EpollPoller::Wait(std::vector<PollEvent>& ready, int timeoutMs) {
+    ready.clear();
+
+    int count = epoll_wait(m_EpollFd, m_Events.data(), (int)m_Events.size(), timeoutMs);
+    if (count < 0) {
+        // a signal is not an error, just a spurious wakeup
+        return errno == EINTR ? 0 : SOCKET_ERROR;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const struct epoll_event& ev = m_Events[i];
+        uint32 flags = 0;
+        // hang-ups are reported as readable too, so that recv() sees the EOF
+        if (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) flags |= kPOLL_READ;
+        if (ev.events & EPOLLOUT) flags |= kPOLL_WRITE;
+        if (ev.events & (EPOLLERR | EPOLLHUP)) flags |= kPOLL_ERROR;
+        ready.push_back(PollEvent{ev.data.u64, flags});
+    }
+
+    // a full batch means there may be more ready sockets than we can take at once
+    if ((size_t)count == m_Events.size() && m_Events.size() < kMAX_EVENTS) {
+        m_Events.resize(m_Events.size() * 2);
+    }
+    return count;
+}
+
+#endif  // __linux__
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "poller.h"
+
+// The Linux epoll backend.
+// Sockets are registered edge-triggered, so a wakeup costs O(ready sockets)
+// no matter how many connections are being watched.
+class EpollPoller : public Poller {
+public:
+    EpollPoller();
+    ~EpollPoller() override;
+
+    bool IsValid() const { return m_EpollFd != -1; }
+
+    const char* Name() const override { return "epoll"; }
+
+    int Add(SOCKET socket, uint32 flags, uint64 token) override;
+    int Modify(SOCKET socket, uint32 flags, uint64 token) override;
+    int Remove(SOCKET socket) override;
+    int Wait(std::vector<PollEvent>& ready, int timeoutMs) override;
+
+private:
+    int Control(int op, SOCKET socket, uint32 flags, uint64 token);
+
+private:
+    int m_EpollFd = -1;
+    std::vector<struct epoll_event> m_Events;  // epoll_wait output, grows when it fills up
+
+    static constexpr size_t kINITIAL_EVENTS = 256;
+    static constexpr size_t kMAX_EVENTS = 64 * 1024;
+};
+
+#endif  // __linux__
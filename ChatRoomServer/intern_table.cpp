@@ -0,0 +1,71 @@
+#include "intern_table.h"
+
+namespace {
+constexpr size_t kINITIAL_SLOTS = 64;
+}
+
+InternTable::InternTable() : m_Slots(kINITIAL_SLOTS, Slot{0, kINVALID_ID}) {}
+
+uint32 InternTable::Find(std::string_view name) const {
+    return m_Slots[Probe(name, Hash(name))].id;
+}
+
+uint32 InternTable::Intern(std::string_view name) {
+    uint64 hash = Hash(name);
+    size_t slot = Probe(name, hash);
+    if (m_Slots[slot].id != kINVALID_ID) {
+        return m_Slots[slot].id;
+    }
+
+    uint32 id = static_cast<uint32>(m_Names.size());
+    m_Names.emplace_back(name);
+    m_Slots[slot] = Slot{static_cast<uint32>(hash), id};
+
+    // keep the load factor under 1/2 so probe sequences stay short
+    if (m_Names.size() * 2 > m_Slots.size()) {
+        Grow();
+    }
+    return id;
+}
+
+// FNV-1a
+uint64 InternTable::Hash(std::string_view name) {
+    uint64 hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<uint8>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t InternTable::Probe(std::string_view name, uint64 hash) const {
+    size_t mask = m_Slots.size() - 1;
+    size_t slot = static_cast<size_t>(hash) & mask;
+    for (;;) {
+        const Slot& s = m_Slots[slot];
+        if (s.id == kINVALID_ID) {
+            return slot;
+        }
+        if (s.hash == static_cast<uint32>(hash) && m_Names[s.id] == name) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+void InternTable::Grow() {
+    std::vector<Slot> old;
+    old.swap(m_Slots);
+    m_Slots.assign(old.size() * 2, Slot{0, kINVALID_ID});
+
+    // re-place by the stored hash, no need to hash the names again
+    size_t mask = m_Slots.size() - 1;
+    for (const Slot& s : old) {
+        if (s.id == kINVALID_ID) continue;
+        size_t slot = s.hash & mask;
+        while (m_Slots[slot].id != kINVALID_ID) {
+            slot = (slot + 1) & mask;
+        }
+        m_Slots[slot] = s;
+    }
+}
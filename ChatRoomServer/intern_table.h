@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+
+// Maps names to dense ids 0, 1, 2... in the order they are first seen.
+//
+// An open addressing hash table (linear probing, power of two size) over a
+// flat slot array, the names themselves live in one vector indexed by id.
+// Ids are never recycled, a name keeps its id for the lifetime of the table.
+class InternTable {
+public:
+    static constexpr uint32 kINVALID_ID = ~0u;
+
+    InternTable();
+
+    // id of name, kINVALID_ID if it was never interned
+    uint32 Find(std::string_view name) const;
+
+    // id of name, a new one if it was never interned
+    uint32 Intern(std::string_view name);
+
+    const std::string& Name(uint32 id) const { return m_Names[id]; }
+    uint32 Size() const { return static_cast<uint32>(m_Names.size()); }
+
+private:
+    struct Slot {
+        uint32 hash;  // low bits of the name's hash, saves most string compares
+        uint32 id;    // kINVALID_ID for an empty slot
+    };
+
+    static uint64 Hash(std::string_view name);
+
+    // the slot holding name, or the empty slot where it would go
+    size_t Probe(std::string_view name, uint64 hash) const;
+    void Grow();
+
+private:
+    std::vector<Slot> m_Slots;
+    std::vector<std::string> m_Names;
+};
@@ -0,0 +1,428 @@
+#include "io_uring_poller.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+// the poll mask of the readiness flags
+uint32 PollMask(uint32 flags) {
+    uint32 events = 0;
+    if (flags & kPOLL_READ) events |= POLLIN | POLLRDHUP;
+    if (flags & kPOLL_WRITE) events |= POLLOUT;
+    return events;
+}
+
+// the kernel's side of the rings is read and written with these, it runs alongside
+uint32 LoadAcquire(const uint32* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+
+template <typename T>
+void StoreRelease(T* target, T value) {
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+}
+}  // namespace
+
+IoUringPoller::IoUringPoller() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = kCOMPLETION_ENTRIES;
+    m_RingFd = static_cast<int>(syscall(__NR_io_uring_setup, kSUBMISSION_ENTRIES, &params));
+    if (m_RingFd < 0) {
+        m_RingFd = -1;
+        return;
+    }
+
+    // both rings in one mapping, completions kept by the kernel rather than lost when the ring is full,
+    // and waits that time out
+    uint32 features = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & features) != features) {
+        Close();
+        return;
+    }
+
+    m_RingSize = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(uint32),
+                                  params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    m_RingMemory =
+        mmap(nullptr, m_RingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQ_RING);
+    m_EntriesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* entries =
+        mmap(nullptr, m_EntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQES);
+    if (m_RingMemory == MAP_FAILED || entries == MAP_FAILED) {
+        if (m_RingMemory == MAP_FAILED) m_RingMemory = nullptr;
+        if (entries != MAP_FAILED) munmap(entries, m_EntriesSize);
+        Close();
+        return;
+    }
+    m_Entries = static_cast<struct io_uring_sqe*>(entries);
+
+    char* ring = static_cast<char*>(m_RingMemory);
+    m_SqHead = reinterpret_cast<uint32*>(ring + params.sq_off.head);
+    m_SqTail = reinterpret_cast<uint32*>(ring + params.sq_off.tail);
+    m_SqArray = reinterpret_cast<uint32*>(ring + params.sq_off.array);
+    m_SqMask = *reinterpret_cast<uint32*>(ring + params.sq_off.ring_mask);
+    m_SqCapacity = params.sq_entries;
+    m_SqQueued = *m_SqTail;
+    m_CqHead = reinterpret_cast<uint32*>(ring + params.cq_off.head);
+    m_CqTail = reinterpret_cast<uint32*>(ring + params.cq_off.tail);
+    m_Completions = reinterpret_cast<struct io_uring_cqe*>(ring + params.cq_off.cqes);
+    m_CqMask = *reinterpret_cast<uint32*>(ring + params.cq_off.ring_mask);
+
+    // the receive buffers, a multishot recv picks one per completion
+    m_BufferRingSize = kBUFFER_COUNT * sizeof(struct io_uring_buf);
+    void* bufferRing = mmap(nullptr, m_BufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufferRing == MAP_FAILED) {
+        Close();
+        return;
+    }
+    m_BufferRing = bufferRing;
+    struct io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<uint64>(m_BufferRing);
+    registration.ring_entries = kBUFFER_COUNT;
+    registration.bgid = kBUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, m_RingFd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        Close();
+        return;
+    }
+    m_Buffers.resize(static_cast<size_t>(kBUFFER_COUNT) * kBUFFER_SIZE);
+    for (uint32 bufferId = 0; bufferId < kBUFFER_COUNT; bufferId++) {
+        ProvideBuffer(static_cast<uint16>(bufferId));
+    }
+    StoreRelease(&static_cast<struct io_uring_buf_ring*>(m_BufferRing)->tail, m_BufferTail);
+}
+
+IoUringPoller::~IoUringPoller() { Close(); }
+
+// closing the ring cancels whatever is still in flight
+void IoUringPoller::Close() {
+    if (m_RingFd != -1) {
+        close(m_RingFd);
+        m_RingFd = -1;
+    }
+    if (m_BufferRing != nullptr) {
+        munmap(m_BufferRing, m_BufferRingSize);
+        m_BufferRing = nullptr;
+    }
+    if (m_Entries != nullptr) {
+        munmap(m_Entries, m_EntriesSize);
+        m_Entries = nullptr;
+    }
+    if (m_RingMemory != nullptr) {
+        munmap(m_RingMemory, m_RingSize);
+        m_RingMemory = nullptr;
+    }
+}
+
+int IoUringPoller::Add(SOCKET socket, uint32 flags, uint64 token) {
+    // the descriptor shares the user_data with the generation and the op
+    if (socket < 0 || socket >= (1 << 29)) {
+        return SOCKET_ERROR;
+    }
+    if (static_cast<size_t>(socket) >= m_Watches.size()) {
+        m_Watches.resize(socket + 1);
+    }
+    Watch& watch = m_Watches[socket];
+    if (watch.watched) {
+        return SOCKET_ERROR;
+    }
+
+    watch.watched = true;
+    watch.flags = flags;
+    watch.token = token;
+    watch.pollEvents = 0;
+    watch.receiving = false;
+    watch.accepting = false;
+    watch.sending = false;
+    watch.ended = false;
+    Arm(socket, watch);
+    return 0;
+}
+
+int IoUringPoller::Modify(SOCKET socket, uint32 flags, uint64 token) {
+    if (socket < 0 || static_cast<size_t>(socket) >= m_Watches.size() || !m_Watches[socket].watched) {
+        return SOCKET_ERROR;
+    }
+    Watch& watch = m_Watches[socket];
+    watch.flags = flags;
+    watch.token = token;
+
+    // what is in flight and no longer wanted is cancelled, and its completion arms what is wanted by then;
+    // a recv's completions before the cancel still come back, so nothing received is lost
+    if (watch.pollEvents != 0 && watch.pollEvents != PollMask(flags)) Cancel(socket, watch, kOP_POLL);
+    if (watch.receiving && !(flags & kPOLL_RECEIVE)) Cancel(socket, watch, kOP_RECV);
+    if (watch.accepting && !(flags & kPOLL_ACCEPT)) Cancel(socket, watch, kOP_ACCEPT);
+    Arm(socket, watch);
+    return 0;
+}
+
+int IoUringPoller::Remove(SOCKET socket) {
+    if (socket < 0 || static_cast<size_t>(socket) >= m_Watches.size() || !m_Watches[socket].watched) {
+        return SOCKET_ERROR;
+    }
+    Watch& watch = m_Watches[socket];
+
+    // everything in flight holds on to the socket, which would stay open past its close otherwise;
+    // the cancel goes by descriptor, so it is submitted now, while the descriptor is still this socket
+    bool inFlight = watch.pollEvents != 0 || watch.receiving || watch.accepting || watch.sending;
+    if (inFlight) {
+        if (struct io_uring_sqe* entry = NextEntry(socket, UserData(socket, watch, kOP_CANCEL))) {
+            entry->opcode = IORING_OP_ASYNC_CANCEL;
+            entry->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        }
+    }
+    // the completions still to come are stale from now on
+    watch.watched = false;
+    watch.generation++;
+    if (inFlight && Submit(0, 0, nullptr, 0) < 0) {
+        return SOCKET_ERROR;
+    }
+    return 0;
+}
+
+int IoUringPoller::Send(SOCKET socket, const network::IoSlice* slices, uint32 count, uint64 token) {
+    if (socket < 0 || static_cast<size_t>(socket) >= m_Watches.size() || !m_Watches[socket].watched) {
+        return SOCKET_ERROR;
+    }
+    Watch& watch = m_Watches[socket];
+    if (watch.sending || count == 0) {
+        return SOCKET_ERROR;
+    }
+
+    // a write's user_data is its index in m_Writes rather than the socket's, it outlives the watch
+    uint32 index = static_cast<uint32>(m_Writes.size());
+    if (!m_FreeWrites.empty()) {
+        index = m_FreeWrites.back();
+    } else if (index >= (1u << 29)) {
+        return SOCKET_ERROR;
+    }
+    struct io_uring_sqe* entry = NextEntry(socket, static_cast<uint64>(index) << 3 | kOP_SEND);
+    if (entry == nullptr) {
+        return SOCKET_ERROR;
+    }
+    if (index == m_Writes.size()) {
+        m_Writes.emplace_back();
+    } else {
+        m_FreeWrites.pop_back();
+    }
+
+    Write& write = m_Writes[index];
+    write.socket = socket;
+    write.generation = watch.generation;
+    write.token = token;
+    uint32 taken = std::min(count, kSEND_SLICES);
+    for (uint32 i = 0; i < taken; i++) {
+        write.slices[i].iov_base = const_cast<char*>(slices[i].data);
+        write.slices[i].iov_len = slices[i].len;
+    }
+    memset(&write.message, 0, sizeof(write.message));
+    write.message.msg_iov = write.slices;
+    write.message.msg_iovlen = taken;
+    entry->opcode = IORING_OP_SENDMSG;
+    entry->addr = reinterpret_cast<uint64>(&write.message);
+    entry->len = 1;
+    entry->msg_flags = MSG_NOSIGNAL;
+    watch.sending = true;
+    return 0;
+}
+
+int IoUringPoller::Wait(std::vector<PollEvent>& ready, int timeoutMs) {
+    ready.clear();
+
+    // the buffers handed out by the last Wait() are done with
+    if (!m_Lent.empty()) {
+        for (uint16 bufferId : m_Lent) {
+            ProvideBuffer(bufferId);
+        }
+        StoreRelease(&static_cast<struct io_uring_buf_ring*>(m_BufferRing)->tail, m_BufferTail);
+        m_Lent.clear();
+    }
+
+    // submit everything queued, waiting in the same call unless there are completions in already
+    bool completed = LoadAcquire(m_CqTail) != *m_CqHead;
+    if (m_SqQueued != LoadAcquire(m_SqHead) || !completed) {
+        struct __kernel_timespec timeout;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        if (timeoutMs > 0) {
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uint64>(&timeout);
+        }
+        uint32 minComplete = completed || timeoutMs == 0 ? 0 : 1;
+        if (Submit(minComplete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) < 0) {
+            // a timeout or a signal is not an error, just a wakeup with nothing to show for it
+            if (errno != ETIME && errno != EINTR && errno != EBUSY) {
+                return SOCKET_ERROR;
+            }
+        }
+    }
+
+    uint32 head = *m_CqHead;
+    uint32 tail = LoadAcquire(m_CqTail);
+    for (; head != tail; head++) {
+        Complete(m_Completions[head & m_CqMask], ready);
+    }
+    StoreRelease(m_CqHead, head);
+    return static_cast<int>(ready.size());
+}
+
+void IoUringPoller::Complete(const struct io_uring_cqe& cqe, std::vector<PollEvent>& ready) {
+    Op op = static_cast<Op>(cqe.user_data & 7);
+    if (op == kOP_SEND) {
+        CompleteWrite(cqe, ready);
+        return;
+    }
+    SOCKET socket = static_cast<SOCKET>((cqe.user_data >> 3) & ((1 << 29) - 1));
+    uint32 generation = static_cast<uint32>(cqe.user_data >> 32);
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+    // a buffer is lent until the next Wait() even if nobody is listening any more
+    const char* data = nullptr;
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        uint16 bufferId = static_cast<uint16>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        m_Lent.push_back(bufferId);
+        data = m_Buffers.data() + static_cast<size_t>(bufferId) * kBUFFER_SIZE;
+    }
+
+    if (op == kOP_CANCEL || static_cast<size_t>(socket) >= m_Watches.size()) return;
+    Watch& watch = m_Watches[socket];
+    // from a socket removed since, which may have had the same descriptor
+    if (!watch.watched || watch.generation != generation) return;
+
+    switch (op) {
+        case kOP_POLL:
+            watch.pollEvents = 0;
+            if (cqe.res > 0) {
+                uint32 flags = 0;
+                // hang-ups are reported as readable too, so that recv() sees the EOF
+                if (cqe.res & (POLLIN | POLLRDHUP | POLLHUP)) flags |= kPOLL_READ;
+                if (cqe.res & POLLOUT) flags |= kPOLL_WRITE;
+                if (cqe.res & (POLLERR | POLLHUP)) flags |= kPOLL_ERROR;
+                ready.push_back(PollEvent{watch.token, flags});
+            }
+            break;
+        case kOP_RECV:
+            if (!more) watch.receiving = false;
+            if (cqe.res > 0) {
+                ready.push_back(PollEvent{watch.token, kPOLL_RECEIVE, cqe.res, data});
+            } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+                // the end of the stream or an error, out of buffers or cancelled it is armed again below if wanted
+                watch.ended = true;
+                ready.push_back(PollEvent{watch.token, kPOLL_RECEIVE, cqe.res});
+            }
+            break;
+        case kOP_ACCEPT:
+            if (!more) watch.accepting = false;
+            if (cqe.res != -ECANCELED) {
+                ready.push_back(PollEvent{watch.token, kPOLL_ACCEPT, cqe.res});
+            }
+            break;
+        default:
+            break;
+    }
+    Arm(socket, watch);
+}
+
+// A write is reported whether or not its socket is still watched, the caller keeps its bytes until then
+void IoUringPoller::CompleteWrite(const struct io_uring_cqe& cqe, std::vector<PollEvent>& ready) {
+    uint32 index = static_cast<uint32>((cqe.user_data >> 3) & ((1 << 29) - 1));
+    if (index >= m_Writes.size()) return;
+    const Write& write = m_Writes[index];
+    ready.push_back(PollEvent{write.token, kPOLL_SENT, cqe.res});
+    m_FreeWrites.push_back(index);
+
+    // the socket's next write may go, unless it was removed since
+    Watch& watch = m_Watches[write.socket];
+    if (watch.watched && watch.generation == write.generation) watch.sending = false;
+}
+
+// Queue whatever the socket is watched for and has nothing in flight for
+void IoUringPoller::Arm(SOCKET socket, Watch& watch) {
+    uint32 events = PollMask(watch.flags);
+    if (events != 0 && watch.pollEvents == 0) {
+        if (struct io_uring_sqe* entry = NextEntry(socket, UserData(socket, watch, kOP_POLL))) {
+            entry->opcode = IORING_OP_POLL_ADD;
+            entry->poll32_events = events;
+            watch.pollEvents = events;
+        }
+    }
+    if ((watch.flags & kPOLL_RECEIVE) && !watch.receiving && !watch.ended) {
+        if (struct io_uring_sqe* entry = NextEntry(socket, UserData(socket, watch, kOP_RECV))) {
+            entry->opcode = IORING_OP_RECV;
+            entry->ioprio = IORING_RECV_MULTISHOT;
+            entry->flags = IOSQE_BUFFER_SELECT;
+            entry->buf_group = kBUFFER_GROUP;
+            watch.receiving = true;
+        }
+    }
+    if ((watch.flags & kPOLL_ACCEPT) && !watch.accepting) {
+        if (struct io_uring_sqe* entry = NextEntry(socket, UserData(socket, watch, kOP_ACCEPT))) {
+            entry->opcode = IORING_OP_ACCEPT;
+            entry->ioprio = IORING_ACCEPT_MULTISHOT;
+            entry->accept_flags = SOCK_CLOEXEC;
+            watch.accepting = true;
+        }
+    }
+}
+
+void IoUringPoller::Cancel(SOCKET socket, const Watch& watch, Op op) {
+    if (struct io_uring_sqe* entry = NextEntry(socket, UserData(socket, watch, kOP_CANCEL))) {
+        entry->opcode = IORING_OP_ASYNC_CANCEL;
+        entry->addr = UserData(socket, watch, op);
+    }
+}
+
+// A zeroed submission queue entry, queued for the next submit
+// returns nullptr if the queue is full and the kernel takes none of it
+struct io_uring_sqe* IoUringPoller::NextEntry(SOCKET socket, uint64 userData) {
+    if (m_SqQueued - LoadAcquire(m_SqHead) == m_SqCapacity) {
+        // what is queued goes to the kernel now, without waiting
+        Submit(0, 0, nullptr, 0);
+        if (m_SqQueued - LoadAcquire(m_SqHead) == m_SqCapacity) {
+            return nullptr;
+        }
+    }
+
+    uint32 index = m_SqQueued & m_SqMask;
+    struct io_uring_sqe* entry = &m_Entries[index];
+    memset(entry, 0, sizeof(*entry));
+    entry->fd = socket;
+    entry->user_data = userData;
+    m_SqArray[index] = index;
+    m_SqQueued++;
+    return entry;
+}
+
+// Submit the queued entries, and wait for minComplete completions with IORING_ENTER_GETEVENTS
+// returns what io_uring_enter does, -1 with errno set on failure
+int IoUringPoller::Submit(uint32 minComplete, uint32 flags, const void* arg, size_t argSize) {
+    StoreRelease(m_SqTail, m_SqQueued);
+    uint32 queued = m_SqQueued - LoadAcquire(m_SqHead);
+    m_EnterCalls++;
+    return static_cast<int>(syscall(__NR_io_uring_enter, m_RingFd, queued, minComplete, flags, arg, argSize));
+}
+
+// Hand a buffer (back) to the kernel, the tail is published by the caller
+void IoUringPoller::ProvideBuffer(uint16 bufferId) {
+    // not through io_uring_buf_ring::bufs, which C++ puts past an empty struct rather than at the start
+    struct io_uring_buf* ring = static_cast<struct io_uring_buf*>(m_BufferRing);
+    struct io_uring_buf& buffer = ring[m_BufferTail & (kBUFFER_COUNT - 1)];
+    buffer.addr = reinterpret_cast<uint64>(m_Buffers.data() + static_cast<size_t>(bufferId) * kBUFFER_SIZE);
+    buffer.len = kBUFFER_SIZE;
+    buffer.bid = bufferId;
+    m_BufferTail++;
+}
+
+uint64 IoUringPoller::UserData(SOCKET socket, const Watch& watch, Op op) const {
+    return static_cast<uint64>(watch.generation) << 32 | static_cast<uint64>(socket) << 3 | op;
+}
+
+#endif  // __linux__
@@ -0,0 +1,135 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <deque>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "poller.h"
+
+// The Linux io_uring backend, on raw system calls.
+//
+// Nothing goes to the kernel as it is asked for: Add, Modify and Send only
+// fill submission queue entries, and Wait() submits them all in the system
+// call that waits, so a broadcast to ten thousand clients costs a few
+// io_uring_enter calls rather than ten thousand sendmsg. A listen socket
+// watched for kPOLL_ACCEPT has a multishot accept armed on it, as the server's
+// is in either accept mode, and a connection watched for kPOLL_RECEIVE a
+// multishot recv that fills the buffers of a ring registered with the kernel;
+// the buffers a Wait() hands out go back to the ring at the next one. Plain
+// kPOLL_READ and kPOLL_WRITE, for a caller doing its own I/O like the load
+// generator, are watched with one-shot polls re-armed as they fire. A write's
+// kPOLL_SENT comes even if its socket is removed first. Needs Linux 6.0.
+class IoUringPoller : public Poller {
+public:
+    IoUringPoller();
+    ~IoUringPoller() override;
+
+    IoUringPoller(const IoUringPoller&) = delete;
+    IoUringPoller& operator=(const IoUringPoller&) = delete;
+
+    bool IsValid() const { return m_RingFd != -1; }
+
+    const char* Name() const override { return "io_uring"; }
+    bool DoesIo() const override { return true; }
+
+    int Add(SOCKET socket, uint32 flags, uint64 token) override;
+    int Modify(SOCKET socket, uint32 flags, uint64 token) override;
+    // cancels whatever is in flight on the socket at once, before the caller closes it
+    int Remove(SOCKET socket) override;
+    int Wait(std::vector<PollEvent>& ready, int timeoutMs) override;
+    int Send(SOCKET socket, const network::IoSlice* slices, uint32 count, uint64 token) override;
+
+    // io_uring_enter calls made so far
+    uint64 EnterCalls() const { return m_EnterCalls; }
+
+private:
+    // what a completion is for, in the low bits of its user_data
+    enum Op : uint64 {
+        kOP_POLL,
+        kOP_RECV,
+        kOP_ACCEPT,
+        kOP_SEND,
+        kOP_CANCEL,
+    };
+
+    static constexpr uint32 kSEND_SLICES = 16;
+
+    // a watched socket, by descriptor
+    struct Watch {
+        uint32 generation = 0;  // bumped by Remove(), the completions of an earlier socket with the number are stale
+        bool watched = false;
+        uint32 flags = 0;
+        uint64 token = 0;
+        // what is in flight
+        uint32 pollEvents = 0;  // the poll's mask, 0 if there is none
+        bool receiving = false;
+        bool accepting = false;
+        bool sending = false;
+        bool ended = false;  // the recv saw the end of the stream or an error, it is not armed again
+    };
+
+    // a write in flight, the kernel reads it when the entry is submitted
+    // kept apart from the watch: its completion is reported even if the socket is removed first,
+    // and a socket that gets the descriptor next may write before it comes
+    struct Write {
+        SOCKET socket = INVALID_SOCKET;
+        uint32 generation = 0;  // the socket's
+        uint64 token = 0;
+        struct msghdr message;
+        struct iovec slices[kSEND_SLICES];
+    };
+
+    void Close();
+    struct io_uring_sqe* NextEntry(SOCKET socket, uint64 userData);
+    void Arm(SOCKET socket, Watch& watch);
+    void Cancel(SOCKET socket, const Watch& watch, Op op);
+    int Submit(uint32 minComplete, uint32 flags, const void* arg, size_t argSize);
+    void Complete(const struct io_uring_cqe& cqe, std::vector<PollEvent>& ready);
+    void CompleteWrite(const struct io_uring_cqe& cqe, std::vector<PollEvent>& ready);
+    void ProvideBuffer(uint16 bufferId);
+    uint64 UserData(SOCKET socket, const Watch& watch, Op op) const;
+
+private:
+    int m_RingFd = -1;
+    uint64 m_EnterCalls = 0;
+
+    // the rings shared with the kernel
+    void* m_RingMemory = nullptr;
+    size_t m_RingSize = 0;
+    struct io_uring_sqe* m_Entries = nullptr;
+    size_t m_EntriesSize = 0;
+    uint32* m_SqHead = nullptr;
+    uint32* m_SqTail = nullptr;
+    uint32* m_SqArray = nullptr;
+    uint32 m_SqMask = 0;
+    uint32 m_SqCapacity = 0;
+    uint32 m_SqQueued = 0;  // our tail, entries past the kernel's are not submitted yet
+    uint32* m_CqHead = nullptr;
+    uint32* m_CqTail = nullptr;
+    struct io_uring_cqe* m_Completions = nullptr;
+    uint32 m_CqMask = 0;
+
+    // the receive buffers, lent to the kernel through a buffer ring, and the ones handed out by the last Wait()
+    void* m_BufferRing = nullptr;
+    size_t m_BufferRingSize = 0;
+    std::vector<char> m_Buffers;
+    uint16 m_BufferTail = 0;
+    std::vector<uint16> m_Lent;
+
+    std::vector<Watch> m_Watches;
+    std::deque<Write> m_Writes;  // a deque, so that a write's slices stay put while the table grows
+    std::vector<uint32> m_FreeWrites;
+
+    static constexpr uint32 kSUBMISSION_ENTRIES = 1024;
+    static constexpr uint32 kCOMPLETION_ENTRIES = 8 * 1024;
+    static constexpr uint32 kBUFFER_COUNT = 1024;  // a power of two
+    static constexpr uint32 kBUFFER_SIZE = 4096;
+    static constexpr uint16 kBUFFER_GROUP = 0;
+};
+
+#endif  // __linux__
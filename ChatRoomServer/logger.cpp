@@ -0,0 +1,299 @@
+#include "logger.h"
+
+#include <stdarg.h>
+
+#include <algorithm>
+
+namespace {
+// the calling thread's queue, owned by the logger
+thread_local SpscQueue<LogRecord>* t_Queue = nullptr;
+
+const char* const kLEVEL_NAMES[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+// reads the arguments of a record back in the order they were packed
+class ArgReader {
+public:
+    explicit ArgReader(const LogRecord& record) : m_Record(record) {}
+
+    // the next argument's type, false if there is none left
+    bool Next(uint8& type) {
+        if (m_Offset >= m_Record.argBytes) return false;
+        type = static_cast<uint8>(m_Record.args[m_Offset++]);
+        return true;
+    }
+
+    template <typename V>
+    V Scalar() {
+        V value;
+        memcpy(&value, m_Record.args + m_Offset, sizeof(V));
+        m_Offset += sizeof(V);
+        return value;
+    }
+
+    std::string_view String() {
+        uint16 length = Scalar<uint16>();
+        std::string_view value{m_Record.args + m_Offset, length};
+        m_Offset += length;
+        return value;
+    }
+
+private:
+    const LogRecord& m_Record;
+    uint32 m_Offset = 0;
+};
+
+void Appendf(std::string& out, const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+    }
+}
+
+// an integer argument as an int, for a '*' width or precision
+int IntArg(ArgReader& reader) {
+    uint8 type;
+    if (!reader.Next(type)) return 0;
+    return static_cast<int>(type == LogRecord::kARG_DOUBLE ? reader.Scalar<double>() : reader.Scalar<int64>());
+}
+
+// one conversion, with the '*' width and precision it took
+template <typename V>
+void AppendConversion(std::string& line, const char* spec, const int* stars, int starCount, V value) {
+    if (starCount == 2) {
+        Appendf(line, spec, stars[0], stars[1], value);
+    } else if (starCount == 1) {
+        Appendf(line, spec, stars[0], value);
+    } else {
+        Appendf(line, spec, value);
+    }
+}
+}  // namespace
+
+Logger& Logger::Instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() { m_Thread = std::thread(&Logger::DrainLoop, this); }
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_Stopping = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+}
+
+void Logger::SetOutput(FILE* output) {
+    Flush();
+    std::lock_guard<std::mutex> lock(m_WakeMutex);
+    m_Output = output;
+}
+
+int64 Logger::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void Logger::PackString(LogRecord& record, std::string_view value) {
+    size_t room = LogRecord::kARG_BYTES - record.argBytes;
+    if (room < 1 + sizeof(uint16)) {
+        record.truncated = 1;
+        return;
+    }
+    uint16 length = static_cast<uint16>(std::min(value.size(), room - 1 - sizeof(uint16)));
+    if (length < value.size()) record.truncated = 1;
+
+    char* out = record.args + record.argBytes;
+    out[0] = static_cast<char>(LogRecord::kARG_STRING);
+    memcpy(out + 1, &length, sizeof(length));
+    memcpy(out + 1 + sizeof(length), value.data(), length);
+    record.argBytes += static_cast<uint16>(1 + sizeof(length) + length);
+}
+
+void Logger::Submit(LogRecord&& record) {
+    if (!ThreadQueue().TryPush(std::move(record))) {
+        m_Dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+SpscQueue<LogRecord>& Logger::ThreadQueue() {
+    if (t_Queue == nullptr) {
+        std::lock_guard<std::mutex> lock(m_QueuesMutex);
+        m_Queues.push_back(std::make_unique<SpscQueue<LogRecord>>(kQUEUE_RECORDS));
+        t_Queue = m_Queues.back().get();
+    }
+    return *t_Queue;
+}
+
+void Logger::Flush() {
+    std::unique_lock<std::mutex> lock(m_WakeMutex);
+    uint64 ticket = ++m_FlushRequested;
+    m_Wake.notify_one();
+    m_Flushed.wait(lock, [&]() { return m_FlushDone >= ticket || m_Stopping; });
+}
+
+// wake up every kDRAIN_INTERVAL, or for a flush, and write out what the threads logged
+void Logger::DrainLoop() {
+    for (;;) {
+        std::unique_lock<std::mutex> lock(m_WakeMutex);
+        m_Wake.wait_for(lock, kDRAIN_INTERVAL, [&]() { return m_Stopping || m_FlushRequested > m_FlushDone; });
+        bool stopping = m_Stopping;
+        uint64 flushRequested = m_FlushRequested;
+        lock.unlock();
+
+        Drain();
+
+        lock.lock();
+        m_FlushDone = flushRequested;
+        m_Flushed.notify_all();
+        if (stopping) return;
+    }
+}
+
+// pop every queue, format the records in timestamp order and write them in one go
+void Logger::Drain() {
+    {
+        std::lock_guard<std::mutex> lock(m_QueuesMutex);
+        LogRecord record;
+        for (const std::unique_ptr<SpscQueue<LogRecord>>& queue : m_Queues) {
+            while (queue->TryPop(record)) {
+                m_Batch.push_back(record);
+            }
+        }
+    }
+
+    // each thread's records are in order already, this interleaves the threads
+    std::stable_sort(m_Batch.begin(), m_Batch.end(),
+                     [](const LogRecord& a, const LogRecord& b) { return a.timestamp < b.timestamp; });
+
+    m_Text.clear();
+    for (const LogRecord& record : m_Batch) {
+        Format(record, m_Text);
+        m_Text += '\n';
+    }
+    m_Batch.clear();
+
+    uint64 dropped = Dropped();
+    if (dropped != m_DroppedReported) {
+        Appendf(m_Text, "%llu log records dropped, the queues were full\n", dropped - m_DroppedReported);
+        m_DroppedReported = dropped;
+    }
+    if (m_Text.empty()) return;
+
+    FILE* output;
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        output = m_Output;
+    }
+    fwrite(m_Text.data(), 1, m_Text.size(), output);
+    fflush(output);
+}
+
+// "hh:mm:ss.uuuuuu LEVEL message", the time of day in UTC
+// The format is walked like printf does, each conversion takes the next
+// argument whatever its length modifier says, so %d and %llu both print
+// any integer and %s any string.
+void Logger::Format(const LogRecord& record, std::string& line) {
+    int64 micros = record.timestamp / 1000;
+    int64 seconds = micros / 1000000;
+    Appendf(line, "%02d:%02d:%02d.%06d %s ", static_cast<int>(seconds / 3600 % 24),
+            static_cast<int>(seconds / 60 % 60), static_cast<int>(seconds % 60), static_cast<int>(micros % 1000000),
+            record.level < kLOG_OFF ? kLEVEL_NAMES[record.level] : "?    ");
+
+    ArgReader reader{record};
+    bool missing = false;
+    for (const char* p = record.format; *p != '\0'; p++) {
+        if (*p != '%') {
+            line += *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            line += '%';
+            p++;
+            continue;
+        }
+
+        // flags, width and precision are kept, '*' ones are taken from the arguments
+        char spec[32] = "%";
+        size_t specLength = 1;
+        int stars[2];
+        int starCount = 0;
+        for (p++; *p != '\0' && strchr("-+ #0123456789.*", *p) != nullptr; p++) {
+            if (*p == '*' && starCount < 2) stars[starCount++] = IntArg(reader);
+            if (specLength < sizeof(spec) - 8) spec[specLength++] = *p;
+        }
+        // length modifiers are dropped, the argument knows its own size
+        while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+            p++;
+        }
+        if (*p == '\0') break;
+        char conversion = *p;
+
+        uint8 type;
+        if (!reader.Next(type)) {
+            missing = true;
+            line += "<?>";
+            continue;
+        }
+
+        bool floating = strchr("fFeEgGaA", conversion) != nullptr;
+        char* end = spec + specLength;
+        switch (type) {
+            case LogRecord::kARG_INT:
+            case LogRecord::kARG_UINT: {
+                int64 value = reader.Scalar<int64>();
+                if (floating) {
+                    end[0] = conversion;
+                    end[1] = '\0';
+                    AppendConversion(line, spec, stars, starCount, static_cast<double>(value));
+                } else if (conversion == 'c') {
+                    end[0] = 'c';
+                    end[1] = '\0';
+                    AppendConversion(line, spec, stars, starCount, static_cast<int>(value));
+                } else {
+                    end[0] = 'l';
+                    end[1] = 'l';
+                    end[2] = strchr("dioxXu", conversion) != nullptr ? conversion
+                                                                      : (type == LogRecord::kARG_INT ? 'd' : 'u');
+                    end[3] = '\0';
+                    AppendConversion(line, spec, stars, starCount, static_cast<long long>(value));
+                }
+            } break;
+            case LogRecord::kARG_DOUBLE: {
+                end[0] = floating ? conversion : 'f';
+                end[1] = '\0';
+                AppendConversion(line, spec, stars, starCount, reader.Scalar<double>());
+            } break;
+            case LogRecord::kARG_STRING: {
+                std::string_view value = reader.String();
+                line.append(value.data(), value.size());
+            } break;
+            case LogRecord::kARG_POINTER:
+                Appendf(line, "%p", reinterpret_cast<void*>(static_cast<uintptr_t>(reader.Scalar<uint64>())));
+                break;
+            default:
+                missing = true;
+                break;
+        }
+    }
+    if (missing || record.truncated) {
+        line += " [truncated]";
+    }
+}
+
+bool Logger::ParseLevel(const char* name, LogLevel& level) {
+    static const char* const kNAMES[] = {"debug", "info", "warn", "error", "off"};
+    for (int i = 0; i <= kLOG_OFF; i++) {
+        if (strcmp(name, kNAMES[i]) == 0) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
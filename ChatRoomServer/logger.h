@@ -0,0 +1,196 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+#include "spsc_queue.h"
+
+enum LogLevel {
+    kLOG_DEBUG = 0,  // per packet, off unless asked for
+    kLOG_INFO = 1,   // per connection and per session event
+    kLOG_WARN = 2,
+    kLOG_ERROR = 3,
+    kLOG_OFF = 4,
+};
+
+// levels below this are compiled out, their arguments are not even evaluated
+// e.g. -DLOG_COMPILED_LEVEL=1 leaves no trace of the per packet logging in the binary
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 0
+#endif
+
+// One log call as its thread leaves it for the writer: the format is a string
+// literal kept by pointer, the arguments are copied in, type-tagged, and
+// formatted later. Strings that do not fit are cut short.
+struct LogRecord {
+    static constexpr uint32 kARG_BYTES = 232;  // a record is 256 bytes
+
+    // each argument is its type, then its value
+    enum ArgType : uint8 {
+        kARG_INT,
+        kARG_UINT,
+        kARG_DOUBLE,
+        kARG_STRING,  // uint16 length, then the bytes
+        kARG_POINTER,
+    };
+
+    int64 timestamp;     // system_clock, nanoseconds
+    const char* format;  // printf-style, a %s takes any string, %d and %u any integer
+    uint8 level;
+    uint8 truncated;  // arguments were cut short or left out
+    uint16 argBytes;
+    char args[kARG_BYTES];
+};
+
+// An asynchronous logger.
+//
+// Each thread that logs gets a lock-free queue of its own, registered on its
+// first record, so logging is a copy into the record and a push, with no lock
+// and no system call. A background thread drains every queue every
+// kDRAIN_INTERVAL, formats the records in timestamp order and writes them out.
+// A thread that logs faster than that loses records rather than waiting, the
+// count of those is logged in their place.
+class Logger {
+public:
+    static constexpr uint32 kQUEUE_RECORDS = 4096;  // per thread
+    static constexpr std::chrono::milliseconds kDRAIN_INTERVAL{10};
+
+    static Logger& Instance();
+
+    void SetLevel(LogLevel level) { m_Level.store(level, std::memory_order_relaxed); }
+    bool Enabled(LogLevel level) const { return level >= m_Level.load(std::memory_order_relaxed); }
+
+    // stdout by default, the logger does not close it
+    void SetOutput(FILE* output);
+
+    template <typename... Args>
+    void Write(LogLevel level, const char* format, const Args&... args) {
+        LogRecord record;
+        record.timestamp = Now();
+        record.format = format;
+        record.level = static_cast<uint8>(level);
+        record.truncated = 0;
+        record.argBytes = 0;
+        (Pack(record, args), ...);
+        Submit(std::move(record));
+    }
+
+    // write out everything logged so far, returns once it is written
+    void Flush();
+
+    // records lost to full queues, since the start
+    uint64 Dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+    // the formatted line of a record, without the newline
+    static void Format(const LogRecord& record, std::string& line);
+
+    // "debug", "info", "warn", "error" or "off"
+    static bool ParseLevel(const char* name, LogLevel& level);
+
+private:
+    Logger();
+    ~Logger();
+
+    static int64 Now();
+
+    template <typename T>
+    static void Pack(LogRecord& record, const T& value) {
+        if constexpr (std::is_enum_v<T> || std::is_same_v<T, bool>) {
+            PackScalar(record, LogRecord::kARG_INT, static_cast<int64>(value));
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            PackScalar(record, LogRecord::kARG_INT, static_cast<int64>(value));
+        } else if constexpr (std::is_integral_v<T>) {
+            PackScalar(record, LogRecord::kARG_UINT, static_cast<uint64>(value));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            PackScalar(record, LogRecord::kARG_DOUBLE, static_cast<double>(value));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            PackString(record, std::string_view{value});
+        } else {
+            static_assert(std::is_pointer_v<T>, "log arguments are numbers, strings or pointers");
+            PackScalar(record, LogRecord::kARG_POINTER, static_cast<uint64>(reinterpret_cast<uintptr_t>(value)));
+        }
+    }
+
+    template <typename V>
+    static void PackScalar(LogRecord& record, LogRecord::ArgType type, V value) {
+        if (record.argBytes + 1 + sizeof(V) > LogRecord::kARG_BYTES) {
+            record.truncated = 1;
+            return;
+        }
+        record.args[record.argBytes] = static_cast<char>(type);
+        memcpy(record.args + record.argBytes + 1, &value, sizeof(V));
+        record.argBytes += static_cast<uint16>(1 + sizeof(V));
+    }
+
+    static void PackString(LogRecord& record, std::string_view value);
+
+    void Submit(LogRecord&& record);
+    SpscQueue<LogRecord>& ThreadQueue();
+    void DrainLoop();
+    void Drain();
+
+private:
+    std::atomic<int> m_Level{kLOG_INFO};
+    std::atomic<uint64> m_Dropped{0};
+    uint64 m_DroppedReported = 0;  // writer thread only
+
+    // the queues of every thread that has logged, a thread takes the mutex once to register its own
+    std::mutex m_QueuesMutex;
+    std::vector<std::unique_ptr<SpscQueue<LogRecord>>> m_Queues;
+
+    // writer thread
+    std::thread m_Thread;
+    std::mutex m_WakeMutex;
+    std::condition_variable m_Wake;
+    bool m_Stopping = false;
+    uint64 m_FlushRequested = 0;  // Flush() calls so far, under m_WakeMutex
+    uint64 m_FlushDone = 0;       // of those, the ones written out
+    std::condition_variable m_Flushed;
+    FILE* m_Output = stdout;  // under m_WakeMutex
+    std::vector<LogRecord> m_Batch;
+    std::string m_Text;
+};
+
+#define LOG_AT(level, ...)                                \
+    do {                                                  \
+        if (Logger::Instance().Enabled(level)) {          \
+            Logger::Instance().Write(level, __VA_ARGS__); \
+        }                                                 \
+    } while (0)
+
+#if LOG_COMPILED_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(kLOG_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(kLOG_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 2
+#define LOG_WARN(...) LOG_AT(kLOG_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 3
+#define LOG_ERROR(...) LOG_AT(kLOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
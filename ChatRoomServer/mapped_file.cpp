@@ -0,0 +1,137 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, uint64 size) {
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    uint64 mappedSize = static_cast<uint64>(fileSize.QuadPart) > size ? fileSize.QuadPart : size;
+
+    // the mapping grows the file to its size
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(mappedSize >> 32),
+                                        static_cast<DWORD>(mappedSize), nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(mappedSize));
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_File = file;
+    m_Mapping = mapping;
+    m_Data = static_cast<char*>(data);
+    m_Size = mappedSize;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_Data != nullptr) {
+        UnmapViewOfFile(m_Data);
+        m_Data = nullptr;
+    }
+    if (m_Mapping != nullptr) {
+        CloseHandle(m_Mapping);
+        m_Mapping = nullptr;
+    }
+    if (m_File != nullptr) {
+        CloseHandle(m_File);
+        m_File = nullptr;
+    }
+    m_Size = 0;
+}
+
+bool MappedFile::Sync(uint64 offset, uint64 length) {
+    if (m_Data == nullptr || length == 0) return true;
+    // FlushViewOfFile hands the pages to the cache manager, FlushFileBuffers waits for the disk
+    return FlushViewOfFile(m_Data + offset, static_cast<SIZE_T>(length)) && FlushFileBuffers(m_File);
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, uint64 size) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    uint64 mappedSize = static_cast<uint64>(st.st_size) > size ? st.st_size : size;
+    if (static_cast<uint64>(st.st_size) < mappedSize) {
+#ifdef __linux__
+        // reserve the blocks now, a full disk then fails here rather than with a SIGBUS on a store
+        if (posix_fallocate(fd, 0, static_cast<off_t>(mappedSize)) != 0) {
+            close(fd);
+            return false;
+        }
+#else
+        if (ftruncate(fd, static_cast<off_t>(mappedSize)) != 0) {
+            close(fd);
+            return false;
+        }
+#endif
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(mappedSize), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    m_Fd = fd;
+    m_Data = static_cast<char*>(data);
+    m_Size = mappedSize;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_Data != nullptr) {
+        munmap(m_Data, static_cast<size_t>(m_Size));
+        m_Data = nullptr;
+    }
+    if (m_Fd >= 0) {
+        close(m_Fd);
+        m_Fd = -1;
+    }
+    m_Size = 0;
+}
+
+bool MappedFile::Sync(uint64 offset, uint64 length) {
+    if (m_Data == nullptr || length == 0) return true;
+    // msync wants a page aligned start
+    static const uint64 pageSize = static_cast<uint64>(sysconf(_SC_PAGESIZE));
+    uint64 begin = offset - offset % pageSize;
+    return msync(m_Data + begin, static_cast<size_t>(offset + length - begin), MS_SYNC) == 0;
+}
+
+#endif
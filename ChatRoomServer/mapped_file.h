@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "common.h"
+
+// A file mapped read-write into memory, MapViewOfFile on Windows and mmap elsewhere.
+// The file is created at the given size if it does not exist, its new bytes read as zeros.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // open or create path with at least size bytes and map all of it
+    // returns false if the file cannot be created, grown or mapped
+    bool Open(const std::string& path, uint64 size);
+    void Close();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    char* Data() const { return m_Data; }
+    uint64 Size() const { return m_Size; }
+
+    // write [offset, offset + length) back to the file and wait until it is on disk
+    bool Sync(uint64 offset, uint64 length);
+
+private:
+    char* m_Data = nullptr;
+    uint64 m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;     // HANDLE
+    void* m_Mapping = nullptr;  // HANDLE
+#else
+    int m_Fd = -1;
+#endif
+};
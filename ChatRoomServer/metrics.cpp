@@ -0,0 +1,245 @@
+#include "metrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "message.h"
+#include "room_directory.h"
+
+using namespace network;
+
+static_assert(ReactorMetrics::kFIRST_TYPE == MessageType::kLOGIN_REQ, "message types moved");
+static_assert(ReactorMetrics::kLAST_TYPE == MessageType::kRESUME_ACK, "a new message type needs a metrics slot");
+
+namespace {
+// by ReactorMetrics::TypeSlot()
+const char* const kTYPE_NAMES[ReactorMetrics::kTYPE_SLOTS] = {
+    "C2S_LoginReq",
+    "S2C_LoginAck",
+    "C2S_JoinRoomReq",
+    "S2C_JoinRoomAck",
+    "S2C_JoinRoomNtf",
+    "C2S_LeaveRoomReq",
+    "S2C_LeaveRoomAck",
+    "S2C_LeaveRoomNtf",
+    "C2S_ChatInRoomReq",
+    "S2C_ChatInRoomAck",
+    "S2C_ChatInRoomNtf",
+    "C2S_BatchReq",
+    "S2C_Compressed",
+    "C2S_RosterReq",
+    "S2C_RosterAck",
+    "C2S_HistoryReq",
+    "S2C_HistoryAck",
+    "Ping",
+    "Pong",
+    "C2S_ResumeReq",
+    "S2C_ResumeAck",
+    "unknown",
+};
+
+// number of bits needed to write value, 0 for 0
+uint32 BitWidth(uint64 value) {
+#if defined(_MSC_VER)
+    unsigned long bit;
+    return _BitScanReverse64(&bit, value) ? bit + 1 : 0;
+#else
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+#endif
+}
+
+void Appendf(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(line, std::min<size_t>(length, sizeof(line) - 1));
+    }
+}
+
+void AppendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    Appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// buckets summed over reactors, rendered cumulative up to the highest one in use
+void AppendHistogram(std::string& out, const char* name, const char* labels, const uint64* buckets, uint64 sum) {
+    uint32 used = 0;
+    for (uint32 i = 0; i < Histogram::kBUCKET_COUNT; i++) {
+        if (buckets[i] != 0) used = i + 1;
+    }
+
+    const char* separator = labels[0] != '\0' ? "," : "";
+    uint64 count = 0;
+    for (uint32 i = 0; i < used && i + 1 < Histogram::kBUCKET_COUNT; i++) {
+        count += buckets[i];
+        Appendf(out, "%s_bucket{%s%sle=\"%llu\"} %llu\n", name, labels, separator, Histogram::UpperBound(i), count);
+    }
+    if (used == Histogram::kBUCKET_COUNT) count += buckets[used - 1];
+    Appendf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator, count);
+    if (labels[0] != '\0') {
+        Appendf(out, "%s_sum{%s} %llu\n%s_count{%s} %llu\n", name, labels, sum, name, labels, count);
+    } else {
+        Appendf(out, "%s_sum %llu\n%s_count %llu\n", name, sum, name, count);
+    }
+}
+
+// one histogram of every reactor summed into buckets, returns the sum of the values
+template <typename Get>
+uint64 SumHistograms(const std::vector<std::unique_ptr<ReactorMetrics>>& reactors, Get get, uint64* buckets) {
+    uint64 sum = 0;
+    std::fill(buckets, buckets + Histogram::kBUCKET_COUNT, 0);
+    for (const std::unique_ptr<ReactorMetrics>& reactor : reactors) {
+        const Histogram& histogram = get(*reactor);
+        for (uint32 i = 0; i < Histogram::kBUCKET_COUNT; i++) {
+            buckets[i] += histogram.BucketCount(i);
+        }
+        sum += histogram.Sum();
+    }
+    return sum;
+}
+}  // namespace
+
+void Histogram::Record(uint64 value) {
+    uint32 bucket = BitWidth(value);
+    m_Buckets[bucket < kBUCKET_COUNT ? bucket : kBUCKET_COUNT - 1].Add();
+    m_Sum.Add(value);
+}
+
+uint64 Histogram::UpperBound(uint32 bucket) { return bucket + 1 < kBUCKET_COUNT ? (1ull << bucket) - 1 : ~0ull; }
+
+MetricsRegistry::MetricsRegistry(const RoomDirectory& rooms) : m_Rooms(rooms) {}
+
+ReactorMetrics& MetricsRegistry::AddReactor() {
+    m_Reactors.push_back(std::make_unique<ReactorMetrics>());
+    return *m_Reactors.back();
+}
+
+// Counters and histograms are summed over the reactors, gauges are given per reactor.
+// Per type series are left out until the type has been seen.
+void MetricsRegistry::Render(std::string& out) const {
+    struct TypeCounter {
+        const char* name;
+        const char* help;
+        Counter ReactorMetrics::TypeMetrics::*counter;
+    };
+    static const TypeCounter kTYPE_COUNTERS[] = {
+        {"chat_packets_received_total", "Packets received, by message type.", &ReactorMetrics::TypeMetrics::packetsIn},
+        {"chat_bytes_received_total", "Bytes of the packets received, by message type.",
+         &ReactorMetrics::TypeMetrics::bytesIn},
+        {"chat_packets_sent_total", "Packets queued to clients, by message type.",
+         &ReactorMetrics::TypeMetrics::packetsOut},
+        {"chat_bytes_sent_total", "Bytes queued to clients after compression, by message type.",
+         &ReactorMetrics::TypeMetrics::bytesOut},
+    };
+    for (const TypeCounter& series : kTYPE_COUNTERS) {
+        AppendHeader(out, series.name, "counter", series.help);
+        for (uint32 slot = 0; slot < ReactorMetrics::kTYPE_SLOTS; slot++) {
+            uint64 total = 0;
+            for (const std::unique_ptr<ReactorMetrics>& reactor : m_Reactors) {
+                total += (reactor->types[slot].*series.counter).Value();
+            }
+            if (total == 0) continue;
+            Appendf(out, "%s{type=\"%s\"} %llu\n", series.name, kTYPE_NAMES[slot], total);
+        }
+    }
+
+    uint64 buckets[Histogram::kBUCKET_COUNT];
+    AppendHeader(out, "chat_handler_latency_nanoseconds", "histogram",
+                 "Time spent handling a request, responses and broadcasts included, by message type.");
+    for (uint32 slot = 0; slot < ReactorMetrics::kTYPE_SLOTS; slot++) {
+        uint64 sum = SumHistograms(
+            m_Reactors, [slot](const ReactorMetrics& reactor) -> const Histogram& {
+                return reactor.types[slot].handlerNanoseconds;
+            },
+            buckets);
+        if (std::all_of(buckets, buckets + Histogram::kBUCKET_COUNT, [](uint64 n) { return n == 0; })) continue;
+
+        char labels[64];
+        snprintf(labels, sizeof(labels), "type=\"%s\"", kTYPE_NAMES[slot]);
+        AppendHistogram(out, "chat_handler_latency_nanoseconds", labels, buckets, sum);
+    }
+
+    AppendHeader(out, "chat_broadcast_fanout", "histogram", "Targets per broadcast.");
+    uint64 sum = SumHistograms(
+        m_Reactors, [](const ReactorMetrics& reactor) -> const Histogram& { return reactor.fanout; }, buckets);
+    AppendHistogram(out, "chat_broadcast_fanout", "", buckets, sum);
+
+    AppendHeader(out, "chat_auth_latency_nanoseconds", "histogram",
+                 "From a login to the verdict on its password, waiting for a worker included.");
+    sum = SumHistograms(
+        m_Reactors, [](const ReactorMetrics& reactor) -> const Histogram& { return reactor.authNanoseconds; },
+        buckets);
+    AppendHistogram(out, "chat_auth_latency_nanoseconds", "", buckets, sum);
+
+    struct ReactorCounter {
+        const char* name;
+        const char* help;
+        Counter ReactorMetrics::*counter;
+    };
+    static const ReactorCounter kREACTOR_COUNTERS[] = {
+        {"chat_loop_iterations_total", "Event loop wakeups.", &ReactorMetrics::loopIterations},
+        {"chat_broadcasts_dropped_total", "Broadcasts dropped for slow consumers.", &ReactorMetrics::framesDropped},
+        {"chat_slow_consumer_disconnects_total", "Clients disconnected for not reading.",
+         &ReactorMetrics::slowDisconnects},
+        {"chat_heartbeats_sent_total", "Pings sent to silent clients.", &ReactorMetrics::heartbeatsSent},
+        {"chat_idle_disconnects_total", "Clients disconnected for not answering a ping.",
+         &ReactorMetrics::idleDisconnects},
+        {"chat_logins_rejected_total", "Logins with the wrong password.", &ReactorMetrics::loginsRejected},
+        {"chat_logins_turned_away_total", "Logins turned away with too many waiting for a worker.",
+         &ReactorMetrics::loginsTurnedAway},
+        {"chat_sessions_resumed_total", "Reconnected users put back in their rooms by a resume token.",
+         &ReactorMetrics::sessionsResumed},
+        {"chat_sessions_expired_total", "Disconnected users taken out of their rooms when their grace ran out.",
+         &ReactorMetrics::sessionsExpired},
+        {"chat_chats_deferred_total", "Times a chat over its rate limit was left unread until its token came.",
+         &ReactorMetrics::chatsDeferred},
+        {"chat_chats_rejected_total", "Chats over their rate limit failed without being handled.",
+         &ReactorMetrics::chatsRejected},
+    };
+    for (const ReactorCounter& series : kREACTOR_COUNTERS) {
+        uint64 total = 0;
+        for (const std::unique_ptr<ReactorMetrics>& reactor : m_Reactors) {
+            total += ((*reactor).*series.counter).Value();
+        }
+        AppendHeader(out, series.name, "counter", series.help);
+        Appendf(out, "%s %llu\n", series.name, total);
+    }
+
+    struct ReactorGauge {
+        const char* name;
+        const char* help;
+        Gauge ReactorMetrics::*gauge;
+    };
+    static const ReactorGauge kREACTOR_GAUGES[] = {
+        {"chat_connections", "Clients connected, by reactor.", &ReactorMetrics::connections},
+        {"chat_outbound_queued_bytes", "Bytes queued to clients, by reactor.", &ReactorMetrics::queuedBytes},
+        {"chat_outbound_queued_frames", "Frames queued to clients, by reactor.", &ReactorMetrics::queuedFrames},
+        {"chat_outbound_max_queued_bytes", "Bytes queued to the most backed up client, by reactor.",
+         &ReactorMetrics::maxQueuedBytes},
+        {"chat_blocked_clients", "Clients over the send high watermark, by reactor.", &ReactorMetrics::blockedClients},
+    };
+    for (const ReactorGauge& series : kREACTOR_GAUGES) {
+        AppendHeader(out, series.name, "gauge", series.help);
+        for (size_t i = 0; i < m_Reactors.size(); i++) {
+            Appendf(out, "%s{reactor=\"%zu\"} %lld\n", series.name, i, ((*m_Reactors[i]).*series.gauge).Value());
+        }
+    }
+
+    uint64 users = 0;
+    std::vector<uint32> members;
+    m_Rooms.Population(users, members);
+    AppendHeader(out, "chat_users", "gauge", "Users known to the server.");
+    Appendf(out, "chat_users %llu\n", users);
+    AppendHeader(out, "chat_room_members", "gauge", "Members, by room.");
+    for (size_t i = 0; i < members.size() && i < m_Rooms.RoomNames().size(); i++) {
+        Appendf(out, "chat_room_members{room=\"%s\"} %u\n", m_Rooms.RoomNames()[i].c_str(), members[i]);
+    }
+}
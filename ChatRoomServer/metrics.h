@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+class RoomDirectory;
+
+// A count that only goes up, written by one thread.
+// The writer adds with a plain load and store rather than a locked instruction,
+// and any thread may read it at any time.
+class Counter {
+public:
+    void Add(uint64 n = 1) { m_Value.store(m_Value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    uint64 Value() const { return m_Value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64> m_Value{0};
+};
+
+// A value that goes up and down, written by one thread like a Counter
+class Gauge {
+public:
+    void Set(int64 value) { m_Value.store(value, std::memory_order_relaxed); }
+    void Add(int64 n) { Set(Value() + n); }
+    int64 Value() const { return m_Value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64> m_Value{0};
+};
+
+// A histogram with a bucket per power of two, written by one thread like a Counter.
+// Bucket i holds the values of bit width i: 0 in bucket 0, 1 in bucket 1, 2-3 in
+// bucket 2 and so on, the last bucket takes everything above. Coarse, but a
+// Record() is a bit scan and two counter adds.
+class Histogram {
+public:
+    static constexpr uint32 kBUCKET_COUNT = 40;
+
+    void Record(uint64 value);
+
+    uint64 BucketCount(uint32 bucket) const { return m_Buckets[bucket].Value(); }
+    uint64 Sum() const { return m_Sum.Value(); }
+
+    // the largest value bucket holds, ~0 for the last one
+    static uint64 UpperBound(uint32 bucket);
+
+private:
+    Counter m_Buckets[kBUCKET_COUNT];
+    Counter m_Sum;
+};
+
+// What one reactor records, written by its own thread only
+struct ReactorMetrics {
+    // per message type, see TypeSlot()
+    struct TypeMetrics {
+        Counter packetsIn;
+        Counter bytesIn;
+        Counter packetsOut;  // frames queued to a client, a broadcast counts once per target
+        Counter bytesOut;    // as queued, after compression
+        Histogram handlerNanoseconds;
+    };
+
+    static constexpr uint32 kFIRST_TYPE = 1001;  // kLOGIN_REQ
+    static constexpr uint32 kLAST_TYPE = 1021;   // kRESUME_ACK
+    static constexpr uint32 kTYPE_SLOTS = kLAST_TYPE - kFIRST_TYPE + 2;
+
+    // the slot of a message type, the last one for the types the server does not know
+    static uint32 TypeSlot(uint32 messageType) {
+        return messageType >= kFIRST_TYPE && messageType <= kLAST_TYPE ? messageType - kFIRST_TYPE
+                                                                       : kTYPE_SLOTS - 1;
+    }
+
+    TypeMetrics types[kTYPE_SLOTS];
+    Histogram fanout;           // targets per broadcast
+    Counter loopIterations;     // event loop wakeups
+    Counter framesDropped;      // broadcasts dropped for slow consumers
+    Counter slowDisconnects;    // clients disconnected by the slow consumer policy or the hard limit
+    Counter heartbeatsSent;     // PINGs to silent clients
+    Counter idleDisconnects;    // clients disconnected for not answering one
+    Counter loginsRejected;     // wrong passwords
+    Counter loginsTurnedAway;   // with too many logins waiting for a worker
+    Counter sessionsResumed;    // users back in their rooms with a resume token
+    Counter sessionsExpired;    // disconnected users whose grace ran out, taken out of their rooms
+    Counter chatsDeferred;      // times a chat over its rate limit was left unread until its token came
+    Counter chatsRejected;      // chats over their rate limit failed without being handled
+    Histogram authNanoseconds;  // from a login to the verdict on its password, waiting for a worker included
+    Gauge connections;          // clients connected to the reactor
+    // outbound queues, sampled every kMETRICS_INTERVAL by the reactor
+    Gauge queuedBytes;     // over all its clients
+    Gauge queuedFrames;    // over all its clients
+    Gauge maxQueuedBytes;  // of its most backed up client
+    Gauge blockedClients;  // over the high watermark, not read until they drain
+};
+
+// The metrics of every reactor of a server, and the rooms they share.
+//
+// Each reactor writes its own ReactorMetrics without locking or contending
+// with the others, and a scrape sums them up as it renders. Reactors are added
+// before they start running, and the registry outlives them.
+class MetricsRegistry {
+public:
+    explicit MetricsRegistry(const RoomDirectory& rooms);
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // the metrics of a new reactor, not thread-safe
+    ReactorMetrics& AddReactor();
+
+    // everything, in the Prometheus text exposition format, any thread
+    void Render(std::string& out) const;
+
+private:
+    const RoomDirectory& m_Rooms;
+    std::vector<std::unique_ptr<ReactorMetrics>> m_Reactors;
+};
@@ -0,0 +1,129 @@
+#include "metrics_endpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+#include "logger.h"
+
+using namespace network;
+
+namespace {
+// wait up to timeoutMs for the socket to be readable, false on a timeout or an error
+// polled rather than selected, under load the scraper's socket is well past FD_SETSIZE
+bool WaitReadable(SOCKET socket, int timeoutMs) {
+#ifdef _WIN32
+    WSAPOLLFD entry{socket, POLLRDNORM, 0};
+    return WSAPoll(&entry, 1, timeoutMs) > 0;
+#else
+    pollfd entry{socket, POLLIN, 0};
+    return poll(&entry, 1, timeoutMs) > 0;
+#endif
+}
+
+// a blocking send of all of data, false if the client went away
+bool SendAll(SOCKET socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int result = send(socket, data.data() + sent, static_cast<int>(data.size() - sent), 0);
+        if (result <= 0) return false;
+        sent += result;
+    }
+    return true;
+}
+}  // namespace
+
+MetricsEndpoint::MetricsEndpoint(uint16 port, const MetricsRegistry& registry) : m_Registry(registry) {
+    if (StartupSockets() != 0) {
+        LOG_ERROR("metrics endpoint: StartupSockets failed");
+        return;
+    }
+    if (CreateListenSocket(port) != 0) {
+        CleanupSockets();
+        return;
+    }
+    LOG_INFO("metrics on http://127.0.0.1:%u/metrics", port);
+    m_Thread = std::thread(&MetricsEndpoint::ServeLoop, this);
+}
+
+MetricsEndpoint::~MetricsEndpoint() {
+    if (!IsOpen()) return;
+
+    m_Stopping.store(true, std::memory_order_relaxed);
+    m_Thread.join();
+    CloseSocket(m_ListenSocket);
+    CleanupSockets();
+}
+
+// listen on the loopback address only, the metrics are not for the outside world
+int MetricsEndpoint::CreateListenSocket(uint16 port) {
+    m_ListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_ListenSocket == INVALID_SOCKET) {
+        LOG_ERROR("metrics endpoint: socket failed with error: %d", LastSocketError());
+        return SOCKET_ERROR;
+    }
+
+#ifndef _WIN32
+    int reuseAddr = 1;
+    setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+#endif
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(m_ListenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        listen(m_ListenSocket, SOMAXCONN) == SOCKET_ERROR) {
+        LOG_ERROR("metrics endpoint: bind/listen on port %u failed with error: %d", port, LastSocketError());
+        CloseSocket(m_ListenSocket);
+        m_ListenSocket = INVALID_SOCKET;
+        return SOCKET_ERROR;
+    }
+    return 0;
+}
+
+// accept one scraper at a time, waking up now and then to see if the endpoint is stopping
+void MetricsEndpoint::ServeLoop() {
+    while (!m_Stopping.load(std::memory_order_relaxed)) {
+        if (!WaitReadable(m_ListenSocket, 200)) continue;
+
+        SOCKET client = accept(m_ListenSocket, NULL, NULL);
+        if (client == INVALID_SOCKET) continue;
+        Serve(client);
+        CloseSocket(client);
+    }
+}
+
+// read the request line and headers, answer it and close
+void MetricsEndpoint::Serve(SOCKET client) {
+    m_Request.clear();
+    char buffer[1024];
+    while (m_Request.find("\r\n\r\n") == std::string::npos) {
+        if (m_Request.size() >= kMAX_REQUEST || !WaitReadable(client, kREQUEST_TIMEOUT_MS)) return;
+        int received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) return;
+        m_Request.append(buffer, received);
+    }
+
+    const char* status = "200 OK";
+    m_Body.clear();
+    if (m_Request.compare(0, 13, "GET /metrics ") == 0 || m_Request.compare(0, 6, "GET / ") == 0) {
+        m_Registry.Render(m_Body);
+    } else {
+        status = "404 Not Found";
+        m_Body = "try GET /metrics\n";
+    }
+
+    m_Response = "HTTP/1.1 ";
+    m_Response += status;
+    m_Response += "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: ";
+    m_Response += std::to_string(m_Body.size());
+    m_Response += "\r\nConnection: close\r\n\r\n";
+    m_Response += m_Body;
+    if (SendAll(client, m_Response)) {
+        shutdown(client, SD_SEND);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "metrics.h"
+#include "socket.h"
+
+// Serves a MetricsRegistry as plain text over HTTP on localhost, for a scraper such as Prometheus.
+//
+// A thread of its own accepts on 127.0.0.1, reads the request and answers
+// GET /metrics with MetricsRegistry::Render(), one request per connection.
+// It only reads the reactors' counters, so a scrape never holds a reactor up.
+class MetricsEndpoint {
+public:
+    MetricsEndpoint(uint16 port, const MetricsRegistry& registry);
+    ~MetricsEndpoint();
+
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+    // false if the port could not be listened on
+    bool IsOpen() const { return m_ListenSocket != INVALID_SOCKET; }
+
+private:
+    static constexpr int kREQUEST_TIMEOUT_MS = 1000;  // a client that sends nothing for this long is dropped
+    static constexpr size_t kMAX_REQUEST = 8 * 1024;
+
+    int CreateListenSocket(uint16 port);
+    void ServeLoop();
+    void Serve(SOCKET client);
+
+private:
+    const MetricsRegistry& m_Registry;
+    SOCKET m_ListenSocket = INVALID_SOCKET;
+    std::thread m_Thread;
+    std::atomic<bool> m_Stopping{false};
+
+    // reused by every request, serve thread only
+    std::string m_Request;
+    std::string m_Body;
+    std::string m_Response;
+};
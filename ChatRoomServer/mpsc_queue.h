@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "block_pool.h"
+
+// A lock-free multi-producer single-consumer queue (Vyukov's linked list design).
+//
+// Any thread may Push(), producers never wait for each other or for the
+// consumer. Only the owning thread may Pop(). An item whose push is still in
+// progress may be missed by a concurrent Pop(), so producers must signal the
+// consumer after Push() returns. Nodes come from the BlockPool, so pushing
+// does not allocate once the threads' caches are warm.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : m_Head(NewNode()), m_Tail(m_Head.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T item;
+        while (Pop(item)) {
+        }
+        DeleteNode(m_Tail);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // producer side, any thread
+    void Push(T&& value) {
+        Node* node = NewNode();
+        node->value = std::move(value);
+        Node* prev = m_Head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // consumer side, owning thread only
+    bool Pop(T& value) {
+        Node* tail = m_Tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        value = std::move(next->value);
+        m_Tail = next;
+        DeleteNode(tail);
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    static Node* NewNode() { return new (network::BlockPool::Allocate(sizeof(Node))) Node{}; }
+
+    static void DeleteNode(Node* node) {
+        node->~Node();
+        network::BlockPool::Release(node, sizeof(Node));
+    }
+
+    std::atomic<Node*> m_Head;  // last pushed node, producers swap themselves in here
+    Node* m_Tail;               // already consumed node, its successor is the next item
+};
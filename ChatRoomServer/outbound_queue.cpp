@@ -0,0 +1,73 @@
+#include "outbound_queue.h"
+
+using namespace network;
+
+void OutboundQueue::Push(const FramePtr& frame) {
+    m_Frames.push_back(frame);
+    m_QueuedBytes += frame->Size();
+}
+
+int OutboundQueue::Flush(SOCKET socket, uint64& sendCalls) {
+    int totalSent = 0;
+    IoSlice slices[kMAX_IO_SLICES];
+
+    while (!m_Frames.empty()) {
+        // gather as many queued frames as one call takes
+        uint32 count = Gather(slices, kMAX_IO_SLICES);
+        uint64 requested = 0;
+        for (uint32 i = 0; i < count; i++) {
+            requested += slices[i].len;
+        }
+
+        int sent = SendVectored(socket, slices, count);
+        sendCalls++;
+        if (sent == SOCKET_ERROR) {
+            if (IsWouldBlock(LastSocketError())) {
+                // the socket buffer is full, wait until it is writable again
+                return totalSent;
+            }
+            return SOCKET_ERROR;
+        }
+
+        totalSent += sent;
+        Retire(static_cast<uint32>(sent));
+
+        if (static_cast<uint64>(sent) < requested) {
+            // a short write means the socket buffer is full
+            return totalSent;
+        }
+    }
+    return totalSent;
+}
+
+uint32 OutboundQueue::Gather(IoSlice* slices, uint32 maxSlices) const {
+    uint32 count = 0;
+    for (FrameDeque::const_iterator it = m_Frames.begin(); it != m_Frames.end() && count < maxSlices;
+         ++it, ++count) {
+        uint32 offset = count == 0 ? m_HeadOffset : 0;
+        slices[count].data = (*it)->Data() + offset;
+        slices[count].len = (*it)->Size() - offset;
+    }
+    return count;
+}
+
+void OutboundQueue::Retire(uint32 bytes) {
+    // the frames that went out completely leave the queue
+    m_QueuedBytes -= bytes;
+    while (bytes > 0) {
+        uint32 headLeft = m_Frames.front()->Size() - m_HeadOffset;
+        if (bytes < headLeft) {
+            m_HeadOffset += bytes;
+            break;
+        }
+        bytes -= headLeft;
+        m_Frames.pop_front();
+        m_HeadOffset = 0;
+    }
+}
+
+void OutboundQueue::Clear() {
+    m_Frames.clear();
+    m_HeadOffset = 0;
+    m_QueuedBytes = 0;
+}
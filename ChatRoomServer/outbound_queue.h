@@ -0,0 +1,38 @@
+#pragma once
+
+#include <deque>
+
+#include "block_pool.h"
+#include "frame.h"
+#include "socket.h"
+
+// The frames waiting to be written to one client.
+// Frames are queued by reference, and flushed with gather writes whenever
+// the socket can take more. The queue's nodes come from the BlockPool.
+class OutboundQueue {
+public:
+    void Push(const network::FramePtr& frame);
+
+    // write as much as the socket takes without blocking, sendCalls is increased by the system calls made
+    // returns the number of bytes written, or SOCKET_ERROR on a fatal error
+    int Flush(SOCKET socket, uint64& sendCalls);
+
+    // the bytes at the head of the queue as up to maxSlices slices, for a write made elsewhere
+    // returns the number of slices, the frames stay queued until Retire() takes them off
+    uint32 Gather(network::IoSlice* slices, uint32 maxSlices) const;
+    // take the first bytes, written, off the queue
+    void Retire(uint32 bytes);
+
+    void Clear();
+
+    bool Empty() const { return m_Frames.empty(); }
+    uint64 QueuedBytes() const { return m_QueuedBytes; }
+    size_t QueuedFrames() const { return m_Frames.size(); }
+
+private:
+    typedef std::deque<network::FramePtr, network::PoolAllocator<network::FramePtr>> FrameDeque;
+
+    FrameDeque m_Frames;
+    uint32 m_HeadOffset = 0;  // bytes of the first frame already written
+    uint64 m_QueuedBytes = 0;
+};
@@ -0,0 +1,277 @@
+#include "password_hash.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr uint32 kSHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32 RotateRight(uint32 x, uint32 n) { return (x >> n) | (x << (32 - n)); }
+inline uint32 RotateLeft(uint32 x, uint32 n) { return (x << n) | (x >> (32 - n)); }
+
+// scrypt's words are little-endian
+inline uint32 LoadWord(const uint8* p) {
+    return static_cast<uint32>(p[0]) | static_cast<uint32>(p[1]) << 8 | static_cast<uint32>(p[2]) << 16 |
+           static_cast<uint32>(p[3]) << 24;
+}
+inline void StoreWord(uint8* p, uint32 word) {
+    p[0] = static_cast<uint8>(word);
+    p[1] = static_cast<uint8>(word >> 8);
+    p[2] = static_cast<uint8>(word >> 16);
+    p[3] = static_cast<uint8>(word >> 24);
+}
+
+// SHA-256, fed in pieces
+class Sha256Context {
+public:
+    Sha256Context() { Reset(); }
+
+    void Reset() {
+        static constexpr uint32 kINITIAL[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                               0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(m_State, kINITIAL, sizeof(m_State));
+        m_Length = 0;
+        m_Used = 0;
+    }
+
+    void Update(const uint8* data, size_t size) {
+        if (size == 0) return;
+        m_Length += size;
+        if (m_Used > 0) {
+            size_t take = std::min(size, sizeof(m_Block) - m_Used);
+            memcpy(m_Block + m_Used, data, take);
+            m_Used += take;
+            data += take;
+            size -= take;
+            if (m_Used < sizeof(m_Block)) return;
+            Compress(m_Block);
+            m_Used = 0;
+        }
+        for (; size >= sizeof(m_Block); data += sizeof(m_Block), size -= sizeof(m_Block)) {
+            Compress(data);
+        }
+        memcpy(m_Block, data, size);
+        m_Used = size;
+    }
+
+    void Final(uint8 (&digest)[32]) {
+        uint64 bits = m_Length * 8;
+        uint8 pad[sizeof(m_Block) + 8] = {0x80};
+        size_t padSize = (m_Used < 56 ? 56 : 120) - m_Used;
+        for (int i = 0; i < 8; i++) {
+            pad[padSize + i] = static_cast<uint8>(bits >> (56 - i * 8));
+        }
+        Update(pad, padSize + 8);
+        for (int i = 0; i < 8; i++) {
+            digest[i * 4] = static_cast<uint8>(m_State[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8>(m_State[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8>(m_State[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8>(m_State[i]);
+        }
+    }
+
+private:
+    void Compress(const uint8* block) {
+        uint32 w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = static_cast<uint32>(block[i * 4]) << 24 | static_cast<uint32>(block[i * 4 + 1]) << 16 |
+                   static_cast<uint32>(block[i * 4 + 2]) << 8 | block[i * 4 + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32 s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32 s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32 a = m_State[0], b = m_State[1], c = m_State[2], d = m_State[3];
+        uint32 e = m_State[4], f = m_State[5], g = m_State[6], h = m_State[7];
+        for (int i = 0; i < 64; i++) {
+            uint32 s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+            uint32 choose = (e & f) ^ (~e & g);
+            uint32 t1 = h + s1 + choose + kSHA256_K[i] + w[i];
+            uint32 s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+            uint32 majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32 t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        m_State[0] += a;
+        m_State[1] += b;
+        m_State[2] += c;
+        m_State[3] += d;
+        m_State[4] += e;
+        m_State[5] += f;
+        m_State[6] += g;
+        m_State[7] += h;
+    }
+
+private:
+    uint32 m_State[8];
+    uint64 m_Length;  // bytes fed so far
+    uint8 m_Block[64];
+    size_t m_Used;  // bytes of m_Block filled
+};
+
+// HMAC-SHA-256 with the key's pads hashed once, each Mac() starts from copies of them
+class HmacSha256 {
+public:
+    explicit HmacSha256(std::string_view key) {
+        uint8 block[64] = {};
+        if (key.size() > sizeof(block)) {
+            uint8 digest[32];
+            Sha256(reinterpret_cast<const uint8*>(key.data()), key.size(), digest);
+            memcpy(block, digest, sizeof(digest));
+        } else {
+            memcpy(block, key.data(), key.size());
+        }
+        uint8 pad[64];
+        for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x36;
+        m_Inner.Update(pad, sizeof(pad));
+        for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x5c;
+        m_Outer.Update(pad, sizeof(pad));
+    }
+
+    // the MAC of a followed by b
+    void Mac(const uint8* a, size_t aSize, const uint8* b, size_t bSize, uint8 (&mac)[32]) const {
+        Sha256Context inner = m_Inner;
+        inner.Update(a, aSize);
+        inner.Update(b, bSize);
+        uint8 digest[32];
+        inner.Final(digest);
+        Sha256Context outer = m_Outer;
+        outer.Update(digest, sizeof(digest));
+        outer.Final(mac);
+    }
+
+private:
+    Sha256Context m_Inner;
+    Sha256Context m_Outer;
+};
+
+// one Salsa20 quarter round over the words a, b, c and d of x
+inline void QuarterRound(uint32* x, int a, int b, int c, int d) {
+    x[b] ^= RotateLeft(x[a] + x[d], 7);
+    x[c] ^= RotateLeft(x[b] + x[a], 9);
+    x[d] ^= RotateLeft(x[c] + x[b], 13);
+    x[a] ^= RotateLeft(x[d] + x[c], 18);
+}
+
+// Salsa20/8 core, in place
+void Salsa208(uint32 (&b)[16]) {
+    uint32 x[16];
+    memcpy(x, b, sizeof(x));
+    for (int i = 0; i < 8; i += 2) {
+        // columns, then rows
+        QuarterRound(x, 0, 4, 8, 12);
+        QuarterRound(x, 5, 9, 13, 1);
+        QuarterRound(x, 10, 14, 2, 6);
+        QuarterRound(x, 15, 3, 7, 11);
+        QuarterRound(x, 0, 1, 2, 3);
+        QuarterRound(x, 5, 6, 7, 4);
+        QuarterRound(x, 10, 11, 8, 9);
+        QuarterRound(x, 15, 12, 13, 14);
+    }
+    for (int i = 0; i < 16; i++) b[i] += x[i];
+}
+
+// scryptBlockMix of the 2r 64-byte blocks of in into out
+void BlockMix(const uint32* in, uint32* out, uint32 r) {
+    uint32 x[16];
+    memcpy(x, in + (2 * r - 1) * 16, sizeof(x));
+    for (uint32 i = 0; i < 2 * r; i++) {
+        for (int k = 0; k < 16; k++) x[k] ^= in[i * 16 + k];
+        Salsa208(x);
+        // the even blocks go to the first half, the odd ones to the second
+        memcpy(out + ((i & 1) * r + i / 2) * 16, x, sizeof(x));
+    }
+}
+
+// scryptROMix of one 128 * r byte block, in place
+void RoMix(uint8* block, uint32 r, uint32 n, uint32* scratch) {
+    size_t words = 32 * static_cast<size_t>(r);
+    uint32* v = scratch;
+    uint32* x = v + words * n;
+    uint32* y = x + words;
+    for (size_t k = 0; k < words; k++) {
+        x[k] = LoadWord(block + k * 4);
+    }
+    for (uint32 i = 0; i < n; i++) {
+        memcpy(v + words * i, x, words * sizeof(uint32));
+        BlockMix(x, y, r);
+        std::swap(x, y);
+    }
+    for (uint32 i = 0; i < n; i++) {
+        uint32 j = x[(2 * r - 1) * 16] & (n - 1);
+        for (size_t k = 0; k < words; k++) x[k] ^= v[words * j + k];
+        BlockMix(x, y, r);
+        std::swap(x, y);
+    }
+    for (size_t k = 0; k < words; k++) {
+        StoreWord(block + k * 4, x[k]);
+    }
+}
+}  // namespace
+
+void Sha256(const uint8* data, size_t size, uint8 (&digest)[32]) {
+    Sha256Context context;
+    context.Update(data, size);
+    context.Final(digest);
+}
+
+void Pbkdf2Sha256(std::string_view password, const uint8* salt, size_t saltSize, uint32 iterations, uint8* out,
+                  size_t outSize) {
+    HmacSha256 hmac{password};
+    for (uint32 blockIndex = 1; outSize > 0; blockIndex++) {
+        uint8 index[4] = {static_cast<uint8>(blockIndex >> 24), static_cast<uint8>(blockIndex >> 16),
+                          static_cast<uint8>(blockIndex >> 8), static_cast<uint8>(blockIndex)};
+        uint8 u[32];
+        hmac.Mac(salt, saltSize, index, sizeof(index), u);
+        uint8 t[32];
+        memcpy(t, u, sizeof(t));
+        for (uint32 i = 1; i < iterations; i++) {
+            hmac.Mac(u, sizeof(u), nullptr, 0, u);
+            for (int k = 0; k < 32; k++) t[k] ^= u[k];
+        }
+        size_t take = std::min(outSize, sizeof(t));
+        memcpy(out, t, take);
+        out += take;
+        outSize -= take;
+    }
+}
+
+void Scrypt(std::string_view password, const uint8* salt, size_t saltSize, const ScryptParams& params, uint8* out,
+            size_t outSize, std::vector<uint32>& scratch) {
+    uint32 n = 1u << params.logN;
+    size_t blockSize = 128 * static_cast<size_t>(params.r);
+    scratch.resize(32 * static_cast<size_t>(params.r) * (n + 2));
+
+    std::vector<uint8> blocks(blockSize * params.p);
+    Pbkdf2Sha256(password, salt, saltSize, 1, blocks.data(), blocks.size());
+    for (uint32 i = 0; i < params.p; i++) {
+        RoMix(blocks.data() + blockSize * i, params.r, n, scratch.data());
+    }
+    Pbkdf2Sha256(password, blocks.data(), blocks.size(), 1, out, outSize);
+}
+
+bool ConstantTimeEqual(const uint8* a, const uint8* b, size_t size) {
+    uint8 difference = 0;
+    for (size_t i = 0; i < size; i++) difference |= a[i] ^ b[i];
+    return difference == 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+
+// scrypt cost, see RFC 7914: a hash takes 128 * r * 2^logN bytes of memory and as many passes over them
+struct ScryptParams {
+    uint32 logN = 14;  // 16 MiB with r = 8
+    uint32 r = 8;
+    uint32 p = 1;
+};
+
+// SHA-256 of size bytes
+void Sha256(const uint8* data, size_t size, uint8 (&digest)[32]);
+
+// PBKDF2 with HMAC-SHA-256, RFC 8018
+void Pbkdf2Sha256(std::string_view password, const uint8* salt, size_t saltSize, uint32 iterations, uint8* out,
+                  size_t outSize);
+
+// scrypt, RFC 7914: outSize bytes derived from password and salt
+// scratch is the working memory, kept by the caller so that it is allocated once per thread
+void Scrypt(std::string_view password, const uint8* salt, size_t saltSize, const ScryptParams& params, uint8* out,
+            size_t outSize, std::vector<uint32>& scratch);
+
+// compares the whole of both, however early they differ
+bool ConstantTimeEqual(const uint8* a, const uint8* b, size_t size);
@@ -0,0 +1,59 @@
+#include "poller.h"
+
+#include <string.h>
+
+#include "epoll_poller.h"
+#include "io_uring_poller.h"
+#include "select_poller.h"
+
+PollerType DefaultPollerType() {
+#ifdef __linux__
+    return PollerType::kPOLLER_EPOLL;
+#else
+    return PollerType::kPOLLER_SELECT;
+#endif
+}
+
+bool ParsePollerType(const char* name, PollerType& type) {
+    if (strcmp(name, "select") == 0) {
+        type = PollerType::kPOLLER_SELECT;
+        return true;
+    }
+#ifdef __linux__
+    if (strcmp(name, "epoll") == 0) {
+        type = PollerType::kPOLLER_EPOLL;
+        return true;
+    }
+    if (strcmp(name, "io_uring") == 0) {
+        type = PollerType::kPOLLER_URING;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::unique_ptr<Poller> CreatePoller(PollerType type) {
+    switch (type) {
+        case PollerType::kPOLLER_SELECT:
+            return std::make_unique<SelectPoller>();
+#ifdef __linux__
+        case PollerType::kPOLLER_EPOLL: {
+            std::unique_ptr<EpollPoller> poller = std::make_unique<EpollPoller>();
+            if (!poller->IsValid()) {
+                return nullptr;
+            }
+            return poller;
+        }
+        case PollerType::kPOLLER_URING: {
+            // a kernel older than 6.0, or one with io_uring disabled, has none
+            std::unique_ptr<IoUringPoller> poller = std::make_unique<IoUringPoller>();
+            if (!poller->IsValid()) {
+                return nullptr;
+            }
+            return poller;
+        }
+#endif
+        default:
+            return nullptr;
+    }
+}
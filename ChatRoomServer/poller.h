@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "socket.h"
+
+// Readiness flags reported by (and requested from) a poller
+enum PollFlags : uint32 {
+    kPOLL_READ = 1 << 0,
+    kPOLL_WRITE = 1 << 1,
+    kPOLL_ERROR = 1 << 2,
+    // the I/O a backend that does it itself completes, see Poller::DoesIo()
+    kPOLL_ACCEPT = 1 << 3,   // accept on a listen socket, the result is an accepted socket or -errno
+    kPOLL_RECEIVE = 1 << 4,  // receive from a socket, the result is the bytes at data, 0 at its end, or -errno
+    kPOLL_SENT = 1 << 5,     // reported only, a Send() is done, the result is the bytes written or -errno
+};
+
+// A single readiness event or completion, the token is whatever was passed to Add() or Send()
+struct PollEvent {
+    uint64 token;
+    uint32 flags;
+    int32 result = 0;            // completions only
+    const char* data = nullptr;  // kPOLL_RECEIVE, valid until the next Wait()
+};
+
+// The available poller backends
+enum PollerType {
+    kPOLLER_SELECT,  // portable, level-triggered, O(n) per wait
+    kPOLLER_EPOLL,   // Linux only, edge-triggered, O(ready) per wait
+    kPOLLER_URING,   // Linux only, does the I/O itself, everything queued goes to the kernel with the wait
+};
+
+// The readiness notification backend used by the server's event loop.
+//
+// Backends may be edge-triggered, so the caller must always drain a ready
+// socket (accept/recv until it would block) before waiting again.
+//
+// A backend that DoesIo() can also take the system calls off the caller's
+// hands: a listen socket watched for kPOLL_ACCEPT is accepted on, a socket
+// watched for kPOLL_RECEIVE is received from, and Send() writes, and Wait()
+// hands back what each of them completed instead of readiness to act on.
+class Poller {
+public:
+    virtual ~Poller() = default;
+
+    virtual const char* Name() const = 0;
+
+    // start watching a socket, token is handed back in every PollEvent
+    virtual int Add(SOCKET socket, uint32 flags, uint64 token) = 0;
+    // change the flags (and token) a socket is watched for
+    virtual int Modify(SOCKET socket, uint32 flags, uint64 token) = 0;
+    // stop watching a socket, must be called before the socket is closed
+    virtual int Remove(SOCKET socket) = 0;
+
+    // wait up to timeoutMs for events, ready is overwritten with the ready sockets only
+    // returns the number of events, or SOCKET_ERROR
+    virtual int Wait(std::vector<PollEvent>& ready, int timeoutMs) = 0;
+
+    // true if the backend takes kPOLL_ACCEPT, kPOLL_RECEIVE and Send()
+    virtual bool DoesIo() const { return false; }
+
+    // queue a gather write to go out with the next Wait(), the bytes must stay valid until its kPOLL_SENT
+    // a socket has one write in flight at most, and it may take fewer slices than given;
+    // the kPOLL_SENT comes even if the socket is removed first, cancelled or not
+    // returns SOCKET_ERROR if the backend does no I/O or a write is in flight already
+    virtual int Send(SOCKET /*socket*/, const network::IoSlice* /*slices*/, uint32 /*count*/, uint64 /*token*/) {
+        return SOCKET_ERROR;
+    }
+};
+
+// the best backend available on this platform
+PollerType DefaultPollerType();
+
+// parse "select" / "epoll" / "io_uring", returns false for unknown or unsupported names
+bool ParsePollerType(const char* name, PollerType& type);
+
+// returns nullptr if the backend is not available on this platform
+std::unique_ptr<Poller> CreatePoller(PollerType type);
@@ -0,0 +1,67 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+namespace {
+constexpr int64 kNANOSECONDS_PER_SECOND = 1000000000;
+
+int64 Nanoseconds(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+int64 IntervalOf(const RateLimit& limit) { return limit.rate != 0 ? kNANOSECONDS_PER_SECOND / limit.rate : 0; }
+
+int64 ToleranceOf(const RateLimit& limit) {
+    return IntervalOf(limit) * (static_cast<int64>(std::max(limit.burst, 1u)) - 1);
+}
+}  // namespace
+
+RateLimiter::RateLimiter(const RateLimit& limit) : m_Interval(IntervalOf(limit)), m_Tolerance(ToleranceOf(limit)) {}
+
+bool RateLimiter::TryTake(Clock::time_point now) {
+    if (m_Interval == 0) return true;
+
+    int64 t = Nanoseconds(now);
+    int64 full = std::max(m_Full, t);
+    if (full - t > m_Tolerance) return false;
+    m_Full = full + m_Interval;
+    return true;
+}
+
+RateLimiter::Clock::time_point RateLimiter::NextToken(Clock::time_point now) const {
+    int64 wait = m_Full - m_Tolerance - Nanoseconds(now);
+    return wait > 0 ? now + std::chrono::nanoseconds{wait} : now;
+}
+
+SharedRateLimiter::SharedRateLimiter(const RateLimit& limit)
+    : m_Interval(IntervalOf(limit)), m_Tolerance(ToleranceOf(limit)) {}
+
+bool SharedRateLimiter::TryTake(Clock::time_point now) {
+    if (m_Interval == 0) return true;
+
+    int64 t = Nanoseconds(now);
+    int64 current = m_Full.load(std::memory_order_relaxed);
+    for (;;) {
+        int64 full = std::max(current, t);
+        if (full - t > m_Tolerance) return false;
+        // a failed exchange reloads current, the check is made again against it
+        if (m_Full.compare_exchange_weak(current, full + m_Interval, std::memory_order_relaxed)) return true;
+    }
+}
+
+SharedRateLimiter::Clock::time_point SharedRateLimiter::NextToken(Clock::time_point now) const {
+    int64 wait = m_Full.load(std::memory_order_relaxed) - m_Tolerance - Nanoseconds(now);
+    return wait > 0 ? now + std::chrono::nanoseconds{wait} : now;
+}
+
+RoomRateLimits::RoomRateLimits(const std::vector<std::string>& roomNames, const RateLimit& limit) {
+    for (const std::string& roomName : roomNames) {
+        m_RoomIds.Intern(roomName);
+        m_Limiters.emplace_back(limit);
+    }
+}
+
+SharedRateLimiter* RoomRateLimits::Find(std::string_view roomName) {
+    uint32 roomId = m_RoomIds.Find(roomName);
+    return roomId != InternTable::kINVALID_ID ? &m_Limiters[roomId] : nullptr;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "intern_table.h"
+
+// A rate: burst at once, then rate a second; a 0 rate is no limit
+struct RateLimit {
+    uint32 rate = 0;
+    uint32 burst = 1;
+};
+
+// A token bucket kept as one timestamp, the generic cell rate algorithm.
+//
+// Rather than a count of tokens topped up as time passes, the bucket keeps the
+// time it would be full again: taking a token pushes that one interval
+// (1 / rate) further out, and a token may be taken as long as it stays within
+// burst intervals of now. Nothing is refilled and nothing ticks, a check is a
+// subtraction and a compare. Single threaded, see SharedRateLimiter.
+class RateLimiter {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit RateLimiter(const RateLimit& limit = RateLimit{});
+
+    // take a token, returns false if there is none
+    bool TryTake(Clock::time_point now);
+    // put back the token last taken
+    void GiveBack() { m_Full -= m_Interval; }
+
+    // when the next token comes, now if there is one
+    Clock::time_point NextToken(Clock::time_point now) const;
+
+private:
+    int64 m_Interval;   // nanoseconds per token, 0 for no limit
+    int64 m_Tolerance;  // how far ahead of now m_Full may be, (burst - 1) intervals
+    int64 m_Full = 0;   // when the bucket is full again, in nanoseconds of Clock
+};
+
+// A RateLimiter any number of threads take from, e.g. a room's, reached from every reactor.
+// The timestamp is moved with a compare and swap, there is no lock.
+class SharedRateLimiter {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit SharedRateLimiter(const RateLimit& limit = RateLimit{});
+
+    SharedRateLimiter(const SharedRateLimiter&) = delete;
+    SharedRateLimiter& operator=(const SharedRateLimiter&) = delete;
+
+    bool TryTake(Clock::time_point now);
+    void GiveBack() { m_Full.fetch_sub(m_Interval, std::memory_order_relaxed); }
+    Clock::time_point NextToken(Clock::time_point now) const;
+
+private:
+    int64 m_Interval;
+    int64 m_Tolerance;
+    std::atomic<int64> m_Full{0};
+};
+
+// A SharedRateLimiter for each room, the rooms being fixed at construction.
+// Shared by the reactors of a group like the RoomDirectory.
+class RoomRateLimits {
+public:
+    RoomRateLimits(const std::vector<std::string>& roomNames, const RateLimit& limit);
+
+    RoomRateLimits(const RoomRateLimits&) = delete;
+    RoomRateLimits& operator=(const RoomRateLimits&) = delete;
+
+    // nullptr if there is no such room
+    SharedRateLimiter* Find(std::string_view roomName);
+
+private:
+    InternTable m_RoomIds;                     // never changed after construction, safe to read from any thread
+    std::deque<SharedRateLimiter> m_Limiters;  // by room id, a deque makes them in place
+};
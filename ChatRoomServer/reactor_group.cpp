@@ -0,0 +1,54 @@
+#include "reactor_group.h"
+
+#include <stdio.h>
+
+#include <thread>
+
+#include "logger.h"
+
+ReactorGroup::ReactorGroup(uint16 port, const ServerConfig& config)
+    : m_RoomLimits(m_Rooms.RoomNames(), config.roomChatLimit), m_Metrics(m_Rooms) {
+    if (config.chatLog) {
+        m_Log = std::make_unique<ChatLog>(m_Rooms.RoomNames(), HistoryLogConfig(config));
+        if (!m_Log->IsOpen()) {
+            LOG_WARN("the chat log is off");
+            m_Log.reset();
+        }
+    }
+    m_History = std::make_unique<ChatHistory>(m_Rooms.RoomNames(), config.historyCapacity, m_Log.get());
+
+    if (config.authentication) {
+        m_Auth = std::make_unique<AuthPool>(
+            config.credentials, config.authThreads, config.authQueue,
+            [this](const AuthRequest& request, AuthVerdict verdict) {
+                Reactor(request.reactor).PostVerdict(request.client, verdict);
+            });
+    }
+
+    uint32 count = config.reactorThreads > 0 ? config.reactorThreads : 1;
+    m_Reactors.reserve(count);
+    for (uint32 i = 0; i < count; i++) {
+        m_Reactors.push_back(std::make_unique<ChatRoomServer>(port, config, this, i));
+    }
+
+    // every reactor has its metrics registered, scrapes can start
+    if (config.metricsPort != 0) {
+        m_Endpoint = std::make_unique<MetricsEndpoint>(config.metricsPort, m_Metrics);
+    }
+}
+
+ReactorGroup::~ReactorGroup() {}
+
+int ReactorGroup::RunLoop() {
+    std::vector<std::thread> threads;
+    for (uint32 i = 1; i < Size(); i++) {
+        threads.emplace_back(&ChatRoomServer::RunLoop, m_Reactors[i].get());
+    }
+
+    int result = m_Reactors[0]->RunLoop();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    return result;
+}
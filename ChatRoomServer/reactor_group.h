@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "auth_pool.h"
+#include "chat_history.h"
+#include "chat_log.h"
+#include "metrics.h"
+#include "metrics_endpoint.h"
+#include "rate_limiter.h"
+#include "room_directory.h"
+#include "server.h"
+
+// Runs config.reactorThreads ChatRoomServer reactors, one per thread.
+//
+// Each reactor owns the connections it accepted (through its own SO_REUSEPORT
+// listen socket, or handed over by reactor 0 in dispatch mode), and all of them
+// share one RoomDirectory. Anything a reactor needs done to another reactor's
+// connections goes through that reactor's lock-free mailbox.
+class ReactorGroup {
+public:
+    ReactorGroup(uint16 port, const ServerConfig& config);
+    ~ReactorGroup();
+
+    // runs reactor 0 on the calling thread and the others on their own threads
+    int RunLoop();
+
+    uint32 Size() const { return static_cast<uint32>(m_Reactors.size()); }
+    ChatRoomServer& Reactor(uint32 index) { return *m_Reactors[index]; }
+    RoomDirectory& Rooms() { return m_Rooms; }
+    RoomRateLimits& RoomLimits() { return m_RoomLimits; }
+    ChatLog* Log() { return m_Log.get(); }
+    ChatHistory& History() { return *m_History; }
+    MetricsRegistry& Metrics() { return m_Metrics; }
+    AuthPool* Auth() { return m_Auth.get(); }
+
+private:
+    RoomDirectory m_Rooms;
+    RoomRateLimits m_RoomLimits;
+    std::unique_ptr<ChatLog> m_Log;  // nullptr if it is off
+    std::unique_ptr<ChatHistory> m_History;
+    MetricsRegistry m_Metrics;
+    std::vector<std::unique_ptr<ChatRoomServer>> m_Reactors;
+    std::unique_ptr<MetricsEndpoint> m_Endpoint;  // nullptr if the metrics are not served
+    // made before the reactors, and stopped before they go since its workers post to them
+    std::unique_ptr<AuthPool> m_Auth;  // nullptr if authentication is off
+};
@@ -0,0 +1,360 @@
+#include "room_directory.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+
+#include "password_hash.h"
+
+RoomDirectory::RoomDirectory() {
+    // init chatroom logic stuff
+    m_RoomNames.push_back("graphics");
+    m_RoomNames.push_back("network");
+    m_RoomNames.push_back("media");
+    m_RoomNames.push_back("configuration");
+
+    for (const std::string& roomName : m_RoomNames) {
+        m_RoomIds.Intern(roomName);
+    }
+    m_Rooms.resize(m_RoomNames.size());
+}
+
+bool RoomDirectory::Login(std::string_view userName, const ClientLocation& location, std::string_view token) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 userId = m_UserIds.Intern(userName);
+    if (userId >= m_Users.size()) {
+        m_Users.resize(userId + 1);
+    }
+
+    // the first login of a name owns it
+    User& user = m_Users[userId];
+    if (user.location.reactor != ClientLocation::kNO_REACTOR) {
+        return false;
+    }
+    user.token.assign(token);
+    Relocate(user, location);
+    return true;
+}
+
+bool RoomDirectory::Suspend(std::string_view userName, const ClientLocation& location, ClientLocation& suspended) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 userId = m_UserIds.Find(userName);
+    if (userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+    User& user = m_Users[userId];
+    if (user.location != location || user.token.empty()) {
+        return false;
+    }
+
+    // a handle of its own, so that only the suspension can log it out
+    suspended = ClientLocation{ClientLocation::kNO_REACTOR, ++m_Suspensions};
+    Relocate(user, suspended);
+    return true;
+}
+
+bool RoomDirectory::Suspended(std::string_view userName, ClientLocation& suspended) const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 userId = m_UserIds.Find(userName);
+    if (userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+    const ClientLocation& location = m_Users[userId].location;
+    if (location.reactor != ClientLocation::kNO_REACTOR || location.handle == 0) {
+        return false;
+    }
+    suspended = location;
+    return true;
+}
+
+bool RoomDirectory::Resume(std::string_view userName, std::string_view token, std::string_view newToken,
+                           const ClientLocation& location, ClientLocation& previous,
+                           std::vector<std::string_view>& roomNames) {
+    roomNames.clear();
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 userId = m_UserIds.Find(userName);
+    if (userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+    User& user = m_Users[userId];
+    if (user.token.empty() || user.token.size() != token.size() ||
+        !ConstantTimeEqual(reinterpret_cast<const uint8*>(user.token.data()),
+                           reinterpret_cast<const uint8*>(token.data()), token.size())) {
+        return false;
+    }
+
+    // a token is good for one resume, whoever saw it cannot use it again
+    user.token.assign(newToken);
+    previous = user.location;
+    Relocate(user, location);
+    for (const Membership& membership : user.rooms) {
+        roomNames.push_back(m_RoomNames[membership.room]);
+    }
+    return true;
+}
+
+bool RoomDirectory::Join(std::string_view roomName, std::string_view userName, std::vector<ClientLocation>& notify,
+                         uint32& version, bool& added) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    uint32 slot;
+    added = AddMember(roomId, userName, slot);
+    const Room& room = m_Rooms[roomId];
+    version = room.version;
+    if (added) {
+        Locate(room, slot, notify);
+    } else {
+        notify.clear();
+    }
+    return true;
+}
+
+bool RoomDirectory::Join(std::string_view roomName, std::string_view userName) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    uint32 slot;
+    AddMember(roomId, userName, slot);
+    return true;
+}
+
+bool RoomDirectory::Leave(std::string_view roomName, std::string_view userName, std::vector<ClientLocation>& notify,
+                          uint32& version) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    uint32 userId = m_UserIds.Find(userName);
+    if (userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+    const std::vector<Membership>& rooms = m_Users[userId].rooms;
+    for (size_t i = 0; i < rooms.size(); i++) {
+        if (rooms[i].room == roomId) {
+            RemoveMember(roomId, userId, i);
+
+            const Room& room = m_Rooms[roomId];
+            version = room.version;
+            Locate(room, kNO_SLOT, notify);
+            return true;
+        }
+    }
+    // not a member, nothing changed and nobody is told
+    return false;
+}
+
+bool RoomDirectory::LeaveNextRoom(std::string_view userName, const ClientLocation& location,
+                                  std::string_view& roomName, std::vector<ClientLocation>& notify, uint32& version) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 userId = m_UserIds.Find(userName);
+    if (userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+    const User& user = m_Users[userId];
+    if (user.location != location || user.rooms.empty()) {
+        return false;
+    }
+
+    // the last one, nothing moves in the user's list
+    uint32 roomId = user.rooms.back().room;
+    RemoveMember(roomId, userId, user.rooms.size() - 1);
+
+    const Room& room = m_Rooms[roomId];
+    roomName = m_RoomNames[roomId];
+    version = room.version;
+    Locate(room, kNO_SLOT, notify);
+    return true;
+}
+
+bool RoomDirectory::Logout(std::string_view userName, const ClientLocation& location) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 userId = m_UserIds.Find(userName);
+    if (userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+
+    User& user = m_Users[userId];
+    if (user.location != location) {
+        return false;
+    }
+    user.token.clear();
+    Relocate(user, ClientLocation{});
+    return true;
+}
+
+bool RoomDirectory::Roster(std::string_view roomName, uint32 sinceVersion, uint32 cursor, RosterPage& page,
+                           Arena& arena) const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    const Room& room = m_Rooms[roomId];
+    page.version = room.version;
+    page.present.clear();
+    page.absent.clear();
+    page.nextCursor = 0;
+
+    if (cursor == 0 && sinceVersion >= room.historyBase && sinceVersion <= room.version) {
+        RosterHistory::const_iterator first =
+            std::upper_bound(room.history.begin(), room.history.end(), sinceVersion,
+                             [](uint32 version, const RosterChange& change) { return version < change.version; });
+        if (static_cast<size_t>(room.history.end() - first) <= room.members.size()) {
+            // the latest change of each user wins
+            page.delta = true;
+            std::unordered_set<uint32, std::hash<uint32>, std::equal_to<uint32>, ArenaAllocator<uint32>> seen{
+                static_cast<size_t>(room.history.end() - first), std::hash<uint32>{}, std::equal_to<uint32>{},
+                ArenaAllocator<uint32>{arena}};
+            for (RosterHistory::const_iterator it = room.history.end(); it != first;) {
+                --it;
+                if (!seen.insert(it->user).second) continue;
+                (it->present ? page.present : page.absent).push_back(arena.Copy(m_UserIds.Name(it->user)));
+            }
+            return true;
+        }
+    }
+
+    page.delta = false;
+    size_t begin = std::min<size_t>(cursor, room.members.size());
+    size_t end = std::min<size_t>(begin + kROSTER_PAGE_SIZE, room.members.size());
+    page.present.reserve(end - begin);
+    for (size_t slot = begin; slot < end; slot++) {
+        page.present.push_back(arena.Copy(m_UserIds.Name(room.members[slot])));
+    }
+    if (end < room.members.size()) {
+        page.nextCursor = static_cast<uint32>(end);
+    }
+    return true;
+}
+
+bool RoomDirectory::Members(std::string_view roomName, std::vector<ClientLocation>& members) const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 roomId = m_RoomIds.Find(roomName);
+    if (roomId == InternTable::kINVALID_ID) {
+        return false;
+    }
+
+    Locate(m_Rooms[roomId], kNO_SLOT, members);
+    return true;
+}
+
+bool RoomDirectory::IsMember(std::string_view roomName, std::string_view userName) const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    uint32 roomId = m_RoomIds.Find(roomName);
+    uint32 userId = m_UserIds.Find(userName);
+    if (roomId == InternTable::kINVALID_ID || userId == InternTable::kINVALID_ID || userId >= m_Users.size()) {
+        return false;
+    }
+
+    for (const Membership& membership : m_Users[userId].rooms) {
+        if (membership.room == roomId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RoomDirectory::Population(uint64& users, std::vector<uint32>& members) const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    users = m_Users.size();
+    members.clear();
+    for (const Room& room : m_Rooms) {
+        members.push_back(static_cast<uint32>(room.members.size()));
+    }
+}
+
+// caller holds the lock, fills the user's slot in the room
+// returns false if the user was in the room already
+bool RoomDirectory::AddMember(uint32 roomId, std::string_view userName, uint32& slot) {
+    uint32 userId = m_UserIds.Intern(userName);
+    if (userId >= m_Users.size()) {
+        m_Users.resize(userId + 1);
+    }
+
+    Room& room = m_Rooms[roomId];
+    User& user = m_Users[userId];
+    for (const Membership& membership : user.rooms) {
+        if (membership.room == roomId) {
+            slot = membership.slot;
+            return false;
+        }
+    }
+
+    slot = static_cast<uint32>(room.members.size());
+    room.members.push_back(userId);
+    room.handles.push_back(user.location);
+    user.rooms.push_back(Membership{roomId, slot});
+    RecordChange(room, userId, true);
+    return true;
+}
+
+// caller holds the lock, points the user and its slot in each of its rooms at location
+void RoomDirectory::Relocate(User& user, const ClientLocation& location) {
+    user.location = location;
+    for (const Membership& membership : user.rooms) {
+        m_Rooms[membership.room].handles[membership.slot] = location;
+    }
+}
+
+// caller holds the lock, takes the user out of the room of its membership'th membership
+void RoomDirectory::RemoveMember(uint32 roomId, uint32 userId, size_t membership) {
+    Room& room = m_Rooms[roomId];
+    std::vector<Membership>& rooms = m_Users[userId].rooms;
+
+    // move the room's last member into the hole
+    uint32 slot = rooms[membership].slot;
+    uint32 lastId = room.members.back();
+    if (lastId != userId) {
+        room.members[slot] = lastId;
+        room.handles[slot] = room.handles.back();
+        for (Membership& moved : m_Users[lastId].rooms) {
+            if (moved.room == roomId) {
+                moved.slot = slot;
+                break;
+            }
+        }
+    }
+    room.members.pop_back();
+    room.handles.pop_back();
+
+    rooms[membership] = rooms.back();
+    rooms.pop_back();
+
+    if (lastId != userId) {
+        // part of the same change, ahead of it so that RecordChange() trims the history past both
+        room.history.push_back(RosterChange{room.version + 1, lastId, true});
+    }
+    RecordChange(room, userId, false);
+}
+
+// caller holds the lock, bumps the room's version for one membership change
+void RoomDirectory::RecordChange(Room& room, uint32 userId, bool present) {
+    room.version++;
+    room.history.push_back(RosterChange{room.version, userId, present});
+    while (room.history.size() > kROSTER_HISTORY) {
+        room.historyBase = room.history.front().version;
+        room.history.pop_front();
+    }
+}
+
+// caller holds the lock
+// members who joined without logging in have no connection and are skipped
+void RoomDirectory::Locate(const Room& room, uint32 excludedSlot, std::vector<ClientLocation>& locations) const {
+    locations.clear();
+    locations.reserve(room.handles.size());
+    for (size_t slot = 0; slot < room.handles.size(); slot++) {
+        const ClientLocation& handle = room.handles[slot];
+        if (slot == excludedSlot || handle.reactor == ClientLocation::kNO_REACTOR) continue;
+        locations.push_back(handle);
+    }
+}
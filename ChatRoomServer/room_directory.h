@@ -0,0 +1,179 @@
+#pragma once
+
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.h"
+#include "block_pool.h"
+#include "common.h"
+#include "intern_table.h"
+
+// Where a logged in user's connection lives: the reactor that owns the socket,
+// and the client's handle in that reactor, which goes stale when the client disconnects
+struct ClientLocation {
+    static constexpr uint32 kNO_REACTOR = ~0u;  // not logged in
+
+    uint32 reactor = kNO_REACTOR;
+    uint64 handle = 0;
+
+    bool operator==(const ClientLocation& other) const { return reactor == other.reactor && handle == other.handle; }
+    bool operator!=(const ClientLocation& other) const { return !(*this == other); }
+};
+
+// A slice of a room's roster, filled by RoomDirectory::Roster()
+// the names are views into the arena Roster() was given
+struct RosterPage {
+    uint32 version = 0;                     // the room's roster version when the slice was taken
+    bool delta = false;                     // changes since a version, or a page of the members
+    std::vector<std::string_view> present;  // joined since (delta), or the members from the cursor on (page)
+    std::vector<std::string_view> absent;   // left since, delta only
+    uint32 nextCursor = 0;                  // where the next page starts, 0 after the last page
+
+    // empty, the vectors keep their capacity
+    void Clear() {
+        version = 0;
+        delta = false;
+        present.clear();
+        absent.clear();
+        nextCursor = 0;
+    }
+};
+
+// The room and user state shared by every reactor.
+// Lookups take a shared lock and membership changes an exclusive one, so
+// broadcasts in different reactors do not serialize on each other.
+//
+// User and room names are interned into dense ids. A room keeps its members'
+// connection handles in one contiguous vector, so finding who to send a
+// broadcast to is a linear copy rather than a name lookup per member.
+//
+// Every membership change bumps the room's roster version and goes into a
+// bounded history, so a client that has the roster at a recent version is
+// sent the changes rather than the whole room.
+class RoomDirectory {
+public:
+    static constexpr uint32 kROSTER_PAGE_SIZE = 256;  // names per roster page
+    static constexpr uint32 kROSTER_HISTORY = 1024;   // changes kept per room for deltas
+
+    RoomDirectory();
+
+    // fixed at construction, safe to read without locking
+    const std::vector<std::string>& RoomNames() const { return m_RoomNames; }
+
+    // the first login of a name owns it until it logs out, token is what resuming the session takes, empty for none
+    // returns false if the name is owned by another login, which is left as it is
+    bool Login(std::string_view userName, const ClientLocation& location, std::string_view token = {});
+
+    // keep the session of the user logged in at location, rooms and all, after its connection is gone;
+    // fills where it is kept, a location no reactor has, so the members are sent nothing for it
+    // returns false if the user is not logged in at location, or has no token to resume by
+    bool Suspend(std::string_view userName, const ClientLocation& location, ClientLocation& suspended);
+
+    // fills where the user's session is kept if it is suspended
+    // returns false if it is not
+    bool Suspended(std::string_view userName, ClientLocation& suspended) const;
+
+    // move the user's session to location if token is the one it was given, whether it is suspended or its
+    // old connection is not known to be gone yet, and give it newToken in place of token; fills where the
+    // session was, a live connection the caller has to drop, and the rooms it is in, nothing is broadcast
+    // returns false for the wrong token, or a session logged out or never logged in
+    bool Resume(std::string_view userName, std::string_view token, std::string_view newToken,
+                const ClientLocation& location, ClientLocation& previous, std::vector<std::string_view>& roomNames);
+
+    // take the user logged in at location out of one of its rooms, for a disconnect; call until it returns false,
+    // each call is one Leave(), and fills the room's name, who to notify and the roster version after it
+    // returns false once the user is in no room, or if it is not logged in at location
+    bool LeaveNextRoom(std::string_view userName, const ClientLocation& location, std::string_view& roomName,
+                       std::vector<ClientLocation>& notify, uint32& version);
+
+    // the name is free to log in again, if it was logged in (or suspended) at location
+    // returns false if it was not
+    bool Logout(std::string_view userName, const ClientLocation& location);
+
+    // add the user to the room, fills the roster version with the join in it, and, if the user was not in the
+    // room already (added), who to notify (joiner excluded)
+    // returns false if there is no such room
+    bool Join(std::string_view roomName, std::string_view userName, std::vector<ClientLocation>& notify,
+              uint32& version, bool& added);
+
+    // add the user to the room without collecting anything, for bulk loading
+    // returns false if there is no such room
+    bool Join(std::string_view roomName, std::string_view userName);
+
+    // remove the user from the room, fills who to notify (the remaining users) and the roster version after it
+    // returns false if there is no such room, or the user is not in it
+    bool Leave(std::string_view roomName, std::string_view userName, std::vector<ClientLocation>& notify,
+               uint32& version);
+
+    // with cursor 0, the changes since sinceVersion if they are still known and fewer than the members,
+    // otherwise the page of members starting at cursor
+    // the names are copied into arena, they must outlive the lock
+    // returns false if there is no such room
+    bool Roster(std::string_view roomName, uint32 sinceVersion, uint32 cursor, RosterPage& page,
+                Arena& arena) const;
+
+    // fills where every user in the room is
+    // returns false if there is no such room
+    bool Members(std::string_view roomName, std::vector<ClientLocation>& members) const;
+
+    // true if the user is in the room
+    bool IsMember(std::string_view roomName, std::string_view userName) const;
+
+    // the number of users known, and the members of each room by room id, for metrics
+    void Population(uint64& users, std::vector<uint32>& members) const;
+
+private:
+    // the user's place in one room
+    struct Membership {
+        uint32 room;
+        uint32 slot;  // index in the room's members/handles
+    };
+
+    struct User {
+        ClientLocation location;
+        std::vector<Membership> rooms;  // a user is in a handful of rooms, a linear search is fine
+        std::string token;              // of its session, empty while logged out
+    };
+
+    // one user's membership as of a roster version
+    struct RosterChange {
+        uint32 version;
+        uint32 user;
+        bool present;
+    };
+    typedef std::deque<RosterChange, network::PoolAllocator<RosterChange>> RosterHistory;
+
+    // members and handles are parallel arrays, removal swaps the last member into the hole
+    // the member moved into the hole is recorded as a change too, so that a client paging
+    // by slot through a changing room finds it in the delta it catches up with afterwards
+    struct Room {
+        std::vector<uint32> members;          // user ids
+        std::vector<ClientLocation> handles;  // where each member's connection lives
+        uint32 version = 1;
+        RosterHistory history;    // oldest first, at most kROSTER_HISTORY
+        uint32 historyBase = 1;  // deltas can be made from this version on
+    };
+
+    bool AddMember(uint32 roomId, std::string_view userName, uint32& slot);
+    void Relocate(User& user, const ClientLocation& location);
+    void RemoveMember(uint32 roomId, uint32 userId, size_t membership);
+    void RecordChange(Room& room, uint32 userId, bool present);
+
+    // excludedSlot may be kNO_SLOT
+    void Locate(const Room& room, uint32 excludedSlot, std::vector<ClientLocation>& locations) const;
+
+    static constexpr uint32 kNO_SLOT = ~0u;
+
+private:
+    mutable std::shared_mutex m_Mutex;
+
+    InternTable m_UserIds;  // userName -> index in m_Users
+    InternTable m_RoomIds;  // roomName -> index in m_Rooms
+    std::vector<User> m_Users;
+    std::vector<Room> m_Rooms;
+    std::vector<std::string> m_RoomNames;  // by room id
+    uint64 m_Suspensions = 0;              // the handle of the last suspended session's location
+};
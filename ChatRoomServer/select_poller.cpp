@@ -0,0 +1,96 @@
+// Winsock's default FD_SETSIZE is only 64 sockets
+#ifdef _WIN32
+#define FD_SETSIZE 1024
+#endif
+
+#include "select_poller.h"
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+int SelectPoller::Add(SOCKET socket, uint32 flags, uint64 token) {
+    if (m_Indices.count(socket) != 0) {
+        return SOCKET_ERROR;
+    }
+#ifdef _WIN32
+    if (m_Entries.size() >= FD_SETSIZE) {
+        return SOCKET_ERROR;
+    }
+#else
+    // FD_SET on a descriptor past FD_SETSIZE is undefined behavior
+    if (socket >= FD_SETSIZE) {
+        return SOCKET_ERROR;
+    }
+#endif
+    m_Indices[socket] = m_Entries.size();
+    m_Entries.push_back(Entry{socket, flags, token});
+    return 0;
+}
+
+int SelectPoller::Modify(SOCKET socket, uint32 flags, uint64 token) {
+    std::unordered_map<SOCKET, size_t>::iterator it = m_Indices.find(socket);
+    if (it == m_Indices.end()) {
+        return SOCKET_ERROR;
+    }
+    Entry& entry = m_Entries[it->second];
+    entry.flags = flags;
+    entry.token = token;
+    return 0;
+}
+
+int SelectPoller::Remove(SOCKET socket) {
+    std::unordered_map<SOCKET, size_t>::iterator it = m_Indices.find(socket);
+    if (it == m_Indices.end()) {
+        return SOCKET_ERROR;
+    }
+    // swap with the last entry to keep m_Entries dense
+    size_t index = it->second;
+    m_Indices.erase(it);
+    if (index != m_Entries.size() - 1) {
+        m_Entries[index] = m_Entries.back();
+        m_Indices[m_Entries[index].socket] = index;
+    }
+    m_Entries.pop_back();
+    return 0;
+}
+
+int SelectPoller::Wait(std::vector<PollEvent>& ready, int timeoutMs) {
+    ready.clear();
+
+    fd_set readSet;
+    fd_set writeSet;
+    fd_set errorSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    FD_ZERO(&errorSet);
+
+    SOCKET maxSocket = 0;
+    for (const Entry& entry : m_Entries) {
+        if (entry.flags & kPOLL_READ) FD_SET(entry.socket, &readSet);
+        if (entry.flags & kPOLL_WRITE) FD_SET(entry.socket, &writeSet);
+        FD_SET(entry.socket, &errorSet);
+        if (entry.socket > maxSocket) maxSocket = entry.socket;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+    // the first parameter is ignored by Winsock
+    int result = select((int)maxSocket + 1, &readSet, &writeSet, &errorSet, &tv);
+    if (result <= 0) {
+        return result;
+    }
+
+    for (const Entry& entry : m_Entries) {
+        uint32 flags = 0;
+        if (FD_ISSET(entry.socket, &readSet)) flags |= kPOLL_READ;
+        if (FD_ISSET(entry.socket, &writeSet)) flags |= kPOLL_WRITE;
+        if (FD_ISSET(entry.socket, &errorSet)) flags |= kPOLL_ERROR;
+        if (flags != 0) {
+            ready.push_back(PollEvent{entry.token, flags});
+        }
+    }
+    return (int)ready.size();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "poller.h"
+
+// The portable select() backend.
+// Level-triggered, and each Wait() rebuilds the fd_sets from every watched socket.
+class SelectPoller : public Poller {
+public:
+    const char* Name() const override { return "select"; }
+
+    int Add(SOCKET socket, uint32 flags, uint64 token) override;
+    int Modify(SOCKET socket, uint32 flags, uint64 token) override;
+    int Remove(SOCKET socket) override;
+    int Wait(std::vector<PollEvent>& ready, int timeoutMs) override;
+
+private:
+    struct Entry {
+        SOCKET socket;
+        uint32 flags;
+        uint64 token;
+    };
+
+    std::vector<Entry> m_Entries;                  // watched sockets, densely packed
+    std::unordered_map<SOCKET, size_t> m_Indices;  // socket -> index in m_Entries
+};
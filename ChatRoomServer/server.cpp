@@ -1,250 +1,1101 @@
 #include "server.h"
 
-#include <WS2tcpip.h>
-#include <WinSock2.h>
 #include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "alloc_counter.h"
+#include "logger.h"
+#include "reactor_group.h"
 
 using namespace network;
 
-ChatRoomServer::ChatRoomServer(uint16 port) {
-    // init chatroom logic stuff
-    m_RoomNames.push_back("graphics");
-    m_RoomNames.push_back("network");
-    m_RoomNames.push_back("media");
-    m_RoomNames.push_back("configuration");
+AcceptMode DefaultAcceptMode() {
+#ifdef __linux__
+    return AcceptMode::kACCEPT_REUSEPORT;
+#else
+    return AcceptMode::kACCEPT_DISPATCH;
+#endif
+}
 
-    std::set<std::string> emptyUserSet{};
-    m_RoomMap.insert(std::make_pair("graphics", emptyUserSet));
-    m_RoomMap.insert(std::make_pair("network", emptyUserSet));
-    m_RoomMap.insert(std::make_pair("media", emptyUserSet));
-    m_RoomMap.insert(std::make_pair("configuration", emptyUserSet));
+ChatLogConfig HistoryLogConfig(const ServerConfig& config) {
+    ChatLogConfig logConfig = config.chatLogConfig;
+    logConfig.recentRecords = std::max(logConfig.recentRecords, config.historyCapacity);
+    return logConfig;
+}
+
+ChatRoomServer::ChatRoomServer(uint16 port, const ServerConfig& config, ReactorGroup* group, uint32 reactorIndex)
+    : m_Config(config), m_Group(group), m_ReactorIndex(reactorIndex) {
+    // init chatroom logic stuff
+    if (m_Group != nullptr) {
+        m_Rooms = &m_Group->Rooms();
+        m_RoomLimits = &m_Group->RoomLimits();
+        m_Log = m_Group->Log();
+        m_History = &m_Group->History();
+        m_Metrics = &m_Group->Metrics().AddReactor();
+        m_Auth = m_Group->Auth();
+    } else {
+        m_OwnedRooms = std::make_unique<RoomDirectory>();
+        m_Rooms = m_OwnedRooms.get();
+        m_OwnedRoomLimits = std::make_unique<RoomRateLimits>(m_Rooms->RoomNames(), m_Config.roomChatLimit);
+        m_RoomLimits = m_OwnedRoomLimits.get();
+        if (m_Config.chatLog) {
+            m_OwnedLog = std::make_unique<ChatLog>(m_Rooms->RoomNames(), HistoryLogConfig(m_Config));
+            if (m_OwnedLog->IsOpen()) {
+                m_Log = m_OwnedLog.get();
+            } else {
+                LOG_WARN("the chat log is off");
+                m_OwnedLog.reset();
+            }
+        }
+        m_OwnedHistory = std::make_unique<ChatHistory>(m_Rooms->RoomNames(), m_Config.historyCapacity, m_Log);
+        m_History = m_OwnedHistory.get();
+        m_OwnedMetrics = std::make_unique<MetricsRegistry>(*m_Rooms);
+        m_Metrics = &m_OwnedMetrics->AddReactor();
+        if (m_Config.authentication) {
+            m_OwnedAuth = std::make_unique<AuthPool>(
+                m_Config.credentials, m_Config.authThreads, m_Config.authQueue,
+                [this](const AuthRequest& request, AuthVerdict verdict) { PostVerdict(request.client, verdict); });
+            m_Auth = m_OwnedAuth.get();
+        }
+    }
+    m_Compressor =
+        std::make_unique<PacketCompressor>(BuildDictionary(m_Rooms->RoomNames()), m_Config.compressThreshold);
 
     // init networking stuff
-    int result = Initialize(port);
-    if (result != 0) {
-        //
+    // on a failure the poller is left unset, and RunLoop() refuses to run
+    if (Initialize(port, m_Config.pollerType) != 0) {
+        LOG_ERROR("reactor %u could not be initialized.", m_ReactorIndex);
+    }
+
+    if (m_OwnedMetrics && m_Config.metricsPort != 0) {
+        m_OwnedEndpoint = std::make_unique<MetricsEndpoint>(m_Config.metricsPort, *m_OwnedMetrics);
     }
 }
 
-ChatRoomServer::~ChatRoomServer() { Shutdown(); }
+ChatRoomServer::~ChatRoomServer() {
+    // the workers are done posting verdicts before the mailbox goes
+    m_OwnedAuth.reset();
+    Shutdown();
+}
 
 int ChatRoomServer::RunLoop() {
-    FD_ZERO(&(m_Conn.activeSockets));  // Initialize the sets
-    FD_ZERO(&(m_Conn.socketsReadyForReading));
-
-    // Define timeout for select()
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 500 * 1000;  // 500 milliseconds, half a second
+    if (!m_Conn.poller) {
+        LOG_ERROR("server is not initialized.");
+        return SOCKET_ERROR;
+    }
 
-    int selectResult;
+    // Define timeout for the poller
+    const int timeoutMs = 500;  // 500 milliseconds, half a second
 
-    // select work here
+    // poll work here
     for (;;) {
-        // SocketsReadyForReading will be empty here
-        FD_ZERO(&m_Conn.socketsReadyForReading);
-
-        // Add all the sockets that have data ready to be recv'd
-        // to the socketsReadyForReading
-        //
-        // socketsReadyForReading contains:
-        //  ListenSocket
-        //  All connectedClients' socket
-        //
-        // 1. Add the listen socket, to see if there are any new connections
-        FD_SET(m_Conn.listenSocket, &m_Conn.socketsReadyForReading);
-
-        // 2. Add all the connected sockets, to see if the is any information
-        //    to be recieved from the connected clients.
-        for (int i = 0; i < m_Conn.clients.size(); i++) {
-            ClientInfo& client = m_Conn.clients[i];
-            if (client.connected) {
-                FD_SET(client.socket, &m_Conn.socketsReadyForReading);
+        ReportStats();
+        SampleQueues();
+
+        // Only the sockets that are actually ready come back, so the work per
+        // wakeup is proportional to the ready sockets rather than to every
+        // connected client. On a timeout readyEvents is empty.
+        int waitResult = m_Conn.poller->Wait(m_Conn.readyEvents, PollTimeoutMs(timeoutMs));
+        if (waitResult == SOCKET_ERROR) {
+            LOG_ERROR("%s wait failed with error: %d", m_Conn.poller->Name(), LastSocketError());
+            return waitResult;
+        }
+        m_Metrics->loopIterations.Add();
+
+        for (const PollEvent& ev : m_Conn.readyEvents) {
+            if (ev.token == kLISTEN_TOKEN) {
+                // There are new clients trying to connect to the server
+                // using a "connect" function call.
+                if (!(ev.flags & kPOLL_ACCEPT)) {
+                    AcceptClients();
+                } else if (ev.result >= 0) {
+                    // the poller accepted it already
+                    DispatchClient(ev.result);
+                } else {
+                    LOG_ERROR("accept failed with error: %d", -ev.result);
+                }
+            } else if (ev.token == kWAKE_TOKEN) {
+                // Another reactor has posted work for us
+                DrainMailbox();
+            } else {
+                uint64 handle = ev.token;
+                if (ev.flags & kPOLL_RECEIVE) {
+                    // The poller received from a client (or saw it hang up)
+                    ReceiveFromClient(handle, ev.data, ev.result);
+                }
+                if (ev.flags & kPOLL_SENT) {
+                    // The poller wrote some of a client's queue
+                    CompleteSend(handle, ev.result);
+                }
+                if (ev.flags & (kPOLL_READ | kPOLL_ERROR)) {
+                    // A connected client has sent data using send (or hung up)
+                    ReadFromClient(handle);
+                }
+                if (ev.flags & kPOLL_WRITE) {
+                    // A client with queued frames can take more, and if that
+                    // brought it back under the low watermark, resume reading it
+                    if (FlushClient(handle)) {
+                        ReadFromClient(handle);
+                    }
+                }
             }
         }
 
-        // Select will check all sockets in the SocketsReadyForReading set
-        // to see if there is any data to be read on the socket.
-        // https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-select
-        selectResult = select(0, &m_Conn.socketsReadyForReading, NULL, NULL, &tv);
-        if (selectResult == 0) {
-            // Time limit expired
-            continue;
+        // ping the clients gone silent, drop the ones that did not answer
+        ExpireTimers();
+
+        // write the broadcasts this iteration queued, if their window is up
+        FlushCoalesced();
+
+        // the clients that went away take their leave of their rooms
+        ReleaseDeparted();
+    }
+}
+
+// How long the poller may sleep: no longer than until the coalesced broadcasts are due,
+// or than the next tick of the timers if any are armed
+int ChatRoomServer::PollTimeoutMs(int idleTimeoutMs) const {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (const TimingWheel* timers : {&m_Timers, &m_GraceTimers, &m_ThrottleTimers}) {
+        if (timers->Size() == 0) continue;
+        int64 tickMs = std::chrono::ceil<std::chrono::milliseconds>(timers->UntilNextTick(now)).count();
+        idleTimeoutMs = static_cast<int>(std::min<int64>(tickMs, idleTimeoutMs));
+    }
+    if (m_PendingFlush.empty()) return idleTimeoutMs;
+
+    std::chrono::steady_clock::duration left = m_FlushDeadline - now;
+    if (left <= std::chrono::steady_clock::duration::zero()) return 0;
+    // the poller counts in milliseconds, a shorter window is only as precise as the loop is busy
+    return static_cast<int>(std::min<int64>(std::chrono::ceil<std::chrono::milliseconds>(left).count(), idleTimeoutMs));
+}
+
+// Heartbeats, for the clients whose timer went off:
+// one heard from within the interval is given the rest of it, a silent one is
+// pinged, and one that has not answered when the ping times out is disconnected.
+// Receiving only notes the time, the wheel is not touched for every packet.
+// Then the suspended sessions whose grace ran out leave their rooms, and the throttled clients
+// whose next chat has its token are read again.
+void ChatRoomServer::ExpireTimers() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    m_Timers.Advance(now, m_Expired);
+
+    for (uint32 slot : m_Expired) {
+        ClientInfo& client = m_Conn.clients.At(slot);
+        if (!client.connected) continue;
+
+        std::chrono::steady_clock::time_point idleDeadline = client.lastReceive + m_Config.heartbeatInterval;
+        if (client.sendBlocked || client.throttled) {
+            // a blocked or throttled client is not being read, its silence says nothing
+            m_Timers.Schedule(slot, now + m_Config.heartbeatInterval);
+        } else if (idleDeadline > now) {
+            m_Timers.Schedule(slot, idleDeadline);
+        } else if (client.lastReceive >= client.pingSent) {
+            // never pinged, or the last ping was answered
+            client.pingSent = now;
+            m_Timers.Schedule(slot, now + m_Config.heartbeatTimeout);
+            SendPing(client);
+        } else {
+            LOG_INFO("client silent for %lld s, disconnecting.",
+                     std::chrono::duration_cast<std::chrono::seconds>(now - client.lastReceive).count());
+            m_Metrics->idleDisconnects.Add();
+            DisconnectClient(client);
         }
-        if (selectResult == SOCKET_ERROR) {
-            printf("select failed with error: %d\n", WSAGetLastError());
-            return selectResult;
+    }
+    m_Expired.clear();
+
+    m_GraceTimers.Advance(now, m_Expired);
+    for (uint32 slot : m_Expired) {
+        const SuspendedSession& session = m_Suspended.At(slot);
+        // nothing to do if it was resumed, or logged in afresh, in the meantime
+        if (PurgeSession(session.userName, session.location)) {
+            LOG_INFO("'%s' did not come back in time.", session.userName);
+            m_Metrics->sessionsExpired.Add();
         }
+        m_Suspended.Release(m_Suspended.Handle(slot));
+    }
+    m_Expired.clear();
 
-        // Check if our ListenSocket is set. This checks if there is a
-        // new client trying to connect to the server using a "connect"
-        // function call.
-        if (FD_ISSET(m_Conn.listenSocket, &m_Conn.socketsReadyForReading)) {
-            // [Accept]
-            SOCKET clientSocket = accept(m_Conn.listenSocket, NULL, NULL);
-            if (clientSocket == INVALID_SOCKET) {
-                printf("accept failed with error: %d\n", WSAGetLastError());
-            } else {
-                printf("accept OK!\n");
-                ClientInfo newClient;
-                newClient.socket = clientSocket;
-                newClient.connected = true;
-                m_Conn.clients.push_back(newClient);
+    m_ThrottleTimers.Advance(now, m_Expired);
+    for (uint32 slot : m_Expired) {
+        ClientInfo& client = m_Conn.clients.At(slot);
+        if (!client.connected || !client.throttled) continue;
+        client.throttled = false;
+        UpdateInterest(client);
+        // the chat that waited first, then whatever came after it
+        ReadFromClient(m_Conn.clients.Handle(slot));
+    }
+    m_Expired.clear();
+}
+
+// [Accept] every pending connection.
+// The listen socket may be edge-triggered, so keep going until accept would block.
+void ChatRoomServer::AcceptClients() {
+    for (;;) {
+        SOCKET clientSocket = accept(m_Conn.listenSocket, NULL, NULL);
+        if (clientSocket == INVALID_SOCKET) {
+            int error = LastSocketError();
+            if (!IsWouldBlock(error)) {
+                LOG_ERROR("accept failed with error: %d", error);
             }
+            return;
         }
+        DispatchClient(clientSocket);
+    }
+}
 
-        // Check if any of the currently connected clients have sent data using send
-        for (int i = 0; i < m_Conn.clients.size(); i++) {
-            ClientInfo& client = m_Conn.clients[i];
+// Serve an accepted socket here, or in dispatch mode on the reactor whose turn it is
+void ChatRoomServer::DispatchClient(SOCKET clientSocket) {
+    // in dispatch mode the sockets are dealt out to the reactors in turn
+    uint32 target = m_ReactorIndex;
+    if (m_Group != nullptr && m_Config.acceptMode == AcceptMode::kACCEPT_DISPATCH) {
+        target = m_NextReactor;
+        m_NextReactor = (m_NextReactor + 1) % m_Group->Size();
+    }
 
-            if (!client.connected) continue;
+    if (target == m_ReactorIndex) {
+        AdoptClient(clientSocket);
+    } else {
+        MailboxItem item;
+        item.kind = MailboxItem::kADOPT;
+        item.socket = clientSocket;
+        m_Group->Reactor(target).Post(std::move(item));
+    }
+}
 
-            if (FD_ISSET(client.socket, &m_Conn.socketsReadyForReading)) {
-                // https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-recv
-                // result
-                //		-1 : SOCKET_ERROR (More info received from WSAGetLastError() after)
-                //		0 : client disconnected
-                //		>0: The number of bytes received.
-                ZeroMemory(&m_RawRecvBuf, kRECV_BUF_SIZE);
-                int recvResult = recv(client.socket, m_RawRecvBuf, kRECV_BUF_SIZE, 0);
+// Start serving an accepted socket on this reactor
+void ChatRoomServer::AdoptClient(SOCKET clientSocket) {
+    // a poller that does the I/O waits for the socket in the kernel, it is left blocking
+    if (!m_Conn.completions && SetNonBlocking(clientSocket) == SOCKET_ERROR) {
+        LOG_ERROR("set non-blocking failed with error: %d", LastSocketError());
+        CloseSocket(clientSocket);
+        return;
+    }
 
-                if (recvResult < 0) {
-                    printf("recv failed: %d\n", WSAGetLastError());
-                    continue;
-                }
+    if (m_Config.coalesceWrites) {
+        // the server batches its own writes, Nagle would only hold the last of them back
+        int noDelay = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    }
 
-                // Saving some time to not modify a vector while
-                // iterating through it. Want remove the client
-                // from the vector
-                if (recvResult == 0) {
-                    printf("client disconnected!\n");
-                    client.connected = false;
-                    continue;
-                }
+    uint64 handle = m_Conn.clients.Acquire();
+    uint32 readFlag = m_Conn.completions ? kPOLL_RECEIVE : kPOLL_READ;
+    if (m_Conn.poller->Add(clientSocket, readFlag, handle) == SOCKET_ERROR) {
+        LOG_ERROR("%s add failed with error: %d", m_Conn.poller->Name(), LastSocketError());
+        m_Conn.clients.Release(handle);
+        CloseSocket(clientSocket);
+        return;
+    }
+
+    LOG_INFO("accept OK!");
+    // a reused slot keeps its buffers, emptied
+    ClientInfo& client = m_Conn.clients.At(SlotTable<ClientInfo>::SlotOf(handle));
+    client.socket = clientSocket;
+    client.connected = true;
+    client.handle = handle;
+    client.recvBuf.Consume(client.recvBuf.ReadableSize());
+    client.sendQueue.Clear();
+    client.sendInFlight = false;
+    client.pollFlags = readFlag;
+    client.sendBlocked = false;
+    client.framesDropped = 0;
+    client.flushPending = false;
+    client.features = 0;
+    client.userName.clear();
+    client.authPending = false;
+    client.authName.clear();
+    client.chatLimiter = RateLimiter{m_Config.clientChatLimit};
+    client.throttled = false;
+    client.lastReceive = std::chrono::steady_clock::now();
+    client.pingSent = std::chrono::steady_clock::time_point::min();
+    if (m_Config.heartbeatInterval.count() > 0) {
+        m_Timers.Schedule(SlotTable<ClientInfo>::SlotOf(handle), client.lastReceive + m_Config.heartbeatInterval);
+    }
+    m_Metrics->connections.Add(1);
+}
+
+// Hand work to this reactor from any thread
+void ChatRoomServer::Post(MailboxItem&& item) {
+    m_Mailbox.Push(std::move(item));
+    m_Waker.Wake();
+}
 
-                printf("recv %d bytes from client.\n", recvResult);
+void ChatRoomServer::PostVerdict(uint64 client, AuthVerdict verdict) {
+    MailboxItem item;
+    item.kind = MailboxItem::kAUTHENTICATED;
+    item.client = client;
+    item.verdict = verdict;
+    Post(std::move(item));
+}
 
-                // We must receive 4 bytes before we know how long the packet actually is
-                // We must receive the entire packet before we can handle the message.
-                // Our protocol says we have a HEADER[pktsize, messagetype];
-                m_RecvBuf.Set(m_RawRecvBuf, kRECV_BUF_SIZE);
-                uint32_t packetSize = m_RecvBuf.ReadUInt32LE();
-                MessageType messageType = static_cast<MessageType>(m_RecvBuf.ReadUInt32LE());
+// Do the work other reactors have posted
+void ChatRoomServer::DrainMailbox() {
+    m_Waker.Drain();
 
-                if (m_RecvBuf.Size() >= packetSize) {
-                    // We can finally handle our message
-                    HandleMessage(messageType, client);
+    MailboxItem item;
+    while (m_Mailbox.Pop(item)) {
+        switch (item.kind) {
+            case MailboxItem::kDELIVER:
+                for (uint64 handle : item.targets) {
+                    if (ClientInfo* client = m_Conn.clients.Find(handle)) {
+                        SendResponse(*client, item.frame, true);
+                    }
+                }
+                break;
+            case MailboxItem::kADOPT:
+                AdoptClient(item.socket);
+                break;
+            case MailboxItem::kAUTHENTICATED:
+                // a client gone since has its slot released or about to be
+                if (ClientInfo* client = m_Conn.clients.Find(item.client)) {
+                    if (!client->connected || !client->authPending) break;
+                    CompleteLogin(*client, item.verdict);
+                    // then the requests that came after the login
+                    ReadFromClient(item.client);
                 }
+                break;
+            case MailboxItem::kSUPERSEDED:
+                DropSuperseded(item.client);
+                break;
+        }
+    }
+}
+
+// Receive everything a client has sent so far.
+// The socket may be edge-triggered, so keep going until recv would block.
+void ChatRoomServer::ReadFromClient(uint64 handle) {
+    ClientInfo* found = m_Conn.clients.Find(handle);
+    if (found == nullptr) return;
+
+    std::chrono::steady_clock::time_point drainStart = std::chrono::steady_clock::now();
+
+    ClientInfo& client = *found;
 
-                FD_CLR(client.socket, &m_Conn.socketsReadyForReading);
+    // packets left over from when the client was blocked, logging in or throttled go first
+    if (client.connected && !client.sendBlocked && !client.authPending && !client.throttled &&
+        !HandlePackets(client)) {
+        DisconnectClient(client);
+    }
+
+    // a blocked client's requests stay unread in the socket until its queue drains, those of a client
+    // logging in until its password is checked, and those of a throttled one until its next chat's token comes;
+    // a poller that does the I/O receives for the client itself, ReceiveFromClient() takes it from there
+    while (!m_Conn.completions && client.connected && !client.sendBlocked && !client.authPending &&
+           !client.throttled) {
+        // recv straight into the free space of the client's ring, HandlePackets
+        // always leaves some room so the size is never 0
+        // result
+        //		-1 : SOCKET_ERROR (More info received from LastSocketError() after)
+        //		0 : client disconnected
+        //		>0: The number of bytes received.
+        RingBuffer& ring = client.recvBuf;
+        int recvResult = recv(client.socket, ring.WritePtr(), (int)ring.WritableSize(), 0);
+
+        if (recvResult < 0) {
+            int error = LastSocketError();
+            if (IsWouldBlock(error)) {
+                // drained
+                break;
             }
+            LOG_ERROR("recv failed: %d", error);
+            DisconnectClient(client);
+            break;
+        }
+
+        if (recvResult == 0) {
+            LOG_INFO("client disconnected!");
+            DisconnectClient(client);
+            break;
+        }
+
+        LOG_DEBUG("recv %d bytes from client.", recvResult);
+        ring.Commit(recvResult);
+        client.lastReceive = drainStart;
+        m_DrainStats.recvCalls++;
+        m_DrainStats.bytes += recvResult;
+
+        if (!HandlePackets(client)) {
+            DisconnectClient(client);
+            break;
         }
     }
+
+    m_DrainStats.drainNanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - drainStart).count();
 }
 
-// [send] S2C_LoginAckMsg
-int ChatRoomServer::AckLogin(ClientInfo& client, MessageStatus status, const std::vector<std::string>& roomNames) {
-    S2C_LoginAckMsg msg{MessageStatus::kSUCCESS, m_RoomNames};
-    msg.Serialize(m_SendBuf);
-    return SendResponse(client, &msg);
+// Take in what the poller received from a client, a poller that does the I/O.
+// Bytes may still come for a client that is not being read, received before reading it was paused,
+// they wait in its ring with the rest.
+void ChatRoomServer::ReceiveFromClient(uint64 handle, const char* data, int result) {
+    ClientInfo* found = m_Conn.clients.Find(handle);
+    if (found == nullptr || !found->connected) return;
+
+    ClientInfo& client = *found;
+    if (result <= 0) {
+        if (result == 0) {
+            LOG_INFO("client disconnected!");
+        } else {
+            LOG_ERROR("recv failed: %d", -result);
+        }
+        DisconnectClient(client);
+        return;
+    }
+
+    std::chrono::steady_clock::time_point drainStart = std::chrono::steady_clock::now();
+
+    LOG_DEBUG("recv %d bytes from client.", result);
+    RingBuffer& ring = client.recvBuf;
+    ring.Reserve(ring.ReadableSize() + result);
+    for (uint32 copied = 0; copied < static_cast<uint32>(result);) {
+        // in two pieces if the free space wraps around the end of the ring
+        uint32 size = std::min(ring.WritableSize(), static_cast<uint32>(result) - copied);
+        memcpy(ring.WritePtr(), data + copied, size);
+        ring.Commit(size);
+        copied += size;
+    }
+    client.lastReceive = drainStart;
+    m_DrainStats.recvCalls++;
+    m_DrainStats.bytes += result;
+
+    if (!HandlePackets(client)) {
+        DisconnectClient(client);
+    }
+
+    m_DrainStats.drainNanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - drainStart).count();
 }
 
-// [send] S2C_JoinRoomAckMsg
-int ChatRoomServer::AckJoinRoom(ClientInfo& client, network::MessageStatus status, const std::string& roomName,
-                                std::vector<std::string>& userNames) {
-    S2C_JoinRoomAckMsg msg{static_cast<uint16>(status), roomName, userNames};
-    msg.Serialize(m_SendBuf);
-    return SendResponse(client, &msg);
+// Handle every complete packet in the client's receive ring.
+// A partial packet is left in the ring until the rest of it arrives.
+// returns false if the stream is corrupt and the client must be dropped
+bool ChatRoomServer::HandlePackets(ClientInfo& client) {
+    RingBuffer& ring = client.recvBuf;
+
+    // We must receive 4 bytes before we know how long the packet actually is
+    // We must receive the entire packet before we can handle the message.
+    // Our protocol says we have a HEADER[pktsize, messagetype];
+    uint32 packetSize = 0;
+    while (client.connected && !client.sendBlocked && !client.authPending && !client.throttled &&
+           ring.PeekUInt32LE(0, packetSize)) {
+        if (packetSize < sizeof(PacketHeader) || packetSize > kMAX_PACKET_SIZE) {
+            LOG_WARN("invalid packet size %u from client.", packetSize);
+            return false;
+        }
+
+        if (ring.ReadableSize() < packetSize) {
+            // wait for the rest, and make sure a large packet will fit
+            ring.Reserve(packetSize);
+            break;
+        }
+
+        // We can finally handle our message, decoded in place from the ring
+        const char* packet = ring.Contiguous(packetSize);
+        MessageType messageType = static_cast<MessageType>(LoadUInt32LE(packet + sizeof(uint32)));
+        const char* body = packet + sizeof(PacketHeader);
+        uint32 bodySize = packetSize - sizeof(PacketHeader);
+        if (messageType == MessageType::kCHAT_IN_ROOM_REQ && !AdmitChat(client, body, bodySize, true)) {
+            // over its rate limit: put off, it stays in the ring until its token comes, or failed and dropped
+            if (client.throttled) break;
+            ring.Consume(packetSize);
+            continue;
+        }
+
+        uint64 allocationsBefore = AllocationCount();
+        bool handled = HandleMessage(messageType, body, bodySize, client);
+        m_DrainStats.allocations += AllocationCount() - allocationsBefore;
+        // the packet is answered, its temporaries go all at once
+        m_Arena.Reset();
+        if (!handled) {
+            LOG_WARN("malformed message %u from client.", messageType);
+            return false;
+        }
+
+        ring.Consume(packetSize);
+        m_DrainStats.packets++;
+    }
+    return true;
 }
 
-// [send] S2C_JoinRoomNtfMsg
-int ChatRoomServer::BroadcastJoinRoom(const std::set<std::string>& usersInRoom, const std::string& roomName,
-                                      const std::string& userName) {
-    for (const std::string& name : usersInRoom) {
-        if (name != userName) {
-            std::map<std::string, size_t>::iterator it = m_ClientMap.find(name);
-            if (it != m_ClientMap.end()) {
-                S2C_JoinRoomNtfMsg msg{roomName, userName};
-                msg.Serialize(m_SendBuf);
-                ClientInfo& client = m_Conn.clients.at(it->second);
-                SendResponse(client, &msg);
+// Print the receive and send path activity since the last report
+void ChatRoomServer::ReportStats() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - m_LastStatsReport < kSTATS_INTERVAL) return;
+    m_LastStatsReport = now;
+
+    if (m_DrainStats.recvCalls != 0) {
+        double seconds = m_DrainStats.drainNanoseconds / 1e9;
+        LOG_INFO("drained %llu packets, %llu bytes in %llu recv calls, %.3f ms busy (%.1f MB/s, %.0f packets/s), "
+                 "%.2f allocations/packet",
+                 m_DrainStats.packets, m_DrainStats.bytes, m_DrainStats.recvCalls, seconds * 1e3,
+                 seconds > 0 ? m_DrainStats.bytes / seconds / (1024 * 1024) : 0.0,
+                 seconds > 0 ? m_DrainStats.packets / seconds : 0.0,
+                 m_DrainStats.packets > 0 ? static_cast<double>(m_DrainStats.allocations) / m_DrainStats.packets : 0.0);
+    }
+    if (m_SendStats.sendCalls != 0 || m_SendStats.framesDropped != 0) {
+        LOG_INFO("sent %llu frames, %llu bytes in %llu send calls (%.1f frames/call), %llu slow consumers, "
+                 "%llu broadcasts dropped, %llu disconnected",
+                 m_SendStats.frames, m_SendStats.bytes, m_SendStats.sendCalls,
+                 m_SendStats.sendCalls > 0 ? static_cast<double>(m_SendStats.frames) / m_SendStats.sendCalls : 0.0,
+                 m_SendStats.slowConsumers, m_SendStats.framesDropped, m_SendStats.slowDisconnects);
+    }
+    const std::vector<CompressionStats>& compression = m_Compressor->Stats();
+    for (size_t i = 0; i < compression.size(); i++) {
+        const CompressionStats& stats = compression[i];
+        uint64 tried = stats.packets + stats.incompressible;
+        if (tried == 0) continue;
+        LOG_INFO("compressed %llu of %llu type %u packets, %llu -> %llu bytes (%.2fx), %.2f us/packet", stats.packets,
+                 tried, static_cast<uint32>(PacketCompressor::StatsType(i)), stats.bytesIn, stats.bytesOut,
+                 stats.bytesOut > 0 ? static_cast<double>(stats.bytesIn) / stats.bytesOut : 0.0,
+                 stats.nanoseconds / 1e3 / tried);
+    }
+    // the log is shared, the first reactor reports it
+    if (m_Log != nullptr && m_ReactorIndex == 0) {
+        ChatLogStats log = m_Log->TakeStats();
+        if (log.appends != 0 || log.rejected != 0) {
+            LOG_INFO("logged %llu chats, %llu bytes, %llu syncs (%.3f ms each), %llu segment rotations, %llu rejected",
+                     log.appends, log.bytes, log.syncs, log.syncs > 0 ? log.syncNanoseconds / 1e6 / log.syncs : 0.0,
+                     log.rotations, log.rejected);
+        }
+    }
+    m_DrainStats = DrainStats{};
+    m_SendStats = SendStats{};
+    m_Compressor->ResetStats();
+}
+
+// Publish how backed up the outbound queues are, every kMETRICS_INTERVAL
+void ChatRoomServer::SampleQueues() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - m_LastQueueSample < kMETRICS_INTERVAL) return;
+    m_LastQueueSample = now;
+
+    uint64 bytes = 0, frames = 0, maxBytes = 0, blocked = 0;
+    for (uint32 slot : m_Conn.clients.LiveSlots()) {
+        const ClientInfo& client = m_Conn.clients.At(slot);
+        if (!client.connected) continue;
+        uint64 queued = client.sendQueue.QueuedBytes();
+        bytes += queued;
+        frames += client.sendQueue.QueuedFrames();
+        maxBytes = std::max(maxBytes, queued);
+        if (client.sendBlocked) blocked++;
+    }
+    m_Metrics->queuedBytes.Set(bytes);
+    m_Metrics->queuedFrames.Set(frames);
+    m_Metrics->maxQueuedBytes.Set(maxBytes);
+    m_Metrics->blockedClients.Set(blocked);
+}
+
+// Stop watching and close a client's socket.
+// The client is flagged as disconnected and keeps its slot until ReleaseDeparted(),
+// a disconnect may happen in the middle of a broadcast that still refers to it.
+void ChatRoomServer::DisconnectClient(ClientInfo& client) {
+    if (!client.connected) return;
+
+    m_Conn.poller->Remove(client.socket);
+    CloseSocket(client.socket);
+    client.socket = INVALID_SOCKET;
+    client.connected = false;
+    // a write in flight still reads the frames at the head of the queue, they go when it completes
+    if (!client.sendInFlight) client.sendQueue.Clear();
+    client.sendBlocked = false;
+    client.throttled = false;
+    m_Timers.Cancel(SlotTable<ClientInfo>::SlotOf(client.handle));
+    m_ThrottleTimers.Cancel(SlotTable<ClientInfo>::SlotOf(client.handle));
+    m_Departed.push_back(client.handle);
+    m_Metrics->connections.Add(-1);
+}
+
+// Suspend the sessions of the clients disconnected this loop iteration, or take their users
+// out of their rooms if they cannot be resumed, and free the clients' slots.
+// A client the poller is still writing to keeps its slot, and its frames, until a later pass after that is done.
+void ChatRoomServer::ReleaseDeparted() {
+    size_t lingering = 0;
+    // the leave broadcasts may disconnect more clients, they are appended and released in the same pass
+    for (size_t i = 0; i < m_Departed.size(); i++) {
+        uint64 handle = m_Departed[i];
+        ClientInfo* client = m_Conn.clients.Find(handle);
+        if (client == nullptr) continue;
+
+        if (!client->userName.empty()) {
+            ClientLocation location{m_ReactorIndex, handle};
+            if (!SuspendSession(client->userName, location)) {
+                PurgeSession(client->userName, location);
             }
+            client->userName.clear();
         }
+        if (client->sendInFlight) {
+            m_Departed[lingering++] = handle;
+            continue;
+        }
+        m_Conn.clients.Release(handle);
+    }
+    m_Departed.resize(lingering);
+}
+
+// Keep the session of a user whose connection went in its rooms for the grace window, its members are told nothing
+// returns false if it cannot be resumed: resuming is off, or the user was not logged in at location
+bool ChatRoomServer::SuspendSession(const std::string& userName, const ClientLocation& location) {
+    ClientLocation suspended;
+    if (m_Config.resumeGrace.count() == 0 || !m_Rooms->Suspend(userName, location, suspended)) {
+        return false;
+    }
+
+    uint64 handle = m_Suspended.Acquire();
+    SuspendedSession& session = *m_Suspended.Find(handle);
+    session.userName = userName;
+    session.location = suspended;
+    m_GraceTimers.Schedule(SlotTable<SuspendedSession>::SlotOf(handle),
+                           std::chrono::steady_clock::now() + m_Config.resumeGrace);
+    LOG_INFO("'%s' has gone, its rooms are kept for %lld s.", userName,
+             static_cast<long long>(m_Config.resumeGrace.count()));
+    return true;
+}
+
+// Take the user logged in (or suspended) at location out of its rooms, telling the members left as a
+// leave request would, and log it out. The memberships are the user's own list, so this is as much work
+// as the rooms it was in.
+// returns false if the session is not at location any more
+bool ChatRoomServer::PurgeSession(const std::string& userName, const ClientLocation& location) {
+    std::string_view roomName;
+    uint32 rosterVersion = 0;
+    while (m_Rooms->LeaveNextRoom(userName, location, roomName, m_Targets, rosterVersion)) {
+        LOG_INFO("'%s' has left #%s.", userName, roomName);
+        BroadcastLeaveRoom(m_Targets, roomName, userName, rosterVersion);
+    }
+    return m_Rooms->Logout(userName, location);
+}
+
+// Put the client in the rooms of the session the token was given to, in place of a login.
+// The members are not told, to them the user never left.
+void ChatRoomServer::Resume(ClientInfo& client, std::string_view userName, std::string_view token) {
+    // a client logged in already would leave its own session behind
+    std::string newToken = NewResumeToken();
+    ClientLocation previous;
+    if (client.userName.empty() && !client.authPending &&
+        m_Rooms->Resume(userName, token, newToken, ClientLocation{m_ReactorIndex, client.handle}, previous,
+                        m_NameScratch)) {
+        LOG_INFO("'%s' is back in %u rooms.", userName, static_cast<uint32>(m_NameScratch.size()));
+        m_Metrics->sessionsResumed.Add();
+        // the old connection may not be known to be gone yet, it must not go on acting as the user
+        if (previous.reactor != ClientLocation::kNO_REACTOR) {
+            Supersede(previous);
+        }
+        client.userName.assign(userName);
+        AckResume(client, MessageStatus::kSUCCESS, m_NameScratch, newToken);
+        return;
+    }
+
+    LOG_INFO("'%s' cannot resume, it has to log in.", userName);
+    m_NameScratch.clear();
+    AckResume(client, MessageStatus::kFAILURE, m_NameScratch);
+}
+
+// Drop the connection a session was resumed away from, on whichever reactor it is
+void ChatRoomServer::Supersede(const ClientLocation& location) {
+    if (location.reactor == m_ReactorIndex || m_Group == nullptr) {
+        DropSuperseded(location.handle);
+        return;
+    }
+    MailboxItem item;
+    item.kind = MailboxItem::kSUPERSEDED;
+    item.client = location.handle;
+    m_Group->Reactor(location.reactor).Post(std::move(item));
+}
+
+// the session is not this client's any more, so its disconnect leaves the session alone
+void ChatRoomServer::DropSuperseded(uint64 handle) {
+    ClientInfo* client = m_Conn.clients.Find(handle);
+    if (client == nullptr || client->userName.empty()) return;
+
+    LOG_INFO("'%s' has resumed on another connection, the old one is dropped.", client->userName);
+    client->userName.clear();
+    DisconnectClient(*client);
+}
+
+// a token is as good as the password for the session, so it comes from the random source
+std::string ChatRoomServer::NewResumeToken() {
+    std::string token(kRESUME_TOKEN_SIZE, '\0');
+    for (size_t i = 0; i < token.size(); i += sizeof(uint32)) {
+        uint32 random = m_Random();
+        memcpy(&token[i], &random, sizeof(random));
+    }
+    return token;
+}
+
+// Hand a login's password to the workers, the client is not read until the verdict is in.
+// Without authentication, or with too many logins waiting, the verdict is given right away.
+void ChatRoomServer::Authenticate(ClientInfo& client, std::string_view userName, std::string_view password) {
+    client.authName.assign(userName);
+    if (m_Auth == nullptr) {
+        CompleteLogin(client, AuthVerdict::kAUTH_ACCEPTED);
+        return;
     }
+
+    AuthRequest request;
+    request.reactor = m_ReactorIndex;
+    request.client = client.handle;
+    request.userName.assign(userName);
+    request.password.assign(password);
+    if (!m_Auth->Submit(std::move(request))) {
+        LOG_WARN("too many logins waiting, '%s' is turned away.", userName);
+        m_Metrics->loginsTurnedAway.Add();
+        AckLogin(client, MessageStatus::kFAILURE, {});
+        return;
+    }
+    client.authPending = true;
+    client.authStarted = std::chrono::steady_clock::now();
+    UpdateInterest(client);
+}
+
+// Log the client in, or turn it away, on the verdict on its password
+void ChatRoomServer::CompleteLogin(ClientInfo& client, AuthVerdict verdict) {
+    if (client.authPending) {
+        client.authPending = false;
+        m_Metrics->authNanoseconds.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now() - client.authStarted)
+                                              .count());
+        UpdateInterest(client);
+    }
+
+    if (verdict == AuthVerdict::kAUTH_REJECTED) {
+        LOG_WARN("'%s' gave the wrong password.", client.authName);
+        m_Metrics->loginsRejected.Add();
+        AckLogin(client, MessageStatus::kFAILURE, {});
+        return;
+    }
+
+    if (verdict == AuthVerdict::kAUTH_REGISTERED) {
+        LOG_INFO("'%s' is registered.", client.authName);
+    }
+    // logging in rather than resuming starts over, the suspended session leaves its rooms as on a disconnect
+    ClientLocation suspended;
+    if (m_Rooms->Suspended(client.authName, suspended)) {
+        PurgeSession(client.authName, suspended);
+    }
+
+    // update client map
+    std::string token = m_Config.resumeGrace.count() != 0 ? NewResumeToken() : std::string{};
+    if (!m_Rooms->Login(client.authName, ClientLocation{m_ReactorIndex, client.handle}, token)) {
+        // the name is another live connection's, this one would act in its rooms without hearing from them
+        LOG_WARN("'%s' is logged in on another connection, this login is turned down.", client.authName);
+        AckLogin(client, MessageStatus::kFAILURE, {});
+        return;
+    }
+    LOG_INFO("'%s' has logged in.", client.authName);
+    client.userName = client.authName;
+
+    // respond with S2C_LoginAckMsg
+    AckLogin(client, MessageStatus::kSUCCESS, m_Rooms->RoomNames(), token);
+}
+
+// true if the client is logged in as userName, the only one that may join, leave or chat in its name
+bool ChatRoomServer::ActsAs(const ClientInfo& client, std::string_view userName) {
+    return !client.userName.empty() && client.userName == userName;
+}
+
+// Take a token for a chat from the client's bucket and its room's, before the chat is decoded.
+// returns true if the chat may be handled now; if not, the client is throttled until the token
+// comes and the chat stays unread, or, if it cannot wait or the policy says not to, it is failed
+bool ChatRoomServer::AdmitChat(ClientInfo& client, const char* body, uint32 bodySize, bool deferrable) {
+    // a client not logged in takes nobody's tokens, its chat is failed when it is handled
+    if (client.userName.empty()) return true;
+    // the room name is the first field, a chat too short to have one is for Decode() to turn down
+    if (bodySize < sizeof(uint32) || LoadUInt32LE(body) > bodySize - sizeof(uint32)) return true;
+    std::string_view roomName{body + sizeof(uint32), LoadUInt32LE(body)};
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    SharedRateLimiter* roomLimiter = m_Config.roomChatLimit.rate != 0 ? m_RoomLimits->Find(roomName) : nullptr;
+    std::chrono::steady_clock::time_point nextToken;
+    if (!client.chatLimiter.TryTake(now)) {
+        nextToken = client.chatLimiter.NextToken(now);
+    } else if (roomLimiter != nullptr && !roomLimiter->TryTake(now)) {
+        // the room is what holds the chat back, the client keeps its token
+        client.chatLimiter.GiveBack();
+        nextToken = roomLimiter->NextToken(now);
+    } else {
+        return true;
+    }
+
+    if (deferrable && m_Config.rateLimitPolicy == RateLimitPolicy::kRATE_LIMIT_DEFER) {
+        m_Metrics->chatsDeferred.Add();
+        client.throttled = true;
+        m_ThrottleTimers.Schedule(SlotTable<ClientInfo>::SlotOf(client.handle), nextToken);
+        UpdateInterest(client);
+        return false;
+    }
+
+    LOG_DEBUG("'%s' is over its chat rate in #%s.", client.userName, roomName);
+    m_Metrics->chatsRejected.Add();
+    AckChatInRoom(client, MessageStatus::kFAILURE, roomName, client.userName);
+    return false;
+}
+
+// Watch the client for reads unless it is blocked, logging in or throttled, and for writes while it has frames queued
+void ChatRoomServer::UpdateInterest(ClientInfo& client) {
+    if (!client.connected) return;
+
+    uint32 flags = 0;
+    if (!client.sendBlocked && !client.authPending && !client.throttled) {
+        flags |= m_Conn.completions ? kPOLL_RECEIVE : kPOLL_READ;
+    }
+    // a poller that does the I/O writes whatever it is handed, nothing waits for the socket to be writable
+    if (!client.sendQueue.Empty() && !m_Conn.completions) flags |= kPOLL_WRITE;
+    if (flags == client.pollFlags) return;
+
+    if (m_Conn.poller->Modify(client.socket, flags, client.handle) == SOCKET_ERROR) {
+        LOG_ERROR("%s modify failed with error: %d", m_Conn.poller->Name(), LastSocketError());
+        DisconnectClient(client);
+        return;
+    }
+    client.pollFlags = flags;
+}
+
+// [send] S2C_LoginAckMsg
+int ChatRoomServer::AckLogin(ClientInfo& client, MessageStatus status, const std::vector<std::string>& roomNames,
+                             std::string_view resumeToken) {
+    S2C_LoginAckGather msg{status, {}, client.features, resumeToken};
+    msg.roomNames.swap(m_NameScratch);
+    msg.roomNames.assign(roomNames.begin(), roomNames.end());
+    int result = SendResponse(client, Frame::Encode(msg));
+    msg.roomNames.swap(m_NameScratch);
+    return result;
+}
+
+// [send] S2C_ResumeAckMsg
+// the names are lent to the message, the vector goes back with its capacity
+int ChatRoomServer::AckResume(ClientInfo& client, MessageStatus status, std::vector<std::string_view>& roomNames,
+                              std::string_view resumeToken) {
+    S2C_ResumeAckGather msg{static_cast<uint16>(status), {}, client.features, resumeToken};
+    msg.roomNames.swap(roomNames);
+    int result = SendResponse(client, Frame::Encode(msg));
+    msg.roomNames.swap(roomNames);
+    return result;
+}
+
+// [send] S2C_JoinRoomAckMsg
+// the roster's names are lent to the message, the vectors go back to the roster with their capacity
+int ChatRoomServer::AckJoinRoom(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                                RosterPage& roster) {
+    S2C_JoinRoomAckGather msg{static_cast<uint16>(status),
+                              roomName,
+                              {},
+                              {},
+                              roster.version,
+                              static_cast<uint16>(roster.delta ? RosterKind::kROSTER_DELTA : RosterKind::kROSTER_PAGE),
+                              roster.nextCursor};
+    msg.userNames.swap(roster.present);
+    msg.leftUserNames.swap(roster.absent);
+    int result = SendResponse(client, Frame::Encode(msg));
+    msg.userNames.swap(roster.present);
+    msg.leftUserNames.swap(roster.absent);
+    return result;
+}
+
+// [send] S2C_JoinRoomNtfMsg
+int ChatRoomServer::BroadcastJoinRoom(const std::vector<ClientLocation>& targets, std::string_view roomName,
+                                      std::string_view userName, uint32 rosterVersion) {
+    if (targets.empty()) return 0;
+
+    S2C_JoinRoomNtfView msg{roomName, userName, rosterVersion};
+    Broadcast(targets, Frame::Encode(msg));
     return 0;
 }
 
 // [send] S2C_LeaveRoomAckMsg
-int ChatRoomServer::AckLeaveRoom(ClientInfo& client, network::MessageStatus status, const std::string& roomName,
-                                 const std::string& userName) {
-    S2C_LeaveRoomAckMsg msg{static_cast<uint16>(status), roomName, userName};
-    msg.Serialize(m_SendBuf);
-    return SendResponse(client, &msg);
+int ChatRoomServer::AckLeaveRoom(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                                 std::string_view userName) {
+    S2C_LeaveRoomAckView msg{static_cast<uint16>(status), roomName, userName};
+    return SendResponse(client, Frame::Encode(msg));
 }
 
 // [send] S2C_LeaveRoomNtfMsg
-int ChatRoomServer::BroadcastLeaveRoom(const std::set<std::string>& usersInRoom, const std::string& roomName,
-                                       const std::string& userName) {
-    for (const std::string& name : usersInRoom) {
-        std::map<std::string, size_t>::iterator it = m_ClientMap.find(name);
-        if (it != m_ClientMap.end()) {
-            S2C_LeaveRoomNtfMsg msg{roomName, userName};
-            msg.Serialize(m_SendBuf);
-            ClientInfo& client = m_Conn.clients.at(it->second);
-            SendResponse(client, &msg);
-        }
-    }
+int ChatRoomServer::BroadcastLeaveRoom(const std::vector<ClientLocation>& targets, std::string_view roomName,
+                                       std::string_view userName, uint32 rosterVersion) {
+    if (targets.empty()) return 0;
+
+    S2C_LeaveRoomNtfView msg{roomName, userName, rosterVersion};
+    Broadcast(targets, Frame::Encode(msg));
     return 0;
 }
 
 // [send] S2C_ChatInRoomAckMsg
-int ChatRoomServer::AckChatInRoom(ClientInfo& client, network::MessageStatus status, const std::string& roomName,
-                                  const std::string& userName) {
-    S2C_ChatInRoomAckMsg msg{MessageStatus::kSUCCESS, roomName, userName};
-    msg.Serialize(m_SendBuf);
-    return SendResponse(client, &msg);
+int ChatRoomServer::AckChatInRoom(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                                  std::string_view userName) {
+    S2C_ChatInRoomAckView msg{static_cast<uint16>(status), roomName, userName};
+    return SendResponse(client, Frame::Encode(msg));
 }
 
 // [send] S2C_ChatInRoomNtfMsg
-int ChatRoomServer::BroadcastChatInRoom(const std::set<std::string>& usersInRoom, const std::string& roomName,
-                                        const std::string& userName, const std::string& chat) {
-    for (const std::string& name : usersInRoom) {
-        std::map<std::string, size_t>::iterator it = m_ClientMap.find(name);
-        if (it != m_ClientMap.end()) {
-            S2C_ChatInRoomNtfMsg msg{roomName, userName, chat};
-            msg.Serialize(m_SendBuf);
-            ClientInfo& client = m_Conn.clients.at(it->second);
-            SendResponse(client, &msg);
-        }
+int ChatRoomServer::BroadcastChatInRoom(const std::vector<ClientLocation>& targets, std::string_view roomName,
+                                        std::string_view userName, std::string_view chat) {
+    // numbered and kept in the room's history as it is encoded
+    FramePtr frame = m_History->Append(roomName, userName, chat);
+    if (!frame) return 0;
+    // logged as it is sent, so that a backfill goes out without encoding it again
+    if (m_Log != nullptr) {
+        m_Log->Append(roomName, frame->Data(), frame->Size());
     }
+    if (targets.empty()) return 0;
+
+    Broadcast(targets, frame);
     return 0;
 }
 
+// [send] S2C_RosterAckMsg
+// the roster's names are lent to the message, the vectors go back to the roster with their capacity
+int ChatRoomServer::AckRoster(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                              RosterPage& roster) {
+    S2C_RosterAckGather msg{static_cast<uint16>(status),
+                            roomName,
+                            {},
+                            {},
+                            roster.version,
+                            static_cast<uint16>(roster.delta ? RosterKind::kROSTER_DELTA : RosterKind::kROSTER_PAGE),
+                            roster.nextCursor};
+    msg.userNames.swap(roster.present);
+    msg.leftUserNames.swap(roster.absent);
+    int result = SendResponse(client, Frame::Encode(msg));
+    msg.userNames.swap(roster.present);
+    msg.leftUserNames.swap(roster.absent);
+    return result;
+}
+
+// [send] S2C_ChatInRoomNtfMsg, the room's recent chats straight from its log
+int ChatRoomServer::SendBackfill(ClientInfo& client, std::string_view roomName) {
+    if (m_Log == nullptr || !m_Log->Recent(roomName, m_Config.chatLogConfig.recentRecords, m_Backfill)) return 0;
+
+    int result = SendResponses(client, m_Backfill.data(), m_Backfill.size());
+    m_Backfill.clear();
+    return result;
+}
+
+// [send] S2C_HistoryAckMsg, the chats in m_HistoryFrames copied into one packet as they are
+int ChatRoomServer::AckHistory(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                               uint32 oldestSeq, uint32 newestSeq) {
+    S2C_HistoryAckGather msg{static_cast<uint16>(status), roomName, oldestSeq, newestSeq, {}};
+    msg.packets.swap(m_HistoryPackets);
+    msg.packets.clear();
+    for (const FramePtr& frame : m_HistoryFrames) {
+        msg.packets.emplace_back(frame->Data(), frame->Size());
+    }
+    int result = SendResponse(client, Frame::Encode(msg));
+    msg.packets.swap(m_HistoryPackets);
+    m_HistoryFrames.clear();
+    return result;
+}
+
+// [send] S2C_PingMsg, a heartbeat
+int ChatRoomServer::SendPing(ClientInfo& client) {
+    S2C_PingMsg msg{++m_PingSequence};
+    m_Metrics->heartbeatsSent.Add();
+    return SendResponse(client, Frame::Encode(msg));
+}
+
+// [send] S2C_PongMsg
+int ChatRoomServer::AckPing(ClientInfo& client, uint32 sequence) {
+    S2C_PongMsg msg{sequence};
+    return SendResponse(client, Frame::Encode(msg));
+}
+
+// Send one frame to many clients.
+// Broadcasts encode the message once, and every target is sent the same frame.
+// Targets on other reactors are batched into one mailbox item per reactor.
+void ChatRoomServer::Broadcast(const std::vector<ClientLocation>& targets, const network::FramePtr& frame) {
+    m_Metrics->fanout.Record(targets.size());
+    for (const ClientLocation& target : targets) {
+        if (target.reactor == m_ReactorIndex) {
+            if (ClientInfo* client = m_Conn.clients.Find(target.handle)) {
+                SendResponse(*client, frame, true);
+            }
+        } else {
+            if (m_RemoteTargets.size() <= target.reactor) {
+                m_RemoteTargets.resize(target.reactor + 1);
+            }
+            m_RemoteTargets[target.reactor].push_back(target.handle);
+        }
+    }
+
+    for (uint32 reactor = 0; reactor < m_RemoteTargets.size(); reactor++) {
+        std::vector<uint64>& remote = m_RemoteTargets[reactor];
+        if (remote.empty() || m_Group == nullptr) continue;
+
+        // copied rather than swapped, remote keeps its capacity and the copy comes from the BlockPool
+        MailboxItem item;
+        item.kind = MailboxItem::kDELIVER;
+        item.frame = frame;
+        item.targets.assign(remote.begin(), remote.end());
+        remote.clear();
+        m_Group->Reactor(reactor).Post(std::move(item));
+    }
+}
+
 // Initialization includes:
-// 1. Initialize Winsock: WSAStartup
-// 2. getaddrinfo
-// 3. create socket
-// 4. bind
-// 5. listen
-int ChatRoomServer::Initialize(uint16 port) {
+// 1. Initialize sockets (WSAStartup on Windows)
+// 2. create the listen socket, unless reactor 0 accepts for this reactor
+// 3. create the poller and watch the listen socket and the waker
+int ChatRoomServer::Initialize(uint16 port, PollerType pollerType) {
     // Decalre adn initialize variables
-    WSADATA wsaData;
     int result;
 
-    FD_ZERO(&m_Conn.activeSockets);
-    FD_ZERO(&m_Conn.socketsReadyForReading);
-
-    // 1. WSAStartup
-    result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    // 1. StartupSockets
+    result = StartupSockets();
     if (result != 0) {
-        printf("WSAStartup failed with error %d\n", result);
+        LOG_ERROR("StartupSockets failed with error %d", result);
         return 1;
     } else {
-        printf("WSAStartup OK!\n");
+        LOG_INFO("StartupSockets OK!");
+    }
+
+    // 2. [Listen] socket
+    bool listening =
+        m_Group == nullptr || m_Config.acceptMode == AcceptMode::kACCEPT_REUSEPORT || m_ReactorIndex == 0;
+    if (listening) {
+        result = CreateListenSocket(port);
+        if (result != 0) {
+            CleanupSockets();
+            return result;
+        }
+    }
+
+    // 3. [Poller] the listen socket is non-blocking, so that accepting can be drained,
+    // unless the poller accepts on it itself
+    m_Conn.poller = CreatePoller(pollerType);
+    m_Conn.completions = m_Conn.poller && m_Conn.poller->DoesIo();
+    uint32 listenFlag = m_Conn.completions ? kPOLL_ACCEPT : kPOLL_READ;
+    if (!m_Conn.poller || !m_Waker.IsValid() ||
+        m_Conn.poller->Add(m_Waker.Handle(), kPOLL_READ, kWAKE_TOKEN) == SOCKET_ERROR ||
+        (listening && ((!m_Conn.completions && SetNonBlocking(m_Conn.listenSocket) == SOCKET_ERROR) ||
+                       m_Conn.poller->Add(m_Conn.listenSocket, listenFlag, kLISTEN_TOKEN) == SOCKET_ERROR))) {
+        LOG_ERROR("poller setup failed with error: %d", LastSocketError());
+        m_Conn.poller.reset();
+        if (m_Conn.info != nullptr) {
+            freeaddrinfo(m_Conn.info);
+            m_Conn.info = nullptr;
+        }
+        if (m_Conn.listenSocket != INVALID_SOCKET) {
+            CloseSocket(m_Conn.listenSocket);
+            m_Conn.listenSocket = INVALID_SOCKET;
+        }
+        CleanupSockets();
+        return SOCKET_ERROR;
+    } else {
+        LOG_INFO("%s poller OK!", m_Conn.poller->Name());
     }
 
-    // 2. getaddrinfo
-    ZeroMemory(&m_Conn.hints, sizeof(m_Conn.hints));
+    return result;
+}
+
+// Create the listen socket:
+// 1. getaddrinfo
+// 2. create socket
+// 3. bind
+// 4. listen
+int ChatRoomServer::CreateListenSocket(uint16 port) {
+    int result;
+
+    // 1. getaddrinfo
+    memset(&m_Conn.hints, 0, sizeof(m_Conn.hints));
     m_Conn.hints.ai_family = AF_INET;        // IPV4
     m_Conn.hints.ai_socktype = SOCK_STREAM;  // Stream
     m_Conn.hints.ai_protocol = IPPROTO_TCP;  // TCP
@@ -252,186 +1103,496 @@ int ChatRoomServer::Initialize(uint16 port) {
 
     result = getaddrinfo(NULL, std::to_string(port).c_str(), &m_Conn.hints, &m_Conn.info);
     if (result != 0) {
-        printf("getaddrinfo failed with error: %d\n", result);
-        WSACleanup();
+        LOG_ERROR("getaddrinfo failed with error: %d", result);
+        m_Conn.info = nullptr;
         return result;
     } else {
-        printf("getaddrinfo ok!\n");
+        LOG_INFO("getaddrinfo ok!");
     }
 
-    // 3. Create our listen socket [Socket]
+    // 2. Create our listen socket [Socket]
     m_Conn.listenSocket =
         socket(m_Conn.info->ai_family, m_Conn.info->ai_socktype, m_Conn.info->ai_protocol);
     if (m_Conn.listenSocket == INVALID_SOCKET) {
-        printf("socket failed with error: %d\n", WSAGetLastError());
+        LOG_ERROR("socket failed with error: %d", LastSocketError());
         freeaddrinfo(m_Conn.info);
-        WSACleanup();
-        return result;
+        m_Conn.info = nullptr;
+        return SOCKET_ERROR;
     } else {
-        printf("socket OK!\n");
+        LOG_INFO("socket OK!");
+    }
+
+#ifndef _WIN32
+    // allow a restarted server to bind while old connections sit in TIME_WAIT
+    int reuseAddr = 1;
+    setsockopt(m_Conn.listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
+#endif
+#ifdef SO_REUSEPORT
+    // every reactor of the group binds the same port, the kernel spreads the connections
+    if (m_Group != nullptr && m_Config.acceptMode == AcceptMode::kACCEPT_REUSEPORT) {
+        int reusePort = 1;
+        setsockopt(m_Conn.listenSocket, SOL_SOCKET, SO_REUSEPORT, &reusePort, sizeof(reusePort));
     }
+#endif
 
-    // 4. Bind our socket [Bind]
+    // 3. Bind our socket [Bind]
     // 12,14,1,3:80				Address lengths can be different
     // 123,111,230,109:55555	Must specify the length
     result = bind(m_Conn.listenSocket, m_Conn.info->ai_addr, (int)m_Conn.info->ai_addrlen);
     if (result == SOCKET_ERROR) {
-        printf("bind failed with error: %d\n", WSAGetLastError());
+        LOG_ERROR("bind failed with error: %d", LastSocketError());
         freeaddrinfo(m_Conn.info);
-        closesocket(m_Conn.listenSocket);
-        WSACleanup();
+        m_Conn.info = nullptr;
+        CloseSocket(m_Conn.listenSocket);
+        m_Conn.listenSocket = INVALID_SOCKET;
         return result;
     } else {
-        printf("bind OK!\n");
+        LOG_INFO("bind OK!");
     }
 
-    // 5. [Listen]
+    // 4. [Listen]
     result = listen(m_Conn.listenSocket, SOMAXCONN);
     if (result == SOCKET_ERROR) {
-        printf("listen failed with error: %d\n", WSAGetLastError());
+        LOG_ERROR("listen failed with error: %d", LastSocketError());
         freeaddrinfo(m_Conn.info);
-        closesocket(m_Conn.listenSocket);
-        WSACleanup();
+        m_Conn.info = nullptr;
+        CloseSocket(m_Conn.listenSocket);
+        m_Conn.listenSocket = INVALID_SOCKET;
         return result;
     } else {
-        printf("listen OK!\n");
+        LOG_INFO("listen OK!");
     }
 
     return result;
 }
 
 // Send response to client
-int ChatRoomServer::SendResponse(ClientInfo& client, network::Message* msg) {
-    // https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-send
-    int sendResult = send(client.socket, m_SendBuf.ConstData(), msg->header.packetSize, 0);
-    if (sendResult == SOCKET_ERROR) {
-        printf("send failed with error %d\n", WSAGetLastError());
-        WSACleanup();
+// The frame is queued and written without blocking, whatever the socket does not
+// take now is written when the poller reports it writable. Droppable frames
+// (broadcasts) are skipped for slow consumers.
+int ChatRoomServer::SendResponse(ClientInfo& client, const network::FramePtr& frame, bool droppable) {
+    return SendResponses(client, &frame, 1, droppable);
+}
+
+// Send several frames to one client, queued together and written with one gather write
+int ChatRoomServer::SendResponses(ClientInfo& client, const network::FramePtr* frames, size_t count, bool droppable) {
+    if (!client.connected || count == 0) return 0;
+
+    if (client.sendBlocked && droppable) {
+        // slow consumer, it misses this one
+        m_SendStats.framesDropped++;
+        m_Metrics->framesDropped.Add();
+        client.framesDropped++;
+        if (m_Config.slowConsumerDropBudget != 0 && client.framesDropped > m_Config.slowConsumerDropBudget) {
+            LOG_WARN("slow consumer missed %u broadcasts, disconnecting.", client.framesDropped);
+            m_SendStats.slowDisconnects++;
+            m_Metrics->slowDisconnects.Add();
+            DisconnectClient(client);
+            return SOCKET_ERROR;
+        }
+        return 0;
+    }
+
+    bool wasEmpty = client.sendQueue.Empty();
+    for (size_t i = 0; i < count; i++) {
+        const FramePtr& queued = CompressFor(client, frames[i]);
+        client.sendQueue.Push(queued);
+        // counted as the type it was encoded as, even if it goes out compressed
+        uint32 messageType = LoadUInt32LE(frames[i]->Data() + sizeof(uint32));
+        ReactorMetrics::TypeMetrics& metrics = m_Metrics->types[ReactorMetrics::TypeSlot(messageType)];
+        metrics.packetsOut.Add();
+        metrics.bytesOut.Add(queued->Size());
+    }
+    m_SendStats.frames += count;
+    if (droppable && m_Config.coalesceWrites) {
+        // a broadcast waits for the coalesced flush, with whatever else the client gets until then
+        DeferFlush(client);
+    } else if (wasEmpty || client.flushPending) {
+        // nothing ahead of it but deferred broadcasts, try to write it (and them) right away
+        FlushClient(client.handle);
+        if (!client.connected) return SOCKET_ERROR;
+    }
+
+    uint64 queuedBytes = client.sendQueue.QueuedBytes();
+    if (queuedBytes > m_Config.sendHardLimit) {
+        LOG_WARN("client over the send hard limit (%llu bytes queued), disconnecting.", queuedBytes);
+        m_SendStats.slowDisconnects++;
+        m_Metrics->slowDisconnects.Add();
+        DisconnectClient(client);
+        return SOCKET_ERROR;
+    }
+
+    if (!client.sendBlocked && queuedBytes > m_Config.sendHighWatermark) {
+        m_SendStats.slowConsumers++;
+        if (m_Config.slowConsumerPolicy == SlowConsumerPolicy::kSLOW_CONSUMER_DISCONNECT) {
+            LOG_WARN("slow consumer (%llu bytes queued), disconnecting.", queuedBytes);
+            m_SendStats.slowDisconnects++;
+            m_Metrics->slowDisconnects.Add();
+            DisconnectClient(client);
+            return SOCKET_ERROR;
+        }
+        client.sendBlocked = true;
+        client.framesDropped = 0;
+        UpdateInterest(client);
     }
     return 0;
 }
 
+// The frame as this client gets it, compressed if the client asked for that and the frame is large enough.
+// The login ack goes without the dictionary, the client builds it from the ack.
+const FramePtr& ChatRoomServer::CompressFor(const ClientInfo& client, const FramePtr& frame) {
+    if (!(client.features & Feature::kFEATURE_LZ4) || frame->Size() < m_Config.compressThreshold) return frame;
+
+    if (frame != m_LastFrame) {
+        bool loginAck = LoadUInt32LE(frame->Data() + sizeof(uint32)) == MessageType::kLOGIN_ACK;
+        m_LastFrame = frame;
+        m_LastCompressed = m_Compressor->Compress(*frame, !loginAck);
+    }
+    return m_LastCompressed ? m_LastCompressed : frame;
+}
+
+// Write a client's queued frames, as much as its socket takes.
+// returns true if the client just drained below the low watermark and reading it can resume
+bool ChatRoomServer::FlushClient(uint64 handle) {
+    ClientInfo* found = m_Conn.clients.Find(handle);
+    if (found == nullptr) return false;
+
+    ClientInfo& client = *found;
+    if (!client.connected || client.sendQueue.Empty()) return false;
+
+    if (m_Conn.completions) {
+        // the poller writes it, CompleteSend() carries on from there
+        SubmitSend(client);
+        return false;
+    }
+
+    // https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-wsasend
+    int sendResult = client.sendQueue.Flush(client.socket, m_SendStats.sendCalls);
+    if (sendResult == SOCKET_ERROR) {
+        LOG_ERROR("send failed with error %d", LastSocketError());
+        DisconnectClient(client);
+        return false;
+    }
+    m_SendStats.bytes += sendResult;
+
+    bool unblocked = false;
+    if (client.sendBlocked && client.sendQueue.QueuedBytes() <= m_Config.sendLowWatermark) {
+        client.sendBlocked = false;
+        unblocked = true;
+    }
+    UpdateInterest(client);
+    return unblocked && client.connected;
+}
+
+// Hand the head of a client's queue to the poller to write, a poller that does the I/O, unless a write is in flight
+void ChatRoomServer::SubmitSend(ClientInfo& client) {
+    if (client.sendInFlight || client.sendQueue.Empty()) return;
+
+    IoSlice slices[kMAX_IO_SLICES];
+    uint32 count = client.sendQueue.Gather(slices, kMAX_IO_SLICES);
+    if (m_Conn.poller->Send(client.socket, slices, count, client.handle) == SOCKET_ERROR) {
+        LOG_ERROR("%s send failed.", m_Conn.poller->Name());
+        DisconnectClient(client);
+        return;
+    }
+    client.sendInFlight = true;
+    m_SendStats.sendCalls++;
+}
+
+// The poller wrote some of a client's queue: take it off and hand over the rest,
+// and if that brought the client back under the low watermark, resume reading it
+void ChatRoomServer::CompleteSend(uint64 handle, int result) {
+    ClientInfo* found = m_Conn.clients.Find(handle);
+    if (found == nullptr) return;
+
+    ClientInfo& client = *found;
+    client.sendInFlight = false;
+    if (!client.connected) {
+        // disconnected while the write was in flight, its frames were kept for it until now
+        client.sendQueue.Clear();
+        return;
+    }
+    if (result < 0) {
+        LOG_ERROR("send failed with error %d", -result);
+        DisconnectClient(client);
+        return;
+    }
+
+    client.sendQueue.Retire(static_cast<uint32>(result));
+    m_SendStats.bytes += result;
+    SubmitSend(client);
+
+    bool unblocked = false;
+    if (client.sendBlocked && client.sendQueue.QueuedBytes() <= m_Config.sendLowWatermark) {
+        client.sendBlocked = false;
+        unblocked = true;
+    }
+    UpdateInterest(client);
+    if (unblocked && client.connected) {
+        ReadFromClient(handle);
+    }
+}
+
+// Queue a client for the coalesced flush, the first one opens the flush window
+void ChatRoomServer::DeferFlush(ClientInfo& client) {
+    if (client.flushPending) return;
+
+    if (m_PendingFlush.empty()) {
+        m_FlushDeadline = std::chrono::steady_clock::now() + m_Config.flushWindow;
+    }
+    client.flushPending = true;
+    m_PendingFlush.push_back(client.handle);
+}
+
+// Write every deferred client's queue, each in as few gather writes as it takes,
+// once the flush window is up (or at once for a 0 window)
+void ChatRoomServer::FlushCoalesced() {
+    if (m_PendingFlush.empty()) return;
+    if (m_Config.flushWindow.count() > 0 && std::chrono::steady_clock::now() < m_FlushDeadline) return;
+
+    // reading a client that comes back under its low watermark may defer more flushes
+    m_FlushScratch.swap(m_PendingFlush);
+    for (uint64 handle : m_FlushScratch) {
+        ClientInfo* client = m_Conn.clients.Find(handle);
+        if (client == nullptr) continue;
+        client->flushPending = false;
+        if (FlushClient(handle)) {
+            ReadFromClient(handle);
+        }
+    }
+    m_FlushScratch.clear();
+}
+
 // Shutdown and cleanup
 void ChatRoomServer::Shutdown() {
-    printf("closing ...\n");
-    freeaddrinfo(m_Conn.info);
-    closesocket(m_Conn.listenSocket);
-    WSACleanup();
+    if (!m_Conn.poller) {
+        // Initialize failed and already cleaned up
+        return;
+    }
+
+    LOG_INFO("closing ...");
+    // the rooms are not told, the server is going away with them
+    for (uint32 slot : m_Conn.clients.LiveSlots()) {
+        DisconnectClient(m_Conn.clients.At(slot));
+    }
+    m_Conn.poller.reset();
+    if (m_Conn.info != nullptr) {
+        freeaddrinfo(m_Conn.info);
+    }
+    if (m_Conn.listenSocket != INVALID_SOCKET) {
+        CloseSocket(m_Conn.listenSocket);
+    }
+    CleanupSockets();
+}
+
+// Handle one message and record it in the metrics, a batch's time includes that of the messages in it
+// returns false if the message is malformed
+bool ChatRoomServer::HandleMessage(network::MessageType msgType, const char* body, uint32 bodySize,
+                                   ClientInfo& client) {
+    ReactorMetrics::TypeMetrics& metrics = m_Metrics->types[ReactorMetrics::TypeSlot(msgType)];
+    metrics.packetsIn.Add();
+    metrics.bytesIn.Add(sizeof(PacketHeader) + bodySize);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool handled = DispatchMessage(msgType, body, bodySize, client);
+    metrics.handlerNanoseconds.Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    return handled;
 }
 
 // Handle received messages
-void ChatRoomServer::HandleMessage(network::MessageType msgType, ClientInfo& client) {
+// Handle one message, its fields are views into the client's receive ring
+// returns false if the message is malformed
+bool ChatRoomServer::DispatchMessage(network::MessageType msgType, const char* body, uint32 bodySize,
+                                     ClientInfo& client) {
     switch (msgType) {
         // received C2S_LoginReqMsg
         case MessageType::kLOGIN_REQ: {
-            uint32_t userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-            uint32_t passwordLength = m_RecvBuf.ReadUInt32LE();
-            std::string password = m_RecvBuf.ReadString(passwordLength);
-
-            printf("authenticating user...\n");
-            // TODO: user authentication
-            printf("'%s' has logged in.\n", userName.c_str());
-            // update client map
-            for (size_t i = 0; i < m_Conn.clients.size(); i++) {
-                if (m_Conn.clients[i].socket == client.socket) {
-                    m_ClientMap.insert(std::make_pair(userName, i));
-                    break;
-                }
+            C2S_LoginReqView req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            // one login per connection, a second name would leave the first one's session behind in its rooms
+            if (!client.userName.empty()) {
+                LOG_WARN("'%s' is logged in already, its login as '%s' is turned down.", client.userName, req.userName);
+                AckLogin(client, MessageStatus::kFAILURE, {});
+                break;
+            }
+            if (req.userName.size() > kMAX_NAME_SIZE) {
+                LOG_WARN("a login with a %u byte name is turned down.", static_cast<uint32>(req.userName.size()));
+                AckLogin(client, MessageStatus::kFAILURE, {});
+                break;
             }
 
-            // respond with S2C_LoginAckMsg
-            AckLogin(client, MessageStatus::kSUCCESS, m_RoomNames);
+            LOG_DEBUG("authenticating user...");
+            client.features = m_Config.compression ? (req.features & Feature::kFEATURE_LZ4) : 0;
+            // acked once the password is checked, on a worker
+            Authenticate(client, req.userName, req.password);
+        } break;
+
+        // received C2S_ResumeReqMsg, a reconnect taking back its session instead of logging in
+        case MessageType::kRESUME_REQ: {
+            C2S_ResumeReqView req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            client.features = m_Config.compression ? (req.features & Feature::kFEATURE_LZ4) : 0;
+            Resume(client, req.userName, req.resumeToken);
         } break;
 
         // received C2S_JoinRoomReqMsg
         case MessageType::kJOIN_ROOM_REQ: {
-            uint32_t userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-            uint32_t roomNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-
-            printf("'%s' has joined #%s.\n", userName.c_str(), roomName.c_str());
+            C2S_JoinRoomReqView req;
+            if (!Decode(body, bodySize, req)) return false;
 
-            // add the user to room
-            std::map<std::string, std::set<std::string>>::iterator it = m_RoomMap.find(roomName);
-            if (it != m_RoomMap.end()) {
-                std::set<std::string>& usersInRoom = it->second;
-                usersInRoom.insert(userName);
+            // add the user to room, if it is the client's own
+            uint32 rosterVersion = 0;
+            bool added = false;
+            if (ActsAs(client, req.userName) &&
+                m_Rooms->Join(req.roomName, req.userName, m_Targets, rosterVersion, added)) {
+                if (added) LOG_INFO("'%s' has joined #%s.", req.userName, req.roomName);
 
-                // respond with S2C_JoinRoomAckMsg SUCCESS
-                std::vector<std::string> userNames{usersInRoom.begin(), usersInRoom.end()};
-                AckJoinRoom(client, MessageStatus::kSUCCESS, roomName, userNames);
+                // respond with S2C_JoinRoomAckMsg SUCCESS, the changes since the client's roster or its first page
+                m_Rooms->Roster(req.roomName, req.rosterVersion, 0, m_Roster, m_Arena);
+                AckJoinRoom(client, MessageStatus::kSUCCESS, req.roomName, m_Roster);
+                // then what was said in the room before
+                SendBackfill(client, req.roomName);
 
-                // broadcast event with S2C_JoinRoomNtfMsg
-                BroadcastJoinRoom(usersInRoom, roomName, userName);
+                // broadcast event with S2C_JoinRoomNtfMsg, unless it was a member already and nothing changed
+                if (added) {
+                    BroadcastJoinRoom(m_Targets, req.roomName, req.userName, rosterVersion);
+                }
             } else {
                 // respond with S2C_JoinRoomAckMsg FAILURE
-                std::vector<std::string> placeHolder{};
-                AckJoinRoom(client, MessageStatus::kFAILURE, roomName, placeHolder);
+                m_Roster.Clear();
+                AckJoinRoom(client, MessageStatus::kFAILURE, req.roomName, m_Roster);
             }
 
         } break;
 
         // received C2S_LeaveRoomReqMsg
         case MessageType::kLEAVE_ROOM_REQ: {
-            uint32_t roomNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-            uint32_t userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-
-            printf("'%s' has left #%s.\n", userName.c_str(), roomName.c_str());
-
-            // remove the user from room
-            std::map<std::string, std::set<std::string>>::iterator it = m_RoomMap.find(roomName);
-            if (it != m_RoomMap.end()) {
-                std::set<std::string>& usersInRoom = it->second;
-                std::set<std::string>::iterator uit = usersInRoom.find(userName);
-                if (uit != usersInRoom.end()) {
-                    usersInRoom.erase(uit);
-                }
+            C2S_LeaveRoomReqView req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            // remove the user from room, if it is the client's own
+            uint32 rosterVersion = 0;
+            if (ActsAs(client, req.userName) && m_Rooms->Leave(req.roomName, req.userName, m_Targets, rosterVersion)) {
+                LOG_INFO("'%s' has left #%s.", req.userName, req.roomName);
 
                 // respond with S2C_LeaveRoomAckMsg SUCCESS
-                AckLeaveRoom(client, MessageStatus::kSUCCESS, roomName, userName);
+                AckLeaveRoom(client, MessageStatus::kSUCCESS, req.roomName, req.userName);
 
                 // broadcast event with S2C_LeaveRoomNtfMsg
-                BroadcastLeaveRoom(usersInRoom, roomName, userName);
+                BroadcastLeaveRoom(m_Targets, req.roomName, req.userName, rosterVersion);
             } else {
                 // respond with S2C_LeaveRoomAckMsg FAILURE
-                AckLeaveRoom(client, MessageStatus::kFAILURE, roomName, userName);
+                AckLeaveRoom(client, MessageStatus::kFAILURE, req.roomName, req.userName);
             }
 
         } break;
 
         // received C2S_ChatInRoomReqMsg
+        // the hot path: decoded in place and the room lookup reuses m_Targets, nothing is copied out of the ring
         case MessageType::kCHAT_IN_ROOM_REQ: {
-            uint32_t roomNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string roomName = m_RecvBuf.ReadString(roomNameLength);
-            uint32_t userNameLength = m_RecvBuf.ReadUInt32LE();
-            std::string userName = m_RecvBuf.ReadString(userNameLength);
-            uint32_t chatLength = m_RecvBuf.ReadUInt32LE();
-            std::string chat = m_RecvBuf.ReadString(chatLength);
+            C2S_ChatInRoomReqView req;
+            if (!Decode(body, bodySize, req)) return false;
 
-            printf("'%s' - #%s: %s.\n", userName.c_str(), roomName.c_str(), chat.c_str());
+            // a chat goes out under the name the client logged in as, never one it claims
+            // and one too long for its notification to fit a history ack is failed
+            if (ActsAs(client, req.userName) && req.chat.size() <= kMAX_CHAT_SIZE &&
+                m_Rooms->Members(req.roomName, m_Targets)) {
+                LOG_DEBUG("'%s' - #%s: %s.", client.userName, req.roomName, req.chat);
 
-            std::map<std::string, std::set<std::string>>::iterator it = m_RoomMap.find(roomName);
-            if (it != m_RoomMap.end()) {
                 // respond with S2C_ChatInRoomAckMsg SUCCESS
-                AckChatInRoom(client, MessageStatus::kSUCCESS, roomName, userName);
+                AckChatInRoom(client, MessageStatus::kSUCCESS, req.roomName, client.userName);
 
                 // broadcast event with S2C_ChatInRoomNtfMsg
-                std::set<std::string>& usersInRoom = it->second;
-                BroadcastChatInRoom(usersInRoom, roomName, userName, chat);
+                BroadcastChatInRoom(m_Targets, req.roomName, client.userName, req.chat);
 
             } else {
                 // respond with S2C_ChatInRoomAckMsg FAILURE
-                AckChatInRoom(client, MessageStatus::kFAILURE, roomName, userName);
+                AckChatInRoom(client, MessageStatus::kFAILURE, req.roomName, req.userName);
             }
 
         } break;
 
+        // received C2S_RosterReqMsg
+        case MessageType::kROSTER_REQ: {
+            C2S_RosterReqView req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            // rosters are for logged in users only
+            if (!client.userName.empty() &&
+                m_Rooms->Roster(req.roomName, req.sinceVersion, req.cursor, m_Roster, m_Arena)) {
+                AckRoster(client, MessageStatus::kSUCCESS, req.roomName, m_Roster);
+            } else {
+                m_Roster.Clear();
+                AckRoster(client, MessageStatus::kFAILURE, req.roomName, m_Roster);
+            }
+        } break;
+
+        // received C2S_HistoryReqMsg
+        case MessageType::kHISTORY_REQ: {
+            C2S_HistoryReqView req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            // a room's chats are for its members only
+            uint32 oldestSeq, newestSeq;
+            if (!client.userName.empty() && m_Rooms->IsMember(req.roomName, client.userName) &&
+                m_History->Fetch(req.roomName, req.afterSeq, req.count, m_HistoryFrames, oldestSeq, newestSeq)) {
+                AckHistory(client, MessageStatus::kSUCCESS, req.roomName, oldestSeq, newestSeq);
+            } else {
+                AckHistory(client, MessageStatus::kFAILURE, req.roomName, 0, 0);
+            }
+        } break;
+
+        // received C2S_PingMsg, answered with the same sequence
+        case MessageType::kPING: {
+            C2S_PingMsg req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            AckPing(client, req.sequence);
+        } break;
+
+        // received C2S_PongMsg, the answer to a heartbeat
+        // that the client was heard from at all is what counts, ReadFromClient noted it
+        case MessageType::kPONG: {
+            C2S_PongMsg ack;
+            if (!Decode(body, bodySize, ack)) return false;
+        } break;
+
+        // received C2S_BatchReqMsg
+        case MessageType::kBATCH_REQ: {
+            C2S_BatchReqView req;
+            if (!Decode(body, bodySize, req)) return false;
+
+            // each packet is handled as if it had arrived on its own, a batch inside a batch is malformed
+            for (std::string_view packet : req.packets) {
+                if (!client.connected) break;
+                if (packet.size() < sizeof(PacketHeader) || LoadUInt32LE(packet.data()) != packet.size()) return false;
+
+                MessageType innerType = static_cast<MessageType>(LoadUInt32LE(packet.data() + sizeof(uint32)));
+                if (innerType == MessageType::kBATCH_REQ) return false;
+                // what follows a login waits for its verdict, which a batch cannot, so a login in one is failed
+                if (innerType == MessageType::kLOGIN_REQ) {
+                    LOG_WARN("a login inside a batch is turned down.");
+                    AckLogin(client, MessageStatus::kFAILURE, {});
+                    continue;
+                }
+                const char* innerBody = packet.data() + sizeof(PacketHeader);
+                uint32 innerSize = static_cast<uint32>(packet.size() - sizeof(PacketHeader));
+                // a batch cannot wait for a token either, a chat over the limit is failed
+                if (innerType == MessageType::kCHAT_IN_ROOM_REQ && !AdmitChat(client, innerBody, innerSize, false)) {
+                    continue;
+                }
+                if (!HandleMessage(innerType, innerBody, innerSize, client)) {
+                    return false;
+                }
+            }
+        } break;
+
         default:
-            printf("unknown message.\n");
+            LOG_WARN("unknown message.");
             break;
     }
+    return true;
 }
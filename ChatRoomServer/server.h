@@ -1,20 +1,159 @@
 #pragma once
 
-#define WIN32_LEAN_AND_MEAN
-#include <WinSock2.h>
-
-#include <map>
-#include <set>
+#include <chrono>
+#include <memory>
+#include <random>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "arena.h"
+#include "auth_pool.h"
+#include "block_pool.h"
 #include "buffer.h"
+#include "chat_history.h"
+#include "chat_log.h"
+#include "compression.h"
+#include "frame.h"
 #include "message.h"
+#include "metrics.h"
+#include "metrics_endpoint.h"
+#include "mpsc_queue.h"
+#include "outbound_queue.h"
+#include "poller.h"
+#include "rate_limiter.h"
+#include "ring_buffer.h"
+#include "room_directory.h"
+#include "slot_table.h"
+#include "socket.h"
+#include "timing_wheel.h"
+#include "waker.h"
+
+class ReactorGroup;
+
+// What to do with a client that reads slower than the server writes to it
+enum SlowConsumerPolicy {
+    kSLOW_CONSUMER_DROP,        // drop broadcasts to it until its queue drains below the low watermark
+    kSLOW_CONSUMER_DISCONNECT,  // disconnect it as soon as its queue goes over the high watermark
+};
+
+// What to do with a chat over its rate limit
+enum RateLimitPolicy {
+    kRATE_LIMIT_DEFER,   // stop reading the client until the chat's token comes, TCP pushes back on it
+    kRATE_LIMIT_REJECT,  // fail the chat with a S2C_ChatInRoomAck without handling it
+};
+
+// How connections are spread over the reactors
+enum AcceptMode {
+    kACCEPT_REUSEPORT,  // every reactor listens on the port with SO_REUSEPORT, the kernel balances (Linux only)
+    kACCEPT_DISPATCH,   // reactor 0 accepts everything and hands the sockets out round-robin
+};
+
+// the best accept mode available on this platform
+AcceptMode DefaultAcceptMode();
+
+// Server tunables
+struct ServerConfig {
+    PollerType pollerType = DefaultPollerType();
+
+    // number of event-loop threads, each owning a share of the connections
+    uint32 reactorThreads = 1;
+    AcceptMode acceptMode = DefaultAcceptMode();
+
+    // outbound backpressure, per client
+    // over the high watermark a client is a slow consumer: it is handled according to the policy,
+    // and its requests are not read until its queue drains below the low watermark
+    uint64 sendHighWatermark = 256 * 1024;
+    uint64 sendLowWatermark = 64 * 1024;
+    // hard cap whatever the policy, acks still queue while broadcasts are dropped
+    uint64 sendHardLimit = 4 * 1024 * 1024;
+    SlowConsumerPolicy slowConsumerPolicy = SlowConsumerPolicy::kSLOW_CONSUMER_DROP;
+    // under the drop policy, a client that misses more than this many broadcasts before it drains below the
+    // low watermark is disconnected after all, 0 lets it miss any number
+    uint32 slowConsumerDropBudget = 4096;
+
+    // chats are rate limited before they are decoded: a client may send clientChatLimit.rate a second, in bursts
+    // of up to clientChatLimit.burst, and a room takes roomChatLimit from all its members together, 0 rates are
+    // no limit; a chat over a limit waits unread for its token or is failed, by the policy, and one in a batch,
+    // which cannot wait, is failed either way
+    RateLimit clientChatLimit{20, 40};
+    RateLimit roomChatLimit;
+    RateLimitPolicy rateLimitPolicy = RateLimitPolicy::kRATE_LIMIT_DEFER;
+
+    // write coalescing: broadcasts are queued without writing, and each client's queue goes out in one gather write
+    // at the end of the event loop iteration (a 0 window) or once the oldest one has waited flushWindow
+    // acks are still written right away, taking whatever broadcasts are queued ahead of them along
+    // Nagle is turned off for the clients, the server does the batching itself
+    bool coalesceWrites = false;
+    std::chrono::microseconds flushWindow{0};
+
+    // packets of at least compressThreshold bytes are compressed for the clients that ask for it at login
+    bool compression = true;
+    uint32 compressThreshold = 256;
+
+    // chats are appended to a per-room log, and the last chatLogConfig.recentRecords of a room
+    // are sent to whoever joins it
+    bool chatLog = true;
+    ChatLogConfig chatLogConfig;
+
+    // chats per room kept in memory for C2S_HistoryReq
+    uint32 historyCapacity = 256;
+
+    // metrics are always recorded, and served as plain text on 127.0.0.1:metricsPort unless it is 0
+    uint16 metricsPort = 0;
+
+    // heartbeats: a client the server has heard nothing from for heartbeatInterval is sent a PING,
+    // and disconnected if it still sends nothing for heartbeatTimeout, a 0 interval turns them off
+    std::chrono::seconds heartbeatInterval{30};
+    std::chrono::seconds heartbeatTimeout{10};
+
+    // logins are checked against the credentials on authThreads workers, off the event loops,
+    // at most authQueue of them wait and the ones over that are turned away; off, any password is taken
+    bool authentication = true;
+    CredentialConfig credentials;
+    uint32 authThreads = 2;
+    uint32 authQueue = 256;
+
+    // a logged in client is given a token, and if its connection goes, its user is kept in its rooms for
+    // resumeGrace, so that reconnecting with the token puts it back without its members seeing it leave and join;
+    // after that it leaves them as on any disconnect, a 0 grace turns resuming off
+    std::chrono::seconds resumeGrace{30};
+};
+
+// chatLogConfig, with enough records kept at hand to seed the history as well as to backfill
+ChatLogConfig HistoryLogConfig(const ServerConfig& config);
 
 // Client socket info
 struct ClientInfo {
     SOCKET socket;
     bool connected;
+    uint64 handle;                // in m_Conn.clients, also the poller token
+    network::RingBuffer recvBuf;  // bytes received but not yet handled, keeps partial packets between reads
+    OutboundQueue sendQueue;      // frames not yet written to the socket
+    bool sendInFlight;            // the poller is writing the head of sendQueue, which stays queued until it is done
+    uint32 pollFlags;             // what the poller currently watches the socket for
+    bool sendBlocked;             // over the high watermark, reading is paused
+    uint32 framesDropped;         // broadcasts it missed since it went over the high watermark
+    bool flushPending;            // in m_PendingFlush, waiting for the coalesced flush
+    uint32 features;              // network::Feature flags granted at login
+    std::string userName;         // logged in as, empty until then
+    // a login waiting for its password to be checked, the client's later requests are not read until then
+    bool authPending;
+    std::string authName;
+    std::chrono::steady_clock::time_point authStarted;
+    // heartbeats, the client's timer in m_Timers goes off when it has to be pinged or dropped
+    std::chrono::steady_clock::time_point lastReceive;
+    std::chrono::steady_clock::time_point pingSent;  // the last PING went unanswered if lastReceive is older
+    // chats it may send; while throttled, its next chat waits unread in recvBuf for a token,
+    // and its timer in m_ThrottleTimers goes off when the token comes
+    RateLimiter chatLimiter;
+    bool throttled;
+};
+
+// A departed client's session, kept in its rooms until it is resumed or its grace runs out
+struct SuspendedSession {
+    std::string userName;
+    ClientLocation location;  // where m_Rooms keeps it, no reactor's
 };
 
 // All connection related info
@@ -22,54 +161,219 @@ struct ConnectionInfo {
     struct addrinfo* info = nullptr;
     struct addrinfo hints;
     SOCKET listenSocket = INVALID_SOCKET;
-    fd_set activeSockets;
-    fd_set socketsReadyForReading;
-    std::vector<ClientInfo> clients;
+    std::unique_ptr<Poller> poller;      // readiness backend, watches the listen socket and all the clients
+    bool completions = false;            // the poller does the accepts, receives and sends, see Poller::DoesIo()
+    std::vector<PollEvent> readyEvents;  // output of the last poller->Wait()
+    // the clients by handle, a disconnected one keeps its slot until the end of the loop iteration
+    SlotTable<ClientInfo> clients;
+};
+
+// Receive path throughput, reported periodically by RunLoop
+struct DrainStats {
+    uint64 recvCalls = 0;
+    uint64 bytes = 0;
+    uint64 packets = 0;
+    uint64 drainNanoseconds = 0;  // time spent in recv and packet handling
+    uint64 allocations = 0;       // heap allocations made handling the packets, responses and broadcasts included
+};
+
+// Send path activity, reported periodically by RunLoop
+struct SendStats {
+    uint64 sendCalls = 0;
+    uint64 bytes = 0;
+    uint64 frames = 0;           // frames queued, frames / sendCalls is what coalescing buys
+    uint64 framesDropped = 0;    // broadcasts dropped for slow consumers
+    uint64 slowConsumers = 0;    // clients that went over the high watermark
+    uint64 slowDisconnects = 0;  // clients disconnected by the policy or the hard limit
+};
+
+// Work handed to a reactor by another thread
+struct MailboxItem {
+    enum Kind {
+        kDELIVER,        // send frame to each of the reactor's clients in targets
+        kADOPT,          // take over socket, accepted by the dispatching reactor
+        kAUTHENTICATED,  // verdict is in on the login of the client with handle client
+        kSUPERSEDED,     // the session of the client with handle client was resumed on another connection
+    };
+
+    Kind kind = Kind::kDELIVER;
+    network::FramePtr frame;
+    std::vector<uint64, network::PoolAllocator<uint64>> targets;  // client handles
+    SOCKET socket = INVALID_SOCKET;
+    uint64 client = 0;
+    AuthVerdict verdict = AuthVerdict::kAUTH_REJECTED;
 };
 
 // the ChatRoom server
+//
+// One instance is one reactor: an event loop owning a poller and a set of
+// connections. A standalone server has its own rooms, while the reactors of a
+// ReactorGroup share the group's RoomDirectory and reach each other's
+// connections through their mailboxes.
 class ChatRoomServer {
 public:
-    explicit ChatRoomServer(uint16 port);
+    explicit ChatRoomServer(uint16 port, const ServerConfig& config = ServerConfig{}, ReactorGroup* group = nullptr,
+                            uint32 reactorIndex = 0);
     ~ChatRoomServer();
 
     int RunLoop();
 
+    // thread-safe, hand work to this reactor
+    void Post(MailboxItem&& item);
+    // thread-safe, the verdict on a login submitted to the AuthPool
+    void PostVerdict(uint64 client, AuthVerdict verdict);
+
     // Responses
-    int AckLogin(ClientInfo& client, network::MessageStatus status, const std::vector<std::string>& roomNames);
-    int AckJoinRoom(ClientInfo& client, network::MessageStatus status, const std::string& roomName,
-                    std::vector<std::string>& userNames);
-    int BroadcastJoinRoom(const std::set<std::string>& usersInRoom, const std::string& roomName,
-                          const std::string& userName);
-    int AckLeaveRoom(ClientInfo& client, network::MessageStatus status, const std::string& roomName,
-                     const std::string& userName);
-    int BroadcastLeaveRoom(const std::set<std::string>& usersInRoom, const std::string& roomName,
-                           const std::string& userName);
-    int AckChatInRoom(ClientInfo& client, network::MessageStatus status, const std::string& roomName,
-                      const std::string& userName);
-    int BroadcastChatInRoom(const std::set<std::string>& usersInRoom, const std::string& roomName,
-                            const std::string& userName, const std::string& chat);
+    int AckLogin(ClientInfo& client, network::MessageStatus status, const std::vector<std::string>& roomNames,
+                 std::string_view resumeToken = {});
+    int AckResume(ClientInfo& client, network::MessageStatus status, std::vector<std::string_view>& roomNames,
+                  std::string_view resumeToken = {});
+    int AckJoinRoom(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                    RosterPage& roster);
+    int BroadcastJoinRoom(const std::vector<ClientLocation>& targets, std::string_view roomName,
+                          std::string_view userName, uint32 rosterVersion);
+    int AckLeaveRoom(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                     std::string_view userName);
+    int BroadcastLeaveRoom(const std::vector<ClientLocation>& targets, std::string_view roomName,
+                           std::string_view userName, uint32 rosterVersion);
+    int AckChatInRoom(ClientInfo& client, network::MessageStatus status, std::string_view roomName,
+                      std::string_view userName);
+    int BroadcastChatInRoom(const std::vector<ClientLocation>& targets, std::string_view roomName,
+                            std::string_view userName, std::string_view chat);
+    int AckRoster(ClientInfo& client, network::MessageStatus status, std::string_view roomName, RosterPage& roster);
+    int SendBackfill(ClientInfo& client, std::string_view roomName);
+    int AckHistory(ClientInfo& client, network::MessageStatus status, std::string_view roomName, uint32 oldestSeq,
+                   uint32 newestSeq);
+    int SendPing(ClientInfo& client);
+    int AckPing(ClientInfo& client, uint32 sequence);
 
 private:
-    int Initialize(uint16 port);
-    int SendResponse(ClientInfo& client, network::Message* msg);
-    void HandleMessage(network::MessageType msgType, ClientInfo& client);
+    int Initialize(uint16 port, PollerType pollerType);
+    int CreateListenSocket(uint16 port);
+    void AcceptClients();
+    void DispatchClient(SOCKET clientSocket);
+    void AdoptClient(SOCKET clientSocket);
+    void Broadcast(const std::vector<ClientLocation>& targets, const network::FramePtr& frame);
+    void DrainMailbox();
+    void ReadFromClient(uint64 handle);
+    void ReceiveFromClient(uint64 handle, const char* data, int result);
+    bool HandlePackets(ClientInfo& client);
+    void ReportStats();
+    void DisconnectClient(ClientInfo& client);
+    void ReleaseDeparted();
+    bool SuspendSession(const std::string& userName, const ClientLocation& location);
+    bool PurgeSession(const std::string& userName, const ClientLocation& location);
+    void Resume(ClientInfo& client, std::string_view userName, std::string_view token);
+    void Supersede(const ClientLocation& location);
+    void DropSuperseded(uint64 handle);
+    std::string NewResumeToken();
+    void Authenticate(ClientInfo& client, std::string_view userName, std::string_view password);
+    void CompleteLogin(ClientInfo& client, AuthVerdict verdict);
+    static bool ActsAs(const ClientInfo& client, std::string_view userName);
+    bool AdmitChat(ClientInfo& client, const char* body, uint32 bodySize, bool deferrable);
+    int SendResponse(ClientInfo& client, const network::FramePtr& frame, bool droppable = false);
+    int SendResponses(ClientInfo& client, const network::FramePtr* frames, size_t count, bool droppable = false);
+    const network::FramePtr& CompressFor(const ClientInfo& client, const network::FramePtr& frame);
+    bool FlushClient(uint64 handle);
+    void SubmitSend(ClientInfo& client);
+    void CompleteSend(uint64 handle, int result);
+    void DeferFlush(ClientInfo& client);
+    void FlushCoalesced();
+    int PollTimeoutMs(int idleTimeoutMs) const;
+    void ExpireTimers();
+    void UpdateInterest(ClientInfo& client);
+    bool HandleMessage(network::MessageType msgType, const char* body, uint32 bodySize, ClientInfo& client);
+    bool DispatchMessage(network::MessageType msgType, const char* body, uint32 bodySize, ClientInfo& client);
+    void SampleQueues();
     void Shutdown();
 
 private:
+    ServerConfig m_Config;
+
+    // reactor group, nullptr for a standalone server
+    ReactorGroup* m_Group;
+    uint32 m_ReactorIndex;
+    uint32 m_NextReactor = 0;  // round-robin target when dispatching accepted sockets
+
     // low-level network stuff
     ConnectionInfo m_Conn;
 
-    // send/recv buffer
-    static constexpr int kRECV_BUF_SIZE = 512;
-    char m_RawRecvBuf[kRECV_BUF_SIZE];
-    network::Buffer m_RecvBuf{kRECV_BUF_SIZE};
+    // cross-thread work, m_Waker gets the poller out of Wait() when something is posted
+    MpscQueue<MailboxItem> m_Mailbox;
+    Waker m_Waker;
+    std::vector<std::vector<uint64>> m_RemoteTargets;  // Broadcast() scratch, per reactor
+
+    // poller tokens of the listen socket and the waker, client sockets use their handle
+    static constexpr uint64 kLISTEN_TOKEN = ~0ull;
+    static constexpr uint64 kWAKE_TOKEN = ~0ull - 1;
+
+    // Server cache, shared by the reactors of a group
+    std::unique_ptr<RoomDirectory> m_OwnedRooms;  // standalone server only
+    RoomDirectory* m_Rooms;
+    std::vector<ClientLocation> m_Targets;        // who to notify, filled by m_Rooms
+    RosterPage m_Roster;                          // roster page or delta for a join or roster ack, filled by m_Rooms
+    std::vector<std::string_view> m_NameScratch;  // the room names of a login ack
+
+    // password checks, shared by the reactors of a group like the rooms, nullptr if authentication is off
+    std::unique_ptr<AuthPool> m_OwnedAuth;  // standalone server only
+    AuthPool* m_Auth = nullptr;
+
+    // the chat rate limits of the rooms, shared by the reactors of a group like the rooms
+    std::unique_ptr<RoomRateLimits> m_OwnedRoomLimits;  // standalone server only
+    RoomRateLimits* m_RoomLimits;
+
+    // the temporaries of handling one packet, reset after each
+    Arena m_Arena;
+
+    // chat log, shared by the reactors of a group like the rooms, nullptr if it is off
+    std::unique_ptr<ChatLog> m_OwnedLog;  // standalone server only
+    ChatLog* m_Log = nullptr;
+    std::vector<network::FramePtr> m_Backfill;  // a room's recent chats for a joining member, filled by m_Log
+
+    // recent chats in memory, shared by the reactors of a group like the rooms
+    std::unique_ptr<ChatHistory> m_OwnedHistory;  // standalone server only
+    ChatHistory* m_History;
+    std::vector<network::FramePtr> m_HistoryFrames;  // for a history ack, filled by m_History
+    std::vector<std::string_view> m_HistoryPackets;  // the bytes of m_HistoryFrames
+
+    // write coalescing, the clients with broadcasts queued but not written yet
+    std::vector<uint64> m_PendingFlush;
+    std::vector<uint64> m_FlushScratch;
+    std::chrono::steady_clock::time_point m_FlushDeadline;  // when the oldest pending broadcast must go out
+
+    // clients disconnected this loop iteration, to be taken out of their rooms and released
+    std::vector<uint64> m_Departed;
+
+    // heartbeat timers, by client slot
+    static constexpr std::chrono::milliseconds kTIMER_TICK{100};
+    TimingWheel m_Timers{kTIMER_TICK, std::chrono::steady_clock::now()};
+    std::vector<uint32> m_Expired;  // ExpireTimers() scratch
+    uint32 m_PingSequence = 0;
+
+    // the sessions of departed clients waiting to be resumed, and their grace timers, by slot
+    SlotTable<SuspendedSession> m_Suspended;
+    TimingWheel m_GraceTimers{kTIMER_TICK, std::chrono::steady_clock::now()};
+    static constexpr size_t kRESUME_TOKEN_SIZE = 16;
+    std::random_device m_Random;  // for the resume tokens
+
+    // the throttled clients' timers, by client slot, each goes off when the client's next chat may be handled
+    TimingWheel m_ThrottleTimers{kTIMER_TICK, std::chrono::steady_clock::now()};
+
+    // compression, the last frame compressed is kept so that a broadcast is compressed once for all its targets
+    std::unique_ptr<network::PacketCompressor> m_Compressor;
+    network::FramePtr m_LastFrame;
+    network::FramePtr m_LastCompressed;  // nullptr if m_LastFrame goes out as it is
 
-    static constexpr int kSEND_BUF_SIZE = 512;
-    network::Buffer m_SendBuf{kSEND_BUF_SIZE};
+    // metrics, the registry is shared by the reactors of a group like the rooms
+    std::unique_ptr<MetricsRegistry> m_OwnedMetrics;   // standalone server only
+    std::unique_ptr<MetricsEndpoint> m_OwnedEndpoint;  // standalone server only, nullptr if not served
+    ReactorMetrics* m_Metrics;                         // this reactor's, in the registry
+    static constexpr std::chrono::seconds kMETRICS_INTERVAL{1};
+    std::chrono::steady_clock::time_point m_LastQueueSample = std::chrono::steady_clock::now();
 
-    // Server cache
-    std::map<std::string, size_t> m_ClientMap;  // userName (string) -> ClientInfo index in m_Conn.clients
-    std::map<std::string, std::set<std::string>> m_RoomMap;  // roomName (string) -> userNames (set of string)
-    std::vector<std::string> m_RoomNames;                    // all the keys of m_RoomMap
+    // stats
+    static constexpr std::chrono::seconds kSTATS_INTERVAL{10};
+    DrainStats m_DrainStats;
+    SendStats m_SendStats;
+    std::chrono::steady_clock::time_point m_LastStatsReport = std::chrono::steady_clock::now();
 };
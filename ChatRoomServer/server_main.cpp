@@ -1,12 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "reactor_group.h"
 #include "server.h"
 
+#ifdef _WIN32
 // Need to link Ws2_32.lib
 #pragma comment(lib, "Ws2_32.lib")
+#endif
 
 #define DEFAULT_PORT 5555
 
+// usage: ChatRoomServer [--poller select|epoll|io_uring] [--threads n] [--accept reuseport|dispatch]
+//                       [--send-high-watermark bytes] [--send-low-watermark bytes] [--send-hard-limit bytes]
+//                       [--slow-consumer drop|disconnect] [--slow-consumer-budget broadcasts] [--flush-window us]
+//                       [--chat-rate chats/s] [--chat-burst chats] [--room-chat-rate chats/s] [--room-chat-burst chats]
+//                       [--rate-limit defer|reject]
+//                       [--compression on|off] [--compress-threshold bytes]
+//                       [--chat-log on|off] [--log-dir dir] [--log-sync none|group|always] [--log-sync-interval ms]
+//                       [--log-segment-size bytes] [--log-segments n] [--backfill n] [--history n]
+//                       [--metrics-port port] [--log-level debug|info|warn|error|off]
+//                       [--heartbeat-interval s] [--heartbeat-timeout s] [--resume-grace s]
+//                       [--auth on|off] [--credentials file] [--auth-threads n] [--auth-queue n] [--auth-cost log2n]
+// --flush-window turns write coalescing on, 0 flushes at the end of every event loop iteration
+// --chat-rate and --room-chat-rate 0 do not limit chats, the bursts should cover a 100 ms timer tick
+// --metrics-port serves GET /metrics on 127.0.0.1
+// --log-level debug logs every packet, the default is info
+// --heartbeat-interval 0 never pings idle clients nor disconnects them
+// --resume-grace 0 takes a disconnected user out of its rooms at once, and gives out no resume tokens
+// --auth off takes any password, --credentials "" keeps the passwords in memory only
+// --auth-cost is scrypt's log2 N for the passwords registered from now on, a hash takes 128 * 8 * 2^log2n bytes
 int main(int argc, char** argv) {
-    ChatRoomServer server{DEFAULT_PORT};
+    ServerConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            printf("missing value for '%s'\n", arg);
+            return 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--poller") == 0) {
+            if (!ParsePollerType(value, config.pollerType)) {
+                printf("unsupported poller '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--threads") == 0) {
+            config.reactorThreads = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--accept") == 0) {
+            if (strcmp(value, "dispatch") == 0) {
+                config.acceptMode = AcceptMode::kACCEPT_DISPATCH;
+#ifdef SO_REUSEPORT
+            } else if (strcmp(value, "reuseport") == 0) {
+                config.acceptMode = AcceptMode::kACCEPT_REUSEPORT;
+#endif
+            } else {
+                printf("unsupported accept mode '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--send-high-watermark") == 0) {
+            config.sendHighWatermark = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--send-low-watermark") == 0) {
+            config.sendLowWatermark = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--send-hard-limit") == 0) {
+            config.sendHardLimit = strtoull(value, nullptr, 10);
+        } else if (strcmp(arg, "--slow-consumer") == 0) {
+            if (strcmp(value, "drop") == 0) {
+                config.slowConsumerPolicy = SlowConsumerPolicy::kSLOW_CONSUMER_DROP;
+            } else if (strcmp(value, "disconnect") == 0) {
+                config.slowConsumerPolicy = SlowConsumerPolicy::kSLOW_CONSUMER_DISCONNECT;
+            } else {
+                printf("unknown slow consumer policy '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--slow-consumer-budget") == 0) {
+            config.slowConsumerDropBudget = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--chat-rate") == 0) {
+            config.clientChatLimit.rate = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--chat-burst") == 0) {
+            config.clientChatLimit.burst = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--room-chat-rate") == 0) {
+            config.roomChatLimit.rate = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--room-chat-burst") == 0) {
+            config.roomChatLimit.burst = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--rate-limit") == 0) {
+            if (strcmp(value, "defer") == 0) {
+                config.rateLimitPolicy = RateLimitPolicy::kRATE_LIMIT_DEFER;
+            } else if (strcmp(value, "reject") == 0) {
+                config.rateLimitPolicy = RateLimitPolicy::kRATE_LIMIT_REJECT;
+            } else {
+                printf("unknown rate limit policy '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--flush-window") == 0) {
+            config.coalesceWrites = true;
+            config.flushWindow = std::chrono::microseconds{strtoull(value, nullptr, 10)};
+        } else if (strcmp(arg, "--compression") == 0) {
+            if (strcmp(value, "on") == 0) {
+                config.compression = true;
+            } else if (strcmp(value, "off") == 0) {
+                config.compression = false;
+            } else {
+                printf("--compression is on or off, not '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--compress-threshold") == 0) {
+            config.compressThreshold = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--chat-log") == 0) {
+            if (strcmp(value, "on") == 0) {
+                config.chatLog = true;
+            } else if (strcmp(value, "off") == 0) {
+                config.chatLog = false;
+            } else {
+                printf("--chat-log is on or off, not '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--log-dir") == 0) {
+            config.chatLogConfig.directory = value;
+        } else if (strcmp(arg, "--log-sync") == 0) {
+            if (strcmp(value, "none") == 0) {
+                config.chatLogConfig.syncPolicy = LogSyncPolicy::kLOG_SYNC_NONE;
+            } else if (strcmp(value, "group") == 0) {
+                config.chatLogConfig.syncPolicy = LogSyncPolicy::kLOG_SYNC_GROUP;
+            } else if (strcmp(value, "always") == 0) {
+                config.chatLogConfig.syncPolicy = LogSyncPolicy::kLOG_SYNC_ALWAYS;
+            } else {
+                printf("unknown log sync policy '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--log-sync-interval") == 0) {
+            config.chatLogConfig.syncInterval = std::chrono::milliseconds{strtoull(value, nullptr, 10)};
+        } else if (strcmp(arg, "--log-segment-size") == 0) {
+            config.chatLogConfig.segmentSize = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--log-segments") == 0) {
+            config.chatLogConfig.maxSegments = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--backfill") == 0) {
+            config.chatLogConfig.recentRecords = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--history") == 0) {
+            config.historyCapacity = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--metrics-port") == 0) {
+            config.metricsPort = static_cast<uint16>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--heartbeat-interval") == 0) {
+            config.heartbeatInterval = std::chrono::seconds{strtoull(value, nullptr, 10)};
+        } else if (strcmp(arg, "--heartbeat-timeout") == 0) {
+            config.heartbeatTimeout = std::chrono::seconds{strtoull(value, nullptr, 10)};
+        } else if (strcmp(arg, "--resume-grace") == 0) {
+            config.resumeGrace = std::chrono::seconds{strtoull(value, nullptr, 10)};
+        } else if (strcmp(arg, "--auth") == 0) {
+            if (strcmp(value, "on") == 0) {
+                config.authentication = true;
+            } else if (strcmp(value, "off") == 0) {
+                config.authentication = false;
+            } else {
+                printf("--auth is on or off, not '%s'\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--credentials") == 0) {
+            config.credentials.path = value;
+        } else if (strcmp(arg, "--auth-threads") == 0) {
+            config.authThreads = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--auth-queue") == 0) {
+            config.authQueue = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--auth-cost") == 0) {
+            config.credentials.params.logN = static_cast<uint32>(strtoul(value, nullptr, 10));
+        } else if (strcmp(arg, "--log-level") == 0) {
+            LogLevel level;
+            if (!Logger::ParseLevel(value, level)) {
+                printf("unknown log level '%s'\n", value);
+                return 1;
+            }
+            Logger::Instance().SetLevel(level);
+        } else {
+            printf("unknown option '%s'\n", arg);
+            return 1;
+        }
+    }
+
+    if (config.sendLowWatermark > config.sendHighWatermark) {
+        printf("the send low watermark must not be above the high watermark\n");
+        return 1;
+    }
+
+    if (config.chatLogConfig.maxSegments == 0) {
+        printf("at least one log segment is kept per room\n");
+        return 1;
+    }
+
+    if (config.credentials.params.logN < 1 || config.credentials.params.logN > 24) {
+        printf("--auth-cost is between 1 and 24\n");
+        return 1;
+    }
+
+    if (config.reactorThreads > 1) {
+        ReactorGroup group{DEFAULT_PORT, config};
+        group.RunLoop();
+        return 0;
+    }
+
+    ChatRoomServer server{DEFAULT_PORT, config};
     server.RunLoop();
     return 0;
 }
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "common.h"
+
+// A slab of Ts addressed by generation-tagged handles.
+//
+// A released slot goes on a free list and is the next one handed out, so the
+// table only grows to the most Ts ever live at once. Every release bumps the
+// slot's generation, and a handle carries the generation it was handed out
+// with, so a handle kept past its T's release finds nothing rather than
+// whatever took the slot over. The live slots are also kept packed in a
+// vector of their own, iterating them skips nothing.
+//
+// A released T is left as it was, Acquire() hands it back for reuse as is, so
+// its buffers keep their capacity. The Ts move when the slab grows.
+template <typename T>
+class SlotTable {
+public:
+    static constexpr uint64 kNO_HANDLE = 0;  // generations start at 1, no handle is 0
+
+    static uint32 SlotOf(uint64 handle) { return static_cast<uint32>(handle); }
+
+    // a free slot, its T as the last holder left it
+    uint64 Acquire() {
+        uint32 slot;
+        if (!m_Free.empty()) {
+            slot = m_Free.back();
+            m_Free.pop_back();
+        } else {
+            slot = static_cast<uint32>(m_Entries.size());
+            m_Entries.emplace_back();
+        }
+        Entry& entry = m_Entries[slot];
+        entry.live = m_Live.size();
+        m_Live.push_back(slot);
+        return Handle(slot);
+    }
+
+    // the slot goes back on the free list, handles to it go stale
+    void Release(uint64 handle) {
+        if (Find(handle) == nullptr) return;
+
+        uint32 slot = SlotOf(handle);
+        Entry& entry = m_Entries[slot];
+        // the last live slot takes the released one's place
+        uint32 moved = m_Live.back();
+        m_Live[entry.live] = moved;
+        m_Entries[moved].live = entry.live;
+        m_Live.pop_back();
+
+        entry.live = kNOT_LIVE;
+        entry.generation = entry.generation + 1 == 0 ? 1 : entry.generation + 1;
+        m_Free.push_back(slot);
+    }
+
+    // nullptr if the handle is stale
+    T* Find(uint64 handle) {
+        uint32 slot = SlotOf(handle);
+        if (slot >= m_Entries.size()) return nullptr;
+        Entry& entry = m_Entries[slot];
+        if (entry.live == kNOT_LIVE || entry.generation != static_cast<uint32>(handle >> 32)) return nullptr;
+        return &entry.value;
+    }
+
+    // the live slots, in no particular order, released ones leave it at once
+    const std::vector<uint32>& LiveSlots() const { return m_Live; }
+    T& At(uint32 slot) { return m_Entries[slot].value; }
+    const T& At(uint32 slot) const { return m_Entries[slot].value; }
+    uint64 Handle(uint32 slot) const { return static_cast<uint64>(m_Entries[slot].generation) << 32 | slot; }
+
+    size_t Size() const { return m_Live.size(); }
+
+private:
+    static constexpr size_t kNOT_LIVE = ~static_cast<size_t>(0);
+
+    struct Entry {
+        T value;
+        uint32 generation = 1;
+        size_t live = kNOT_LIVE;  // index in m_Live
+    };
+
+private:
+    std::vector<Entry> m_Entries;
+    std::vector<uint32> m_Free;
+    std::vector<uint32> m_Live;
+};
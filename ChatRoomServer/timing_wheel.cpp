@@ -0,0 +1,133 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+namespace {
+constexpr uint64 kSLOT_MASK = TimingWheel::kSLOTS - 1;
+constexpr uint64 kMAX_DELTA = (1ull << (TimingWheel::kSLOT_BITS * TimingWheel::kLEVELS)) - 1;
+}  // namespace
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, Clock::time_point start)
+    : m_Tick(std::max<Clock::duration>(tick, std::chrono::milliseconds{1})),
+      m_Start(start),
+      m_Heads(kLEVELS * kSLOTS, kNONE) {}
+
+void TimingWheel::Schedule(uint32 id, Clock::time_point deadline) {
+    if (id >= m_Nodes.size()) {
+        m_Nodes.resize(static_cast<size_t>(id) + 1, Node{0, kNONE, kNONE, kNONE});
+    }
+    if (m_Nodes[id].slot != kNONE) {
+        Unlink(id);
+    } else {
+        m_Count++;
+    }
+
+    uint64 expiry = TickAfter(deadline);
+    // the tick the wheel is at has been expired already
+    m_Nodes[id].expiry = std::min(std::max(expiry, m_Now + 1), m_Now + kMAX_DELTA);
+    Link(id);
+}
+
+void TimingWheel::Cancel(uint32 id) {
+    if (!Scheduled(id)) return;
+
+    Unlink(id);
+    m_Count--;
+}
+
+void TimingWheel::Advance(Clock::time_point now, std::vector<uint32>& expired) {
+    uint64 target = TickAt(now);
+    while (m_Now < target) {
+        if (m_Count == 0) {
+            // nothing to cascade or expire on the way
+            m_Now = target;
+            break;
+        }
+        m_Now++;
+
+        // a level whose wheel below has come full circle pours its next slot down,
+        // the highest one first so that what it pours is poured on again
+        uint32 top = 0;
+        while (top + 1 < kLEVELS && (m_Now & ((1ull << ((top + 1) * kSLOT_BITS)) - 1)) == 0) {
+            top++;
+        }
+        for (uint32 level = top; level > 0; level--) {
+            Cascade(level);
+        }
+        Expire(expired);
+    }
+}
+
+TimingWheel::Clock::duration TimingWheel::UntilNextTick(Clock::time_point now) const {
+    Clock::time_point next = m_Start + m_Tick * static_cast<Clock::rep>(TickAt(now) + 1);
+    return next - now;
+}
+
+uint64 TimingWheel::TickAt(Clock::time_point t) const {
+    if (t <= m_Start) return 0;
+    return static_cast<uint64>((t - m_Start) / m_Tick);
+}
+
+uint64 TimingWheel::TickAfter(Clock::time_point t) const {
+    if (t <= m_Start) return 0;
+    return static_cast<uint64>((t - m_Start + m_Tick - Clock::duration{1}) / m_Tick);
+}
+
+// into the slot of its expiry, at the lowest level that reaches it
+void TimingWheel::Link(uint32 id) {
+    Node& node = m_Nodes[id];
+    uint64 delta = node.expiry - m_Now;
+    uint32 level = 0;
+    while (level + 1 < kLEVELS && delta >= (1ull << ((level + 1) * kSLOT_BITS))) {
+        level++;
+    }
+    uint32 slot = level * kSLOTS + static_cast<uint32>((node.expiry >> (level * kSLOT_BITS)) & kSLOT_MASK);
+
+    node.slot = slot;
+    node.prev = kNONE;
+    node.next = m_Heads[slot];
+    if (node.next != kNONE) {
+        m_Nodes[node.next].prev = id;
+    }
+    m_Heads[slot] = id;
+}
+
+void TimingWheel::Unlink(uint32 id) {
+    Node& node = m_Nodes[id];
+    if (node.prev != kNONE) {
+        m_Nodes[node.prev].next = node.next;
+    } else {
+        m_Heads[node.slot] = node.next;
+    }
+    if (node.next != kNONE) {
+        m_Nodes[node.next].prev = node.prev;
+    }
+    node.slot = kNONE;
+}
+
+// the timers of the level's current slot are due within its span, each goes down a level or more
+void TimingWheel::Cascade(uint32 level) {
+    uint32 slot = level * kSLOTS + static_cast<uint32>((m_Now >> (level * kSLOT_BITS)) & kSLOT_MASK);
+    uint32 id = m_Heads[slot];
+    m_Heads[slot] = kNONE;
+    while (id != kNONE) {
+        uint32 next = m_Nodes[id].next;
+        Link(id);
+        id = next;
+    }
+}
+
+// every timer in the current level 0 slot expires on this very tick
+void TimingWheel::Expire(std::vector<uint32>& expired) {
+    uint32 slot = static_cast<uint32>(m_Now & kSLOT_MASK);
+    uint32 id = m_Heads[slot];
+    m_Heads[slot] = kNONE;
+    while (id != kNONE) {
+        Node& node = m_Nodes[id];
+        uint32 next = node.next;
+        node.slot = kNONE;
+        m_Count--;
+        expired.push_back(id);
+        id = next;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "common.h"
+
+// Timers keyed by a dense id, e.g. the index of a connection, on a hierarchical timing wheel.
+//
+// Time moves in ticks of a fixed length. There are kLEVELS wheels of kSLOTS
+// slots, a slot of level n spanning kSLOTS^n ticks: a timer goes into the
+// lowest level that reaches its deadline, and moves down a level when the
+// wheel below comes round to it. A slot is an intrusive doubly linked list of
+// timers, so scheduling and cancelling are O(1), and advancing costs the slots
+// passed and the timers in them, however many timers are pending.
+class TimingWheel {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr uint32 kSLOT_BITS = 6;
+    static constexpr uint32 kSLOTS = 1 << kSLOT_BITS;
+    static constexpr uint32 kLEVELS = 4;  // 2^24 ticks ahead, deadlines further out are brought in to that
+
+    TimingWheel(std::chrono::milliseconds tick, Clock::time_point start);
+
+    // arm id's timer, or move it if it is armed already
+    // it fires on the first tick at or after deadline, never before
+    void Schedule(uint32 id, Clock::time_point deadline);
+    void Cancel(uint32 id);
+    bool Scheduled(uint32 id) const { return id < m_Nodes.size() && m_Nodes[id].slot != kNONE; }
+
+    // move the wheel up to now, the timers due by then are disarmed and their ids appended to expired
+    void Advance(Clock::time_point now, std::vector<uint32>& expired);
+
+    // time left until the wheel can next advance, for a poll timeout
+    Clock::duration UntilNextTick(Clock::time_point now) const;
+
+    // armed timers
+    uint32 Size() const { return m_Count; }
+
+private:
+    static constexpr uint32 kNONE = ~0u;
+
+    struct Node {
+        uint64 expiry;  // tick
+        uint32 prev;    // in the slot's list, kNONE at either end
+        uint32 next;
+        uint32 slot;  // index in m_Heads, kNONE while not armed
+    };
+
+    // the tick t falls in, rounded down or up
+    uint64 TickAt(Clock::time_point t) const;
+    uint64 TickAfter(Clock::time_point t) const;
+
+    void Link(uint32 id);
+    void Unlink(uint32 id);
+    void Cascade(uint32 level);
+    void Expire(std::vector<uint32>& expired);
+
+private:
+    Clock::duration m_Tick;
+    Clock::time_point m_Start;
+    uint64 m_Now = 0;  // the tick the wheel is at, counted from m_Start
+    uint32 m_Count = 0;
+    std::vector<uint32> m_Heads;  // the first timer of each slot, level by level
+    std::vector<Node> m_Nodes;    // by id
+};
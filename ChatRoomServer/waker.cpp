@@ -0,0 +1,71 @@
+#include "waker.h"
+
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+using namespace network;
+
+Waker::Waker() {
+#ifdef __linux__
+    m_Handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    // a loopback datagram socket talking to itself
+    SOCKET udpSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (udpSocket == INVALID_SOCKET) {
+        return;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addrLen = sizeof(addr);
+    if (bind(udpSocket, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        getsockname(udpSocket, (struct sockaddr*)&addr, &addrLen) == SOCKET_ERROR ||
+        connect(udpSocket, (struct sockaddr*)&addr, addrLen) == SOCKET_ERROR ||
+        SetNonBlocking(udpSocket) == SOCKET_ERROR) {
+        CloseSocket(udpSocket);
+        return;
+    }
+    m_Handle = udpSocket;
+#endif
+}
+
+Waker::~Waker() {
+    if (m_Handle != INVALID_SOCKET) {
+        CloseSocket(m_Handle);
+    }
+}
+
+void Waker::Wake() {
+    if (m_Pending.exchange(true, std::memory_order_acq_rel)) {
+        // already signaled and not drained yet
+        return;
+    }
+#ifdef __linux__
+    uint64 one = 1;
+    ssize_t written = write(m_Handle, &one, sizeof(one));
+    (void)written;
+#else
+    char one = 1;
+    send(m_Handle, &one, 1, 0);
+#endif
+}
+
+void Waker::Drain() {
+#ifdef __linux__
+    uint64 count;
+    ssize_t bytesRead = read(m_Handle, &count, sizeof(count));
+    (void)bytesRead;
+#else
+    char buf[64];
+    while (recv(m_Handle, buf, sizeof(buf), 0) > 0) {
+    }
+#endif
+    // cleared once the handle is drained, a Wake() from here on signals it again
+    m_Pending.store(false, std::memory_order_release);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+
+#include "socket.h"
+
+// Wakes a reactor blocked in its poller from another thread.
+// The handle is registered with the poller for kPOLL_READ. Wakes are
+// coalesced, only the first Wake() after a Drain() touches the kernel.
+class Waker {
+public:
+    Waker();
+    ~Waker();
+
+    Waker(const Waker&) = delete;
+    Waker& operator=(const Waker&) = delete;
+
+    bool IsValid() const { return m_Handle != INVALID_SOCKET; }
+    SOCKET Handle() const { return m_Handle; }
+
+    // any thread
+    void Wake();
+    // owning thread, call before handling whatever the wake was for
+    void Drain();
+
+private:
+    std::atomic<bool> m_Pending{false};
+    // an eventfd on Linux, elsewhere a UDP socket connected to itself
+    SOCKET m_Handle = INVALID_SOCKET;
+};
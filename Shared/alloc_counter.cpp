@@ -0,0 +1,32 @@
+#include <stdlib.h>
+
+#include <new>
+
+#include "alloc_counter.h"
+
+// Replaces the global operator new/delete to count heap allocations per thread.
+// The nothrow and array forms forward to these, so every allocation made
+// through new (containers included) is counted.
+
+namespace {
+thread_local uint64 t_Allocations = 0;
+}
+
+uint64 AllocationCount() { return t_Allocations; }
+
+void* operator new(size_t size) {
+    t_Allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc{};
+    return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete[](void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+void operator delete[](void* p, size_t) noexcept { free(p); }
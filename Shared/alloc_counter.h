@@ -0,0 +1,7 @@
+#pragma once
+
+#include "common.h"
+
+// heap allocations made by this thread so far, counted by the operator new in alloc_counter.cpp
+// linking alloc_counter.cpp replaces the global operator new/delete of the whole program
+uint64 AllocationCount();
@@ -0,0 +1,132 @@
+#include "block_pool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace network {
+namespace {
+constexpr size_t kCLASS_COUNT = 13;  // kMIN_BLOCK << 12 == kMAX_BLOCK
+
+// a shared list keeps as many blocks as this many thread caches, the rest are freed
+constexpr size_t kSHARED_CACHES = 4;
+
+size_t SizeClass(size_t size) {
+    size_t sizeClass = 0;
+    for (size_t block = BlockPool::kMIN_BLOCK; block < size; block <<= 1) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+size_t BlockSize(size_t sizeClass) { return BlockPool::kMIN_BLOCK << sizeClass; }
+
+// free blocks a thread keeps of one size, about 256 KiB worth but few enough that blocks
+// freed by another thread than the one taking them get back to it soon
+size_t CacheLimit(size_t sizeClass) {
+    return std::min<size_t>(128, std::max<size_t>(8, 256 * 1024 / BlockSize(sizeClass)));
+}
+
+struct SharedList {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+};
+
+// never destroyed: threads give their caches back as they exit, which may be after static destructors ran
+SharedList* SharedLists() {
+    static SharedList* lists = new SharedList[kCLASS_COUNT];
+    return lists;
+}
+
+// hand count blocks to the shared list, freeing those it has no room for
+void GiveBack(size_t sizeClass, void* const* blocks, size_t count) {
+    SharedList& shared = SharedLists()[sizeClass];
+    size_t limit = CacheLimit(sizeClass) * kSHARED_CACHES;
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (size_t i = 0; i < count; i++) {
+        if (shared.blocks.size() < limit) {
+            shared.blocks.push_back(blocks[i]);
+        } else {
+            ::operator delete(blocks[i]);
+        }
+    }
+}
+
+struct ThreadCache {
+    std::vector<void*> blocks[kCLASS_COUNT];
+    ~ThreadCache();
+};
+
+// set once the thread's cache is destroyed, what its last destructors free goes to the shared lists
+thread_local bool t_CacheGone = false;
+thread_local ThreadCache t_Cache;
+
+ThreadCache::~ThreadCache() {
+    t_CacheGone = true;
+    for (size_t sizeClass = 0; sizeClass < kCLASS_COUNT; sizeClass++) {
+        GiveBack(sizeClass, blocks[sizeClass].data(), blocks[sizeClass].size());
+    }
+}
+
+// an empty cache takes half its limit from the shared list, if it has them
+void Refill(size_t sizeClass, std::vector<void*>& cache) {
+    size_t limit = CacheLimit(sizeClass);
+    if (cache.capacity() < limit) {
+        cache.reserve(limit);
+    }
+
+    SharedList& shared = SharedLists()[sizeClass];
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    size_t take = std::min(shared.blocks.size(), limit / 2);
+    cache.insert(cache.end(), shared.blocks.end() - take, shared.blocks.end());
+    shared.blocks.resize(shared.blocks.size() - take);
+}
+}  // namespace
+
+void* BlockPool::Allocate(size_t size) {
+    if (size > kMAX_BLOCK) {
+        return ::operator new(size);
+    }
+
+    size_t sizeClass = SizeClass(size);
+    if (!t_CacheGone) {
+        std::vector<void*>& cache = t_Cache.blocks[sizeClass];
+        if (cache.empty()) {
+            Refill(sizeClass, cache);
+        }
+        if (!cache.empty()) {
+            void* block = cache.back();
+            cache.pop_back();
+            return block;
+        }
+    }
+    return ::operator new(BlockSize(sizeClass));
+}
+
+void BlockPool::Release(void* block, size_t size) {
+    if (block == nullptr) return;
+    if (size > kMAX_BLOCK) {
+        ::operator delete(block);
+        return;
+    }
+
+    size_t sizeClass = SizeClass(size);
+    if (t_CacheGone) {
+        GiveBack(sizeClass, &block, 1);
+        return;
+    }
+
+    // a full cache keeps the half it freed last, the likeliest to still be in the CPU cache
+    std::vector<void*>& cache = t_Cache.blocks[sizeClass];
+    size_t limit = CacheLimit(sizeClass);
+    if (cache.size() >= limit) {
+        size_t give = cache.size() - limit / 2;
+        GiveBack(sizeClass, cache.data(), give);
+        cache.erase(cache.begin(), cache.begin() + give);
+    } else if (cache.capacity() < limit) {
+        cache.reserve(limit);
+    }
+    cache.push_back(block);
+}
+}  // namespace network
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "common.h"
+
+namespace network {
+// Blocks for the short-lived objects the server makes and frees at a high
+// rate: frames, the nodes of its queues and mailboxes and the like.
+//
+// Sizes are rounded up to a power of two from kMIN_BLOCK to kMAX_BLOCK, larger
+// ones go straight to operator new. Each thread keeps a cache of free blocks
+// per size, so a warm thread neither locks nor allocates. A block may be freed
+// by another thread than the one that took it (a broadcast frame is released
+// by whichever reactor sends it last): a cache that grows past its limit hands
+// half of its blocks to a shared list, which the threads whose caches run dry
+// refill from.
+class BlockPool {
+public:
+    static constexpr size_t kMIN_BLOCK = 16;
+    static constexpr size_t kMAX_BLOCK = 64 * 1024;
+
+    static void* Allocate(size_t size);
+
+    // size is the one the block was allocated with
+    static void Release(void* block, size_t size);
+};
+
+// std allocator over the BlockPool, for the containers of the hot path
+template <typename T>
+struct PoolAllocator {
+    typedef T value_type;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(BlockPool::Allocate(count * sizeof(T))); }
+    void deallocate(T* p, size_t count) { BlockPool::Release(p, count * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return false;
+}
+}  // namespace network
@@ -112,8 +112,7 @@ const char* Buffer::ConstData() { return (const char*)m_Data.data(); }
 size_t Buffer::Size() const { return m_Data.size(); }
 
 void Buffer::Set(const char* rawBuf, uint32 len) {
-    m_Data.resize(len, 0);
-    std::fill(m_Data.begin(), m_Data.end(), 0);
+    // assign overwrites every byte, no need to clear first
     m_Data.assign(rawBuf, rawBuf + len);
     m_ReadIndex = 0;
     m_WriteIndex = len;
@@ -123,4 +122,12 @@ void Buffer::Reset() {
     std::fill(m_Data.begin(), m_Data.end(), 0);
     m_ReadIndex = m_WriteIndex = 0;
 }
+
+std::vector<uint8> Buffer::Detach() {
+    m_Data.resize(m_WriteIndex);
+    std::vector<uint8> data = std::move(m_Data);
+    m_Data.clear();
+    m_ReadIndex = m_WriteIndex = 0;
+    return data;
+}
 }  // namespace network
\ No newline at end of file
@@ -24,6 +24,8 @@ class Buffer {
     size_t Size() const;
     void Set(const char* rawBuf, uint32 len);
     void Reset();
+    // hand the written bytes over to the caller, the buffer is left empty
+    std::vector<uint8> Detach();
 
    private:
     void WriteUInt32LE(size_t index, uint32 value);
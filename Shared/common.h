@@ -1,8 +1,10 @@
 #pragma once
 
+typedef long long int64;
 typedef int int32;
 typedef short int16;
 typedef char int8;
+typedef unsigned long long uint64;
 typedef unsigned int uint32;
 typedef unsigned short uint16;
 typedef unsigned char uint8;
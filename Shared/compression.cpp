@@ -0,0 +1,69 @@
+#include "compression.h"
+
+#include <chrono>
+
+#include "lz4_block.h"
+
+namespace network {
+
+PacketCompressor::PacketCompressor(std::string dictionary, uint32 threshold)
+    : m_Dictionary(std::move(dictionary)), m_Threshold(threshold) {}
+
+FramePtr PacketCompressor::Compress(const Frame& frame, bool useDictionary) {
+    if (frame.Size() < m_Threshold || frame.Size() < sizeof(PacketHeader)) return nullptr;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::string_view packet{frame.Data(), frame.Size()};
+    std::string_view dictionary = useDictionary ? std::string_view{m_Dictionary} : std::string_view{};
+    m_Scratch.resize(Lz4CompressBound(frame.Size()));
+    uint32 compressedSize = Lz4Compress(packet, dictionary, m_Scratch.data());
+
+    S2C_CompressedView msg{static_cast<uint16>(useDictionary ? Codec::kCODEC_LZ4_DICT : Codec::kCODEC_LZ4),
+                           frame.Size(), std::string_view{m_Scratch.data(), compressedSize}};
+    FramePtr compressed;
+    if (PacketSize(msg) < frame.Size()) {
+        compressed = Frame::Encode(msg);
+    }
+
+    uint32 type = LoadUInt32LE(frame.Data() + sizeof(uint32));
+    if (type >= MessageType::kLOGIN_REQ) {
+        size_t index = type - MessageType::kLOGIN_REQ;
+        if (index >= m_Stats.size()) {
+            m_Stats.resize(index + 1);
+        }
+        CompressionStats& stats = m_Stats[index];
+        stats.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        if (compressed) {
+            stats.packets++;
+            stats.bytesIn += frame.Size();
+            stats.bytesOut += compressed->Size();
+        } else {
+            stats.incompressible++;
+        }
+    }
+    return compressed;
+}
+
+void PacketCompressor::ResetStats() { m_Stats.assign(m_Stats.size(), CompressionStats{}); }
+
+bool DecompressPacket(const S2C_CompressedView& msg, std::string_view dictionary, std::vector<char>& packet) {
+    if (msg.originalSize < sizeof(PacketHeader) || msg.originalSize > kMAX_PACKET_SIZE) return false;
+
+    switch (msg.codec) {
+        case Codec::kCODEC_LZ4:
+            dictionary = std::string_view{};
+            break;
+        case Codec::kCODEC_LZ4_DICT:
+            break;
+        default:
+            return false;
+    }
+
+    packet.resize(msg.originalSize);
+    if (!Lz4Decompress(msg.data, dictionary, packet.data(), msg.originalSize)) return false;
+    return LoadUInt32LE(packet.data()) == msg.originalSize;
+}
+}  // namespace network
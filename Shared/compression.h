@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "frame.h"
+#include "message.h"
+
+namespace network {
+// Negotiated packet compression
+//
+// A client that asks for kFEATURE_LZ4 at login may be sent any packet over the
+// server's threshold as a S2C_Compressed holding the whole packet compressed
+// in the LZ4 block format (lz4_block.h). Packets that would not shrink go out
+// as they are.
+//
+// Every packet after the login ack is compressed with a dictionary of the room
+// names as the login ack listed them, so both ends build the same one without
+// sending it. The login ack itself is compressed without it.
+
+// How the data of a S2C_Compressed is compressed
+enum Codec {
+    kCODEC_LZ4 = 1,
+    kCODEC_LZ4_DICT = 2,  // with the room name dictionary
+};
+
+// the room names laid out as they are on the wire (length, then name), which is what matches in rosters and chats
+template <typename Names>
+std::string BuildDictionary(const Names& roomNames) {
+    std::string dictionary;
+    for (std::string_view name : roomNames) {
+        char length[sizeof(uint32)];
+        WireWriter{reinterpret_cast<uint8*>(length)}.Write(static_cast<uint32>(name.size()));
+        dictionary.append(length, sizeof(length));
+        dictionary.append(name.data(), name.size());
+    }
+    return dictionary;
+}
+
+// What compression did for one message type
+struct CompressionStats {
+    uint64 packets = 0;         // compressed
+    uint64 incompressible = 0;  // over the threshold but sent as they were
+    uint64 bytesIn = 0;         // of the compressed packets, before
+    uint64 bytesOut = 0;        // and after
+    uint64 nanoseconds = 0;     // spent compressing, incompressible packets included
+};
+
+// Compresses server packets, one per reactor (it keeps scratch space and stats)
+class PacketCompressor {
+public:
+    PacketCompressor(std::string dictionary, uint32 threshold);
+
+    // the frame as a S2C_Compressed, or nullptr if it is under the threshold or does not shrink
+    FramePtr Compress(const Frame& frame, bool useDictionary);
+
+    // by MessageType, for the types that have been compressed or tried
+    const std::vector<CompressionStats>& Stats() const { return m_Stats; }
+    static MessageType StatsType(size_t index) { return static_cast<MessageType>(MessageType::kLOGIN_REQ + index); }
+    void ResetStats();
+
+private:
+    std::string m_Dictionary;
+    uint32 m_Threshold;
+    std::vector<char> m_Scratch;
+    std::vector<CompressionStats> m_Stats;
+};
+
+// decompress a S2C_Compressed into packet (header included)
+// returns false if it is corrupt, uses an unknown codec, or is not a packet of the size it claims
+bool DecompressPacket(const S2C_CompressedView& msg, std::string_view dictionary, std::vector<char>& packet);
+}  // namespace network
@@ -0,0 +1,19 @@
+#include "frame.h"
+
+namespace network {
+
+Frame::Frame(std::vector<uint8>&& data)
+    : m_Data(std::move(data)),
+      m_View(reinterpret_cast<const char*>(m_Data.data())),
+      m_Size(static_cast<uint32>(m_Data.size())) {}
+
+Frame::Frame(const char* data, uint32 size, std::shared_ptr<const void> owner)
+    : m_Owner(std::move(owner)), m_View(data), m_Size(size) {}
+
+Frame::Frame(uint32 size)
+    : m_Block(static_cast<uint8*>(BlockPool::Allocate(size))),
+      m_View(reinterpret_cast<const char*>(m_Block)),
+      m_Size(size) {}
+
+Frame::~Frame() { BlockPool::Release(m_Block, m_Size); }
+}  // namespace network
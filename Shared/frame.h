@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "block_pool.h"
+#include "common.h"
+#include "message.h"
+
+namespace network {
+class Frame;
+
+// Frames are shared by reference, e.g. by every recipient of a broadcast
+typedef std::shared_ptr<const Frame> FramePtr;
+
+// A fully encoded packet (header included), immutable once built.
+// A message that goes to many clients is encoded into one Frame, and the
+// same bytes are then handed to each client's outbound path.
+// A frame either owns its bytes or views bytes that owner keeps alive, e.g. a memory-mapped log segment.
+// Encode() takes the frame and its bytes from the BlockPool, so encoding on a warm thread does not allocate.
+class Frame {
+public:
+    explicit Frame(std::vector<uint8>&& data);
+    Frame(const char* data, uint32 size, std::shared_ptr<const void> owner);
+    // size bytes from the BlockPool, written by Encode()
+    explicit Frame(uint32 size);
+    ~Frame();
+
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    const char* Data() const { return m_View; }
+    uint32 Size() const { return m_Size; }
+
+    // encode a message (a Msg or a View, see message.h) into a new frame
+    template <typename Msg>
+    static FramePtr Encode(const Msg& msg) {
+        uint32 packetSize = PacketSize(msg);
+        std::shared_ptr<Frame> frame = std::allocate_shared<Frame>(PoolAllocator<Frame>{}, packetSize);
+        EncodeInto(msg, packetSize, frame->m_Block);
+        return frame;
+    }
+
+private:
+    std::vector<uint8> m_Data;
+    uint8* m_Block = nullptr;  // from the BlockPool
+    std::shared_ptr<const void> m_Owner;
+    const char* m_View;
+    uint32 m_Size;
+};
+}  // namespace network
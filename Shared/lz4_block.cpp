@@ -0,0 +1,194 @@
+#include "lz4_block.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace network {
+namespace {
+constexpr uint32 kMIN_MATCH = 4;
+constexpr uint32 kLAST_LITERALS = 5;  // a block always ends with at least this many literals
+constexpr uint32 kMF_LIMIT = 12;      // and its last match starts at least this far from the end
+constexpr uint32 kMAX_OFFSET = 65535;
+constexpr uint32 kHASH_BITS = 12;
+
+uint32 Read32(const uint8* p) {
+    uint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32 Hash(uint32 sequence) { return (sequence * 2654435761u) >> (32 - kHASH_BITS); }
+
+// a length field: 15 in the token nibble, then 255s, then the rest
+uint8* WriteLength(uint8* op, uint32 length) {
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<uint8>(length);
+    return op;
+}
+
+uint8* WriteSequence(uint8* op, const uint8* literals, uint32 literalLength, uint32 offset, uint32 matchLength) {
+    uint8* token = op++;
+    if (literalLength >= 15) {
+        *token = 15 << 4;
+        op = WriteLength(op, literalLength - 15);
+    } else {
+        *token = static_cast<uint8>(literalLength << 4);
+    }
+    memcpy(op, literals, literalLength);
+    op += literalLength;
+
+    if (matchLength == 0) {
+        // the last sequence, literals only
+        return op;
+    }
+    *op++ = static_cast<uint8>(offset);
+    *op++ = static_cast<uint8>(offset >> 8);
+    uint32 extra = matchLength - kMIN_MATCH;
+    if (extra >= 15) {
+        *token |= 15;
+        op = WriteLength(op, extra - 15);
+    } else {
+        *token |= static_cast<uint8>(extra);
+    }
+    return op;
+}
+
+// a length field's continuation bytes, false if the input runs out
+bool ReadLength(const uint8*& ip, const uint8* end, uint32& length) {
+    uint8 b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+}  // namespace
+
+uint32 Lz4Compress(std::string_view src, std::string_view dictionary, char* dst) {
+    // the dictionary only counts within a match offset of the data
+    if (dictionary.size() > kMAX_OFFSET) {
+        dictionary.remove_prefix(dictionary.size() - kMAX_OFFSET);
+    }
+
+    // dictionary and data back to back, so that matches reach into the dictionary like into earlier data
+    thread_local std::vector<uint8> window;
+    window.resize(dictionary.size() + src.size());
+    if (!dictionary.empty()) memcpy(window.data(), dictionary.data(), dictionary.size());
+    if (!src.empty()) memcpy(window.data() + dictionary.size(), src.data(), src.size());
+
+    const uint8* base = window.data();
+    const uint32 start = static_cast<uint32>(dictionary.size());
+    const uint32 end = static_cast<uint32>(window.size());
+    uint8* op = reinterpret_cast<uint8*>(dst);
+    uint32 anchor = start;
+
+    if (src.size() > kMF_LIMIT) {
+        // position + 1 of the last place each hash was seen, 0 for never
+        uint32 table[1 << kHASH_BITS] = {};
+        for (uint32 p = 0; p + kMIN_MATCH <= start; p++) {
+            table[Hash(Read32(base + p))] = p + 1;
+        }
+
+        const uint32 matchLimit = end - kLAST_LITERALS;
+        const uint32 mfLimit = end - kMF_LIMIT;
+        uint32 ip = start;
+        uint32 misses = 0;
+        while (ip < mfLimit) {
+            uint32 sequence = Read32(base + ip);
+            uint32 h = Hash(sequence);
+            uint32 candidate = table[h];
+            table[h] = ip + 1;
+
+            if (candidate == 0 || ip - (candidate - 1) > kMAX_OFFSET || Read32(base + candidate - 1) != sequence) {
+                // skip faster through data that does not compress
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            uint32 ref = candidate - 1;
+            uint32 length = kMIN_MATCH;
+            while (ip + length < matchLimit && base[ref + length] == base[ip + length]) {
+                length++;
+            }
+
+            op = WriteSequence(op, base + anchor, ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+            if (ip < mfLimit) {
+                table[Hash(Read32(base + ip - 2))] = ip - 2 + 1;
+            }
+        }
+    }
+
+    op = WriteSequence(op, base + anchor, end - anchor, 0, 0);
+    return static_cast<uint32>(op - reinterpret_cast<uint8*>(dst));
+}
+
+bool Lz4Decompress(std::string_view src, std::string_view dictionary, char* dst, uint32 dstSize) {
+    if (dictionary.size() > kMAX_OFFSET) {
+        dictionary.remove_prefix(dictionary.size() - kMAX_OFFSET);
+    }
+
+    const uint8* ip = reinterpret_cast<const uint8*>(src.data());
+    const uint8* const iend = ip + src.size();
+    uint8* op = reinterpret_cast<uint8*>(dst);
+    uint8* const ostart = op;
+    uint8* const oend = op + dstSize;
+    const uint8* const dict = reinterpret_cast<const uint8*>(dictionary.data());
+    const uint32 dictSize = static_cast<uint32>(dictionary.size());
+
+    while (true) {
+        if (ip >= iend) return false;
+        uint8 token = *ip++;
+
+        uint32 literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, iend, literalLength)) return false;
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+        if (literalLength != 0) memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == iend) {
+            // the last sequence has no match
+            return op == oend;
+        }
+
+        if (iend - ip < 2) return false;
+        uint32 offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        uint32 matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(ip, iend, matchLength)) return false;
+        matchLength += kMIN_MATCH;
+
+        uint32 produced = static_cast<uint32>(op - ostart);
+        if (offset == 0 || offset > produced + dictSize || matchLength > static_cast<size_t>(oend - op)) {
+            return false;
+        }
+
+        // the part of the match that lies in the dictionary, then the part in the output
+        if (offset > produced) {
+            uint32 fromDictionary = std::min(matchLength, offset - produced);
+            memcpy(op, dict + dictSize - (offset - produced), fromDictionary);
+            op += fromDictionary;
+            matchLength -= fromDictionary;
+        }
+        if (offset >= matchLength) {
+            memcpy(op, op - offset, matchLength);
+            op += matchLength;
+        } else {
+            // the match overlaps what it is producing, a run
+            for (uint32 i = 0; i < matchLength; i++, op++) {
+                *op = *(op - offset);
+            }
+        }
+    }
+}
+}  // namespace network
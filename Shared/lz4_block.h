@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+
+#include "common.h"
+
+namespace network {
+// The LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md),
+// a greedy single pass compressor and a bounds checked decompressor.
+//
+// A dictionary is a block of bytes both sides know in advance. It acts as if
+// it came right before the data, so matches may point back into it; short,
+// repetitive messages (room and user names) compress much better with one.
+
+// the most a block of srcSize bytes can grow to
+constexpr uint32 Lz4CompressBound(uint32 srcSize) { return srcSize + srcSize / 255 + 16; }
+
+// compress src into dst, which holds at least Lz4CompressBound(src.size()) bytes
+// returns the compressed size
+uint32 Lz4Compress(std::string_view src, std::string_view dictionary, char* dst);
+
+// decompress exactly dstSize bytes into dst
+// returns false if the block is corrupt, refers outside the dictionary, or is not exactly dstSize bytes
+bool Lz4Decompress(std::string_view src, std::string_view dictionary, char* dst, uint32 dstSize);
+}  // namespace network
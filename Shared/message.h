@@ -1,14 +1,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
 #include "common.h"
+#include "message_schema.h"
 
 namespace network {
-// forward decalaration
-class Buffer;
-
 // Naming convention:
 // prefixes:
 // C2S = client to server
@@ -32,6 +32,16 @@ enum MessageType {
     kCHAT_IN_ROOM_REQ = 1009,
     kCHAT_IN_ROOM_ACK = 1010,
     kCHAT_IN_ROOM_NTF = 1011,
+    kBATCH_REQ = 1012,
+    kCOMPRESSED = 1013,
+    kROSTER_REQ = 1014,
+    kROSTER_ACK = 1015,
+    kHISTORY_REQ = 1016,
+    kHISTORY_ACK = 1017,
+    kPING = 1018,
+    kPONG = 1019,
+    kRESUME_REQ = 1020,
+    kRESUME_ACK = 1021,
 };
 
 // The message status code
@@ -41,148 +51,393 @@ enum MessageStatus {
     kERROR = 500,
 };
 
-// The fixed-length packet header
-struct PacketHeader {
-    uint32 packetSize;
-    uint32 messageType;
+// Optional protocol features
+// the client asks for the ones it supports in its login request, the server's login ack grants the ones it uses
+enum Feature {
+    kFEATURE_LZ4 = 1 << 0,  // large server packets may come as S2C_Compressed, see compression.h
+};
+
+// What the roster fields of a S2C_JoinRoomAck or S2C_RosterAck hold
+// Every membership change bumps the room's roster version. A client that has
+// the roster at some version gets only the changes since; one that has none,
+// or is too far behind, pages through the members and then asks for the
+// changes since the version of the first page.
+enum RosterKind {
+    kROSTER_PAGE = 1,   // userNames are members from the cursor on, nextCursor is where the next page starts (0: done)
+    kROSTER_DELTA = 2,  // userNames joined and leftUserNames left since the version asked for
+};
+
+// Upper bound of a packet, anything larger is treated as a corrupt stream
+constexpr uint32 kMAX_PACKET_SIZE = 1024 * 1024;
+
+// Upper bounds of a user name and of a chat's text, a login or a chat over them is failed
+// so that a S2C_ChatInRoomNtf always fits a S2C_HistoryAck of its own, and a log segment
+constexpr uint32 kMAX_NAME_SIZE = 256;
+constexpr uint32 kMAX_CHAT_SIZE = 64 * 1024;
+
+// Variable length fields of a message
+// A Msg owns its strings, a View points into a received packet and is only
+// valid as long as those bytes are (see Decode() in message_schema.h).
+struct OwnedFields {
+    typedef std::string String;
+    typedef std::vector<std::string> StringList;
 };
 
-// the Message (aka. protocol) base class
-struct Message {
-    PacketHeader header;
-    virtual void Serialize(Buffer& buf);
+struct ViewFields {
+    typedef std::string_view String;
+    typedef StringListView StringList;
+};
+
+// to encode a list of strings that are not laid out one after the other, e.g. frames of other packets,
+// or names that live elsewhere
+struct GatherFields {
+    typedef std::string_view String;
+    typedef std::vector<std::string_view> StringList;
 };
 
 // Login req message
-struct C2S_LoginReqMsg : public Message {
-    uint32 userNameLength;
-    std::string userName;
-    uint32 passwordLength;
-    std::string password;
+template <typename F>
+struct LoginReq {
+    static constexpr MessageType kTYPE = MessageType::kLOGIN_REQ;
+    typename F::String userName;
+    typename F::String password;
+    uint32 features;  // Feature flags the client supports
 
-    C2S_LoginReqMsg(const std::string& strUserName, const std::string& strPassword);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&LoginReq::userName, &LoginReq::password, &LoginReq::features);
+    }
 };
+typedef LoginReq<OwnedFields> C2S_LoginReqMsg;
+typedef LoginReq<ViewFields> C2S_LoginReqView;
 
 // Login ack message
-struct S2C_LoginAckMsg : public Message {
+template <typename F>
+struct LoginAck {
+    static constexpr MessageType kTYPE = MessageType::kLOGIN_ACK;
     uint16 loginStatus;
-    uint32 roomListLength;
-    std::vector<uint32> roomNameLengths;
-    std::vector<std::string> roomNames;
+    typename F::StringList roomNames;
+    uint32 features;                 // Feature flags granted for the rest of the connection
+    typename F::String resumeToken;  // for a C2S_ResumeReq after a reconnect, empty if sessions are not kept
 
-    S2C_LoginAckMsg(uint16 iStatus, const std::vector<std::string>& vecRoomNames);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&LoginAck::loginStatus, &LoginAck::roomNames, &LoginAck::features,
+                               &LoginAck::resumeToken);
+    }
 };
+typedef LoginAck<OwnedFields> S2C_LoginAckMsg;
+typedef LoginAck<ViewFields> S2C_LoginAckView;
+typedef LoginAck<GatherFields> S2C_LoginAckGather;
 
 // JoinRoom req message
-struct C2S_JoinRoomReqMsg : public Message {
-    uint32 userNameLength;
-    std::string userName;
-    uint32 roomNameLength;
-    std::string roomName;
+template <typename F>
+struct JoinRoomReq {
+    static constexpr MessageType kTYPE = MessageType::kJOIN_ROOM_REQ;
+    typename F::String userName;
+    typename F::String roomName;
+    uint32 rosterVersion;  // of the roster the client already has for the room, 0 for none
 
-    C2S_JoinRoomReqMsg(const std::string& strUserName, const std::string& strRoomName);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&JoinRoomReq::userName, &JoinRoomReq::roomName, &JoinRoomReq::rosterVersion);
+    }
 };
+typedef JoinRoomReq<OwnedFields> C2S_JoinRoomReqMsg;
+typedef JoinRoomReq<ViewFields> C2S_JoinRoomReqView;
 
 // JoinRoom ack message
-struct S2C_JoinRoomAckMsg : public Message {
+template <typename F>
+struct JoinRoomAck {
+    static constexpr MessageType kTYPE = MessageType::kJOIN_ROOM_ACK;
     uint16 joinStatus;
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userListLength;
-    std::vector<uint32> userNameLengths;
-    std::vector<std::string> userNames;
+    typename F::String roomName;
+    typename F::StringList userNames;
+    typename F::StringList leftUserNames;
+    uint32 rosterVersion;
+    uint16 rosterKind;  // RosterKind
+    uint32 nextCursor;
 
-    S2C_JoinRoomAckMsg(uint16 iStatus, const std::string& strRoomName, const std::vector<std::string>& vecUserNames);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&JoinRoomAck::joinStatus, &JoinRoomAck::roomName, &JoinRoomAck::userNames,
+                               &JoinRoomAck::leftUserNames, &JoinRoomAck::rosterVersion, &JoinRoomAck::rosterKind,
+                               &JoinRoomAck::nextCursor);
+    }
 };
+typedef JoinRoomAck<OwnedFields> S2C_JoinRoomAckMsg;
+typedef JoinRoomAck<ViewFields> S2C_JoinRoomAckView;
+typedef JoinRoomAck<GatherFields> S2C_JoinRoomAckGather;
 
 // JoinRoom ntf message
 // to broadcast the event that someone has joined the room
-struct S2C_JoinRoomNtfMsg : public Message {
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
+template <typename F>
+struct JoinRoomNtf {
+    static constexpr MessageType kTYPE = MessageType::kJOIN_ROOM_NTF;
+    typename F::String roomName;
+    typename F::String userName;
+    uint32 rosterVersion;  // the room's roster version with the join in it
 
-    S2C_JoinRoomNtfMsg(const std::string& strRoomName, const std::string& strUserName);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&JoinRoomNtf::roomName, &JoinRoomNtf::userName, &JoinRoomNtf::rosterVersion);
+    }
 };
+typedef JoinRoomNtf<OwnedFields> S2C_JoinRoomNtfMsg;
+typedef JoinRoomNtf<ViewFields> S2C_JoinRoomNtfView;
 
 // LeaveRoom req message
-struct C2S_LeaveRoomReqMsg : public Message {
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
+template <typename F>
+struct LeaveRoomReq {
+    static constexpr MessageType kTYPE = MessageType::kLEAVE_ROOM_REQ;
+    typename F::String roomName;
+    typename F::String userName;
 
-    C2S_LeaveRoomReqMsg(const std::string& strRoomName, const std::string& strUserName);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() { return std::make_tuple(&LeaveRoomReq::roomName, &LeaveRoomReq::userName); }
 };
+typedef LeaveRoomReq<OwnedFields> C2S_LeaveRoomReqMsg;
+typedef LeaveRoomReq<ViewFields> C2S_LeaveRoomReqView;
 
 // LeaveRoom ack message
-struct S2C_LeaveRoomAckMsg : public Message {
+template <typename F>
+struct LeaveRoomAck {
+    static constexpr MessageType kTYPE = MessageType::kLEAVE_ROOM_ACK;
     uint16 leaveStatus;
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
+    typename F::String roomName;
+    typename F::String userName;
 
-    S2C_LeaveRoomAckMsg(uint16 iStatus, const std::string& strRoomName, const std::string& strUserName);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&LeaveRoomAck::leaveStatus, &LeaveRoomAck::roomName, &LeaveRoomAck::userName);
+    }
 };
+typedef LeaveRoomAck<OwnedFields> S2C_LeaveRoomAckMsg;
+typedef LeaveRoomAck<ViewFields> S2C_LeaveRoomAckView;
 
 // LeaveRoom ntf message
 // to broadcast the event that someone has left the room
-struct S2C_LeaveRoomNtfMsg : public Message {
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
+template <typename F>
+struct LeaveRoomNtf {
+    static constexpr MessageType kTYPE = MessageType::kLEAVE_ROOM_NTF;
+    typename F::String roomName;
+    typename F::String userName;
+    uint32 rosterVersion;  // the room's roster version with the leave in it
 
-    S2C_LeaveRoomNtfMsg(const std::string& strRoomName, const std::string& strUserName);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&LeaveRoomNtf::roomName, &LeaveRoomNtf::userName, &LeaveRoomNtf::rosterVersion);
+    }
 };
+typedef LeaveRoomNtf<OwnedFields> S2C_LeaveRoomNtfMsg;
+typedef LeaveRoomNtf<ViewFields> S2C_LeaveRoomNtfView;
 
 // ChatInRoom req message
-struct C2S_ChatInRoomReqMsg : public Message {
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
-    uint32 chatLength;
-    std::string chat;
+template <typename F>
+struct ChatInRoomReq {
+    static constexpr MessageType kTYPE = MessageType::kCHAT_IN_ROOM_REQ;
+    typename F::String roomName;
+    typename F::String userName;
+    typename F::String chat;
 
-    C2S_ChatInRoomReqMsg(const std::string& strRoomName, const std::string& strUserName, const std::string& strChat);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&ChatInRoomReq::roomName, &ChatInRoomReq::userName, &ChatInRoomReq::chat);
+    }
 };
+typedef ChatInRoomReq<OwnedFields> C2S_ChatInRoomReqMsg;
+typedef ChatInRoomReq<ViewFields> C2S_ChatInRoomReqView;
 
 // ChatInRoom ack message
-struct S2C_ChatInRoomAckMsg : public Message {
+template <typename F>
+struct ChatInRoomAck {
+    static constexpr MessageType kTYPE = MessageType::kCHAT_IN_ROOM_ACK;
     uint16 chatStatus;
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
+    typename F::String roomName;
+    typename F::String userName;
 
-    S2C_ChatInRoomAckMsg(uint16 iStatus, const std::string& strRoomName, const std::string& strUserName);
-    void Serialize(Buffer& buf) override;
+    static constexpr auto Fields() {
+        return std::make_tuple(&ChatInRoomAck::chatStatus, &ChatInRoomAck::roomName, &ChatInRoomAck::userName);
+    }
 };
+typedef ChatInRoomAck<OwnedFields> S2C_ChatInRoomAckMsg;
+typedef ChatInRoomAck<ViewFields> S2C_ChatInRoomAckView;
 
 // ChatInRoom ntf message
-// to broadcast someone's chat in a room
-struct S2C_ChatInRoomNtfMsg : public Message {
-    uint32 roomNameLength;
-    std::string roomName;
-    uint32 userNameLength;
-    std::string userName;
-    uint32 chatLength;
-    std::string chat;
-
-    S2C_ChatInRoomNtfMsg(const std::string& strRoomName, const std::string& strUserName, const std::string& strChat);
-    void Serialize(Buffer& buf) override;
+// to broadcast someone's chat in a room, seq numbers the room's chats from 1 on
+template <typename F>
+struct ChatInRoomNtf {
+    static constexpr MessageType kTYPE = MessageType::kCHAT_IN_ROOM_NTF;
+    typename F::String roomName;
+    typename F::String userName;
+    typename F::String chat;
+    uint32 seq;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&ChatInRoomNtf::roomName, &ChatInRoomNtf::userName, &ChatInRoomNtf::chat,
+                               &ChatInRoomNtf::seq);
+    }
+};
+typedef ChatInRoomNtf<OwnedFields> S2C_ChatInRoomNtfMsg;
+typedef ChatInRoomNtf<ViewFields> S2C_ChatInRoomNtfView;
+
+// Batch req message
+// several requests in one packet, each element a whole encoded request (header included)
+// the server handles them in order as if they had arrived one by one, a batch cannot hold a batch
+// and a login in one is failed, its verdict would come after the rest
+template <typename F>
+struct BatchReq {
+    static constexpr MessageType kTYPE = MessageType::kBATCH_REQ;
+    typename F::StringList packets;
+
+    static constexpr auto Fields() { return std::make_tuple(&BatchReq::packets); }
+};
+typedef BatchReq<OwnedFields> C2S_BatchReqMsg;
+typedef BatchReq<ViewFields> C2S_BatchReqView;
+
+// Compressed message
+// a whole server packet (header included) compressed with codec, sent in its place to clients granted kFEATURE_LZ4
+template <typename F>
+struct Compressed {
+    static constexpr MessageType kTYPE = MessageType::kCOMPRESSED;
+    uint16 codec;         // Codec in compression.h
+    uint32 originalSize;  // of the packet, header included
+    typename F::String data;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&Compressed::codec, &Compressed::originalSize, &Compressed::data);
+    }
+};
+typedef Compressed<OwnedFields> S2C_CompressedMsg;
+typedef Compressed<ViewFields> S2C_CompressedView;
+
+// Roster req message
+// the next page of a room's roster (cursor from the last page), or with cursor 0 the changes since sinceVersion
+template <typename F>
+struct RosterReq {
+    static constexpr MessageType kTYPE = MessageType::kROSTER_REQ;
+    typename F::String roomName;
+    uint32 sinceVersion;
+    uint32 cursor;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&RosterReq::roomName, &RosterReq::sinceVersion, &RosterReq::cursor);
+    }
+};
+typedef RosterReq<OwnedFields> C2S_RosterReqMsg;
+typedef RosterReq<ViewFields> C2S_RosterReqView;
+
+// Roster ack message
+// the roster fields are the same as S2C_JoinRoomAck's
+template <typename F>
+struct RosterAck {
+    static constexpr MessageType kTYPE = MessageType::kROSTER_ACK;
+    uint16 rosterStatus;
+    typename F::String roomName;
+    typename F::StringList userNames;
+    typename F::StringList leftUserNames;
+    uint32 rosterVersion;
+    uint16 rosterKind;  // RosterKind
+    uint32 nextCursor;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&RosterAck::rosterStatus, &RosterAck::roomName, &RosterAck::userNames,
+                               &RosterAck::leftUserNames, &RosterAck::rosterVersion, &RosterAck::rosterKind,
+                               &RosterAck::nextCursor);
+    }
+};
+typedef RosterAck<OwnedFields> S2C_RosterAckMsg;
+typedef RosterAck<ViewFields> S2C_RosterAckView;
+typedef RosterAck<GatherFields> S2C_RosterAckGather;
+
+// History req message
+// a room's chats after afterSeq, or with afterSeq 0 its last ones, count at most
+template <typename F>
+struct HistoryReq {
+    static constexpr MessageType kTYPE = MessageType::kHISTORY_REQ;
+    typename F::String roomName;
+    uint32 afterSeq;
+    uint32 count;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&HistoryReq::roomName, &HistoryReq::afterSeq, &HistoryReq::count);
+    }
+};
+typedef HistoryReq<OwnedFields> C2S_HistoryReqMsg;
+typedef HistoryReq<ViewFields> C2S_HistoryReqView;
+
+// History ack message
+// packets are whole S2C_ChatInRoomNtf packets (header included), oldest first
+// the server keeps the chats from oldestSeq on (0 if none), older ones are gone; newestSeq is the last chat
+// the ack covers, the newest kept unless the rest would not fit in one packet, then ask again after it
+template <typename F>
+struct HistoryAck {
+    static constexpr MessageType kTYPE = MessageType::kHISTORY_ACK;
+    uint16 historyStatus;
+    typename F::String roomName;
+    uint32 oldestSeq;
+    uint32 newestSeq;
+    typename F::StringList packets;
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&HistoryAck::historyStatus, &HistoryAck::roomName, &HistoryAck::oldestSeq,
+                               &HistoryAck::newestSeq, &HistoryAck::packets);
+    }
+};
+typedef HistoryAck<OwnedFields> S2C_HistoryAckMsg;
+typedef HistoryAck<ViewFields> S2C_HistoryAckView;
+typedef HistoryAck<GatherFields> S2C_HistoryAckGather;
+
+// Ping message
+// either side may send one, the other answers with a Pong carrying the same sequence
+// the server pings a client it has not heard from in a while, and disconnects it if the silence goes on
+template <typename F>
+struct Ping {
+    static constexpr MessageType kTYPE = MessageType::kPING;
+    uint32 sequence;
+
+    static constexpr auto Fields() { return std::make_tuple(&Ping::sequence); }
+};
+typedef Ping<OwnedFields> C2S_PingMsg;
+typedef Ping<OwnedFields> S2C_PingMsg;
+
+// Pong message
+// the answer to a Ping
+template <typename F>
+struct Pong {
+    static constexpr MessageType kTYPE = MessageType::kPONG;
+    uint32 sequence;  // the Ping's
+
+    static constexpr auto Fields() { return std::make_tuple(&Pong::sequence); }
+};
+typedef Pong<OwnedFields> C2S_PongMsg;
+typedef Pong<OwnedFields> S2C_PongMsg;
+
+// Resume req message
+// sent instead of a login by a client that lost its connection, with the token of its last login or resume ack
+// within the server's grace window the user is back in its rooms as it was, and no member sees it leave or join
+template <typename F>
+struct ResumeReq {
+    static constexpr MessageType kTYPE = MessageType::kRESUME_REQ;
+    typename F::String userName;
+    typename F::String resumeToken;
+    uint32 features;  // Feature flags the client supports, as in a login
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&ResumeReq::userName, &ResumeReq::resumeToken, &ResumeReq::features);
+    }
+};
+typedef ResumeReq<OwnedFields> C2S_ResumeReqMsg;
+typedef ResumeReq<ViewFields> C2S_ResumeReqView;
+
+// Resume ack message
+// on a failure (unknown or expired token) the client logs in again
+template <typename F>
+struct ResumeAck {
+    static constexpr MessageType kTYPE = MessageType::kRESUME_ACK;
+    uint16 resumeStatus;
+    typename F::StringList roomNames;  // the rooms the user is back in
+    uint32 features;                   // Feature flags granted for the rest of the connection
+    typename F::String resumeToken;    // for the next resume, the one resumed by is no good any more
+
+    static constexpr auto Fields() {
+        return std::make_tuple(&ResumeAck::resumeStatus, &ResumeAck::roomNames, &ResumeAck::features,
+                               &ResumeAck::resumeToken);
+    }
 };
+typedef ResumeAck<OwnedFields> S2C_ResumeAckMsg;
+typedef ResumeAck<ViewFields> S2C_ResumeAckView;
+typedef ResumeAck<GatherFields> S2C_ResumeAckGather;
 
 }  // end of namespace network
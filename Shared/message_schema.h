@@ -0,0 +1,257 @@
+#pragma once
+
+#include <string.h>
+
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "common.h"
+
+namespace network {
+// Message schema
+//
+// A message struct lists its fields once, as a constexpr tuple of member
+// pointers returned by a static Fields(), and names its MessageType in kTYPE:
+//
+//     struct PingMsg {
+//         static constexpr MessageType kTYPE = MessageType::kPING;
+//         uint32 sequence;
+//         static constexpr auto Fields() { return std::make_tuple(&PingMsg::sequence); }
+//     };
+//
+// PacketSize(), Encode() and Decode() are generated from that list, in field
+// order, so the encoder and the decoder cannot disagree and nothing goes
+// through a virtual call. A field is a uint16, a uint32, a string
+// (std::string or std::string_view) or a string list (std::vector<std::string>,
+// StringListView, or std::vector<std::string_view> for strings scattered in memory).
+
+// The fixed-length packet header
+struct PacketHeader {
+    uint32 packetSize;
+    uint32 messageType;
+};
+
+inline uint32 LoadUInt32LE(const char* p) {
+    const uint8* b = reinterpret_cast<const uint8*>(p);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<uint32>(b[3]) << 24);
+}
+
+// A list of strings as laid out on the wire: count, count lengths, then the strings back to back
+class StringListView {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        Iterator(const char* length, const char* str) : m_Length(length), m_Str(str) {}
+
+        std::string_view operator*() const { return std::string_view{m_Str, LoadUInt32LE(m_Length)}; }
+        Iterator& operator++() {
+            m_Str += LoadUInt32LE(m_Length);
+            m_Length += sizeof(uint32);
+            return *this;
+        }
+        bool operator==(const Iterator& other) const { return m_Length == other.m_Length; }
+        bool operator!=(const Iterator& other) const { return m_Length != other.m_Length; }
+
+    private:
+        const char* m_Length;  // the current string's length
+        const char* m_Str;     // the current string
+    };
+
+    StringListView() = default;
+    StringListView(uint32 count, const char* lengths, const char* strings, uint32 stringBytes)
+        : m_Count(count), m_Lengths(lengths), m_Strings(strings), m_StringBytes(stringBytes) {}
+
+    uint32 Count() const { return m_Count; }
+    // total size of the strings, lengths excluded
+    uint32 StringBytes() const { return m_StringBytes; }
+    Iterator begin() const { return Iterator{m_Lengths, m_Strings}; }
+    Iterator end() const { return Iterator{m_Lengths + m_Count * sizeof(uint32), nullptr}; }
+
+private:
+    uint32 m_Count = 0;
+    const char* m_Lengths = nullptr;
+    const char* m_Strings = nullptr;
+    uint32 m_StringBytes = 0;
+};
+
+// Bounds checked reads over a message body
+class WireReader {
+public:
+    WireReader(const char* data, uint32 size) : m_Cur(data), m_End(data + size) {}
+
+    bool Read(uint16& value) {
+        if (Remaining() < sizeof(uint16)) return false;
+        const uint8* b = reinterpret_cast<const uint8*>(m_Cur);
+        value = static_cast<uint16>(b[0] | (b[1] << 8));
+        m_Cur += sizeof(uint16);
+        return true;
+    }
+
+    bool Read(uint32& value) {
+        if (Remaining() < sizeof(uint32)) return false;
+        value = LoadUInt32LE(m_Cur);
+        m_Cur += sizeof(uint32);
+        return true;
+    }
+
+    // a length-prefixed string, pointing into the body
+    bool Read(std::string_view& str) {
+        uint32 len = 0;
+        if (!Read(len) || Remaining() < len) return false;
+        str = std::string_view{m_Cur, len};
+        m_Cur += len;
+        return true;
+    }
+
+    bool Read(std::string& str) {
+        std::string_view view;
+        if (!Read(view)) return false;
+        str.assign(view.data(), view.size());
+        return true;
+    }
+
+    bool Read(StringListView& list) {
+        uint32 count = 0;
+        if (!Read(count) || Remaining() / sizeof(uint32) < count) return false;
+        const char* lengths = m_Cur;
+        m_Cur += count * sizeof(uint32);
+
+        uint64 total = 0;
+        for (uint32 i = 0; i < count; i++) {
+            total += LoadUInt32LE(lengths + i * sizeof(uint32));
+        }
+        if (Remaining() < total) return false;
+        list = StringListView{count, lengths, m_Cur, static_cast<uint32>(total)};
+        m_Cur += total;
+        return true;
+    }
+
+    template <typename Str>
+    bool Read(std::vector<Str>& list) {
+        StringListView view;
+        if (!Read(view)) return false;
+        list.assign(view.begin(), view.end());
+        return true;
+    }
+
+private:
+    size_t Remaining() const { return static_cast<size_t>(m_End - m_Cur); }
+
+    const char* m_Cur;
+    const char* m_End;
+};
+
+// Unchecked writes into memory sized with PacketSize()
+class WireWriter {
+public:
+    explicit WireWriter(uint8* out) : m_Cur(out) {}
+
+    void Write(uint16 value) {
+        m_Cur[0] = static_cast<uint8>(value);
+        m_Cur[1] = static_cast<uint8>(value >> 8);
+        m_Cur += sizeof(uint16);
+    }
+
+    void Write(uint32 value) {
+        m_Cur[0] = static_cast<uint8>(value);
+        m_Cur[1] = static_cast<uint8>(value >> 8);
+        m_Cur[2] = static_cast<uint8>(value >> 16);
+        m_Cur[3] = static_cast<uint8>(value >> 24);
+        m_Cur += sizeof(uint32);
+    }
+
+    void Write(std::string_view str) {
+        Write(static_cast<uint32>(str.size()));
+        WriteBytes(str);
+    }
+
+    template <typename Str>
+    void Write(const std::vector<Str>& list) {
+        Write(static_cast<uint32>(list.size()));
+        for (const Str& str : list) {
+            Write(static_cast<uint32>(str.size()));
+        }
+        for (const Str& str : list) {
+            WriteBytes(str);
+        }
+    }
+
+    void Write(const StringListView& list) {
+        Write(list.Count());
+        for (std::string_view str : list) {
+            Write(static_cast<uint32>(str.size()));
+        }
+        for (std::string_view str : list) {
+            WriteBytes(str);
+        }
+    }
+
+private:
+    void WriteBytes(std::string_view str) {
+        if (!str.empty()) {
+            memcpy(m_Cur, str.data(), str.size());
+        }
+        m_Cur += str.size();
+    }
+
+    uint8* m_Cur;
+};
+
+// wire size of each kind of field
+inline uint32 FieldSize(uint16) { return sizeof(uint16); }
+inline uint32 FieldSize(uint32) { return sizeof(uint32); }
+inline uint32 FieldSize(std::string_view str) { return sizeof(uint32) + static_cast<uint32>(str.size()); }
+inline uint32 FieldSize(const StringListView& list) {
+    return sizeof(uint32) + list.Count() * sizeof(uint32) + list.StringBytes();
+}
+template <typename Str>
+uint32 FieldSize(const std::vector<Str>& list) {
+    uint32 size = sizeof(uint32);
+    for (const Str& str : list) {
+        size += sizeof(uint32) + static_cast<uint32>(str.size());
+    }
+    return size;
+}
+
+// size of the whole packet, header included
+template <typename Msg>
+uint32 PacketSize(const Msg& msg) {
+    return std::apply(
+        [&msg](auto... fields) { return (static_cast<uint32>(sizeof(PacketHeader)) + ... + FieldSize(msg.*fields)); },
+        Msg::Fields());
+}
+
+// encode the whole packet into out, which holds at least packetSize bytes
+template <typename Msg>
+void EncodeInto(const Msg& msg, uint32 packetSize, uint8* out) {
+    WireWriter writer{out};
+    writer.Write(packetSize);
+    writer.Write(static_cast<uint32>(Msg::kTYPE));
+    std::apply([&msg, &writer](auto... fields) { (writer.Write(msg.*fields), ...); }, Msg::Fields());
+}
+
+template <typename Msg>
+std::vector<uint8> Encode(const Msg& msg) {
+    uint32 packetSize = PacketSize(msg);
+    std::vector<uint8> packet(packetSize);
+    EncodeInto(msg, packetSize, packet.data());
+    return packet;
+}
+
+// decode a message body (the bytes after the PacketHeader)
+// every length is checked against the body, a truncated packet returns false, trailing bytes are ignored
+template <typename Msg>
+bool Decode(const char* body, uint32 size, Msg& msg) {
+    WireReader reader{body, size};
+    return std::apply([&msg, &reader](auto... fields) { return (reader.Read(msg.*fields) && ...); }, Msg::Fields());
+}
+}  // namespace network
@@ -0,0 +1,76 @@
+#include "ring_buffer.h"
+
+#include <string.h>
+
+namespace network {
+
+static uint32 RoundUpPowerOfTwo(uint32 value) {
+    uint32 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+RingBuffer::RingBuffer(uint32 capacity) : m_Head(0), m_Tail(0) { m_Data.resize(RoundUpPowerOfTwo(capacity)); }
+
+char* RingBuffer::WritePtr() { return &m_Data[m_Tail & Mask()]; }
+
+uint32 RingBuffer::WritableSize() const {
+    uint32 free = Capacity() - ReadableSize();
+    uint32 untilEnd = Capacity() - (m_Tail & Mask());
+    return free < untilEnd ? free : untilEnd;
+}
+
+void RingBuffer::Commit(uint32 len) { m_Tail += len; }
+
+bool RingBuffer::PeekUInt32LE(uint32 offset, uint32& value) const {
+    if (ReadableSize() < offset + 4) {
+        return false;
+    }
+    value = 0;
+    for (uint32 i = 0; i < 4; i++) {
+        value |= static_cast<uint32>(static_cast<uint8>(m_Data[(m_Head + offset + i) & Mask()])) << (8 * i);
+    }
+    return true;
+}
+
+const char* RingBuffer::Contiguous(uint32 len) {
+    uint32 start = m_Head & Mask();
+    if (start + len <= Capacity()) {
+        return &m_Data[start];
+    }
+
+    // the packet wraps around the end of the ring, copy it out in two pieces
+    uint32 firstPart = Capacity() - start;
+    if (m_Scratch.size() < len) {
+        m_Scratch.resize(len);
+    }
+    memcpy(m_Scratch.data(), &m_Data[start], firstPart);
+    memcpy(m_Scratch.data() + firstPart, &m_Data[0], len - firstPart);
+    return m_Scratch.data();
+}
+
+void RingBuffer::Consume(uint32 len) {
+    m_Head += len;
+    if (m_Head == m_Tail) {
+        // empty, rewind so the next recv gets the largest contiguous block
+        m_Head = m_Tail = 0;
+    }
+}
+
+void RingBuffer::Reserve(uint32 len) {
+    if (len <= Capacity()) {
+        return;
+    }
+
+    uint32 readable = ReadableSize();
+    std::vector<char> newData(RoundUpPowerOfTwo(len));
+    if (readable > 0) {
+        memcpy(newData.data(), Contiguous(readable), readable);
+    }
+    m_Data.swap(newData);
+    m_Head = 0;
+    m_Tail = readable;
+}
+}  // namespace network
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "common.h"
+
+namespace network {
+// A growable byte ring used to reassemble a TCP stream into packets.
+//
+// Bytes are appended straight into the free space at the tail (recv() into
+// WritePtr(), then Commit()), and whole packets are taken off the head once
+// enough bytes have arrived. Leftovers stay in the ring until the next read.
+class RingBuffer {
+public:
+    explicit RingBuffer(uint32 capacity = 4096);
+
+    // number of bytes waiting to be consumed
+    uint32 ReadableSize() const { return m_Tail - m_Head; }
+    // total size of the ring
+    uint32 Capacity() const { return static_cast<uint32>(m_Data.size()); }
+
+    // contiguous free space at the tail, 0 if and only if the ring is full
+    char* WritePtr();
+    uint32 WritableSize() const;
+    // mark len bytes written at WritePtr() as readable
+    void Commit(uint32 len);
+
+    // read a little-endian uint32 at offset from the head without consuming it
+    bool PeekUInt32LE(uint32 offset, uint32& value) const;
+    // the first len readable bytes as one contiguous block, valid until the next non-const call
+    const char* Contiguous(uint32 len);
+    // drop len bytes from the head
+    void Consume(uint32 len);
+
+    // grow (to a power of two) so that at least len bytes fit, keeps the readable bytes
+    void Reserve(uint32 len);
+
+private:
+    uint32 Mask() const { return Capacity() - 1; }
+
+private:
+    std::vector<char> m_Data;     // power of two sized storage
+    std::vector<char> m_Scratch;  // linearized copy of a packet that wraps around the end
+    uint32 m_Head;                // free running read index
+    uint32 m_Tail;                // free running write index
+};
+}  // namespace network
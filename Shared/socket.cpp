@@ -0,0 +1,93 @@
+#include "socket.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/uio.h>
+#endif
+
+namespace network {
+
+int StartupSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData);
+#else
+    // a peer closing its end must not kill the whole process on the next send
+    signal(SIGPIPE, SIG_IGN);
+    return 0;
+#endif
+}
+
+void CleanupSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int LastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool IsWouldBlock(int error) {
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+int SetNonBlocking(SOCKET socket) {
+#ifdef _WIN32
+    u_long nonBlock = 1;
+    return ioctlsocket(socket, FIONBIO, &nonBlock);
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags == -1) {
+        return SOCKET_ERROR;
+    }
+    return fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+int CloseSocket(SOCKET socket) {
+#ifdef _WIN32
+    return closesocket(socket);
+#else
+    return close(socket);
+#endif
+}
+
+int SendVectored(SOCKET socket, const IoSlice* slices, uint32 count) {
+    if (count > kMAX_IO_SLICES) {
+        count = kMAX_IO_SLICES;
+    }
+#ifdef _WIN32
+    WSABUF buffers[kMAX_IO_SLICES];
+    for (uint32 i = 0; i < count; i++) {
+        buffers[i].buf = const_cast<char*>(slices[i].data);
+        buffers[i].len = slices[i].len;
+    }
+    DWORD bytesSent = 0;
+    if (WSASend(socket, buffers, count, &bytesSent, 0, NULL, NULL) == SOCKET_ERROR) {
+        return SOCKET_ERROR;
+    }
+    return (int)bytesSent;
+#else
+    struct iovec buffers[kMAX_IO_SLICES];
+    for (uint32 i = 0; i < count; i++) {
+        buffers[i].iov_base = const_cast<char*>(slices[i].data);
+        buffers[i].iov_len = slices[i].len;
+    }
+    struct msghdr msg = {};
+    msg.msg_iov = buffers;
+    msg.msg_iovlen = count;
+    return (int)sendmsg(socket, &msg, MSG_NOSIGNAL);
+#endif
+}
+}  // namespace network
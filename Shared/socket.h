@@ -0,0 +1,58 @@
+#pragma once
+
+// A thin portability layer over Winsock and BSD sockets, so the networking
+// code can be written once and built on both Windows and Linux hosts.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Winsock names, so that the rest of the code does not need to care
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_SEND SHUT_WR
+#endif
+
+#include "common.h"
+
+namespace network {
+// One block of a gather write
+struct IoSlice {
+    const char* data;
+    uint32 len;
+};
+
+// WSAStartup on Windows, no-op elsewhere
+int StartupSockets();
+
+// WSACleanup on Windows, no-op elsewhere
+void CleanupSockets();
+
+// WSAGetLastError on Windows, errno elsewhere
+int LastSocketError();
+
+// true if the error means "try again later" on a non-blocking socket
+bool IsWouldBlock(int error);
+
+// switch the socket to non-blocking mode
+int SetNonBlocking(SOCKET socket);
+
+// closesocket on Windows, close elsewhere
+int CloseSocket(SOCKET socket);
+
+// send several blocks with one system call (WSASend / sendmsg)
+// returns the number of bytes sent, which may be less than the total, or SOCKET_ERROR
+int SendVectored(SOCKET socket, const IoSlice* slices, uint32 count);
+
+// the most slices SendVectored takes at once
+constexpr uint32 kMAX_IO_SLICES = 64;
+}  // namespace network
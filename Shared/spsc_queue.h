@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+
+// A bounded lock-free single-producer single-consumer queue.
+//
+// One thread pushes and one thread pops, neither ever takes a lock or
+// allocates: the items live in a power of two ring, and each side keeps the
+// index it owns on its own cache line, next to a cached copy of the other
+// side's, so the shared lines are only touched when the cache runs out.
+template <typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(uint32 capacity) {
+        uint32 size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_Slots.resize(size);
+        m_Mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer side, returns false (and leaves value alone) if the queue is full
+    bool TryPush(T&& value) {
+        uint32 tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_CachedHead == m_Slots.size()) {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail - m_CachedHead == m_Slots.size()) {
+                return false;
+            }
+        }
+        m_Slots[tail & m_Mask] = std::move(value);
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, returns false if the queue is empty
+    bool TryPop(T& value) {
+        uint32 head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_CachedTail) {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head == m_CachedTail) {
+                return false;
+            }
+        }
+        value = std::move(m_Slots[head & m_Mask]);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // either side, only a snapshot while the other side is running
+    bool Empty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t kCACHE_LINE = 64;
+
+    std::vector<T> m_Slots;
+    uint32 m_Mask = 0;
+
+    // consumer
+    alignas(kCACHE_LINE) std::atomic<uint32> m_Head{0};  // free running index of the next item to pop
+    uint32 m_CachedTail = 0;
+
+    // producer
+    alignas(kCACHE_LINE) std::atomic<uint32> m_Tail{0};  // free running index of the next free slot
+    uint32 m_CachedHead = 0;
+};